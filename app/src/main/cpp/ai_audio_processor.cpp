@@ -1,36 +1,36 @@
 #include "ai_audio_processor.h"
+#include "audio_engine.h"
 #include "audio_engine_components.h"
 #include "spatial_audio_bridge.h"
 #include <algorithm>
-
 #include <cmath>
-#include <mutex>
-
-static AudioSignalStats g_latestStats = {0.0f, 0.0f};
-static std::mutex g_statsMutex;
 
 void AIAudioProcessor::applyState(const AIAudioState& state) {
+    applyState(getDefaultEngine(), state);
+}
+
+void AIAudioProcessor::applyState(AudioEngine& engine, const AIAudioState& state) {
     // 1. Apply EQ
-    getEngineEqualizer().setEnabled(state.eqEnabled);
+    engine.equalizer().setEnabled(state.eqEnabled);
     for (int i = 0; i < 10; ++i) {
-        getEngineEqualizer().setBandGain(i, state.eqBands[i]);
+        engine.equalizer().setBandGain(i, state.eqBands[i]);
     }
 
     // 2. Apply Bass Boost
-    getEngineBassBoost().setStrength(state.bassBoost);
+    engine.bassBoost().setStrength(state.bassBoost);
 
     // 3. Apply Virtualizer
-    getEngineVirtualizer().setStrength(state.virtualizer);
+    engine.virtualizer().setStrength(state.virtualizer);
 
     // 4. Apply Spatializer
-    getEngineSpatializer().setEnabled(state.spatialEnabled);
+    engine.spatializer().setEnabled(state.spatialEnabled);
 
     // 5. Apply Crossfeed
-    getEngineCrossfeed().setParams(state.crossfeedEnabled, 0.5f);
+    engine.crossfeed().setParams(state.crossfeedEnabled, 0.5f);
 
     // 6. Apply Professional Limiter Tuning
-    getEngineLimiter().setEnabled(true);
-    getEngineLimiter().setParams(
+    engine.limiter().setEnabled(true);
+    engine.limiter().setParams(
         state.limiterThresholdDb,
         state.limiterRatio,
         state.limiterAttackMs,
@@ -60,28 +60,6 @@ AIAudioState AIAudioProcessor::getCurrentState() {
     return state;
 }
 
-void AIAudioProcessor::updateStats(const float* buffer, int numFrames, int numChannels) {
-    if (!buffer || numFrames <= 0) return;
-
-    float peak = 0.0f;
-    float sumSquares = 0.0f;
-    int totalSamples = numFrames * numChannels;
-
-    for (int i = 0; i < totalSamples; ++i) {
-        float absSample = std::abs(buffer[i]);
-        if (absSample > peak) peak = absSample;
-        sumSquares += buffer[i] * buffer[i];
-    }
-
-    float rms = std::sqrt(sumSquares / (float)totalSamples);
-
-    std::lock_guard<std::mutex> lock(g_statsMutex);
-    // Simple EMA (Exponential Moving Average) for smoothing
-    g_latestStats.peakLevel = g_latestStats.peakLevel * 0.9f + peak * 0.1f;
-    g_latestStats.rmsLevel = g_latestStats.rmsLevel * 0.9f + rms * 0.1f;
-}
-
 AudioSignalStats AIAudioProcessor::getLatestStats() {
-    std::lock_guard<std::mutex> lock(g_statsMutex);
-    return g_latestStats;
+    return getDefaultEngine().meter().latest();
 }
@@ -1,8 +1,7 @@
 #ifndef AI_AUDIO_PROCESSOR_H
 #define AI_AUDIO_PROCESSOR_H
 
-#include <vector>
-#include <atomic>
+#include "signal_meter.h"
 
 struct AIAudioState {
     bool eqEnabled;
@@ -20,16 +19,14 @@ struct AIAudioState {
     float limiterMakeupGain;
 };
 
-struct AudioSignalStats {
-    float peakLevel;
-    float rmsLevel;
-};
+class AudioEngine;
 
 class AIAudioProcessor {
 public:
+    // Without an engine argument these act on the default (player) engine
     static void applyState(const AIAudioState& state);
+    static void applyState(AudioEngine& engine, const AIAudioState& state);
     static AIAudioState getCurrentState();
-    static void updateStats(const float* buffer, int numFrames, int numChannels);
     static AudioSignalStats getLatestStats();
 };
 
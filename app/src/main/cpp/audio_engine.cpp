@@ -0,0 +1,115 @@
+#include "audio_engine.h"
+#include "pcm_convert.h"
+
+AudioEngine::AudioEngine(int blockFrames)
+    : graph_({&crossfeed_, &equalizer_, &bassBoost_, &toneStage_,
+              &virtualizer_, &pitchShifter_, &spatializer_, &limiter_}),
+      blockFrames_(std::max(1, blockFrames)),
+      arenaSamples_(blockFrames_ * BLOCK_CHANNELS),
+      arena_(new float[arenaSamples_]) {
+    // Builds the built-in HRIR set and its resampled copies now rather than
+    // on the first spatialized render callback
+    HrirLibrary::instance();
+}
+
+template <typename Sample, typename ToFloat, typename FromFloat, typename Meter>
+void AudioEngine::processInteger(Sample* data, int sampleStride, int frameCount, int channelCount, int sampleRate,
+                                 float azimuth, float elevation, ToFloat toFloat, FromFloat fromFloat, Meter meterInteger) {
+    CallbackTimer callback(profiler_, frameCount, sampleRate);
+    DspProfiler *profiler = callback.get();
+
+    const int blockFrames = blockFramesFor(channelCount);
+    if (blockFrames <= 0) return;
+    float *block = arena_.get();
+
+    // Every stage neutral: skip the float round trip, only feed the analyzers
+    if (!graph_.prepare(channelCount)) {
+        StageTimer timer(profiler, DspStage::Meter);
+        meterInteger(data, frameCount, channelCount, sampleRate);
+        for (int start = 0; start < frameCount; start += blockFrames) {
+            const int frames = std::min(blockFrames, frameCount - start);
+            toFloat(data + static_cast<size_t>(start) * channelCount * sampleStride, block, frames * channelCount);
+            loudness_.addBlock(block, frames, channelCount, sampleRate);
+        }
+        return;
+    }
+
+    for (int start = 0; start < frameCount; start += blockFrames) {
+        const int frames = std::min(blockFrames, frameCount - start);
+        const int samples = frames * channelCount;
+        Sample *blockData = data + static_cast<size_t>(start) * channelCount * sampleStride;
+        {
+            StageTimer timer(profiler, DspStage::Convert);
+            toFloat(blockData, block, samples);
+        }
+        {
+            StageTimer timer(profiler, DspStage::Meter);
+            loudness_.addBlock(block, frames, channelCount, sampleRate);
+        }
+        graph_.run(block, frames, channelCount, sampleRate, azimuth, elevation, profiler);
+        {
+            // AI Analyzer - Direct signal feedback
+            StageTimer timer(profiler, DspStage::Meter);
+            meter_.addBlock(block, frames, channelCount, sampleRate);
+        }
+        StageTimer timer(profiler, DspStage::Convert);
+        fromFloat(block, blockData, samples);
+    }
+    StageTimer timer(profiler, DspStage::Meter);
+    meter_.commit();
+}
+
+void AudioEngine::processPcm16(int16_t* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation) {
+    processInteger(data, 1, frameCount, channelCount, sampleRate, azimuth, elevation, pcm::s16ToFloat, pcm::floatToS16,
+                   [this](const int16_t* d, int f, int c, int sr) { meter_.updatePcm16(d, f, c, sr); });
+}
+
+void AudioEngine::processPcm24(uint8_t* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation) {
+    processInteger(data, 3, frameCount, channelCount, sampleRate, azimuth, elevation, pcm::s24ToFloat, pcm::floatToS24,
+                   [this](const uint8_t* d, int f, int c, int sr) { meter_.updatePcm24(d, f, c, sr); });
+}
+
+void AudioEngine::processPcm32(int32_t* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation) {
+    processInteger(data, 1, frameCount, channelCount, sampleRate, azimuth, elevation, pcm::s32ToFloat, pcm::floatToS32,
+                   [this](const int32_t* d, int f, int c, int sr) { meter_.updatePcm32(d, f, c, sr); });
+}
+
+void AudioEngine::processFloat(float* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation) {
+    // The chain runs directly on the caller's buffer; output is left unclamped
+    // to keep float headroom (the limiter bounds it when enabled).
+    CallbackTimer callback(profiler_, frameCount, sampleRate);
+    DspProfiler *profiler = callback.get();
+
+    if (!graph_.prepare(channelCount)) {
+        StageTimer timer(profiler, DspStage::Meter);
+        meter_.update(data, frameCount, channelCount, sampleRate);
+        loudness_.addBlock(data, frameCount, channelCount, sampleRate);
+        return;
+    }
+    const int blockFrames = blockFramesFor(channelCount);
+    if (blockFrames <= 0) return;
+
+    for (int start = 0; start < frameCount; start += blockFrames) {
+        const int frames = std::min(blockFrames, frameCount - start);
+        float *block = data + static_cast<size_t>(start) * channelCount;
+        {
+            StageTimer timer(profiler, DspStage::Meter);
+            loudness_.addBlock(block, frames, channelCount, sampleRate);
+        }
+        graph_.run(block, frames, channelCount, sampleRate, azimuth, elevation, profiler);
+        StageTimer timer(profiler, DspStage::Meter);
+        meter_.addBlock(block, frames, channelCount, sampleRate);
+    }
+    StageTimer timer(profiler, DspStage::Meter);
+    meter_.commit();
+}
+
+void AudioEngine::reset() {
+    spatializer_.reset();
+    limiter_.reset();
+    crossfeed_.reset();
+    equalizer_.reset();
+    bassBoost_.reset();
+    virtualizer_.reset();
+    pitchShifter_.reset();
+}
@@ -0,0 +1,99 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include "audio_engine_components.h"
+#include "dsp_graph.h"
+#include "dsp_profiler.h"
+#include "limiter.h"
+#include "loudness_meter.h"
+#include "pitch_shifter.h"
+#include "signal_meter.h"
+
+/**
+ * One complete, independent effect chain: components, compiled graph,
+ * scratch arena and output meter.
+ *
+ * A callback is rendered in sub-blocks: each block goes through PCM
+ * conversion, every active stage, the meter and back before the next one
+ * starts, so the working set stays in L1 whatever the callback size. The
+ * arena holds one block and is allocated at construction.
+ *
+ * Setters may be called from any thread. Each engine must be rendered by at
+ * most one thread at a time. Different engines can render concurrently, e.g.
+ * the outgoing and incoming tracks of a crossfade: their own state is
+ * separate, and the process-wide state they share is safe for that:
+ *  - g_dspConfigVersion (param_snapshot.h): atomic; any setter's bump makes
+ *    every engine recompile its graph once, which is only wasted work.
+ *  - BiquadCoeffCache::instance(): lock-free lookups, insert-only entries.
+ *  - HrirLibrary::instance(): current() is a wait-free atomic load, and
+ *    loaded sets are never unmapped; load() serializes on its own mutex.
+ *  - g_dspProfilingEnabled: atomic flag, read once per callback.
+ * An HRIR set or profiling switch therefore applies to all engines at once.
+ *
+ * loudness() measures the input, before any effect, so it reflects the
+ * source and not the makeup gain that loudness normalization applies.
+ *
+ * While g_dspProfilingEnabled is set, every callback and stage is timed into
+ * profiler().
+ */
+class AudioEngine {
+public:
+    // Frames per sub-block for up to BLOCK_CHANNELS channels (8 KB of floats
+    // at eight); wider layouts get proportionally fewer frames per block.
+    static constexpr int DEFAULT_BLOCK_FRAMES = 256;
+    static constexpr int BLOCK_CHANNELS = 8;
+
+    explicit AudioEngine(int blockFrames = DEFAULT_BLOCK_FRAMES);
+
+    // Render thread. Buffers are interleaved and processed in place, in any size.
+    void processPcm16(int16_t* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation);
+    void processPcm24(uint8_t* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation);
+    void processPcm32(int32_t* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation);
+    void processFloat(float* data, int frameCount, int channelCount, int sampleRate, float azimuth, float elevation);
+
+    // Control thread: clears every stage's state and effect settings.
+    void reset();
+
+    Spatializer& spatializer() { return spatializer_; }
+    Limiter& limiter() { return limiter_; }
+    Crossfeed& crossfeed() { return crossfeed_; }
+    ParametricEQ& equalizer() { return equalizer_; }
+    BassBoost& bassBoost() { return bassBoost_; }
+    Virtualizer& virtualizer() { return virtualizer_; }
+    PitchShifter& pitchShifter() { return pitchShifter_; }
+    SignalMeter& meter() { return meter_; }
+    LoudnessMeter& loudness() { return loudness_; }
+    DspProfiler& profiler() { return profiler_; }
+
+private:
+    Spatializer spatializer_;
+    Limiter limiter_;
+    Crossfeed crossfeed_;
+    ParametricEQ equalizer_;
+    BassBoost bassBoost_;
+    ToneStage toneStage_;
+    Virtualizer virtualizer_;
+    PitchShifter pitchShifter_;
+    SignalMeter meter_;
+    LoudnessMeter loudness_;
+    DspGraph graph_;
+    DspProfiler profiler_;
+
+    // Render-thread scratch for one sub-block, allocated once so the audio
+    // callback never allocates.
+    int blockFrames_;
+    int arenaSamples_;
+    std::unique_ptr<float[]> arena_;
+
+    int blockFramesFor(int channelCount) const { return std::min(blockFrames_, arenaSamples_ / channelCount); }
+
+    template <typename Sample, typename ToFloat, typename FromFloat, typename Meter>
+    // sampleStride: Sample elements per PCM sample (3 for packed 24-bit bytes)
+    void processInteger(Sample* data, int sampleStride, int frameCount, int channelCount, int sampleRate,
+                        float azimuth, float elevation, ToFloat toFloat, FromFloat fromFloat, Meter meterInteger);
+};
+
+#endif // AUDIO_ENGINE_H
@@ -5,114 +5,76 @@
 #include <cmath>
 #include <algorithm>
 #include <atomic>
-#include <mutex>
+#include <cstdint>
 #include "biquad.h"
+#include "biquad_cascade.h"
+#include "biquad_coeff_cache.h"
+#include "hrtf_renderer.h"
 #include "limiter.h"
+#include "param_snapshot.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+/**
+ * Head-tracked binaural rendering of the stereo mix through HRTF convolution
+ * (see HrtfRenderer). Azimuth is positive to the right, in radians.
+ */
 class Spatializer {
 public:
-    static constexpr int DELAY_BUFFER_SIZE = 4096;
-    
-    Spatializer() : leftDelayBuffer(DELAY_BUFFER_SIZE, 0.0f), rightDelayBuffer(DELAY_BUFFER_SIZE, 0.0f),
-                    writeIndex(0), headRadius(0.0875f), speedOfSound(343.0f), enabled(false) {}
+    Spatializer() : enabled(false) {
+        // Build the built-in HRIR set here, never on the render thread
+        HrirLibrary::instance();
+    }
 
     void process(float* buffer, int numFrames, int channelCount, float azimuth, float elevation, int sampleRate) {
         if (!enabled.load(std::memory_order_acquire)) return;
         if (buffer == nullptr || numFrames <= 0 || sampleRate <= 0) return;
         if (channelCount != 2) return;
 
-        std::lock_guard<std::mutex> lock(processMutex);
-        float absAzimuth = fabsf(azimuth);
-        float itdSamples = (headRadius / speedOfSound) * (sinf(absAzimuth) + absAzimuth) * static_cast<float>(sampleRate);
-        itdSamples = std::min(itdSamples, static_cast<float>(DELAY_BUFFER_SIZE - 1));
-
-        float delayL = (azimuth > 0.0f) ? itdSamples : 0.0f;
-        float delayR = (azimuth < 0.0f) ? itdSamples : 0.0f;
-
-        float gainL = 1.0f;
-        float gainR = 1.0f;
-        if (azimuth > 0.0f) {
-            gainL = 1.0f - (0.6f * sinf(absAzimuth));
-        } else if (azimuth < 0.0f) {
-            gainR = 1.0f - (0.6f * sinf(absAzimuth));
-        }
-
-        float elevationGain = cosf(elevation);
-        gainL *= elevationGain;
-        gainR *= elevationGain;
-
-        for (int i = 0; i < numFrames; ++i) {
-            float inL = buffer[i * 2];
-            float inR = buffer[i * 2 + 1];
-            leftDelayBuffer[writeIndex] = inL;
-            rightDelayBuffer[writeIndex] = inR;
-            buffer[i * 2] = readDelay(leftDelayBuffer, writeIndex, delayL) * gainL;
-            buffer[i * 2 + 1] = readDelay(rightDelayBuffer, writeIndex, delayR) * gainR;
-            writeIndex = (writeIndex + 1) % DELAY_BUFFER_SIZE;
-        }
+        if (resetPending.exchange(false, std::memory_order_acq_rel)) renderer.clear();
+        renderer.process(buffer, numFrames, azimuth, elevation, sampleRate);
     }
 
-    void reset() {
-        std::lock_guard<std::mutex> lock(processMutex);
-        std::fill(leftDelayBuffer.begin(), leftDelayBuffer.end(), 0.0f);
-        std::fill(rightDelayBuffer.begin(), rightDelayBuffer.end(), 0.0f);
-        writeIndex = 0;
-    }
+    // Control thread: the renderer is cleared by the render thread on its next callback.
+    void reset() { resetPending.store(true, std::memory_order_release); }
     
-    void setEnabled(bool e) { enabled.store(e, std::memory_order_release); }
+    void setEnabled(bool e) {
+        // Start from silence rather than the tail of an earlier session
+        if (e && !enabled.load(std::memory_order_acquire)) reset();
+        enabled.store(e, std::memory_order_release);
+        notifyDspConfigChanged();
+    }
     bool isEnabled() { return enabled.load(std::memory_order_acquire); }
+    bool isActive(int channelCount) { return channelCount == 2 && isEnabled(); }
 
 private:
-    std::mutex processMutex;
-    std::vector<float> leftDelayBuffer;
-    std::vector<float> rightDelayBuffer;
-    int writeIndex;
-    const float headRadius;
-    const float speedOfSound;
+    HrtfRenderer renderer;
     std::atomic<bool> enabled;
-
-    float readDelay(const std::vector<float>& buffer, int currentWriteIndex, float delaySamples) {
-        float readIndex = static_cast<float>(currentWriteIndex) - delaySamples;
-        if (readIndex < 0.0f) readIndex += static_cast<float>(DELAY_BUFFER_SIZE);
-        readIndex = std::max(0.0f, std::min(readIndex, static_cast<float>(DELAY_BUFFER_SIZE - 1)));
-        int i1 = static_cast<int>(readIndex);
-        int i2 = (i1 + 1) % DELAY_BUFFER_SIZE;
-        float frac = readIndex - static_cast<float>(i1);
-        return buffer[i1] * (1.0f - frac) + buffer[i2] * frac;
-    }
+    std::atomic<bool> resetPending{false};
 };
 
 class Crossfeed {
 public:
     static constexpr int DELAY_BUFFER_SIZE = 512;
     
-    Crossfeed() : enabled(false), strength(0.0f), sampleRate(44100), 
+    Crossfeed() : enabled(false), strength(0.0f), sampleRate(0), 
                   delayBufferL(DELAY_BUFFER_SIZE, 0.0f), delayBufferR(DELAY_BUFFER_SIZE, 0.0f) {
-        setParams(false, 0.0f);
+        updateFilter(44100);
     }
 
     void setParams(bool e, float s) {
-        enabled.store(e, std::memory_order_release);
         strength.store(std::max(0.0f, std::min(1.0f, s)), std::memory_order_release);
-        
-        float fc = 700.0f; 
-        float w0 = 2.0f * M_PI * fc / (float)sampleRate;
-        b1 = expf(-w0);
-        a0 = 1.0f - b1;
+        enabled.store(e, std::memory_order_release);
+        notifyDspConfigChanged();
     }
 
     void process(float* buffer, int numFrames, int channelCount, int sr) {
         if (!enabled.load(std::memory_order_acquire) || channelCount != 2) return;
-        if (sr != sampleRate) {
-            sampleRate = sr;
-            setParams(enabled.load(), strength.load());
-        }
+        if (resetPending.exchange(false, std::memory_order_acq_rel)) clearState();
+        if (sr != sampleRate && sr > 0) updateFilter(sr);
 
-        std::lock_guard<std::mutex> lock(processMutex);
         float localStrength = strength.load(std::memory_order_acquire);
         float delayMs = 0.25f; 
         float delaySamples = (delayMs / 1000.0f) * (float)sampleRate;
@@ -132,19 +94,18 @@ public:
         }
     }
 
-    void reset() {
-        std::lock_guard<std::mutex> lock(processMutex);
-        std::fill(delayBufferL.begin(), delayBufferL.end(), 0.0f);
-        std::fill(delayBufferR.begin(), delayBufferR.end(), 0.0f);
-        lpL = 0.0f; lpR = 0.0f; writeIndex = 0;
-    }
+    // Control thread: state is cleared by the render thread on its next callback.
+    void reset() { resetPending.store(true, std::memory_order_release); }
 
     bool isEnabled() { return enabled.load(std::memory_order_acquire); }
+    bool isActive(int channelCount) { return channelCount == 2 && isEnabled(); }
 
 private:
-    std::mutex processMutex;
     std::atomic<bool> enabled;
     std::atomic<float> strength;
+    std::atomic<bool> resetPending{false};
+
+    // Render-thread state
     int sampleRate;
     std::vector<float> delayBufferL;
     std::vector<float> delayBufferR;
@@ -152,6 +113,20 @@ private:
     float lpL = 0.0f, lpR = 0.0f;
     float a0, b1;
 
+    void updateFilter(int sr) {
+        sampleRate = sr;
+        float fc = 700.0f; 
+        float w0 = 2.0f * M_PI * fc / (float)sampleRate;
+        b1 = expf(-w0);
+        a0 = 1.0f - b1;
+    }
+
+    void clearState() {
+        std::fill(delayBufferL.begin(), delayBufferL.end(), 0.0f);
+        std::fill(delayBufferR.begin(), delayBufferR.end(), 0.0f);
+        lpL = 0.0f; lpR = 0.0f; writeIndex = 0;
+    }
+
     float readDelay(const std::vector<float>& buffer, float delay) {
         float rIndex = static_cast<float>(writeIndex) - delay;
         if (rIndex < 0.0f) rIndex += static_cast<float>(DELAY_BUFFER_SIZE);
@@ -165,92 +140,219 @@ private:
 
 class ParametricEQ {
 public:
-    ParametricEQ() : enabled(false), preampGain(1.0f) {
-        float freqs[] = {31.0f, 62.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f};
-        for (int i = 0; i < 10; ++i) {
-            Biquad filter;
-            FilterType type = PEAKING;
-            if (i == 0) type = LOW_SHELF;
-            else if (i == 9) type = HIGH_SHELF;
-            filter.setParams(type, freqs[i], 1.41f, 0.0f, 44100);
-            filters.push_back(filter);
-        }
+    static constexpr int NUM_BANDS = 10;
+
+    ParametricEQ() : enabled(false) {
+        params.update([](EqParams& p) {
+            for (int i = 0; i < NUM_BANDS; ++i) p.gainDb[i] = 0.0f;
+            p.preampGain = 1.0f;
+            p.version = 0;
+        });
     }
 
     void setBandGain(int bandIndex, float gainDb) {
-        std::lock_guard<std::mutex> lock(filterMutex);
-        if (bandIndex >= 0 && bandIndex < 10) {
-            gainDb = std::max(-15.0f, std::min(15.0f, gainDb));
-            filters[bandIndex].updateGain(gainDb);
+        if (bandIndex < 0 || bandIndex >= NUM_BANDS) return;
+        gainDb = std::max(-15.0f, std::min(15.0f, gainDb));
+        // Design outside the render path for every rate the stream may switch to
+        BiquadCoeffCache::instance().prewarm(bandType(bandIndex), BAND_FREQS[bandIndex], BAND_Q, gainDb,
+                                             streamRate.load(std::memory_order_relaxed));
+        params.update([&](EqParams& p) {
+            if (std::abs(p.gainDb[bandIndex] - gainDb) < 0.01f) return;
+            p.gainDb[bandIndex] = gainDb;
+            p.version++;
+        });
+        notifyDspConfigChanged();
+    }
+
+    void setPreamp(float gainDb) {
+        float gain = powf(10.0f, gainDb / 20.0f);
+        params.update([&](EqParams& p) { p.preampGain = gain; });
+        notifyDspConfigChanged();
+    }
+    void setEnabled(bool e) { enabled.store(e, std::memory_order_release); notifyDspConfigChanged(); }
+
+    /**
+     * Render thread: fills one slot per band with the section to run at the
+     * stream's sample rate, or nullptr for bands at 0 dB (or for every band
+     * while disabled). Pointers stay valid until the next call. Returns the
+     * linear preamp gain.
+     */
+    float acquireSections(const BiquadCoeffs** slots, int sampleRate) {
+        const bool on = enabled.load(std::memory_order_acquire);
+        const EqParams& p = params.acquire();
+        if (on && (p.version != resolvedVersion || sampleRate != resolvedRate)) {
+            resolve(p, sampleRate);
+        }
+        for (int i = 0; i < NUM_BANDS; ++i) {
+            slots[i] = (on && std::abs(p.gainDb[i]) >= 0.01f) ? &resolved[i] : nullptr;
         }
+        return on ? p.preampGain : 1.0f;
     }
 
-    void setPreamp(float gainDb) { preampGain.store(powf(10.0f, gainDb / 20.0f), std::memory_order_release); }
-    void setEnabled(bool e) { enabled.store(e, std::memory_order_release); }
+    // Render thread: true once after reset() was requested.
+    bool consumeReset() { return resetPending.exchange(false, std::memory_order_acq_rel); }
 
-    void process(float* buffer, int numFrames, int numChannels, int sampleRate) {
-        if (!enabled.load(std::memory_order_acquire)) return;
-        float pGain = preampGain.load(std::memory_order_acquire);
-        if (pGain != 1.0f) {
-            for (int i = 0; i < numFrames * numChannels; ++i) buffer[i] *= pGain;
+    // Render thread: whether the EQ would change the signal at all.
+    bool isActive() {
+        if (!enabled.load(std::memory_order_acquire)) return false;
+        const EqParams& p = params.acquire();
+        if (p.preampGain != 1.0f) return true;
+        for (float g : p.gainDb) {
+            if (std::abs(g) >= 0.01f) return true;
         }
-        std::lock_guard<std::mutex> lock(filterMutex);
-        for (auto& filter : filters) filter.process(buffer, numFrames, numChannels);
+        return false;
     }
-    
+
+    // Control thread: band gains are kept, preamp returns to unity and filter
+    // history is cleared by the render thread on its next callback.
     void reset() {
-        std::lock_guard<std::mutex> lock(filterMutex);
-        for (auto& filter : filters) filter.reset();
-        preampGain.store(1.0f, std::memory_order_release);
+        params.update([](EqParams& p) { p.preampGain = 1.0f; });
+        resetPending.store(true, std::memory_order_release);
+        notifyDspConfigChanged();
     }
 
     float getBandGain(int index) {
-        std::lock_guard<std::mutex> lock(filterMutex);
-        if (index >= 0 && index < (int)filters.size()) return filters[index].getGainDb();
+        if (index >= 0 && index < NUM_BANDS) return params.read().gainDb[index];
         return 0.0f;
     }
 
     bool isEnabled() { return enabled.load(std::memory_order_acquire); }
 
 private:
-    std::mutex filterMutex;
+    struct EqParams {
+        float gainDb[NUM_BANDS];
+        float preampGain;
+        uint32_t version; // bumped whenever a band gain changes
+    };
+
+    static constexpr float BAND_FREQS[NUM_BANDS] = {31.0f, 62.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f};
+    static constexpr float BAND_Q = 1.41f;
+
+    static FilterType bandType(int band) {
+        if (band == 0) return LOW_SHELF;
+        if (band == NUM_BANDS - 1) return HIGH_SHELF;
+        return PEAKING;
+    }
+
+    void resolve(const EqParams& p, int sampleRate) {
+        if (sampleRate != resolvedRate) streamRate.store(sampleRate, std::memory_order_relaxed);
+        for (int i = 0; i < NUM_BANDS; ++i) {
+            resolved[i] = BiquadCoeffCache::instance().get(bandType(i), BAND_FREQS[i], BAND_Q, p.gainDb[i], sampleRate);
+        }
+        resolvedVersion = p.version;
+        resolvedRate = sampleRate;
+    }
+
     std::atomic<bool> enabled;
-    std::atomic<float> preampGain;
-    std::vector<Biquad> filters;
+    std::atomic<bool> resetPending{false};
+    std::atomic<int> streamRate{0};
+    ParamSnapshot<EqParams> params;
+
+    // Render-thread state: coefficients for the current gains at resolvedRate
+    BiquadCoeffs resolved[NUM_BANDS];
+    uint32_t resolvedVersion = 0;
+    int resolvedRate = 0;
 };
 
 class BassBoost {
 public:
-    BassBoost() : strength(0.0f) { filter.setParams(LOW_SHELF, 80.0f, 1.0f, 0.0f, 44100); }
-    void setStrength(float s) { strength.store(s, std::memory_order_release); filter.updateGain(s * 12.0f); }
-    void process(float* buffer, int numFrames, int numChannels) {
-        if (strength.load(std::memory_order_acquire) <= 0.01f) return;
-        filter.process(buffer, numFrames, numChannels);
+    BassBoost() : strength(0.0f) {}
+    void setStrength(float s) {
+        BiquadCoeffCache::instance().prewarm(LOW_SHELF, FREQUENCY, Q, s * MAX_GAIN_DB,
+                                             streamRate.load(std::memory_order_relaxed));
+        strength.store(s, std::memory_order_release);
+        notifyDspConfigChanged();
+    }
+    bool isActive() { return strength.load(std::memory_order_acquire) > 0.01f; }
+    // Render thread: the shelf section at the stream's rate, or nullptr when the boost is off.
+    const BiquadCoeffs* acquireSection(int sampleRate) {
+        const float s = strength.load(std::memory_order_acquire);
+        if (s <= 0.01f) return nullptr;
+        const int32_t step = BiquadCoeffCache::gainStep(s * MAX_GAIN_DB);
+        if (step != resolvedStep || sampleRate != resolvedRate) {
+            if (sampleRate != resolvedRate) streamRate.store(sampleRate, std::memory_order_relaxed);
+            resolved = BiquadCoeffCache::instance().get(LOW_SHELF, FREQUENCY, Q, s * MAX_GAIN_DB, sampleRate);
+            resolvedStep = step;
+            resolvedRate = sampleRate;
+        }
+        return &resolved;
+    }
+    // Render thread: true once after reset() was requested.
+    bool consumeReset() { return resetPending.exchange(false, std::memory_order_acq_rel); }
+    void reset() {
+        strength.store(0.0f, std::memory_order_release);
+        resetPending.store(true, std::memory_order_release);
+        notifyDspConfigChanged();
     }
-    void reset() { filter.reset(); strength.store(0.0f, std::memory_order_release); }
     float getStrength() { return strength.load(std::memory_order_acquire); }
 
 private:
-    Biquad filter;
+    static constexpr float FREQUENCY = 80.0f;
+    static constexpr float Q = 1.0f;
+    static constexpr float MAX_GAIN_DB = 12.0f;
+
     std::atomic<float> strength;
+    std::atomic<bool> resetPending{false};
+    std::atomic<int> streamRate{0};
+
+    // Render-thread state
+    BiquadCoeffs resolved;
+    int32_t resolvedStep = INT32_MIN;
+    int resolvedRate = 0;
+};
+
+/**
+ * The EQ bands followed by the bass-boost shelf, run as one fused biquad
+ * cascade so the buffer is swept once instead of once per filter. The EQ
+ * preamp is folded into the same pass. The stage stays active after the last
+ * filter is switched off until the cascade has rung out.
+ */
+class ToneStage {
+public:
+    static constexpr int BASS_SLOT = ParametricEQ::NUM_BANDS;
+
+    bool isActive(ParametricEQ& eq, BassBoost& bassBoost) const {
+        return eq.isActive() || bassBoost.isActive() || cascade.isRinging();
+    }
+
+    void process(ParametricEQ& eq, BassBoost& bassBoost, float* buffer, int numFrames, int numChannels, int sampleRate) {
+        if (eq.consumeReset()) cascade.resetSlots(0, ParametricEQ::NUM_BANDS);
+        if (bassBoost.consumeReset()) cascade.resetSlots(BASS_SLOT, 1);
+
+        const BiquadCoeffs* sections[ParametricEQ::NUM_BANDS + 1];
+        const float preamp = eq.acquireSections(sections, sampleRate);
+        sections[BASS_SLOT] = bassBoost.acquireSection(sampleRate);
+        const bool wasRinging = cascade.isRinging();
+        cascade.process(buffer, numFrames, numChannels, sections, ParametricEQ::NUM_BANDS + 1, preamp);
+        // Lets the graph drop the stage once nothing else keeps it active
+        if (wasRinging && !cascade.isRinging()) notifyDspConfigChanged();
+    }
+
+private:
+    BiquadCascade cascade;
 };
 
+/**
+ * Mid/side widener. Purely a 2x2 stereo matrix, so the DSP graph runs it as
+ * a matrix kernel (fused with neighbouring linear gains) rather than as a
+ * stage of its own.
+ */
 class Virtualizer {
 public:
     Virtualizer() : strength(0.0f) {}
-    void setStrength(float s) { strength.store(s, std::memory_order_release); }
+    void setStrength(float s) { strength.store(s, std::memory_order_release); notifyDspConfigChanged(); }
     float getStrength() { return strength.load(std::memory_order_acquire); }
-    void process(float* buffer, int numFrames, int numChannels) {
-        float s = strength.load(std::memory_order_acquire);
-        if (s <= 0.01f || numChannels < 2) return;
-        for (int i = 0; i < numFrames; ++i) {
-            float l = buffer[i * 2]; float r = buffer[i * 2 + 1];
-            float mid = (l + r) * 0.5f; float side = (l - r) * 0.5f;
-            side *= (1.0f + s * 0.8f);
-            buffer[i * 2] = mid + side; buffer[i * 2 + 1] = mid - side;
-        }
+    bool isActive(int numChannels) { return numChannels == 2 && strength.load(std::memory_order_acquire) > 0.01f; }
+
+    // Row-major [LL, LR, RL, RR]: mid = (l + r) / 2, side = (l - r) / 2 * (1 + 0.8 s)
+    void getMatrix(float m[4]) {
+        const float width = 1.0f + strength.load(std::memory_order_acquire) * 0.8f;
+        const float direct = 0.5f * (1.0f + width);
+        const float cross = 0.5f * (1.0f - width);
+        m[0] = direct; m[1] = cross;
+        m[2] = cross;  m[3] = direct;
     }
-    void reset() { strength.store(0.0f, std::memory_order_release); }
+    void reset() { strength.store(0.0f, std::memory_order_release); notifyDspConfigChanged(); }
 
 private:
     std::atomic<float> strength;
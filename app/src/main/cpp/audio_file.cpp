@@ -0,0 +1,283 @@
+#include "audio_file.h"
+#include "pcm_convert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr uint16_t WAVE_FORMAT_PCM = 0x0001;
+constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+uint16_t readLe16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+uint32_t readLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint16_t readBe16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+uint32_t readBe32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+// 80-bit IEEE 754 extended, which is how AIFF stores the sample rate
+double readExtended(const uint8_t* p) {
+    const int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    uint64_t mantissa = 0;
+    for (int i = 2; i < 10; ++i) mantissa = (mantissa << 8) | p[i];
+    if (exponent == 0 || mantissa == 0) return 0.0;
+    const double value = std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+bool sampleFormatFor(uint16_t tag, int bits, SampleFormat& format) {
+    if (tag == WAVE_FORMAT_PCM) {
+        switch (bits) {
+            case 16: format = SampleFormat::S16; return true;
+            case 24: format = SampleFormat::S24; return true;
+            case 32: format = SampleFormat::S32; return true;
+            default: return false;
+        }
+    }
+    if (tag == WAVE_FORMAT_IEEE_FLOAT && bits == 32) {
+        format = SampleFormat::F32;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool parseWav(const uint8_t* file, size_t size, PcmStreamInfo& info) {
+    if (file == nullptr || size < 12) return false;
+    if (std::memcmp(file, "RIFF", 4) != 0 || std::memcmp(file + 8, "WAVE", 4) != 0) return false;
+
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = file + pos;
+        const uint32_t chunkSize = readLe32(chunk + 4);
+        const size_t body = pos + 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || body + 16 > size) return false;
+            uint16_t tag = readLe16(file + body);
+            const int channels = readLe16(file + body + 2);
+            const int sampleRate = static_cast<int>(readLe32(file + body + 4));
+            const int bits = readLe16(file + body + 14);
+            if (tag == WAVE_FORMAT_EXTENSIBLE) {
+                // cbSize(2) validBits(2) channelMask(4), then the sub-format GUID
+                if (chunkSize < 40 || body + 26 > size) return false;
+                tag = readLe16(file + body + 24);
+            }
+            if (channels <= 0 || sampleRate <= 0 || !sampleFormatFor(tag, bits, info.format)) return false;
+            info.channels = channels;
+            info.sampleRate = sampleRate;
+            info.bigEndian = false;
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) return false;
+            // Streams cut short (or with a placeholder 0xFFFFFFFF size) end at the file
+            const size_t available = size - body;
+            const size_t bytes = chunkSize > available ? available : chunkSize;
+            info.dataOffset = body;
+            info.frames = static_cast<int64_t>(bytes / info.frameBytes());
+            return true;
+        }
+        if (chunkSize > size - body) break;
+        // Chunks are word-aligned
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+    return false;
+}
+
+bool parseAiff(const uint8_t* file, size_t size, PcmStreamInfo& info) {
+    if (file == nullptr || size < 12 || std::memcmp(file, "FORM", 4) != 0) return false;
+    const bool compressedForm = std::memcmp(file + 8, "AIFC", 4) == 0;
+    if (!compressedForm && std::memcmp(file + 8, "AIFF", 4) != 0) return false;
+
+    bool haveFormat = false;
+    bool haveData = false;
+    uint32_t declaredFrames = 0;
+    size_t dataBytes = 0;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = file + pos;
+        const uint32_t chunkSize = readBe32(chunk + 4);
+        const size_t body = pos + 8;
+        const size_t bodyEnd = chunkSize > size - body ? size : body + chunkSize;
+
+        if (std::memcmp(chunk, "COMM", 4) == 0) {
+            // channels(2) frames(4) bits(2) rate(10), then AIFF-C's compression type
+            if (chunkSize < 18 || bodyEnd - body < 18) return false;
+            const int channels = readBe16(file + body);
+            declaredFrames = readBe32(file + body + 2);
+            const int bits = readBe16(file + body + 6);
+            const double sampleRate = readExtended(file + body + 8);
+            bool isFloat = false;
+            info.bigEndian = true;
+            if (compressedForm) {
+                if (bodyEnd - body < 22) return false;
+                const uint8_t* type = file + body + 18;
+                if (std::memcmp(type, "sowt", 4) == 0) {
+                    info.bigEndian = false;
+                } else if (std::memcmp(type, "fl32", 4) == 0 || std::memcmp(type, "FL32", 4) == 0) {
+                    isFloat = true;
+                } else if (std::memcmp(type, "NONE", 4) != 0 && std::memcmp(type, "twos", 4) != 0) {
+                    return false;
+                }
+            }
+            if (channels <= 0 || !(sampleRate >= 1.0 && sampleRate <= 1e6)) return false;
+            if (isFloat) {
+                if (bits != 32) return false;
+                info.format = SampleFormat::F32;
+            } else {
+                // Samples are left-justified in whole bytes, so 20-bit audio reads as 24-bit
+                switch ((bits + 7) / 8) {
+                    case 2: info.format = SampleFormat::S16; break;
+                    case 3: info.format = SampleFormat::S24; break;
+                    case 4: info.format = SampleFormat::S32; break;
+                    default: return false;
+                }
+            }
+            info.channels = channels;
+            info.sampleRate = static_cast<int>(std::lround(sampleRate));
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "SSND", 4) == 0) {
+            // offset(4) blockSize(4); the offset skips padding before the samples
+            if (bodyEnd - body < 8) return false;
+            const uint32_t offset = readBe32(file + body);
+            if (offset > bodyEnd - body - 8) return false;
+            info.dataOffset = body + 8 + offset;
+            dataBytes = bodyEnd - info.dataOffset;
+            haveData = true;
+        }
+        if (chunkSize > size - body) break;
+        // Chunks are word-aligned
+        pos = body + chunkSize + (chunkSize & 1);
+    }
+    if (!haveFormat || !haveData) return false;
+    info.frames = std::min<int64_t>(declaredFrames, static_cast<int64_t>(dataBytes / info.frameBytes()));
+    return true;
+}
+
+void samplesToFloat(const uint8_t* in, const PcmStreamInfo& info, float* out, int samples) {
+    // Integer samples wider than a byte go through an aligned stack copy,
+    // where big-endian ones are also swapped
+    constexpr int CHUNK = 1024;
+    switch (info.format) {
+        case SampleFormat::S16: {
+            int16_t aligned[CHUNK];
+            for (int done = 0; done < samples; done += CHUNK) {
+                const int n = std::min(CHUNK, samples - done);
+                std::memcpy(aligned, in + static_cast<size_t>(done) * 2, static_cast<size_t>(n) * 2);
+                if (info.bigEndian) {
+                    for (int i = 0; i < n; ++i) {
+                        aligned[i] = static_cast<int16_t>(__builtin_bswap16(static_cast<uint16_t>(aligned[i])));
+                    }
+                }
+                pcm::s16ToFloat(aligned, out + done, n);
+            }
+            break;
+        }
+        case SampleFormat::S24: {
+            if (!info.bigEndian) {
+                pcm::s24ToFloat(in, out, samples);
+                break;
+            }
+            uint8_t swapped[CHUNK * 3];
+            for (int done = 0; done < samples; done += CHUNK) {
+                const int n = std::min(CHUNK, samples - done);
+                const uint8_t* src = in + static_cast<size_t>(done) * 3;
+                for (int i = 0; i < 3 * n; i += 3) {
+                    swapped[i] = src[i + 2];
+                    swapped[i + 1] = src[i + 1];
+                    swapped[i + 2] = src[i];
+                }
+                pcm::s24ToFloat(swapped, out + done, n);
+            }
+            break;
+        }
+        case SampleFormat::S32: {
+            int32_t aligned[CHUNK];
+            for (int done = 0; done < samples; done += CHUNK) {
+                const int n = std::min(CHUNK, samples - done);
+                std::memcpy(aligned, in + static_cast<size_t>(done) * 4, static_cast<size_t>(n) * 4);
+                if (info.bigEndian) {
+                    for (int i = 0; i < n; ++i) {
+                        aligned[i] = static_cast<int32_t>(__builtin_bswap32(static_cast<uint32_t>(aligned[i])));
+                    }
+                }
+                pcm::s32ToFloat(aligned, out + done, n);
+            }
+            break;
+        }
+        case SampleFormat::F32:
+            std::memcpy(out, in, static_cast<size_t>(samples) * sizeof(float));
+            if (info.bigEndian) {
+                for (int i = 0; i < samples; ++i) {
+                    uint32_t bits;
+                    std::memcpy(&bits, out + i, sizeof(bits));
+                    bits = __builtin_bswap32(bits);
+                    std::memcpy(out + i, &bits, sizeof(bits));
+                }
+            }
+            break;
+    }
+}
+
+bool PcmReader::open(const uint8_t* data, size_t size) {
+    file = nullptr;
+    position = 0;
+    blockFrames = blockPosition = 0;
+    if (parseWav(data, size, info) || parseAiff(data, size, info)) {
+        compressed = false;
+        numChannels = info.channels;
+        rate = info.sampleRate;
+        totalFrames = info.frames;
+    } else if (flac.open(data, size)) {
+        compressed = true;
+        numChannels = flac.channels();
+        rate = flac.sampleRate();
+        totalFrames = flac.totalFrames() > 0 ? flac.totalFrames() : -1;
+        scale = 1.0f / static_cast<float>(int64_t{1} << (flac.bitsPerSample() - 1));
+    } else {
+        return false;
+    }
+    file = data;
+    return true;
+}
+
+int PcmReader::read(float* out, int maxFrames) {
+    if (file == nullptr || maxFrames <= 0) return 0;
+    if (!compressed) {
+        const int frames = static_cast<int>(std::min<int64_t>(maxFrames, totalFrames - position));
+        if (frames <= 0) return 0;
+        samplesToFloat(file + info.dataOffset + position * info.frameBytes(), info, out, frames * numChannels);
+        position += frames;
+        return frames;
+    }
+
+    int done = 0;
+    while (done < maxFrames) {
+        if (blockPosition == blockFrames) {
+            blockFrames = flac.decodeFrame();
+            blockPosition = 0;
+            if (blockFrames == 0) break;
+        }
+        // Planar decoder output into interleaved floats
+        const int n = std::min(maxFrames - done, blockFrames - blockPosition);
+        for (int ch = 0; ch < numChannels; ++ch) {
+            const int32_t* src = flac.channelData(ch) + blockPosition;
+            float* dst = out + static_cast<size_t>(done) * numChannels + ch;
+            for (int i = 0; i < n; ++i) dst[static_cast<size_t>(i) * numChannels] = static_cast<float>(src[i]) * scale;
+        }
+        done += n;
+        blockPosition += n;
+    }
+    return done;
+}
@@ -0,0 +1,92 @@
+#ifndef AUDIO_FILE_H
+#define AUDIO_FILE_H
+
+#include "flac_decoder.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Container parsing for audio held in memory (typically a MappedFile).
+ * Parsers only locate and describe the sample data; they never copy it.
+ * PcmReader streams any supported file as float, decoding FLAC on the fly.
+ */
+enum class SampleFormat : uint8_t { S16, S24, S32, F32 }; // interleaved
+
+inline int bytesPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::S16: return 2;
+        case SampleFormat::S24: return 3;
+        case SampleFormat::S32:
+        case SampleFormat::F32: return 4;
+    }
+    return 0;
+}
+
+struct PcmStreamInfo {
+    SampleFormat format;
+    int channels;
+    int sampleRate;
+    size_t dataOffset; // first byte of sample data within the file
+    int64_t frames;    // whole frames available (a truncated tail is dropped)
+    bool bigEndian = false;
+
+    int frameBytes() const { return bytesPerSample(format) * channels; }
+};
+
+/**
+ * RIFF/WAVE with PCM (16/24/32-bit), IEEE float (32-bit) or
+ * WAVE_FORMAT_EXTENSIBLE carrying either. Returns false for anything else,
+ * including truncated headers.
+ */
+bool parseWav(const uint8_t* file, size_t size, PcmStreamInfo& info);
+
+/**
+ * AIFF with 16/24/32-bit samples, or AIFF-C that is uncompressed ("NONE",
+ * "twos"), byte-swapped ("sowt") or 32-bit float ("fl32"). Returns false for
+ * anything else, including 8-bit and truncated headers.
+ */
+bool parseAiff(const uint8_t* file, size_t size, PcmStreamInfo& info);
+
+/**
+ * Converts interleaved samples in the layout of 'info' to float in [-1, 1).
+ * 'in' may be unaligned, as sample data inside a mapped file often is.
+ */
+void samplesToFloat(const uint8_t* in, const PcmStreamInfo& info, float* out, int samples);
+
+/**
+ * Sequential float reader over a WAV, AIFF or FLAC file in memory. FLAC is
+ * decoded a frame at a time, so memory stays at one decoded block whatever
+ * the length of the track.
+ */
+class PcmReader {
+public:
+    // False if the file is in none of the supported formats
+    bool open(const uint8_t* file, size_t size);
+
+    int channels() const { return numChannels; }
+    int sampleRate() const { return rate; }
+    int64_t frames() const { return totalFrames; } // -1 if the stream does not say
+
+    // Layout of uncompressed files, which can also be read at random (and so
+    // in parallel) straight from data(); null for FLAC
+    const PcmStreamInfo* pcm() const { return compressed ? nullptr : &info; }
+    const uint8_t* data() const { return file; }
+
+    // Reads up to maxFrames interleaved frames; fewer only at the end
+    int read(float* out, int maxFrames);
+
+private:
+    const uint8_t* file = nullptr;
+    PcmStreamInfo info{};
+    bool compressed = false;
+    FlacDecoder flac;
+    int numChannels = 0;
+    int rate = 0;
+    int64_t totalFrames = 0;
+    int64_t position = 0; // uncompressed: next frame to read
+    int blockFrames = 0;  // FLAC: frames in the decoded block
+    int blockPosition = 0;
+    float scale = 0.0f;   // FLAC: integer samples to [-1, 1)
+};
+
+#endif // AUDIO_FILE_H
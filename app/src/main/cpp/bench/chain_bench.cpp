@@ -0,0 +1,125 @@
+/*
+ * AudioEngine throughput versus callback size, for several sub-block sizes.
+ *
+ * Each cell renders the same amount of 48 kHz stereo PCM16 through one
+ * engine, walking a source much larger than L2 so every callback starts
+ * cold, as a decoder's output would. The "whole" column gives the engine a
+ * block as large as the callback: every stage then sweeps the entire buffer
+ * before the next one starts, which is how the chain ran before sub-block
+ * scheduling.
+ *
+ * Figures are nanoseconds per stereo frame, best of REPEATS runs; lower is
+ * better.
+ */
+#include "audio_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int SAMPLE_RATE = 48000;
+constexpr int CHANNELS = 2;
+constexpr int SOURCE_FRAMES = SAMPLE_RATE * 20; // 3.7 MB of PCM16
+constexpr int FRAMES_PER_CELL = 1 << 19;
+constexpr int REPEATS = 3;
+
+// Up to the old 384k-sample scratch limit: 192000 stereo frames
+constexpr int CALLBACK_SIZES[] = {64, 128, 256, 512, 1024, 4096, 16384, 48000, 192000};
+constexpr int BLOCK_SIZES[] = {64, 128, 256, 512, 1024};
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    const char* name;
+    bool tone;
+    bool crossfeed;
+    bool virtualizer;
+    bool spatial;
+    float pitch;
+    bool limiter;
+};
+
+constexpr Config CONFIGS[] = {
+    {"widener", false, false, true, false, 1.0f, false},  // conversion-bound: one 2x2 matrix
+    {"tone", true, true, true, false, 1.0f, true},        // crossfeed, EQ, bass, widener, limiter
+    {"spatial", true, false, false, true, 1.0f, true},    // EQ, bass, HRTF, limiter
+    {"pitch", true, false, false, false, 1.12f, true},    // EQ, bass, pitch, limiter
+};
+
+void configure(AudioEngine& engine, const Config& config) {
+    engine.equalizer().setEnabled(config.tone);
+    for (int band = 0; band < ParametricEQ::NUM_BANDS; ++band) {
+        engine.equalizer().setBandGain(band, (band % 2 == 0) ? 4.0f : -3.0f);
+    }
+    engine.bassBoost().setStrength(config.tone ? 0.5f : 0.0f);
+    engine.crossfeed().setParams(config.crossfeed, 0.3f);
+    engine.virtualizer().setStrength(config.virtualizer ? 0.5f : 0.0f);
+    engine.spatializer().setEnabled(config.spatial);
+    engine.pitchShifter().setParams(config.pitch);
+    engine.limiter().setParams(-1.0f, 10.0f, 1.0f, 80.0f, 6.0f);
+    engine.limiter().setEnabled(config.limiter);
+}
+
+double nsPerFrame(const Config& config, int blockFrames, int callbackFrames, std::vector<int16_t>& source) {
+    AudioEngine engine(blockFrames);
+    configure(engine, config);
+
+    size_t position = 0;
+    auto render = [&](int frames) {
+        for (int done = 0; done < frames; done += callbackFrames) {
+            if (position + callbackFrames > SOURCE_FRAMES) position = 0;
+            engine.processPcm16(source.data() + position * CHANNELS, callbackFrames, CHANNELS, SAMPLE_RATE, 0.3f, 0.0f);
+            position += callbackFrames;
+        }
+    };
+
+    render(SAMPLE_RATE); // warm up: coefficient cache, pitch priming, page faults
+    const int frames = std::max(FRAMES_PER_CELL, callbackFrames * 8);
+    double best = 0.0;
+    for (int r = 0; r < REPEATS; ++r) {
+        const auto start = Clock::now();
+        render(frames);
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frames;
+        best = (r == 0) ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    std::vector<int16_t> source(static_cast<size_t>(SOURCE_FRAMES) * CHANNELS);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    for (int i = 0; i < SOURCE_FRAMES; ++i) {
+        const float t = static_cast<float>(i) / SAMPLE_RATE;
+        const float tone = 0.3f * std::sin(2.0f * static_cast<float>(M_PI) * 220.0f * t);
+        source[i * 2] = static_cast<int16_t>((tone + noise(rng)) * 32767.0f);
+        source[i * 2 + 1] = static_cast<int16_t>((0.8f * tone + noise(rng)) * 32767.0f);
+    }
+
+    for (const Config& config : CONFIGS) {
+        std::printf("\n[%s] ns per frame, stereo PCM16 at %d Hz\n", config.name, SAMPLE_RATE);
+        std::printf("%10s", "callback");
+        for (int block : BLOCK_SIZES) std::printf(" %9s%-4d", "block=", block);
+        std::printf(" %12s %10s\n", "whole", "gain");
+
+        for (int callback : CALLBACK_SIZES) {
+            std::printf("%10d", callback);
+            double defaultNs = 0.0;
+            for (int block : BLOCK_SIZES) {
+                const double ns = nsPerFrame(config, block, callback, source);
+                if (block == AudioEngine::DEFAULT_BLOCK_FRAMES) defaultNs = ns;
+                std::printf(" %13.1f", ns);
+            }
+            const double wholeNs = nsPerFrame(config, callback, callback, source);
+            std::printf(" %12.1f %9.2fx\n", wholeNs, wholeNs / defaultNs);
+        }
+    }
+    return 0;
+}
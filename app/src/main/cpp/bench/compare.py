@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Compare two dsp_bench JSON result files.
+
+usage: compare.py BASELINE.json CANDIDATE.json [--threshold=PERCENT]
+
+Prints every measurement whose ns_per_unit moved by more than the threshold
+(default 10%) and exits with status 1 if any of them got slower.
+"""
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {r["key"]: r["ns_per_unit"] for r in json.load(f)["results"]}
+
+
+def main(argv):
+    paths = [a for a in argv[1:] if not a.startswith("--")]
+    threshold = 10.0
+    for a in argv[1:]:
+        if a.startswith("--threshold="):
+            threshold = float(a.split("=", 1)[1])
+    if len(paths) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+
+    base, cand = load(paths[0]), load(paths[1])
+    regressions = 0
+    for key in sorted(base.keys() & cand.keys()):
+        change = (cand[key] / base[key] - 1.0) * 100.0 if base[key] > 0 else 0.0
+        if abs(change) > threshold:
+            regressions += change > 0
+            print(f"{'SLOWER' if change > 0 else 'faster'} {change:+7.1f}%  {key}  "
+                  f"{base[key]:.3f} -> {cand[key]:.3f} ns")
+    for key in sorted(base.keys() - cand.keys()):
+        print(f"missing          {key}")
+    print(f"{len(base.keys() & cand.keys())} compared, {regressions} slower than {threshold:g}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
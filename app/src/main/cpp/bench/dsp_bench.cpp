@@ -0,0 +1,525 @@
+/*
+ * Host benchmark suite for the native audio and recommendation code.
+ *
+ * dsp:    ns per frame for every stage on its own and for the full chain as
+ *         nProcessPcm16 runs it, across buffer sizes, channel counts and
+ *         sample rates. Stages that only exist for some layouts (crossfeed,
+ *         HRTF: stereo) are skipped elsewhere. The widener has no cost of its
+ *         own: it is a 2x2 matrix fused into the graph, so it is covered by
+ *         "chain". Every iteration refreshes the buffer from a clean source
+ *         (one memcpy) so boosts never accumulate.
+ * scorer: ns per candidate for score_candidates, top_k_indices and both,
+ *         for N from 100 to 1M, and for parallel_score_top_k on one thread
+ *         ("score_top_k_fused") and on every core ("score_top_k_parallel").
+ *         score_candidates and batch_cosine are also run on each instruction
+ *         set the CPU supports ("score_candidates_avx2", ...), which must
+ *         first pass the kernels' self-test.
+ *
+ * Usage: dsp_bench [--format=table|csv|json] [--out=PATH] [--quick]
+ *                  [--filter=SUBSTRING] [--min-time-ms=N]
+ *
+ * csv and json carry the same fields, and "key" identifies a measurement
+ * across runs, so two result files from different builds can be joined on
+ * it (see compare.py).
+ */
+#include "audio_engine.h"
+#include "loudness_meter.h"
+#include "pcm_convert.h"
+#include "recommendation_kernels.h"
+#include "signal_meter.h"
+#include "time_stretcher.h"
+#include "waveform_pyramid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int REPEATS = 3;
+constexpr int TOP_K = 50;
+
+struct Options {
+    enum class Format { Table, Csv, Json } format = Format::Table;
+    const char* outPath = nullptr;
+    bool quick = false;
+    std::string filter;
+    double minTimeNs = 10e6;
+};
+
+struct Result {
+    std::string suite;
+    std::string name;
+    int frames = 0;
+    int channels = 0;
+    int sampleRate = 0;
+    int n = 0;
+    int k = 0;
+    double nsPerUnit = 0.0;   // per frame (dsp) or per candidate (scorer)
+    double realtime = 0.0;    // dsp: seconds of audio rendered per CPU second
+
+    std::string key() const {
+        char buf[160];
+        if (suite == "dsp") {
+            std::snprintf(buf, sizeof(buf), "dsp/%s/f%d/c%d/r%d", name.c_str(), frames, channels, sampleRate);
+        } else {
+            std::snprintf(buf, sizeof(buf), "%s/%s/n%d/k%d", suite.c_str(), name.c_str(), n, k);
+        }
+        return buf;
+    }
+};
+
+/**
+ * Best-of-REPEATS time of one call to fn, where each repeat runs fn often
+ * enough to fill minTimeNs.
+ */
+double timeCallNs(const std::function<void()>& fn, double minTimeNs) {
+    fn(); // warm up
+    int iterations = 1;
+    for (;;) {
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) fn();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (ns >= minTimeNs / 4 || iterations >= (1 << 24)) break;
+        iterations *= 4;
+    }
+    double best = 0.0;
+    for (int r = 0; r < REPEATS; ++r) {
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) fn();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+        best = (r == 0) ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+// Tone plus noise per channel, with a different phase on each
+std::vector<float> testSignal(int frames, int channels, int sampleRate) {
+    std::vector<float> signal(static_cast<size_t>(frames) * channels);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+    for (int i = 0; i < frames; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            const float phase = 2.0f * static_cast<float>(M_PI) * 220.0f * i / sampleRate + c;
+            signal[static_cast<size_t>(i) * channels + c] = 0.3f * std::sin(phase) + noise(rng);
+        }
+    }
+    return signal;
+}
+
+void configureTone(ParametricEQ& eq, BassBoost& bass) {
+    eq.setEnabled(true);
+    for (int band = 0; band < ParametricEQ::NUM_BANDS; ++band) eq.setBandGain(band, (band % 2 == 0) ? 4.0f : -3.0f);
+    bass.setStrength(0.5f);
+}
+
+// Everything the player can enable at once for this layout
+void configureChain(AudioEngine& engine, int channels) {
+    configureTone(engine.equalizer(), engine.bassBoost());
+    engine.virtualizer().setStrength(0.5f);
+    engine.spatializer().setEnabled(channels == 2);
+    engine.crossfeed().setParams(false, 0.3f); // the player disables it while spatial is on
+    engine.pitchShifter().setParams(1.12f);
+    engine.limiter().setParams(-1.0f, 10.0f, 1.0f, 80.0f, 6.0f);
+    engine.limiter().setEnabled(true);
+}
+
+struct DspCase {
+    const char* name;
+    int maxChannels;
+    bool stereoOnly;
+    // Builds the stage and returns a call that processes `buffer` in place
+    std::function<std::function<void(float*)>(int frames, int channels, int sampleRate)> make;
+};
+
+std::vector<DspCase> dspCases() {
+    std::vector<DspCase> cases;
+
+    cases.push_back({"pcm16_roundtrip", 16, false, [](int frames, int channels, int) {
+        auto pcm = std::make_shared<std::vector<int16_t>>(static_cast<size_t>(frames) * channels);
+        return std::function<void(float*)>([pcm, frames, channels](float* buffer) {
+            pcm::floatToS16(buffer, pcm->data(), frames * channels);
+            pcm::s16ToFloat(pcm->data(), buffer, frames * channels);
+        });
+    }});
+
+    cases.push_back({"tone_eq10_bass", BiquadCascade::MAX_CHANNELS, false, [](int frames, int channels, int sampleRate) {
+        struct State { ParametricEQ eq; BassBoost bass; ToneStage tone; };
+        auto s = std::make_shared<State>();
+        configureTone(s->eq, s->bass);
+        return std::function<void(float*)>([s, frames, channels, sampleRate](float* buffer) {
+            s->tone.process(s->eq, s->bass, buffer, frames, channels, sampleRate);
+        });
+    }});
+
+    cases.push_back({"bass_only", BiquadCascade::MAX_CHANNELS, false, [](int frames, int channels, int sampleRate) {
+        struct State { ParametricEQ eq; BassBoost bass; ToneStage tone; };
+        auto s = std::make_shared<State>();
+        s->bass.setStrength(0.5f);
+        return std::function<void(float*)>([s, frames, channels, sampleRate](float* buffer) {
+            s->tone.process(s->eq, s->bass, buffer, frames, channels, sampleRate);
+        });
+    }});
+
+    cases.push_back({"crossfeed", 2, true, [](int frames, int channels, int sampleRate) {
+        auto crossfeed = std::make_shared<Crossfeed>();
+        crossfeed->setParams(true, 0.3f);
+        return std::function<void(float*)>([crossfeed, frames, channels, sampleRate](float* buffer) {
+            crossfeed->process(buffer, frames, channels, sampleRate);
+        });
+    }});
+
+    cases.push_back({"spatializer_hrtf", 2, true, [](int frames, int channels, int sampleRate) {
+        auto spatializer = std::make_shared<Spatializer>();
+        spatializer->setEnabled(true);
+        return std::function<void(float*)>([spatializer, frames, channels, sampleRate](float* buffer) {
+            spatializer->process(buffer, frames, channels, 0.4f, 0.0f, sampleRate);
+        });
+    }});
+
+    cases.push_back({"pitch_shift", PitchShifter::MAX_CHANNELS, false, [](int frames, int channels, int sampleRate) {
+        auto shifter = std::make_shared<PitchShifter>();
+        shifter->setParams(1.12f);
+        return std::function<void(float*)>([shifter, frames, channels, sampleRate](float* buffer) {
+            shifter->process(buffer, frames, channels, sampleRate);
+        });
+    }});
+
+    for (const bool speech : {false, true}) {
+        cases.push_back({speech ? "time_stretch_speech" : "time_stretch_music", 16, false,
+                         [speech](int frames, int channels, int sampleRate) {
+            auto stretcher = std::make_shared<TimeStretcher>(channels, sampleRate);
+            stretcher->setFormat(channels, sampleRate);
+            stretcher->setParams(1.25f, 1.0f, speech ? TimeStretcher::Mode::Speech : TimeStretcher::Mode::Music);
+            auto out = std::make_shared<std::vector<float>>(static_cast<size_t>(frames) * channels);
+            return std::function<void(float*)>([stretcher, out, frames](float* buffer) {
+                int consumed = 0;
+                while (consumed < frames) {
+                    consumed += stretcher->put(buffer + consumed * stretcher->channels(), frames - consumed);
+                    while (stretcher->receive(out->data(), frames) > 0) {}
+                }
+            });
+        }});
+    }
+
+    for (const bool truePeak : {true, false}) {
+        cases.push_back({truePeak ? "limiter_true_peak" : "limiter_sample_peak", 16, false,
+                         [truePeak](int frames, int channels, int sampleRate) {
+            auto limiter = std::make_shared<Limiter>();
+            limiter->setParams(-1.0f, 10.0f, 1.0f, 80.0f, 6.0f);
+            limiter->setTruePeakEnabled(truePeak);
+            limiter->setEnabled(true);
+            return std::function<void(float*)>([limiter, frames, channels, sampleRate](float* buffer) {
+                limiter->process(buffer, frames, channels, sampleRate);
+            });
+        }});
+    }
+
+    cases.push_back({"meter", 16, false, [](int frames, int channels, int sampleRate) {
+        auto meter = std::make_shared<SignalMeter>();
+        return std::function<void(float*)>([meter, frames, channels, sampleRate](float* buffer) {
+            meter->update(buffer, frames, channels, sampleRate);
+        });
+    }});
+
+    cases.push_back({"loudness_r128", 16, false, [](int frames, int channels, int sampleRate) {
+        auto meter = std::make_shared<LoudnessMeter>();
+        return std::function<void(float*)>([meter, frames, channels, sampleRate](float* buffer) {
+            meter->addBlock(buffer, frames, channels, sampleRate);
+        });
+    }});
+
+    // Level-0 waveform reduction over whole buckets, as WaveformPyramid::build runs it
+    cases.push_back({"waveform_reduce", 16, false, [](int frames, int channels, int) {
+        auto sink = std::make_shared<float>(0.0f);
+        return std::function<void(float*)>([sink, frames, channels](float* buffer) {
+            const int bucketSamples = WaveformPyramid::BASE_FRAMES * channels;
+            const int total = frames * channels;
+            for (int i = 0; i < total; i += bucketSamples) {
+                float lo, hi, squares;
+                WaveformPyramid::reduce(buffer + i, std::min(bucketSamples, total - i), lo, hi, squares);
+                *sink += hi - lo + squares;
+            }
+        });
+    }});
+
+    cases.push_back({"chain_pcm16", 16, false, [](int frames, int channels, int sampleRate) {
+        auto engine = std::make_shared<AudioEngine>();
+        configureChain(*engine, channels);
+        auto pcm = std::make_shared<std::vector<int16_t>>(static_cast<size_t>(frames) * channels);
+        return std::function<void(float*)>([engine, pcm, frames, channels, sampleRate](float* buffer) {
+            // The conversion in stands in for the decoder writing the buffer
+            pcm::floatToS16(buffer, pcm->data(), frames * channels);
+            engine->processPcm16(pcm->data(), frames, channels, sampleRate, 0.4f, 0.0f);
+        });
+    }});
+
+    // Same chain with DspProfiler recording; the difference to chain_pcm16 is
+    // the cost of profiling when switched on
+    cases.push_back({"chain_pcm16_profiled", 16, false, [](int frames, int channels, int sampleRate) {
+        auto engine = std::make_shared<AudioEngine>();
+        configureChain(*engine, channels);
+        auto pcm = std::make_shared<std::vector<int16_t>>(static_cast<size_t>(frames) * channels);
+        return std::function<void(float*)>([engine, pcm, frames, channels, sampleRate](float* buffer) {
+            pcm::floatToS16(buffer, pcm->data(), frames * channels);
+            g_dspProfilingEnabled.store(true, std::memory_order_relaxed);
+            engine->processPcm16(pcm->data(), frames, channels, sampleRate, 0.4f, 0.0f);
+            g_dspProfilingEnabled.store(false, std::memory_order_relaxed);
+        });
+    }});
+
+    return cases;
+}
+
+void runDsp(const Options& options, std::vector<Result>& results) {
+    const std::vector<int> frameSizes = options.quick ? std::vector<int>{256, 1024} : std::vector<int>{64, 256, 1024, 4096};
+    const std::vector<int> channelCounts = options.quick ? std::vector<int>{2} : std::vector<int>{1, 2, 6, 8};
+    const std::vector<int> sampleRates = options.quick ? std::vector<int>{48000}
+                                                       : std::vector<int>{44100, 48000, 96000, 192000};
+
+    for (const DspCase& c : dspCases()) {
+        if (!options.filter.empty() && std::string(c.name).find(options.filter) == std::string::npos) continue;
+        for (int rate : sampleRates) {
+            for (int channels : channelCounts) {
+                if (channels > c.maxChannels || (c.stereoOnly && channels != 2)) continue;
+                for (int frames : frameSizes) {
+                    const std::vector<float> source = testSignal(frames, channels, rate);
+                    std::vector<float> buffer(source.size());
+                    const auto process = c.make(frames, channels, rate);
+                    const double ns = timeCallNs([&] {
+                        std::memcpy(buffer.data(), source.data(), source.size() * sizeof(float));
+                        process(buffer.data());
+                    }, options.minTimeNs);
+
+                    Result r;
+                    r.suite = "dsp";
+                    r.name = c.name;
+                    r.frames = frames;
+                    r.channels = channels;
+                    r.sampleRate = rate;
+                    r.nsPerUnit = ns / frames;
+                    r.realtime = 1e9 / rate / r.nsPerUnit;
+                    results.push_back(r);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * score_candidates and batch_cosine_similarity (32-dim rows) forced onto
+ * every instruction set the CPU supports, after checking each against the
+ * scalar reference. Named "<kernel>_<isa>".
+ */
+void runScorerIsas(const Options& options, const std::vector<int>& sizes, std::vector<Result>& results) {
+    static constexpr float WEIGHTS[NUM_WEIGHTS] = {0.5f, 0.22f, 0.12f, 0.12f, 0.12f, 0.08f, 0.08f, 0.10f, 0.20f, 0.08f, 0.08f};
+    constexpr int DIM = 32;
+    const char* isas[8];
+    const int isaCount = scorer_supported_isas(isas, 8);
+    for (int i = 0; i < isaCount; ++i) {
+        if (!scorer_kernel_self_test(isas[i])) {
+            std::fprintf(stderr, "scorer kernels for %s disagree with the scalar reference\n", isas[i]);
+            continue;
+        }
+        scorer_use_isa(isas[i]);
+        for (const char* kernel : {"score_candidates", "batch_cosine"}) {
+            const std::string name = std::string(kernel) + "_" + isas[i];
+            if (!options.filter.empty() && name.find(options.filter) == std::string::npos) continue;
+            const bool cosine = kernel[0] == 'b';
+            for (int n : sizes) {
+                std::vector<float> input(static_cast<size_t>(cosine ? DIM : NUM_FEATURES) * n);
+                std::vector<float> user(DIM);
+                std::mt19937 rng(n);
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+                for (float& f : input) f = unit(rng);
+                for (float& f : user) f = unit(rng);
+                std::vector<float> out(n);
+
+                const double ns = timeCallNs([&] {
+                    if (cosine) {
+                        batch_cosine_similarity(user.data(), input.data(), n, DIM, out.data());
+                    } else {
+                        score_candidates(input.data(), n, WEIGHTS, out.data());
+                    }
+                }, options.minTimeNs);
+
+                Result r;
+                r.suite = "scorer";
+                r.name = name;
+                r.n = n;
+                r.nsPerUnit = ns / n;
+                results.push_back(r);
+            }
+        }
+    }
+    scorer_use_isa(nullptr);
+}
+
+void runScorer(const Options& options, std::vector<Result>& results) {
+    static constexpr float WEIGHTS[NUM_WEIGHTS] = {0.5f, 0.22f, 0.12f, 0.12f, 0.12f, 0.08f, 0.08f, 0.10f, 0.20f, 0.08f, 0.08f};
+    const std::vector<int> sizes = options.quick ? std::vector<int>{1000, 100000}
+                                                 : std::vector<int>{100, 1000, 10000, 100000, 1000000};
+
+    const struct { const char* name; int which; } kernels[] = {
+        {"score_candidates", 0}, {"top_k_indices", 1}, {"score_top_k", 2},
+        {"score_top_k_fused", 3}, {"score_top_k_parallel", 4},
+    };
+    for (const auto& kernel : kernels) {
+        if (!options.filter.empty() && std::string(kernel.name).find(options.filter) == std::string::npos) continue;
+        for (int n : sizes) {
+            std::vector<float> features(static_cast<size_t>(NUM_FEATURES) * n);
+            std::mt19937 rng(n);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            for (float& f : features) f = unit(rng);
+            std::vector<float> scores(n);
+            const int k = std::min(TOP_K, n);
+            std::vector<int> top(k);
+            score_candidates(features.data(), n, WEIGHTS, scores.data());
+
+            const double ns = timeCallNs([&] {
+                if (kernel.which >= 3) {
+                    parallel_score_top_k(features.data(), n, WEIGHTS, k, kernel.which == 3 ? 1 : 0, nullptr, top.data());
+                    return;
+                }
+                if (kernel.which != 1) score_candidates(features.data(), n, WEIGHTS, scores.data());
+                if (kernel.which != 0) top_k_indices(scores.data(), n, k, top.data());
+            }, options.minTimeNs);
+
+            Result r;
+            r.suite = "scorer";
+            r.name = kernel.name;
+            r.n = n;
+            r.k = kernel.which == 0 ? 0 : k;
+            r.nsPerUnit = ns / n;
+            results.push_back(r);
+        }
+    }
+    runScorerIsas(options, sizes, results);
+}
+
+const char* simdName() {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return "neon";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+const char* compilerName() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+void writeCsv(FILE* out, const std::vector<Result>& results) {
+    std::fprintf(out, "key,suite,name,frames,channels,sample_rate,n,k,ns_per_unit,realtime_factor\n");
+    for (const Result& r : results) {
+        std::fprintf(out, "%s,%s,%s,%d,%d,%d,%d,%d,%.4f,%.2f\n", r.key().c_str(), r.suite.c_str(), r.name.c_str(),
+                     r.frames, r.channels, r.sampleRate, r.n, r.k, r.nsPerUnit, r.realtime);
+    }
+}
+
+void writeJson(FILE* out, const std::vector<Result>& results) {
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::fprintf(out, "{\n  \"meta\": {\"schema\": 1, \"date\": \"%s\", \"compiler\": \"%s\", \"simd\": \"%s\", "
+                      "\"scorer_isa\": \"%s\", \"pointer_bits\": %d, \"ndebug\": %s},\n  \"results\": [\n",
+                 date, compilerName(), simdName(), scorer_kernel_isa(), static_cast<int>(sizeof(void*) * 8),
+#ifdef NDEBUG
+                 "true"
+#else
+                 "false"
+#endif
+    );
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(out, "    {\"key\": \"%s\", \"suite\": \"%s\", \"name\": \"%s\", \"frames\": %d, \"channels\": %d, "
+                          "\"sample_rate\": %d, \"n\": %d, \"k\": %d, \"ns_per_unit\": %.4f, \"realtime_factor\": %.2f}%s\n",
+                     r.key().c_str(), r.suite.c_str(), r.name.c_str(), r.frames, r.channels, r.sampleRate, r.n, r.k,
+                     r.nsPerUnit, r.realtime, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+void writeTable(FILE* out, const std::vector<Result>& results) {
+    std::string suite;
+    for (const Result& r : results) {
+        if (r.suite != suite) {
+            suite = r.suite;
+            if (suite == "dsp") {
+                std::fprintf(out, "\n%-22s %7s %4s %7s %12s %10s\n", "dsp stage", "frames", "ch", "rate", "ns/frame", "x realtime");
+            } else {
+                std::fprintf(out, "\n%-22s %9s %4s %12s %14s\n", "scorer kernel", "n", "k", "ns/item", "items/s");
+            }
+        }
+        if (suite == "dsp") {
+            std::fprintf(out, "%-22s %7d %4d %7d %12.2f %10.0f\n", r.name.c_str(), r.frames, r.channels, r.sampleRate,
+                         r.nsPerUnit, r.realtime);
+        } else {
+            std::fprintf(out, "%-22s %9d %4d %12.3f %14.3e\n", r.name.c_str(), r.n, r.k, r.nsPerUnit, 1e9 / r.nsPerUnit);
+        }
+    }
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--format=table") options.format = Options::Format::Table;
+        else if (arg == "--format=csv") options.format = Options::Format::Csv;
+        else if (arg == "--format=json") options.format = Options::Format::Json;
+        else if (arg.rfind("--out=", 0) == 0) options.outPath = argv[i] + 6;
+        else if (arg == "--quick") options.quick = true;
+        else if (arg.rfind("--filter=", 0) == 0) options.filter = arg.substr(9);
+        else if (arg.rfind("--min-time-ms=", 0) == 0) options.minTimeNs = std::atof(arg.c_str() + 14) * 1e6;
+        else {
+            std::fprintf(stderr, "usage: %s [--format=table|csv|json] [--out=PATH] [--quick] "
+                                 "[--filter=SUBSTRING] [--min-time-ms=N]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 2;
+
+    std::vector<Result> results;
+    runDsp(options, results);
+    runScorer(options, results);
+
+    FILE* out = stdout;
+    if (options.outPath != nullptr) {
+        out = std::fopen(options.outPath, "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "cannot write %s\n", options.outPath);
+            return 1;
+        }
+    }
+    switch (options.format) {
+        case Options::Format::Table: writeTable(out, results); break;
+        case Options::Format::Csv: writeCsv(out, results); break;
+        case Options::Format::Json: writeJson(out, results); break;
+    }
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
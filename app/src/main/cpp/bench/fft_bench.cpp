@@ -0,0 +1,105 @@
+/*
+ * RealFft correctness and speed against a naive DFT, for every supported
+ * size. The reference is evaluated in double precision with an exact twiddle
+ * table. Above NAIVE_FULL_LIMIT it is computed for an evenly spaced subset
+ * of bins, and its time is extrapolated to the full spectrum.
+ *
+ * Exits non-zero if any forward error (relative to the spectrum's peak
+ * magnitude) or round-trip error exceeds its tolerance.
+ */
+#include "fft.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int NAIVE_FULL_LIMIT = 4096;
+constexpr int NAIVE_SAMPLED_BINS = 257;
+constexpr double FORWARD_TOLERANCE = 1e-5;
+constexpr double ROUND_TRIP_TOLERANCE = 1e-5;
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+struct NaiveResult {
+    double maxError;
+    double peak;
+    double projectedNs;
+};
+
+NaiveResult naiveDft(const std::vector<float>& x, const std::vector<float>& re, const std::vector<float>& im) {
+    const int n = static_cast<int>(x.size());
+    const int bins = n / 2 + 1;
+    std::vector<double> cosTable(n), sinTable(n);
+    for (int i = 0; i < n; ++i) {
+        cosTable[i] = std::cos(2.0 * M_PI * i / n);
+        sinTable[i] = std::sin(2.0 * M_PI * i / n);
+    }
+
+    const int step = n <= NAIVE_FULL_LIMIT ? 1 : std::max(1, bins / NAIVE_SAMPLED_BINS);
+    NaiveResult result{0.0, 0.0, 0.0};
+    int evaluated = 0;
+    const auto start = Clock::now();
+    for (int k = 0; k < bins; k += step) {
+        double sr = 0.0, si = 0.0;
+        size_t phase = 0;
+        for (int t = 0; t < n; ++t) {
+            sr += x[t] * cosTable[phase];
+            si -= x[t] * sinTable[phase];
+            phase = (phase + k) & static_cast<size_t>(n - 1);
+        }
+        result.maxError = std::max(result.maxError, std::hypot(sr - re[k], si - im[k]));
+        result.peak = std::max(result.peak, std::hypot(sr, si));
+        ++evaluated;
+    }
+    result.projectedNs = elapsedNs(start) * bins / evaluated;
+    return result;
+}
+
+} // namespace
+
+int main() {
+    std::printf("%8s %12s %12s %14s %10s %10s %10s\n",
+                "size", "fwd_ns", "inv_ns", "naive_ns", "speedup", "fwd_err", "rt_err");
+
+    bool ok = true;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (int n = RealFft::MIN_SIZE; n <= RealFft::MAX_SIZE; n *= 2) {
+        RealFft fft(n);
+        std::vector<float> x(n), y(n), re(fft.bins()), im(fft.bins());
+        for (float& v : x) v = dist(rng);
+
+        fft.forward(x.data(), re.data(), im.data());
+        fft.inverse(re.data(), im.data(), y.data());
+        double roundTrip = 0.0;
+        for (int t = 0; t < n; ++t) roundTrip = std::max(roundTrip, static_cast<double>(std::fabs(y[t] - x[t])));
+
+        // Enough iterations for roughly 50 ms per direction
+        const int iterations = std::max(20, static_cast<int>(4e7 / (n * std::log2(n))));
+        std::vector<float> re2(fft.bins()), im2(fft.bins());
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) fft.forward(x.data(), re2.data(), im2.data());
+        const double forwardNs = elapsedNs(start) / iterations;
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i) fft.inverse(re.data(), im.data(), y.data());
+        const double inverseNs = elapsedNs(start) / iterations;
+
+        const NaiveResult naive = naiveDft(x, re, im);
+        const double forwardError = naive.maxError / naive.peak;
+        const bool pass = forwardError <= FORWARD_TOLERANCE && roundTrip <= ROUND_TRIP_TOLERANCE;
+        ok = ok && pass;
+
+        std::printf("%8d %12.0f %12.0f %14.0f %10.1f %10.2e %10.2e%s\n",
+                    n, forwardNs, inverseNs, naive.projectedNs, naive.projectedNs / forwardNs,
+                    forwardError, roundTrip, pass ? "" : "  FAIL");
+    }
+    return ok ? 0 : 1;
+}
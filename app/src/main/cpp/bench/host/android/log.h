@@ -0,0 +1,30 @@
+/*
+ * Host stand-in for the NDK logging header, so the DSP sources build
+ * unchanged for the benchmarks. Messages go to stderr.
+ */
+#ifndef BENCH_HOST_ANDROID_LOG_H
+#define BENCH_HOST_ANDROID_LOG_H
+
+#include <cstdarg>
+#include <cstdio>
+
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6,
+};
+
+inline int __android_log_print(int priority, const char* tag, const char* fmt, ...) {
+    if (priority < ANDROID_LOG_WARN) return 0;
+    std::fprintf(stderr, "%s: ", tag);
+    va_list args;
+    va_start(args, fmt);
+    const int n = std::vfprintf(stderr, fmt, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+    return n;
+}
+
+#endif // BENCH_HOST_ANDROID_LOG_H
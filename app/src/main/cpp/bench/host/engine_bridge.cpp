@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for the default-engine bridge that spatial_audio.cpp defines
+ * in the app, so ai_audio_processor.cpp links into host tools. Tools render
+ * through engines of their own; this one only backs the handle-less calls.
+ */
+#include "audio_engine.h"
+#include "spatial_audio_bridge.h"
+
+static AudioEngine defaultEngine;
+
+AudioEngine& getDefaultEngine() { return defaultEngine; }
+ParametricEQ& getEngineEqualizer() { return defaultEngine.equalizer(); }
+BassBoost& getEngineBassBoost() { return defaultEngine.bassBoost(); }
+Virtualizer& getEngineVirtualizer() { return defaultEngine.virtualizer(); }
+Spatializer& getEngineSpatializer() { return defaultEngine.spatializer(); }
+Crossfeed& getEngineCrossfeed() { return defaultEngine.crossfeed(); }
+Limiter& getEngineLimiter() { return defaultEngine.limiter(); }
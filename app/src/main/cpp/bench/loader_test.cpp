@@ -0,0 +1,710 @@
+/*
+ * Loader test: feeds the parsers that read files from outside the app
+ * (FLAC and AIFF audio, .hrir sets, the vector index) well-formed input,
+ * every truncation of it, bit-flipped copies and hand-built bad headers.
+ * Well-formed input must decode exactly; anything else must be rejected or
+ * yield only data that was really there, never read out of bounds.
+ *
+ * Usage: loader_test   (exit status 0 when every check passes)
+ *
+ * Registered with CTest. Out-of-bounds reads are only certain to show up
+ * under a sanitizer build:
+ *   cmake -S app/src/main/cpp/bench -B build-asan -DCMAKE_BUILD_TYPE=Debug \
+ *         -DCMAKE_CXX_FLAGS=-fsanitize=address,undefined
+ *   cmake --build build-asan && ctest --test-dir build-asan --output-on-failure
+ */
+#include "audio_file.h"
+#include "flac_decoder.h"
+#include "hrir_set.h"
+#include "vector_index.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                          \
+        }                                                                        \
+    } while (0)
+
+using Bytes = std::vector<uint8_t>;
+
+// Exactly-sized heap copy, so a sanitizer catches any read past the end
+Bytes prefix(const Bytes& bytes, size_t length) { return Bytes(bytes.begin(), bytes.begin() + length); }
+
+// Prefix lengths worth trying: all of the first 'dense' bytes, then a stride
+std::vector<size_t> truncations(size_t size, size_t dense, size_t stride) {
+    std::vector<size_t> lengths;
+    for (size_t n = 0; n < size; n += n < dense ? 1 : stride) lengths.push_back(n);
+    return lengths;
+}
+
+void flipBytes(Bytes& bytes, std::mt19937& rng, size_t from) {
+    const int flips = 1 + static_cast<int>(rng() % 4);
+    for (int i = 0; i < flips; ++i) {
+        const size_t at = from + rng() % (bytes.size() - from);
+        bytes[at] ^= static_cast<uint8_t>(1 + rng() % 255);
+    }
+}
+
+void putBe16(Bytes& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void putBe32(Bytes& out, uint32_t v) {
+    putBe16(out, v >> 16);
+    putBe16(out, v & 0xFFFF);
+}
+
+void setBe32(Bytes& out, size_t at, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[at + i] = static_cast<uint8_t>(v >> (24 - 8 * i));
+}
+
+void putLe32(Bytes& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void putTag(Bytes& out, const char* tag) { out.insert(out.end(), tag, tag + 4); }
+
+void putFloat(Bytes& out, float f) {
+    uint32_t v;
+    std::memcpy(&v, &f, 4);
+    putLe32(out, v);
+}
+
+// Two channels of 16-bit test signal: tones plus a little noise
+std::vector<int32_t> testSignal(int frames) {
+    std::vector<int32_t> samples(static_cast<size_t>(frames) * 2);
+    std::mt19937 rng(1);
+    for (int i = 0; i < frames; ++i) {
+        const double noise = static_cast<double>(rng() % 201) - 100.0;
+        samples[i * 2] = static_cast<int32_t>(std::lround(12000.0 * std::sin(i * 0.031) + noise));
+        samples[i * 2 + 1] = static_cast<int32_t>(std::lround(9000.0 * std::sin(i * 0.0073 + 1.0) - noise));
+    }
+    return samples;
+}
+
+// ---------------------------------------------------------------- FLAC
+
+class BitWriter {
+public:
+    void put(uint32_t value, int n) {
+        for (int i = n - 1; i >= 0; --i) {
+            current = static_cast<uint8_t>((current << 1) | ((value >> i) & 1));
+            if (++used == 8) flush();
+        }
+    }
+
+    void align() {
+        while (used != 0) put(0, 1);
+    }
+
+    Bytes& bytes() { return out; }
+
+private:
+    Bytes out;
+    uint8_t current = 0;
+    int used = 0;
+
+    void flush() {
+        out.push_back(current);
+        current = 0;
+        used = 0;
+    }
+};
+
+uint8_t crc8(const uint8_t* p, size_t n) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= p[i];
+        for (int bit = 0; bit < 8; ++bit) crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+    return crc;
+}
+
+uint16_t crc16(const uint8_t* p, size_t n) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= static_cast<uint16_t>(p[i] << 8);
+        for (int bit = 0; bit < 8; ++bit) crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+    }
+    return crc;
+}
+
+constexpr int FLAC_RATE = 44100;
+constexpr int FLAC_BLOCK = 1024;
+constexpr int FLAC_FRAMES = 4 * FLAC_BLOCK + 300; // the last block is short
+
+void writeResidual(BitWriter& w, const std::vector<int32_t>& residual) {
+    uint64_t sum = 0;
+    for (int32_t r : residual) sum += static_cast<uint32_t>((r << 1) ^ (r >> 31));
+    int parameter = 0;
+    while (parameter < 14 && (uint64_t{1} << (parameter + 1)) * residual.size() < sum) ++parameter;
+    w.put(0, 2); // 4-bit Rice parameters
+    w.put(0, 4); // one partition
+    w.put(static_cast<uint32_t>(parameter), 4);
+    for (int32_t r : residual) {
+        const uint32_t value = static_cast<uint32_t>((r << 1) ^ (r >> 31));
+        for (uint32_t q = value >> parameter; q > 0; --q) w.put(0, 1);
+        w.put(1, 1);
+        w.put(value & ((1u << parameter) - 1), parameter);
+    }
+}
+
+// Constant, verbatim or fixed order 2, whichever the frame index picks
+void writeSubframe(BitWriter& w, const std::vector<int32_t>& x, int sampleBits, int frameIndex) {
+    const uint32_t mask = sampleBits == 32 ? ~0u : (1u << sampleBits) - 1;
+    if (std::all_of(x.begin(), x.end(), [&](int32_t v) { return v == x[0]; })) {
+        w.put(0, 8);
+        w.put(static_cast<uint32_t>(x[0]) & mask, sampleBits);
+    } else if (frameIndex % 2 == 0) {
+        w.put(1 << 1, 8);
+        for (int32_t v : x) w.put(static_cast<uint32_t>(v) & mask, sampleBits);
+    } else {
+        w.put(10 << 1, 8);
+        w.put(static_cast<uint32_t>(x[0]) & mask, sampleBits);
+        w.put(static_cast<uint32_t>(x[1]) & mask, sampleBits);
+        std::vector<int32_t> residual;
+        for (size_t i = 2; i < x.size(); ++i) residual.push_back(x[i] - 2 * x[i - 1] + x[i - 2]);
+        writeResidual(w, residual);
+    }
+}
+
+// Independent and left/side stereo frames, alternating, plus a silent last block
+Bytes encodeFlac(const std::vector<int32_t>& samples, int frames) {
+    Bytes out = {'f', 'L', 'a', 'C', 0x80, 0, 0, 34};
+    putBe16(out, FLAC_BLOCK); // min block
+    putBe16(out, FLAC_BLOCK); // max block
+    for (int i = 0; i < 6; ++i) out.push_back(0); // frame sizes unknown
+    const uint64_t packed = (static_cast<uint64_t>(FLAC_RATE) << 44) | (uint64_t{1} << 41) | (uint64_t{15} << 36) |
+                            static_cast<uint64_t>(frames);
+    for (int i = 7; i >= 0; --i) out.push_back(static_cast<uint8_t>(packed >> (8 * i)));
+    for (int i = 0; i < 16; ++i) out.push_back(0); // MD5 not computed
+
+    int frameIndex = 0;
+    for (int start = 0; start < frames; start += FLAC_BLOCK, ++frameIndex) {
+        const int n = std::min(FLAC_BLOCK, frames - start);
+        const bool leftSide = frameIndex % 2 == 1;
+        BitWriter w;
+        w.put(0xFFF8, 16);
+        w.put(n == FLAC_BLOCK ? 10 : 7, 4); // 256 << 2, or a 16-bit length below
+        w.put(9, 4);                        // 44.1 kHz
+        w.put(leftSide ? 8 : 1, 4);
+        w.put(4, 3);                        // 16-bit
+        w.put(0, 1);
+        w.put(static_cast<uint32_t>(frameIndex), 8);
+        if (n != FLAC_BLOCK) w.put(static_cast<uint32_t>(n - 1), 16);
+        w.put(crc8(w.bytes().data(), w.bytes().size()), 8);
+
+        std::vector<int32_t> left(n), right(n);
+        for (int i = 0; i < n; ++i) {
+            left[i] = samples[(start + i) * 2];
+            right[i] = samples[(start + i) * 2 + 1];
+        }
+        if (leftSide) {
+            for (int i = 0; i < n; ++i) right[i] = left[i] - right[i];
+        }
+        writeSubframe(w, left, 16, frameIndex);
+        writeSubframe(w, right, leftSide ? 17 : 16, frameIndex);
+        w.align();
+        const uint16_t crc = crc16(w.bytes().data(), w.bytes().size());
+        w.put(crc, 16);
+        out.insert(out.end(), w.bytes().begin(), w.bytes().end());
+    }
+    return out;
+}
+
+struct FlacBlock {
+    int start;
+    int frames;
+};
+
+/*
+ * Drains the decoder and checks that every frame it returns is one of the
+ * encoded blocks, in order, sample for sample. Returns the blocks decoded.
+ */
+int drainFlac(FlacDecoder& decoder, const std::vector<int32_t>& samples, int frames) {
+    std::vector<FlacBlock> blocks;
+    for (int start = 0; start < frames; start += FLAC_BLOCK) blocks.push_back({start, std::min(FLAC_BLOCK, frames - start)});
+    size_t next = 0;
+    int decoded = 0;
+    for (int n; (n = decoder.decodeFrame()) > 0; ++decoded) {
+        CHECK(n <= FLAC_BLOCK);
+        if (decoder.channels() != 2) continue;
+        const auto matches = [&](const FlacBlock& block) {
+            if (block.frames != n) return false;
+            for (int ch = 0; ch < 2; ++ch) {
+                for (int i = 0; i < n; ++i) {
+                    if (decoder.channelData(ch)[i] != samples[(block.start + i) * 2 + ch]) return false;
+                }
+            }
+            return true;
+        };
+        while (next < blocks.size() && !matches(blocks[next])) ++next;
+        CHECK(next < blocks.size());
+        if (next < blocks.size()) ++next;
+    }
+    return decoded;
+}
+
+void testFlac() {
+    const std::vector<int32_t> samples = testSignal(FLAC_FRAMES);
+    // A silent final block exercises the constant subframe
+    std::vector<int32_t> signal = samples;
+    std::fill(signal.begin() + 4 * FLAC_BLOCK * 2, signal.end(), 0);
+    const Bytes flac = encodeFlac(signal, FLAC_FRAMES);
+    const size_t headerBytes = 4 + 4 + 34;
+
+    FlacDecoder decoder;
+    CHECK(decoder.open(flac.data(), flac.size()));
+    CHECK(decoder.channels() == 2 && decoder.sampleRate() == FLAC_RATE && decoder.bitsPerSample() == 16);
+    CHECK(decoder.totalFrames() == FLAC_FRAMES);
+    CHECK(drainFlac(decoder, signal, FLAC_FRAMES) == 5);
+
+    // The same behind an ID3v2 tag, read as float through PcmReader
+    Bytes tagged = {'I', 'D', '3', 4, 0, 0, 0, 0, 0, 20};
+    tagged.resize(30, 0);
+    tagged.insert(tagged.end(), flac.begin(), flac.end());
+    PcmReader reader;
+    CHECK(reader.open(tagged.data(), tagged.size()));
+    CHECK(reader.pcm() == nullptr && reader.frames() == FLAC_FRAMES);
+    std::vector<float> chunk(700 * 2);
+    int64_t read = 0;
+    bool exact = true;
+    for (int n; (n = reader.read(chunk.data(), 700)) > 0; read += n) {
+        for (int i = 0; i < n * 2; ++i) exact &= chunk[i] == static_cast<float>(signal[read * 2 + i]) / 32768.0f;
+    }
+    CHECK(read == FLAC_FRAMES && exact);
+
+    // Every truncation: the header fails cleanly, then whole frames only
+    for (size_t length : truncations(flac.size(), headerBytes + 64, 5)) {
+        const Bytes cut = prefix(flac, length);
+        FlacDecoder d;
+        const bool opened = d.open(cut.data(), cut.size());
+        CHECK(opened == (length >= headerBytes));
+        if (opened) drainFlac(d, signal, FLAC_FRAMES);
+    }
+
+    // Damage anywhere after the header costs frames, never wrong samples
+    for (uint32_t seed = 0; seed < 400; ++seed) {
+        std::mt19937 rng(seed);
+        Bytes damaged = flac;
+        flipBytes(damaged, rng, headerBytes);
+        FlacDecoder d;
+        CHECK(d.open(damaged.data(), damaged.size()));
+        drainFlac(d, signal, FLAC_FRAMES);
+    }
+    // Damage in the header may change the format, but must stay in bounds
+    for (uint32_t seed = 0; seed < 400; ++seed) {
+        std::mt19937 rng(seed);
+        Bytes damaged = prefix(flac, headerBytes + 600);
+        damaged[4 + rng() % (headerBytes - 4)] ^= static_cast<uint8_t>(1 + rng() % 255);
+        FlacDecoder d;
+        if (d.open(damaged.data(), damaged.size())) {
+            while (d.decodeFrame() > 0) {
+            }
+        }
+    }
+
+    const auto rejects = [](Bytes bytes) {
+        FlacDecoder d;
+        return !d.open(bytes.data(), bytes.size());
+    };
+    Bytes bad = flac;
+    bad[10] = 0; bad[11] = 8;                         // max block 8
+    CHECK(rejects(bad));
+    bad = flac;
+    bad[18] = bad[19] = 0; bad[20] &= 0x0F;           // sample rate 0
+    CHECK(rejects(bad));
+    bad = flac;
+    bad[5] = 0xFF; bad[6] = 0xFF; bad[7] = 0xFF;      // block longer than the file
+    CHECK(rejects(bad));
+    bad = flac;
+    bad[7] = 20;                                      // STREAMINFO too short
+    CHECK(rejects(bad));
+    bad = flac;
+    bad[4] = 0x81;                                    // padding only, no STREAMINFO
+    CHECK(rejects(bad));
+    bad = flac;
+    bad[4] = 0x00;                                    // "more blocks" runs into frame data
+    CHECK(rejects(prefix(bad, headerBytes + 2)));
+    bad = tagged;
+    bad[6] = bad[7] = bad[8] = bad[9] = 0x7F;         // ID3 tag larger than the file
+    CHECK(rejects(bad));
+    CHECK(rejects(Bytes{'f', 'L', 'a', 'X', 0x80, 0, 0, 34}));
+}
+
+// ---------------------------------------------------------------- AIFF
+
+// 80-bit IEEE extended, as COMM stores the sample rate
+void putExtended(Bytes& out, double value) {
+    int exponent = 0;
+    const double mantissa = std::frexp(value, &exponent); // [0.5, 1)
+    putBe16(out, static_cast<uint32_t>(16383 + exponent - 1));
+    const auto bits = static_cast<uint64_t>(std::ldexp(mantissa, 64));
+    putBe32(out, static_cast<uint32_t>(bits >> 32));
+    putBe32(out, static_cast<uint32_t>(bits));
+}
+
+constexpr int AIFF_FRAMES = 3000;
+
+// 16-bit stereo AIFF, or AIFF-C "sowt" (little endian) when sowt is set
+Bytes encodeAiff(const std::vector<int32_t>& samples, bool sowt) {
+    Bytes out;
+    putTag(out, "FORM");
+    putBe32(out, 0); // set below
+    putTag(out, sowt ? "AIFC" : "AIFF");
+    putTag(out, "COMM");
+    putBe32(out, sowt ? 22 : 18);
+    putBe16(out, 2);
+    putBe32(out, AIFF_FRAMES);
+    putBe16(out, 16);
+    putExtended(out, 44100.0);
+    if (sowt) putTag(out, "sowt");
+    putTag(out, "SSND");
+    putBe32(out, 8 + AIFF_FRAMES * 4);
+    putBe32(out, 0); // offset
+    putBe32(out, 0); // block size
+    for (int32_t s : samples) {
+        const auto v = static_cast<uint16_t>(s);
+        if (sowt) {
+            out.push_back(static_cast<uint8_t>(v));
+            out.push_back(static_cast<uint8_t>(v >> 8));
+        } else {
+            putBe16(out, v);
+        }
+    }
+    setBe32(out, 4, static_cast<uint32_t>(out.size() - 8));
+    return out;
+}
+
+// Whatever parseAiff accepts must lie inside the file; reads it all
+bool checkAiffBounds(const Bytes& bytes) {
+    PcmStreamInfo info{};
+    if (!parseAiff(bytes.data(), bytes.size(), info)) return false;
+    CHECK(info.channels > 0 && info.frames >= 0);
+    CHECK(info.dataOffset + static_cast<size_t>(info.frames) * info.frameBytes() <= bytes.size());
+    PcmReader reader;
+    CHECK(reader.open(bytes.data(), bytes.size()));
+    // Damage can declare thousands of channels; keep the chunk small anyway
+    const int chunkFrames = std::max(1, 4096 / info.channels);
+    std::vector<float> chunk(static_cast<size_t>(chunkFrames) * info.channels);
+    int64_t read = 0;
+    for (int n; (n = reader.read(chunk.data(), chunkFrames)) > 0;) read += n;
+    CHECK(read == info.frames);
+    return true;
+}
+
+void testAiff() {
+    const std::vector<int32_t> samples = testSignal(AIFF_FRAMES);
+    const size_t dataOffset = 12 + 8 + 18 + 8 + 8;
+
+    for (bool sowt : {false, true}) {
+        const Bytes aiff = encodeAiff(samples, sowt);
+        PcmStreamInfo info{};
+        CHECK(parseAiff(aiff.data(), aiff.size(), info));
+        CHECK(info.format == SampleFormat::S16 && info.channels == 2 && info.sampleRate == 44100);
+        CHECK(info.frames == AIFF_FRAMES && info.bigEndian == !sowt);
+        CHECK(info.dataOffset == dataOffset + (sowt ? 4 : 0));
+        PcmReader reader;
+        CHECK(reader.open(aiff.data(), aiff.size()) && reader.pcm() != nullptr);
+        std::vector<float> all(static_cast<size_t>(AIFF_FRAMES) * 2);
+        CHECK(reader.read(all.data(), AIFF_FRAMES) == AIFF_FRAMES);
+        bool exact = true;
+        for (size_t i = 0; i < all.size(); ++i) exact &= all[i] == static_cast<float>(samples[i]) / 32768.0f;
+        CHECK(exact);
+
+        // A cut inside the samples keeps the whole frames before it
+        for (size_t length : truncations(aiff.size(), dataOffset + 64, 3)) {
+            const Bytes cut = prefix(aiff, length);
+            const bool parsed = checkAiffBounds(cut);
+            const size_t start = dataOffset + (sowt ? 4 : 0);
+            CHECK(parsed == (length >= start));
+            if (parsed) {
+                PcmStreamInfo cutInfo{};
+                parseAiff(cut.data(), cut.size(), cutInfo);
+                CHECK(cutInfo.frames == static_cast<int64_t>((length - start) / 4));
+            }
+        }
+        for (uint32_t seed = 0; seed < 500; ++seed) {
+            std::mt19937 rng(seed);
+            Bytes damaged = prefix(aiff, dataOffset + 400);
+            flipBytes(damaged, rng, 0);
+            checkAiffBounds(damaged);
+        }
+    }
+
+    const Bytes aiff = encodeAiff(samples, false);
+    const auto parses = [](const Bytes& bytes, PcmStreamInfo& info) { return parseAiff(bytes.data(), bytes.size(), info); };
+    PcmStreamInfo info{};
+    Bytes bad = aiff;
+    setBe32(bad, 22, 0xFFFFFFFF); // more frames declared than stored
+    CHECK(parses(bad, info) && info.frames == AIFF_FRAMES);
+    bad = aiff;
+    setBe32(bad, 42, 0xFFFFFFF0); // SSND larger than the file
+    CHECK(parses(bad, info) && info.frames == AIFF_FRAMES);
+    bad = aiff;
+    setBe32(bad, 46, 0xFFFFFFF0); // SSND offset past its end
+    CHECK(!parses(bad, info));
+    bad = aiff;
+    setBe32(bad, 16, 0xFFFFFFF0); // COMM larger than the file
+    CHECK(!parses(bad, info));
+    bad = aiff;
+    bad[27] = 8;                  // 8-bit
+    CHECK(!parses(bad, info));
+    bad = aiff;
+    bad[20] = bad[21] = 0;        // no channels
+    CHECK(!parses(bad, info));
+    bad = aiff;
+    bad[28] = bad[29] = 0x7F;     // sample rate exponent out of range
+    CHECK(!parses(bad, info));
+    bad = aiff;
+    std::memcpy(bad.data() + 12, "JUNK", 4); // no COMM
+    CHECK(!parses(bad, info));
+    bad = encodeAiff(samples, true);
+    std::memcpy(bad.data() + 38, "ulaw", 4);  // compressed AIFF-C
+    CHECK(!parses(bad, info));
+}
+
+// ---------------------------------------------------------------- files
+
+class TempDir {
+public:
+    TempDir() {
+        char pattern[] = "/tmp/loader_test.XXXXXX";
+        if (mkdtemp(pattern) != nullptr) path = pattern;
+    }
+
+    ~TempDir() {
+        for (const std::string& file : files) unlink(file.c_str());
+        if (!path.empty()) rmdir(path.c_str());
+    }
+
+    bool ok() const { return !path.empty(); }
+
+    std::string write(const char* name, const Bytes& bytes) {
+        const std::string file = path + "/" + name;
+        FILE* f = std::fopen(file.c_str(), "wb");
+        if (f != nullptr) {
+            if (!bytes.empty()) std::fwrite(bytes.data(), 1, bytes.size(), f);
+            std::fclose(f);
+        }
+        if (std::find(files.begin(), files.end(), file) == files.end()) files.push_back(file);
+        return file;
+    }
+
+    std::string file(const char* name) {
+        const std::string f = path + "/" + name;
+        if (std::find(files.begin(), files.end(), f) == files.end()) files.push_back(f);
+        return f;
+    }
+
+private:
+    std::string path;
+    std::vector<std::string> files;
+};
+
+Bytes readFile(const std::string& path) {
+    Bytes bytes;
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) return bytes;
+    uint8_t buffer[4096];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0;) bytes.insert(bytes.end(), buffer, buffer + n);
+    std::fclose(f);
+    return bytes;
+}
+
+// ---------------------------------------------------------------- HRIR
+
+constexpr int HRIR_RATE = 48000;
+constexpr int HRIR_LENGTH = 64;
+constexpr int HRIR_DIRECTIONS = 4;
+
+Bytes encodeHrir() {
+    Bytes out = {'S', 'U', 'V', 'H', 'R', 'I', 'R', '1'};
+    putLe32(out, 1);
+    putLe32(out, HRIR_RATE);
+    putLe32(out, HRIR_LENGTH);
+    putLe32(out, HRIR_DIRECTIONS);
+    putLe32(out, 0);
+    putLe32(out, 0);
+    for (int d = 0; d < HRIR_DIRECTIONS; ++d) {
+        putFloat(out, static_cast<float>(d) * 1.5f - 2.0f);
+        putFloat(out, 0.1f * static_cast<float>(d));
+    }
+    for (int d = 0; d < HRIR_DIRECTIONS; ++d) {
+        for (int ear = 0; ear < 2; ++ear) {
+            for (int i = 0; i < HRIR_LENGTH; ++i) putFloat(out, i == 4 + d + ear ? 1.0f : 0.01f * ((i % 3) - 1));
+        }
+    }
+    return out;
+}
+
+void testHrir(TempDir& dir) {
+    const Bytes hrir = encodeHrir();
+    const std::unique_ptr<HrirSet> set = HrirSet::loadFile(dir.write("set.hrir", hrir).c_str());
+    CHECK(set != nullptr);
+    if (set != nullptr) {
+        CHECK(set->sampleRate() == HRIR_RATE && set->irLength() == HRIR_LENGTH);
+        CHECK(set->numDirections() == HRIR_DIRECTIONS);
+        CHECK(set->ir(2, 1)[7] == 1.0f && set->onset(2, 1) == 7);
+        CHECK(std::fabs(set->direction(3).elevation - 0.3f) < 1e-6f);
+        const HrirSet* lower = set->forRate(44100);
+        CHECK(lower != set.get() && lower->irLength() == 59);
+        int indices[HrirSet::MAX_NEIGHBOURS];
+        float weights[HrirSet::MAX_NEIGHBOURS];
+        CHECK(set->nearest(-0.5f, 0.1f, indices, weights) >= 1 && indices[0] == 1);
+    }
+
+    // Anything short of the declared data is refused
+    for (size_t length : truncations(hrir.size(), 40, 97)) {
+        CHECK(HrirSet::loadFile(dir.write("cut.hrir", prefix(hrir, length)).c_str()) == nullptr);
+    }
+
+    const auto loads = [&](const Bytes& bytes) { return HrirSet::loadFile(dir.write("bad.hrir", bytes).c_str()) != nullptr; };
+    const auto withField = [&](size_t offset, uint32_t value) {
+        Bytes bad = hrir;
+        for (int i = 0; i < 4; ++i) bad[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+        return bad;
+    };
+    Bytes bad = hrir;
+    bad[7] = '2';
+    CHECK(!loads(bad));
+    CHECK(!loads(withField(8, 2)));       // version
+    CHECK(!loads(withField(12, 7999)));   // sample rate
+    CHECK(!loads(withField(12, 400000)));
+    CHECK(!loads(withField(16, 15)));     // IR length
+    CHECK(!loads(withField(16, 4097)));
+    CHECK(!loads(withField(20, 0)));      // direction count
+    CHECK(!loads(withField(20, 16385)));
+    CHECK(!loads(withField(20, 16384)));  // in range, but the file is far too short
+    CHECK(!loads(withField(16, 4096)));
+    CHECK(HrirSet::loadFile(dir.file("missing.hrir").c_str()) == nullptr);
+    // Trailing bytes are tolerated
+    bad = hrir;
+    bad.resize(hrir.size() + 13, 0xAB);
+    CHECK(loads(bad));
+}
+
+// ---------------------------------------------------------------- vector index
+
+constexpr int INDEX_DIM = 8;
+constexpr int INDEX_M = 4;
+constexpr int INDEX_SONGS = 80;
+
+std::vector<float> indexVectors(int count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal;
+    std::vector<float> vectors(static_cast<size_t>(count) * INDEX_DIM);
+    for (float& v : vectors) v = normal(rng);
+    return vectors;
+}
+
+std::vector<std::string> searchIds(const VectorIndex& index, const float* query) {
+    std::vector<std::string> ids(10);
+    std::vector<float> similarities(10);
+    ids.resize(static_cast<size_t>(index.search(query, 10, 40, ids.data(), similarities.data())));
+    return ids;
+}
+
+void testVectorIndex(TempDir& dir) {
+    std::vector<std::string> ids;
+    for (int i = 0; i < INDEX_SONGS; ++i) ids.push_back("song-" + std::to_string(i));
+    const std::vector<float> vectors = indexVectors(INDEX_SONGS, 7);
+    VectorIndex source(INDEX_DIM, INDEX_M, 32);
+    CHECK(source.add(ids.data(), INDEX_SONGS, vectors.data()));
+    CHECK(source.remove(ids.data() + 10, 5) == 5); // deleted nodes are saved too
+    const std::string path = dir.file("index.bin");
+    CHECK(source.save(path.c_str()));
+    const Bytes saved = readFile(path);
+    CHECK(!saved.empty());
+
+    const std::vector<float> query = indexVectors(1, 99);
+    VectorIndex loaded(INDEX_DIM, INDEX_M, 32);
+    CHECK(loaded.load(path.c_str()));
+    CHECK(loaded.size() == INDEX_SONGS - 5);
+    CHECK(searchIds(loaded, query.data()) == searchIds(source, query.data()));
+
+    // A failed load leaves the index as it was
+    const std::string other = "other";
+    const std::vector<float> otherVector = indexVectors(1, 3);
+    VectorIndex target(INDEX_DIM, INDEX_M, 32);
+    target.add(&other, 1, otherVector.data());
+    const auto unchanged = [&] { return target.size() == 1 && searchIds(target, query.data()) == std::vector<std::string>{other}; };
+
+    for (size_t length : truncations(saved.size(), 64, 11)) {
+        CHECK(!target.load(dir.write("cut.bin", prefix(saved, length)).c_str()));
+    }
+    CHECK(unchanged());
+    CHECK(!target.load(dir.file("missing.bin").c_str()));
+    CHECK(unchanged());
+
+    // Damage is refused, or loads something searches can walk safely
+    for (uint32_t seed = 0; seed < 300; ++seed) {
+        std::mt19937 rng(seed);
+        Bytes damaged = saved;
+        flipBytes(damaged, rng, 0);
+        VectorIndex index(INDEX_DIM, INDEX_M, 32);
+        index.add(&other, 1, otherVector.data());
+        if (index.load(dir.write("damaged.bin", damaged).c_str())) {
+            CHECK(index.size() <= INDEX_SONGS);
+            searchIds(index, query.data());
+            std::vector<int32_t> positions(ids.size());
+            std::vector<float> similarities(ids.size());
+            index.searchAmong(query.data(), ids.data(), INDEX_SONGS, 5, 20, positions.data(), similarities.data());
+            index.add(ids.data(), 3, vectors.data());
+        } else {
+            CHECK(index.size() == 1);
+        }
+    }
+
+    // Counts whose sections add up to far more than the file (and would
+    // wrap a 32-bit size_t) are refused
+    Bytes huge = saved;
+    for (size_t offset : {size_t{24}, size_t{36}, size_t{40}}) { // nodeCount, upperLinkCount, idBytes
+        for (int i = 0; i < 4; ++i) huge[offset + i] = offset == 24 ? (i == 3 ? 0x01 : 0x00) : 0xFF;
+    }
+    CHECK(!target.load(dir.write("huge.bin", huge).c_str()));
+    CHECK(unchanged());
+
+    // Built with other parameters
+    VectorIndex wider(INDEX_DIM + 1, INDEX_M, 32);
+    CHECK(!wider.load(path.c_str()));
+    VectorIndex denser(INDEX_DIM, INDEX_M * 2, 32);
+    CHECK(!denser.load(path.c_str()));
+}
+
+} // namespace
+
+int main() {
+    TempDir dir;
+    if (!dir.ok()) {
+        std::fprintf(stderr, "cannot create a temporary directory\n");
+        return 1;
+    }
+    testFlac();
+    testAiff();
+    testHrir(dir);
+    testVectorIndex(dir);
+    if (failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all loader checks passed\n");
+    return 0;
+}
@@ -0,0 +1,512 @@
+/*
+ * Offline renderer: runs WAV files through the same AudioEngine chain that
+ * nProcess / nProcessPcm16 drive on the device, faster than real time.
+ *
+ * Usage: offline_render [options] input.wav...
+ *   --preset=FILE.json   preset as a JSON object (keys below)
+ *   --set=KEY=VALUE      override one preset key; repeatable
+ *   --out-dir=DIR        where processed files go (same name and format)
+ *   --null               render without writing output
+ *   --jobs=N             files rendered in parallel (default: all cores)
+ *   --block=FRAMES       callback size handed to the engine (default 1024)
+ *   --format=table|csv   report format
+ *
+ * Preset keys are the AIAudioState fields, applied through
+ * AIAudioProcessor::applyState exactly as nApplyAIState does:
+ *   eqEnabled, eqBands (10 values in dB), bassBoost, virtualizer,
+ *   spatialEnabled, crossfeedEnabled, limiterThresholdDb, limiterRatio,
+ *   limiterAttackMs, limiterReleaseMs, limiterMakeupGain
+ * plus the settings the player sets outside that path:
+ *   eqPreampDb, crossfeedStrength, pitch, azimuth, elevation,
+ *   limiterEnabled, truePeak, balance
+ *
+ * For every file the report gives the real-time factor of the DSP alone
+ * (audio duration / CPU time inside the engine) and an FNV-1a hash of the
+ * rendered PCM, so two builds can be compared for output and CPU cost
+ * without keeping the renders around.
+ */
+#include "ai_audio_processor.h"
+#include "audio_engine.h"
+#include "audio_file.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Preset {
+    AIAudioState state{
+        false, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 0.0f, 0.0f, false, false,
+        // SpatialAudioProcessor's limiter settings
+        -0.3f, 12.0f, 1.0f, 80.0f, 0.0f};
+    float eqPreampDb = 0.0f;
+    float crossfeedStrength = -1.0f; // < 0: keep applyState's
+    float pitch = 1.0f;
+    float azimuth = 0.0f;
+    float elevation = 0.0f;
+    int limiterEnabled = -1; // < 0: keep applyState's (on)
+    int truePeak = -1;
+    float balance = 0.0f;
+};
+
+struct Options {
+    Preset preset;
+    std::vector<std::string> inputs;
+    std::string outDir;
+    bool writeOutput = true;
+    int jobs = 0;
+    int blockFrames = 1024;
+    bool csv = false;
+};
+
+struct FileResult {
+    bool ok = false;
+    std::string error;
+    int channels = 0;
+    int sampleRate = 0;
+    double audioSeconds = 0.0;
+    double dspSeconds = 0.0;
+    double wallSeconds = 0.0;
+    uint64_t hash = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Preset parsing: a flat JSON object of numbers, booleans and number arrays
+
+struct Value {
+    std::vector<double> numbers;
+    bool isArray = false;
+};
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : s(text) {}
+
+    bool parseObject(Preset& preset, std::string& error) {
+        skip();
+        if (!take('{')) return fail(error, "expected '{'");
+        skip();
+        if (take('}')) return true;
+        for (;;) {
+            std::string key;
+            Value value;
+            if (!parseString(key)) return fail(error, "expected a key");
+            skip();
+            if (!take(':')) return fail(error, "expected ':'");
+            if (!parseValue(value)) return fail(error, "bad value for " + key);
+            if (!applyValue(preset, key, value, error)) return false;
+            skip();
+            if (take('}')) return true;
+            if (!take(',')) return fail(error, "expected ',' or '}'");
+            skip();
+        }
+    }
+
+    bool parseValue(Value& value) {
+        skip();
+        if (take('[')) {
+            value.isArray = true;
+            skip();
+            if (take(']')) return true;
+            for (;;) {
+                double number;
+                if (!parseScalar(number)) return false;
+                value.numbers.push_back(number);
+                skip();
+                if (take(']')) return true;
+                if (!take(',')) return false;
+            }
+        }
+        double number;
+        if (!parseScalar(number)) return false;
+        value.numbers.push_back(number);
+        return true;
+    }
+
+    bool atEnd() {
+        skip();
+        return pos == s.size();
+    }
+
+    static bool applyValue(Preset& preset, const std::string& key, const Value& value, std::string& error);
+
+private:
+    const std::string& s;
+    size_t pos = 0;
+
+    static bool fail(std::string& error, const std::string& message) {
+        error = message;
+        return false;
+    }
+
+    void skip() {
+        while (pos < s.size() && std::isspace(static_cast<unsigned char>(s[pos]))) ++pos;
+    }
+
+    bool take(char c) {
+        if (pos < s.size() && s[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseString(std::string& out) {
+        if (!take('"')) return false;
+        const size_t end = s.find('"', pos);
+        if (end == std::string::npos) return false;
+        out = s.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    }
+
+    bool parseScalar(double& out) {
+        skip();
+        if (s.compare(pos, 4, "true") == 0) { pos += 4; out = 1.0; return true; }
+        if (s.compare(pos, 5, "false") == 0) { pos += 5; out = 0.0; return true; }
+        const char* start = s.c_str() + pos;
+        char* end = nullptr;
+        out = std::strtod(start, &end);
+        if (end == start) return false;
+        pos += static_cast<size_t>(end - start);
+        return true;
+    }
+};
+
+bool Parser::applyValue(Preset& preset, const std::string& key, const Value& value, std::string& error) {
+    AIAudioState& st = preset.state;
+    if (key == "eqBands") {
+        if (value.numbers.size() != 10) {
+            error = "eqBands needs 10 values";
+            return false;
+        }
+        for (int i = 0; i < 10; ++i) st.eqBands[i] = static_cast<float>(value.numbers[i]);
+        return true;
+    }
+    if (value.isArray || value.numbers.size() != 1) {
+        error = key + " takes a single value";
+        return false;
+    }
+    const double v = value.numbers[0];
+    const float f = static_cast<float>(v);
+    if (key == "eqEnabled") st.eqEnabled = v != 0.0;
+    else if (key == "bassBoost") st.bassBoost = f;
+    else if (key == "virtualizer") st.virtualizer = f;
+    else if (key == "spatialEnabled") st.spatialEnabled = v != 0.0;
+    else if (key == "crossfeedEnabled") st.crossfeedEnabled = v != 0.0;
+    else if (key == "limiterThresholdDb") st.limiterThresholdDb = f;
+    else if (key == "limiterRatio") st.limiterRatio = f;
+    else if (key == "limiterAttackMs") st.limiterAttackMs = f;
+    else if (key == "limiterReleaseMs") st.limiterReleaseMs = f;
+    else if (key == "limiterMakeupGain") st.limiterMakeupGain = f;
+    else if (key == "eqPreampDb") preset.eqPreampDb = f;
+    else if (key == "crossfeedStrength") preset.crossfeedStrength = f;
+    else if (key == "pitch") preset.pitch = f;
+    else if (key == "azimuth") preset.azimuth = f;
+    else if (key == "elevation") preset.elevation = f;
+    else if (key == "limiterEnabled") preset.limiterEnabled = v != 0.0;
+    else if (key == "truePeak") preset.truePeak = v != 0.0;
+    else if (key == "balance") preset.balance = f;
+    else {
+        error = "unknown preset key " + key;
+        return false;
+    }
+    return true;
+}
+
+bool loadPreset(const char* path, Preset& preset) {
+    FILE* f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        std::fprintf(stderr, "cannot read %s\n", path);
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    std::fclose(f);
+
+    Parser parser(text);
+    std::string error;
+    if (!parser.parseObject(preset, error) || !parser.atEnd()) {
+        std::fprintf(stderr, "%s: %s\n", path, error.empty() ? "trailing characters" : error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// KEY=VALUE, where VALUE is a JSON scalar or array ("1,2,3" is accepted for arrays too)
+bool applyOverride(const std::string& assignment, Preset& preset) {
+    const size_t eq = assignment.find('=');
+    if (eq == std::string::npos) {
+        std::fprintf(stderr, "--set expects KEY=VALUE, got %s\n", assignment.c_str());
+        return false;
+    }
+    const std::string key = assignment.substr(0, eq);
+    std::string text = assignment.substr(eq + 1);
+    if (text.find(',') != std::string::npos && text.front() != '[') text = "[" + text + "]";
+
+    Parser parser(text);
+    Value value;
+    std::string error;
+    if (!parser.parseValue(value) || !parser.atEnd()) error = "bad value " + text;
+    if (error.empty()) Parser::applyValue(preset, key, value, error);
+    if (!error.empty()) {
+        std::fprintf(stderr, "--set %s: %s\n", assignment.c_str(), error.c_str());
+        return false;
+    }
+    return true;
+}
+
+void applyPreset(AudioEngine& engine, const Preset& preset) {
+    AIAudioProcessor::applyState(engine, preset.state);
+    engine.equalizer().setPreamp(preset.eqPreampDb);
+    if (preset.crossfeedStrength >= 0.0f) {
+        engine.crossfeed().setParams(preset.state.crossfeedEnabled, preset.crossfeedStrength);
+    }
+    engine.pitchShifter().setParams(preset.pitch);
+    if (preset.limiterEnabled == 0) engine.limiter().setEnabled(false);
+    if (preset.truePeak >= 0) engine.limiter().setTruePeakEnabled(preset.truePeak != 0);
+    engine.limiter().setBalance(preset.balance);
+}
+
+// ---------------------------------------------------------------------------
+// Rendering
+
+void writeLe16(FILE* f, uint16_t v) {
+    const uint8_t b[2] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8)};
+    std::fwrite(b, 1, 2, f);
+}
+
+void writeLe32(FILE* f, uint32_t v) {
+    const uint8_t b[4] = {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8),
+                          static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24)};
+    std::fwrite(b, 1, 4, f);
+}
+
+// Canonical 44-byte header; the data size is patched in once known
+void writeWavHeader(FILE* f, const PcmStreamInfo& info, uint32_t dataBytes) {
+    const int sampleBytes = bytesPerSample(info.format);
+    std::fwrite("RIFF", 1, 4, f);
+    writeLe32(f, 36 + dataBytes);
+    std::fwrite("WAVEfmt ", 1, 8, f);
+    writeLe32(f, 16);
+    writeLe16(f, info.format == SampleFormat::F32 ? 3 : 1);
+    writeLe16(f, static_cast<uint16_t>(info.channels));
+    writeLe32(f, static_cast<uint32_t>(info.sampleRate));
+    writeLe32(f, static_cast<uint32_t>(info.sampleRate * info.frameBytes()));
+    writeLe16(f, static_cast<uint16_t>(info.frameBytes()));
+    writeLe16(f, static_cast<uint16_t>(sampleBytes * 8));
+    std::fwrite("data", 1, 4, f);
+    writeLe32(f, dataBytes);
+}
+
+// CPU time of the calling thread, so workers sharing cores are not charged
+// for each other's time slices
+double threadCpuNs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) * 1e9 + static_cast<double>(ts.tv_nsec);
+}
+
+uint64_t fnv1a(uint64_t hash, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::string baseName(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+FileResult renderFile(const std::string& path, const Options& options) {
+    FileResult result;
+    const auto wallStart = Clock::now();
+
+    MappedFile input(path.c_str());
+    PcmStreamInfo info;
+    if (!input.isOpen()) {
+        result.error = "cannot open";
+        return result;
+    }
+    if (!parseWav(input.data(), input.size(), info)) {
+        result.error = "not a supported WAV file";
+        return result;
+    }
+    result.channels = info.channels;
+    result.sampleRate = info.sampleRate;
+    result.audioSeconds = static_cast<double>(info.frames) / info.sampleRate;
+
+    FILE* out = nullptr;
+    if (options.writeOutput) {
+        const std::string outPath = options.outDir + "/" + baseName(path);
+        out = std::fopen(outPath.c_str(), "wb");
+        if (out == nullptr) {
+            result.error = "cannot write " + outPath;
+            return result;
+        }
+        writeWavHeader(out, info, 0);
+    }
+
+    auto engine = std::make_unique<AudioEngine>();
+    applyPreset(*engine, options.preset);
+
+    const int frameBytes = info.frameBytes();
+    std::vector<uint8_t> block(static_cast<size_t>(options.blockFrames) * frameBytes);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    double dspNs = 0.0;
+    const uint8_t* data = input.data() + info.dataOffset;
+
+    for (int64_t start = 0; start < info.frames; start += options.blockFrames) {
+        const int frames = static_cast<int>(std::min<int64_t>(options.blockFrames, info.frames - start));
+        const size_t bytes = static_cast<size_t>(frames) * frameBytes;
+        std::memcpy(block.data(), data + start * frameBytes, bytes);
+
+        const double t0 = threadCpuNs();
+        switch (info.format) {
+            case SampleFormat::S16:
+                engine->processPcm16(reinterpret_cast<int16_t*>(block.data()), frames, info.channels, info.sampleRate,
+                                     options.preset.azimuth, options.preset.elevation);
+                break;
+            case SampleFormat::S24:
+                engine->processPcm24(block.data(), frames, info.channels, info.sampleRate,
+                                     options.preset.azimuth, options.preset.elevation);
+                break;
+            case SampleFormat::S32:
+                engine->processPcm32(reinterpret_cast<int32_t*>(block.data()), frames, info.channels, info.sampleRate,
+                                     options.preset.azimuth, options.preset.elevation);
+                break;
+            case SampleFormat::F32:
+                engine->processFloat(reinterpret_cast<float*>(block.data()), frames, info.channels, info.sampleRate,
+                                     options.preset.azimuth, options.preset.elevation);
+                break;
+        }
+        dspNs += threadCpuNs() - t0;
+
+        hash = fnv1a(hash, block.data(), bytes);
+        if (out != nullptr) std::fwrite(block.data(), 1, bytes, out);
+    }
+
+    if (out != nullptr) {
+        const uint32_t dataBytes = static_cast<uint32_t>(std::min<int64_t>(info.frames * frameBytes, 0xFFFFFFF0LL));
+        std::fseek(out, 0, SEEK_SET);
+        writeWavHeader(out, info, dataBytes);
+        if (std::fclose(out) != 0) {
+            result.error = "write failed";
+            return result;
+        }
+    }
+
+    result.ok = true;
+    result.hash = hash;
+    result.dspSeconds = dspNs * 1e-9;
+    result.wallSeconds = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    return result;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--preset=", 0) == 0) {
+            if (!loadPreset(arg.c_str() + 9, options.preset)) return false;
+        } else if (arg.rfind("--set=", 0) == 0) {
+            if (!applyOverride(arg.substr(6), options.preset)) return false;
+        } else if (arg.rfind("--out-dir=", 0) == 0) {
+            options.outDir = arg.substr(10);
+        } else if (arg == "--null") {
+            options.writeOutput = false;
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            options.jobs = std::atoi(arg.c_str() + 7);
+        } else if (arg.rfind("--block=", 0) == 0) {
+            options.blockFrames = std::max(1, std::atoi(arg.c_str() + 8));
+        } else if (arg == "--format=csv") {
+            options.csv = true;
+        } else if (arg == "--format=table") {
+            options.csv = false;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    if (options.inputs.empty() || (options.writeOutput && options.outDir.empty())) {
+        std::fprintf(stderr, "usage: %s [--preset=FILE.json] [--set=KEY=VALUE]... (--out-dir=DIR | --null) "
+                             "[--jobs=N] [--block=FRAMES] [--format=table|csv] input.wav...\n", argv[0]);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 2;
+
+    const int hardware = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int jobs = std::min<int>(options.jobs > 0 ? options.jobs : hardware, static_cast<int>(options.inputs.size()));
+
+    std::vector<FileResult> results(options.inputs.size());
+    std::atomic<size_t> next{0};
+    const auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int j = 0; j < jobs; ++j) {
+        workers.emplace_back([&] {
+            for (size_t i; (i = next.fetch_add(1)) < options.inputs.size();) {
+                results[i] = renderFile(options.inputs[i], options);
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    const double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    int failures = 0;
+    double totalAudio = 0.0;
+    double totalDsp = 0.0;
+    if (options.csv) {
+        std::printf("file,channels,sample_rate,audio_s,dsp_s,realtime_factor,hash,error\n");
+    } else {
+        std::printf("%-40s %3s %6s %9s %9s %10s %18s\n", "file", "ch", "rate", "audio_s", "dsp_s", "x realtime", "fnv1a");
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        const FileResult& r = results[i];
+        const std::string name = baseName(options.inputs[i]);
+        if (!r.ok) {
+            ++failures;
+            if (options.csv) std::printf("%s,,,,,,,%s\n", name.c_str(), r.error.c_str());
+            else std::printf("%-40s %s\n", name.c_str(), r.error.c_str());
+            continue;
+        }
+        totalAudio += r.audioSeconds;
+        totalDsp += r.dspSeconds;
+        const double rtf = r.dspSeconds > 0.0 ? r.audioSeconds / r.dspSeconds : 0.0;
+        if (options.csv) {
+            std::printf("%s,%d,%d,%.3f,%.4f,%.1f,%016llx,\n", name.c_str(), r.channels, r.sampleRate, r.audioSeconds,
+                        r.dspSeconds, rtf, static_cast<unsigned long long>(r.hash));
+        } else {
+            std::printf("%-40s %3d %6d %9.2f %9.3f %10.1f   %016llx\n", name.c_str(), r.channels, r.sampleRate,
+                        r.audioSeconds, r.dspSeconds, rtf, static_cast<unsigned long long>(r.hash));
+        }
+    }
+    std::fprintf(stderr, "%zu files, %.1f s of audio in %.2f s on %d threads: %.1fx real time per core, "
+                         "%.1fx overall\n",
+                 results.size() - failures, totalAudio, wallSeconds, jobs,
+                 totalDsp > 0.0 ? totalAudio / totalDsp : 0.0, wallSeconds > 0.0 ? totalAudio / wallSeconds : 0.0);
+    return failures == 0 ? 0 : 1;
+}
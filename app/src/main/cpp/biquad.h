@@ -14,78 +14,21 @@ enum FilterType {
     HIGH_SHELF
 };
 
-class Biquad {
-public:
-    Biquad() : type(PEAKING), frequency(1000.0f), q(1.0f), gainDb(0.0f), sampleRate(44100) {
-        reset();
-    }
-
-    void setParams(FilterType type, float frequency, float q, float gainDb, int sampleRate) {
-        this->type = type;
-        this->frequency = frequency;
-        this->q = q;
-        this->gainDb = gainDb;
-        this->sampleRate = sampleRate;
-        calculateCoefficients();
-    }
-    
-    void updateGain(float gainDb) {
-        if (std::abs(this->gainDb - gainDb) < 0.01f) return;
-        this->gainDb = gainDb;
-        calculateCoefficients();
-    }
-
-    float getGainDb() const {
-        return gainDb;
-    }
-
-    void process(float* buffer, int numFrames, int numChannels) {
-        // Clamp to max supported channels to prevent buffer overflow
-        const int safeChannels = numChannels > 8 ? 8 : numChannels;
-        for (int i = 0; i < numFrames; ++i) {
-            for (int ch = 0; ch < safeChannels; ++ch) {
-                float in = buffer[i * numChannels + ch];
-                
-                // Direct Form I
-                float out = b0 * in + b1 * x1[ch] + b2 * x2[ch] - a1 * y1[ch] - a2 * y2[ch];
-                
-                // Shift states
-                x2[ch] = x1[ch];
-                x1[ch] = in;
-                y2[ch] = y1[ch];
-                y1[ch] = out;
-                
-                buffer[i * numChannels + ch] = out;
-            }
-        }
-    }
-    
-    void reset() {
-        for (int i = 0; i < 8; ++i) {
-            x1[i] = 0.0f; x2[i] = 0.0f;
-            y1[i] = 0.0f; y2[i] = 0.0f;
-        }
-        calculateCoefficients();
-    }
-
-private:
-    FilterType type;
-    float frequency;
-    float q;
-    float gainDb;
-    int sampleRate;
-
-    // Coefficients
-    float b0, b1, b2, a0, a1, a2;
-    
-    // State variables (support up to 8 channels)
-    float x1[8], x2[8], y1[8], y2[8];
+/**
+ * Normalized biquad coefficients (a0 == 1). Computed on the control thread and
+ * published to the render thread inside parameter snapshots, so the audio path
+ * never evaluates pow/sin/cos.
+ */
+struct BiquadCoeffs {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+    float a1 = 0.0f, a2 = 0.0f;
 
-    void calculateCoefficients() {
+    static BiquadCoeffs design(FilterType type, float frequency, float q, float gainDb, int sampleRate) {
         float A = pow(10.0f, gainDb / 40.0f);
         float w0 = 2.0f * M_PI * frequency / sampleRate;
         float alpha = sin(w0) / (2.0f * q);
         float cosW0 = cos(w0);
+        float b0, b1, b2, a0, a1, a2;
 
         switch (type) {
             case LOW_SHELF:
@@ -118,11 +61,13 @@ private:
         }
 
         // Normalize
-        b0 /= a0;
-        b1 /= a0;
-        b2 /= a0;
-        a1 /= a0;
-        a2 /= a0;
+        BiquadCoeffs c;
+        c.b0 = b0 / a0;
+        c.b1 = b1 / a0;
+        c.b2 = b2 / a0;
+        c.a1 = a1 / a0;
+        c.a2 = a2 / a0;
+        return c;
     }
 };
 
@@ -0,0 +1,224 @@
+#ifndef BIQUAD_CASCADE_H
+#define BIQUAD_CASCADE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "biquad.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BIQUAD_CASCADE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BIQUAD_CASCADE_SSE2 1
+#endif
+
+/**
+ * Series of biquad sections applied in a single sweep over the buffer.
+ *
+ * The buffer is walked in sub-blocks of BLOCK_FRAMES that stay in L1 while
+ * every active section runs over them, so memory is streamed once no matter
+ * how many sections are active. Sections use transposed Direct Form II (two
+ * state words per channel); stereo is processed as one 2-lane vector per
+ * frame.
+ *
+ * A slot passed as nullptr is skipped entirely once its state has died away.
+ * A slot that was active still holds the state of its last input, so it
+ * first keeps running as a unity-gain section (b == a, same poles) that adds
+ * the remaining ringing to the output, until |s1| + |s2| over its channels
+ * falls below TAIL_THRESHOLD. Dropping the state at once would cut that
+ * tail off and click, e.g. when an EQ band is dragged back to 0 dB.
+ *
+ * Layouts wider than MAX_CHANNELS are passed through untouched (no sections
+ * and no input gain), since there is state for MAX_CHANNELS channels only.
+ *
+ * Render thread only.
+ */
+class BiquadCascade {
+public:
+    static constexpr int MAX_SLOTS = 16;
+    static constexpr int MAX_CHANNELS = 8;
+    static constexpr int BLOCK_FRAMES = 64;
+    static constexpr float TAIL_THRESHOLD = 1e-6f; // -120 dB
+
+    BiquadCascade() {
+        reset();
+    }
+
+    /**
+     * @param sections  One entry per slot; nullptr bypasses the slot.
+     * @param numSlots  Number of entries in sections (<= MAX_SLOTS).
+     * @param inputGain Linear gain folded into the same pass (e.g. EQ preamp).
+     *
+     * Does nothing when numChannels > MAX_CHANNELS.
+     */
+    void process(float* buffer, int numFrames, int numChannels,
+                 const BiquadCoeffs* const* sections, int numSlots, float inputGain) {
+        if (numChannels > MAX_CHANNELS) return;
+        numSlots = std::min(numSlots, MAX_SLOTS);
+
+        // Compact the active and still-ringing sections into SoA coefficient arrays
+        int activeSlots[MAX_SLOTS];
+        int numActive = 0;
+        for (int slot = 0; slot < numSlots; ++slot) {
+            if (sections[slot] == nullptr) {
+                if (state[slot] == SlotState::Active) state[slot] = SlotState::Tail;
+                if (state[slot] == SlotState::Off) continue;
+                // Unity gain with the last poles: lets the held state ring out
+                b0[numActive] = 1.0f; b1[numActive] = lastA1[slot]; b2[numActive] = lastA2[slot];
+                a1[numActive] = lastA1[slot]; a2[numActive] = lastA2[slot];
+                activeSlots[numActive++] = slot;
+                continue;
+            }
+            // A slot coming back while still ringing keeps its state
+            if (state[slot] == SlotState::Off) clearSlot(slot);
+            state[slot] = SlotState::Active;
+            const BiquadCoeffs& c = *sections[slot];
+            b0[numActive] = c.b0; b1[numActive] = c.b1; b2[numActive] = c.b2;
+            a1[numActive] = c.a1; a2[numActive] = c.a2;
+            lastA1[slot] = c.a1; lastA2[slot] = c.a2;
+            activeSlots[numActive++] = slot;
+        }
+
+        if (numActive == 0) {
+            if (inputGain != 1.0f) {
+                for (int i = 0; i < numFrames * numChannels; ++i) buffer[i] *= inputGain;
+            }
+            return;
+        }
+
+        for (int start = 0; start < numFrames; start += BLOCK_FRAMES) {
+            const int frames = std::min(BLOCK_FRAMES, numFrames - start);
+            float* block = buffer + start * numChannels;
+
+            if (inputGain != 1.0f) {
+                for (int i = 0; i < frames * numChannels; ++i) block[i] *= inputGain;
+            }
+            for (int k = 0; k < numActive; ++k) {
+                const int slot = activeSlots[k];
+                if (numChannels == 2) {
+                    processStereo(block, frames, k, slot);
+                } else {
+                    for (int ch = 0; ch < numChannels; ++ch) {
+                        processChannel(block + ch, frames, numChannels, k, slot, ch);
+                    }
+                }
+            }
+        }
+
+        for (int k = 0; k < numActive; ++k) {
+            const int slot = activeSlots[k];
+            if (state[slot] == SlotState::Tail && stateMagnitude(slot) < TAIL_THRESHOLD) {
+                clearSlot(slot);
+                state[slot] = SlotState::Off;
+            }
+        }
+    }
+
+    void reset() {
+        for (int slot = 0; slot < MAX_SLOTS; ++slot) {
+            clearSlot(slot);
+            state[slot] = SlotState::Off;
+            lastA1[slot] = lastA2[slot] = 0.0f;
+        }
+    }
+
+    // Whether a slot no longer passed in is still ringing out
+    bool isRinging() const {
+        for (SlotState slotState : state) {
+            if (slotState == SlotState::Tail) return true;
+        }
+        return false;
+    }
+
+    void resetSlots(int first, int count) {
+        for (int slot = first; slot < first + count && slot < MAX_SLOTS; ++slot) clearSlot(slot);
+    }
+
+private:
+    // Coefficients of the currently active sections, compacted (SoA)
+    float b0[MAX_SLOTS], b1[MAX_SLOTS], b2[MAX_SLOTS], a1[MAX_SLOTS], a2[MAX_SLOTS];
+
+    // TDF-II state per slot, channel-contiguous so stereo pairs load as one vector
+    alignas(16) float s1[MAX_SLOTS][MAX_CHANNELS];
+    alignas(16) float s2[MAX_SLOTS][MAX_CHANNELS];
+
+    // Tail: no longer passed in, running at unity gain until its state dies away
+    enum class SlotState : uint8_t { Off, Active, Tail };
+    SlotState state[MAX_SLOTS];
+    // Feedback coefficients the slot last ran with, for its tail
+    float lastA1[MAX_SLOTS], lastA2[MAX_SLOTS];
+
+    void clearSlot(int slot) {
+        for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+            s1[slot][ch] = 0.0f;
+            s2[slot][ch] = 0.0f;
+        }
+    }
+
+    float stateMagnitude(int slot) const {
+        float sum = 0.0f;
+        for (int ch = 0; ch < MAX_CHANNELS; ++ch) sum += std::abs(s1[slot][ch]) + std::abs(s2[slot][ch]);
+        return sum;
+    }
+
+    void processChannel(float* data, int frames, int stride, int k, int slot, int ch) {
+        const float cb0 = b0[k], cb1 = b1[k], cb2 = b2[k], ca1 = a1[k], ca2 = a2[k];
+        float z1 = s1[slot][ch], z2 = s2[slot][ch];
+        for (int i = 0; i < frames; ++i) {
+            const float x = data[i * stride];
+            const float y = cb0 * x + z1;
+            z1 = cb1 * x - ca1 * y + z2;
+            z2 = cb2 * x - ca2 * y;
+            data[i * stride] = y;
+        }
+        s1[slot][ch] = z1;
+        s2[slot][ch] = z2;
+    }
+
+    void processStereo(float* data, int frames, int k, int slot) {
+#if BIQUAD_CASCADE_NEON
+        const float32x2_t cb0 = vdup_n_f32(b0[k]), cb1 = vdup_n_f32(b1[k]), cb2 = vdup_n_f32(b2[k]);
+        const float32x2_t ca1 = vdup_n_f32(a1[k]), ca2 = vdup_n_f32(a2[k]);
+        float32x2_t z1 = vld1_f32(s1[slot]), z2 = vld1_f32(s2[slot]);
+        for (int i = 0; i < frames; ++i) {
+            const float32x2_t x = vld1_f32(data + i * 2);
+            const float32x2_t y = vmla_f32(z1, cb0, x);
+            z1 = vmls_f32(vmla_f32(z2, cb1, x), ca1, y);
+            z2 = vmls_f32(vmul_f32(cb2, x), ca2, y);
+            vst1_f32(data + i * 2, y);
+        }
+        vst1_f32(s1[slot], z1);
+        vst1_f32(s2[slot], z2);
+#elif BIQUAD_CASCADE_SSE2
+        // Lanes 0/1 carry L/R; the upper lanes stay zero
+        const __m128 cb0 = _mm_set1_ps(b0[k]), cb1 = _mm_set1_ps(b1[k]), cb2 = _mm_set1_ps(b2[k]);
+        const __m128 ca1 = _mm_set1_ps(a1[k]), ca2 = _mm_set1_ps(a2[k]);
+        __m128 z1 = loadPair(s1[slot]), z2 = loadPair(s2[slot]);
+        for (int i = 0; i < frames; ++i) {
+            const __m128 x = loadPair(data + i * 2);
+            const __m128 y = _mm_add_ps(_mm_mul_ps(cb0, x), z1);
+            z1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(cb1, x), z2), _mm_mul_ps(ca1, y));
+            z2 = _mm_sub_ps(_mm_mul_ps(cb2, x), _mm_mul_ps(ca2, y));
+            storePair(data + i * 2, y);
+        }
+        storePair(s1[slot], z1);
+        storePair(s2[slot], z2);
+#else
+        processChannel(data, frames, 2, k, slot, 0);
+        processChannel(data + 1, frames, 2, k, slot, 1);
+#endif
+    }
+
+#if BIQUAD_CASCADE_SSE2
+    static inline __m128 loadPair(const float* p) {
+        return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)));
+    }
+    static inline void storePair(float* p, __m128 v) {
+        _mm_store_sd(reinterpret_cast<double*>(p), _mm_castps_pd(v));
+    }
+#endif
+};
+
+#endif // BIQUAD_CASCADE_H
@@ -0,0 +1,78 @@
+#include "biquad_coeff_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static constexpr int COMMON_SAMPLE_RATES[] = {44100, 48000, 88200, 96000};
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+BiquadCoeffCache& BiquadCoeffCache::instance() {
+    static BiquadCoeffCache cache;
+    return cache;
+}
+
+int32_t BiquadCoeffCache::gainStep(float gainDb) {
+    return static_cast<int32_t>(lrintf(gainDb / GAIN_STEP_DB));
+}
+
+BiquadCoeffs BiquadCoeffCache::get(FilterType type, float frequency, float q, float gainDb, int sampleRate) {
+    const int32_t step = gainStep(gainDb);
+    const uint32_t fBits = floatBits(frequency);
+    const uint32_t qBits = floatBits(q);
+
+    uint64_t h = (static_cast<uint64_t>(fBits) << 32) ^ qBits;
+    h ^= (static_cast<uint64_t>(static_cast<uint32_t>(step)) << 24) ^ (static_cast<uint64_t>(sampleRate) << 2) ^ type;
+    h *= 0x9E3779B97F4A7C15ull;
+    uint32_t index = static_cast<uint32_t>(h >> 40) & (CAPACITY - 1);
+
+    auto matches = [&](const Entry& e) {
+        return e.type == static_cast<uint32_t>(type) && e.frequencyBits == fBits && e.qBits == qBits &&
+               e.sampleRate == static_cast<uint32_t>(sampleRate) && e.gainStep == step;
+    };
+    auto design = [&]() {
+        // Keep the centre frequency below Nyquist for low-rate streams
+        float safeFrequency = std::min(frequency, 0.45f * static_cast<float>(sampleRate));
+        return BiquadCoeffs::design(type, safeFrequency, q, step * GAIN_STEP_DB, sampleRate);
+    };
+
+    for (int probe = 0; probe < MAX_PROBES; ++probe, index = (index + 1) & (CAPACITY - 1)) {
+        Entry& e = entries[index];
+        uint32_t state = e.state.load(std::memory_order_acquire);
+        if (state == READY) {
+            if (matches(e)) {
+                BiquadCoeffs c;
+                c.b0 = e.b0; c.b1 = e.b1; c.b2 = e.b2; c.a1 = e.a1; c.a2 = e.a2;
+                return c;
+            }
+            continue;
+        }
+        if (state == WRITING) continue; // another thread is filling it; probe on
+
+        BiquadCoeffs coeffs = design();
+        if (e.state.compare_exchange_strong(state, WRITING, std::memory_order_acquire)) {
+            e.type = static_cast<uint32_t>(type);
+            e.frequencyBits = fBits;
+            e.qBits = qBits;
+            e.sampleRate = static_cast<uint32_t>(sampleRate);
+            e.gainStep = step;
+            e.b0 = coeffs.b0; e.b1 = coeffs.b1; e.b2 = coeffs.b2;
+            e.a1 = coeffs.a1; e.a2 = coeffs.a2;
+            e.state.store(READY, std::memory_order_release);
+        }
+        return coeffs;
+    }
+
+    // Table region is saturated: serve the design uncached
+    return design();
+}
+
+void BiquadCoeffCache::prewarm(FilterType type, float frequency, float q, float gainDb, int extraSampleRate) {
+    for (int rate : COMMON_SAMPLE_RATES) get(type, frequency, q, gainDb, rate);
+    if (extraSampleRate > 0) get(type, frequency, q, gainDb, extraSampleRate);
+}
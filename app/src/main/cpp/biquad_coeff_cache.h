@@ -0,0 +1,51 @@
+#ifndef BIQUAD_COEFF_CACHE_H
+#define BIQUAD_COEFF_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include "biquad.h"
+
+/**
+ * Process-wide cache of designed biquad coefficients keyed by
+ * (filter type, frequency, Q, gain quantized to 0.1 dB, sample rate).
+ *
+ * Lookups are lock-free and safe from the render thread. Entries are
+ * insert-only and never evicted; when the table is full, misses are designed
+ * on the fly without being stored. Setters prewarm every common sample rate,
+ * so a track switching between 44.1/48/96 kHz or a replayed preset resolves
+ * from the table without any pow/sin/cos.
+ */
+class BiquadCoeffCache {
+public:
+    static constexpr float GAIN_STEP_DB = 0.1f;
+
+    static BiquadCoeffCache& instance();
+
+    BiquadCoeffs get(FilterType type, float frequency, float q, float gainDb, int sampleRate);
+
+    // Control thread: designs the filter at each common rate plus extraSampleRate (if > 0).
+    void prewarm(FilterType type, float frequency, float q, float gainDb, int extraSampleRate);
+
+    static int32_t gainStep(float gainDb);
+
+private:
+    static constexpr int CAPACITY = 8192; // power of two
+    static constexpr int MAX_PROBES = 32;
+
+    enum : uint32_t { EMPTY = 0, WRITING = 1, READY = 2 };
+
+    struct Entry {
+        std::atomic<uint32_t> state;
+        uint32_t type;
+        uint32_t frequencyBits;
+        uint32_t qBits;
+        uint32_t sampleRate;
+        int32_t gainStep;
+        // Plain floats rather than BiquadCoeffs so the table stays zero-initialized (.bss)
+        float b0, b1, b2, a1, a2;
+    };
+
+    Entry entries[CAPACITY];
+};
+
+#endif // BIQUAD_COEFF_CACHE_H
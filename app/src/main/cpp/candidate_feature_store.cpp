@@ -0,0 +1,73 @@
+#include "candidate_feature_store.h"
+#include <cstring>
+
+void CandidateFeatureStore::upsert(const std::string* ids, int count, uint32_t columnMask, const float* values,
+                                   int32_t* slots) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < count; ++i) {
+        auto [it, inserted] = slotById.try_emplace(ids[i], 0);
+        if (inserted) {
+            int32_t slot;
+            if (!freeSlots.empty()) {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+                for (auto& column : columns) column[slot] = 0.0f;
+                live[slot] = 1;
+            } else {
+                slot = static_cast<int32_t>(live.size());
+                for (auto& column : columns) column.push_back(0.0f);
+                live.push_back(1);
+            }
+            it->second = slot;
+        }
+        slots[i] = it->second;
+    }
+
+    // Column by column, so each pass streams one input run into one column
+    const float* run = values;
+    for (int feature = 0; feature < NUM_FEATURES; ++feature) {
+        if (!(columnMask & (1u << feature))) continue;
+        float* column = columns[feature].data();
+        for (int i = 0; i < count; ++i) column[slots[i]] = run[i];
+        run += count;
+    }
+}
+
+int CandidateFeatureStore::remove(const std::string* ids, int count) {
+    std::lock_guard<std::mutex> guard(lock);
+    int removed = 0;
+    for (int i = 0; i < count; ++i) {
+        auto it = slotById.find(ids[i]);
+        if (it == slotById.end()) continue;
+        live[it->second] = 0;
+        freeSlots.push_back(it->second);
+        slotById.erase(it);
+        ++removed;
+    }
+    return removed;
+}
+
+bool CandidateFeatureStore::gather(const int32_t* slots, int count, uint32_t overrideMask, const float* overrides,
+                                   float* out) const {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int i = 0; i < count; ++i) {
+        if (slots[i] < 0 || static_cast<size_t>(slots[i]) >= live.size() || !live[slots[i]]) return false;
+    }
+    const float* run = overrides;
+    for (int feature = 0; feature < NUM_FEATURES; ++feature) {
+        float* dst = out + static_cast<size_t>(feature) * count;
+        if (overrideMask & (1u << feature)) {
+            std::memcpy(dst, run, static_cast<size_t>(count) * sizeof(float));
+            run += count;
+        } else {
+            const float* column = columns[feature].data();
+            for (int i = 0; i < count; ++i) dst[i] = column[slots[i]];
+        }
+    }
+    return true;
+}
+
+int CandidateFeatureStore::size() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<int>(slotById.size());
+}
@@ -0,0 +1,54 @@
+#ifndef CANDIDATE_FEATURE_STORE_H
+#define CANDIDATE_FEATURE_STORE_H
+
+#include "recommendation_kernels.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Scoring features of every song the recommender has seen, kept native
+ * between requests in the SoA layout score_candidates reads.
+ *
+ * Each song owns a row (slot) from its first upsert until it is removed, so
+ * callers can hold on to slots and name candidates by them. Upserts write
+ * only the columns they are given; removed rows are recycled. Scoring a
+ * request gathers the requested rows into a scratch table, substituting
+ * the columns that only make sense per request (such as the variety
+ * penalty, which depends on candidate order).
+ *
+ * Thread-safe.
+ */
+class CandidateFeatureStore {
+public:
+    /**
+     * Writes the features in columnMask (bit j = feature j) for each of the
+     * count ids, adding missing ids with all other features 0. values holds
+     * count floats per set bit, in ascending feature order. Each id's slot is
+     * stored in slots.
+     */
+    void upsert(const std::string* ids, int count, uint32_t columnMask, const float* values, int32_t* slots);
+
+    // Removes the ids' rows; returns how many existed
+    int remove(const std::string* ids, int count);
+
+    /**
+     * Copies the rows at slots into out [NUM_FEATURES * count] (SoA), taking
+     * the features in overrideMask from overrides (count floats per set bit,
+     * ascending) instead. False if any slot is not a live row.
+     */
+    bool gather(const int32_t* slots, int count, uint32_t overrideMask, const float* overrides, float* out) const;
+
+    int size() const;
+
+private:
+    mutable std::mutex lock;
+    std::vector<float> columns[NUM_FEATURES];
+    std::vector<uint8_t> live;
+    std::vector<int32_t> freeSlots;
+    std::unordered_map<std::string, int32_t> slotById;
+};
+
+#endif // CANDIDATE_FEATURE_STORE_H
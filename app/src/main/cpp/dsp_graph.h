@@ -0,0 +1,159 @@
+#ifndef DSP_GRAPH_H
+#define DSP_GRAPH_H
+
+#include <atomic>
+#include <cstdint>
+#include "audio_engine_components.h"
+#include "dsp_profiler.h"
+#include "limiter.h"
+#include "param_snapshot.h"
+#include "pitch_shifter.h"
+
+/**
+ * Flat, precompiled version of the effect chain.
+ *
+ * prepare() rebuilds the list of active kernels only when the global config
+ * version or the channel count changes; run() then executes just
+ * those kernels with no per-stage enabled checks. Adjacent linear stereo
+ * stages are fused: the virtualizer's mid/side matrix and the limiter's
+ * makeup gain and balance collapse into one 2x2 matrix pass whenever nothing
+ * nonlinear or stateful sits between them.
+ *
+ * Render thread only.
+ */
+class DspGraph {
+public:
+    struct Stages {
+        Crossfeed* crossfeed;
+        ParametricEQ* equalizer;
+        BassBoost* bassBoost;
+        ToneStage* toneStage;
+        Virtualizer* virtualizer;
+        PitchShifter* pitchShifter;
+        Spatializer* spatializer;
+        Limiter* limiter;
+    };
+
+    explicit DspGraph(const Stages& stages) : stages(stages) {}
+
+    /**
+     * Recompiles if the configuration moved. Returns false when every stage is
+     * neutral, in which case the caller may leave its buffer untouched.
+     */
+    bool prepare(int numChannels) {
+        const uint32_t version = g_dspConfigVersion.load(std::memory_order_acquire);
+        if (version != compiledVersion || numChannels != compiledChannels) {
+            compile(numChannels);
+            compiledVersion = version;
+            compiledChannels = numChannels;
+        }
+        return numKernels > 0;
+    }
+
+    // profiler: times each kernel when non-null (see CallbackTimer)
+    void run(float* buffer, int numFrames, int numChannels, int sampleRate, float azimuth, float elevation,
+             DspProfiler* profiler = nullptr) {
+        for (int k = 0; k < numKernels; ++k) {
+            const Kernel& kernel = kernels[k];
+            StageTimer timer(profiler, stageOf(kernel.op));
+            switch (kernel.op) {
+                case Op::Crossfeed:
+                    stages.crossfeed->process(buffer, numFrames, numChannels, sampleRate);
+                    break;
+                case Op::Tone:
+                    stages.toneStage->process(*stages.equalizer, *stages.bassBoost, buffer, numFrames, numChannels, sampleRate);
+                    break;
+                case Op::StereoMatrix:
+                    applyStereoMatrix(kernel.matrix, buffer, numFrames);
+                    break;
+                case Op::PitchShift:
+                    stages.pitchShifter->process(buffer, numFrames, numChannels, sampleRate);
+                    break;
+                case Op::Spatialize:
+                    stages.spatializer->process(buffer, numFrames, numChannels, azimuth, elevation, sampleRate);
+                    break;
+                case Op::Limit:
+                    stages.limiter->process(buffer, numFrames, numChannels, sampleRate, kernel.applyPreGain);
+                    break;
+            }
+        }
+    }
+
+private:
+    enum class Op : uint8_t { Crossfeed, Tone, StereoMatrix, PitchShift, Spatialize, Limit };
+
+    struct Kernel {
+        Op op;
+        bool applyPreGain;
+        float matrix[4]; // row-major [LL, LR, RL, RR] for StereoMatrix
+    };
+
+    static constexpr int MAX_KERNELS = 8;
+
+    static DspStage stageOf(Op op) {
+        switch (op) {
+            case Op::Crossfeed: return DspStage::Crossfeed;
+            case Op::Tone: return DspStage::Tone;
+            case Op::StereoMatrix: return DspStage::StereoMatrix;
+            case Op::PitchShift: return DspStage::PitchShift;
+            case Op::Spatialize: return DspStage::Spatialize;
+            case Op::Limit: return DspStage::Limit;
+        }
+        return DspStage::Limit;
+    }
+
+    Stages stages;
+    Kernel kernels[MAX_KERNELS];
+    int numKernels = 0;
+    uint32_t compiledVersion = 0;
+    int compiledChannels = 0;
+
+    void push(Op op) {
+        Kernel& k = kernels[numKernels++];
+        k.op = op;
+        k.applyPreGain = true;
+    }
+
+    void compile(int numChannels) {
+        numKernels = 0;
+        if (stages.crossfeed->isActive(numChannels)) push(Op::Crossfeed);
+        if (stages.toneStage->isActive(*stages.equalizer, *stages.bassBoost)) push(Op::Tone);
+
+        const bool virtualize = stages.virtualizer->isActive(numChannels);
+        const bool pitch = stages.pitchShifter->isActive(numChannels);
+        const bool spatialize = stages.spatializer->isActive(numChannels);
+        const bool limit = stages.limiter->isEnabled();
+
+        if (virtualize) {
+            push(Op::StereoMatrix);
+            Kernel& matrix = kernels[numKernels - 1];
+            stages.virtualizer->getMatrix(matrix.matrix);
+
+            // Limiter pre-gain is diagonal; fold it in when the two are adjacent
+            if (limit && !pitch && !spatialize) {
+                float gainL, gainR;
+                stages.limiter->getPreGains(gainL, gainR);
+                matrix.matrix[0] *= gainL; matrix.matrix[1] *= gainL;
+                matrix.matrix[2] *= gainR; matrix.matrix[3] *= gainR;
+            }
+        }
+        if (pitch) push(Op::PitchShift);
+        if (spatialize) push(Op::Spatialize);
+        if (limit) {
+            push(Op::Limit);
+            kernels[numKernels - 1].applyPreGain = !(virtualize && !pitch && !spatialize);
+        }
+    }
+
+    static void applyStereoMatrix(const float m[4], float* buffer, int numFrames) {
+        const float ll = m[0], lr = m[1], rl = m[2], rr = m[3];
+        for (int i = 0; i < numFrames; ++i) {
+            const float l = buffer[i * 2];
+            const float r = buffer[i * 2 + 1];
+            buffer[i * 2] = ll * l + lr * r;
+            buffer[i * 2 + 1] = rl * l + rr * r;
+        }
+    }
+};
+
+#endif // DSP_GRAPH_H
@@ -0,0 +1,112 @@
+#include "dsp_profiler.h"
+
+namespace {
+
+// Single writer: a load and a store are enough, and cheaper than an RMW
+template <typename T>
+inline void bump(std::atomic<T>& counter, T amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline void raise(std::atomic<T>& counter, T value) {
+    if (value > counter.load(std::memory_order_relaxed)) counter.store(value, std::memory_order_relaxed);
+}
+
+int timeBucket(uint64_t ns) {
+    if (ns < 1024) return 0;
+    const int log2 = 63 - __builtin_clzll(ns);
+    const int bucket = log2 - 9;
+    return bucket < DspProfiler::TIME_BUCKETS ? bucket : DspProfiler::TIME_BUCKETS - 1;
+}
+
+double measureNsPerTick() {
+#if defined(__aarch64__)
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return frequency > 0 ? 1e9 / static_cast<double>(frequency) : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+} // namespace
+
+void DspProfiler::Timing::record(uint64_t ns) {
+    bump(count);
+    bump(totalNs, ns);
+    raise(maxNs, ns);
+    bump(buckets[timeBucket(ns)], 1u);
+}
+
+void DspProfiler::Timing::clear() {
+    count.store(0, std::memory_order_relaxed);
+    totalNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+    for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+}
+
+int64_t* DspProfiler::Timing::copyTo(int64_t* out) const {
+    *out++ = static_cast<int64_t>(count.load(std::memory_order_relaxed));
+    *out++ = static_cast<int64_t>(totalNs.load(std::memory_order_relaxed));
+    *out++ = static_cast<int64_t>(maxNs.load(std::memory_order_relaxed));
+    for (const auto& bucket : buckets) *out++ = bucket.load(std::memory_order_relaxed);
+    return out;
+}
+
+DspProfiler::DspProfiler() : nsPerTick(measureNsPerTick()) {}
+
+void DspProfiler::beginCallback() {
+    if (resetRequested.load(std::memory_order_relaxed)) {
+        resetRequested.store(false, std::memory_order_relaxed);
+        clear();
+    }
+    for (auto& ticks : pendingTicks) ticks = 0;
+    pendingStages = 0;
+    callbackStart = profileTicks();
+}
+
+void DspProfiler::endCallback(int frameCount, int sampleRate) {
+    const uint64_t elapsedNs = static_cast<uint64_t>(static_cast<double>(profileTicks() - callbackStart) * nsPerTick);
+    callback.record(elapsedNs);
+    for (int s = 0; s < DSP_STAGE_COUNT; ++s) {
+        // Stages that did not run this callback are left out of their histogram
+        if (pendingStages & (1u << s)) stages[s].record(static_cast<uint64_t>(static_cast<double>(pendingTicks[s]) * nsPerTick));
+    }
+
+    bump(callbacks);
+    if (frameCount <= 0 || sampleRate <= 0) return;
+    const uint64_t bufferNs = static_cast<uint64_t>(frameCount) * 1000000000ULL / static_cast<uint64_t>(sampleRate);
+    bump(busyNs, elapsedNs);
+    bump(budgetNs, bufferNs);
+    if (bufferNs == 0) return;
+
+    const uint64_t permille = elapsedNs * 1000 / bufferNs;
+    if (elapsedNs > bufferNs) bump(overruns);
+    raise(maxLoadPermille, static_cast<uint32_t>(permille < 0xFFFFFFFFULL ? permille : 0xFFFFFFFFULL));
+    const uint64_t bucket = permille / 100;
+    bump(loadBuckets[bucket < LOAD_BUCKETS ? bucket : LOAD_BUCKETS - 1], 1u);
+}
+
+void DspProfiler::clear() {
+    callback.clear();
+    for (auto& stage : stages) stage.clear();
+    callbacks.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    busyNs.store(0, std::memory_order_relaxed);
+    budgetNs.store(0, std::memory_order_relaxed);
+    maxLoadPermille.store(0, std::memory_order_relaxed);
+    for (auto& bucket : loadBuckets) bucket.store(0, std::memory_order_relaxed);
+}
+
+void DspProfiler::snapshot(int64_t* out) const {
+    *out++ = SNAPSHOT_VERSION;
+    *out++ = static_cast<int64_t>(callbacks.load(std::memory_order_relaxed));
+    *out++ = static_cast<int64_t>(overruns.load(std::memory_order_relaxed));
+    *out++ = static_cast<int64_t>(busyNs.load(std::memory_order_relaxed));
+    *out++ = static_cast<int64_t>(budgetNs.load(std::memory_order_relaxed));
+    *out++ = maxLoadPermille.load(std::memory_order_relaxed);
+    for (const auto& bucket : loadBuckets) *out++ = bucket.load(std::memory_order_relaxed);
+    out = callback.copyTo(out);
+    for (const auto& stage : stages) out = stage.copyTo(out);
+}
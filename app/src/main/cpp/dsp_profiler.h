@@ -0,0 +1,164 @@
+#ifndef DSP_PROFILER_H
+#define DSP_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <time.h>
+
+/**
+ * Timed sections of one render callback. Graph stages match DspGraph's
+ * kernels; Convert is PCM <-> float and Meter the output analyzer.
+ */
+enum class DspStage : uint8_t { Convert, Crossfeed, Tone, StereoMatrix, PitchShift, Spatialize, Limit, Meter };
+constexpr int DSP_STAGE_COUNT = 8;
+
+/**
+ * Process-wide switch for DspProfiler. Off by default; while off, the render
+ * path pays one relaxed load per callback and a predictable branch per stage.
+ */
+inline std::atomic<bool> g_dspProfilingEnabled{false};
+
+/**
+ * Monotonic timestamp in profiler ticks. On arm64 this is the virtual counter
+ * register (no vDSO call, typically 19.2-25 MHz); elsewhere clock_gettime
+ * nanoseconds.
+ */
+inline uint64_t profileTicks() {
+#if defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+/**
+ * Per-engine callback and per-stage timing.
+ *
+ * Written only by the engine's render thread, read by any thread: every
+ * counter is an atomic with a single writer, so recording is plain relaxed
+ * loads and stores and snapshot() never blocks the audio thread. A snapshot
+ * taken mid-callback may mix two callbacks' counters, which is harmless for
+ * statistics. Resets are requested from outside and carried out by the
+ * render thread at the start of its next profiled callback.
+ *
+ * Stage times are summed over a callback's sub-blocks and recorded once per
+ * callback, so histograms count callbacks, not blocks.
+ */
+class DspProfiler {
+public:
+    // Log2 duration buckets: 0 is < 1 us, b covers [2^(b+9), 2^(b+10)) ns,
+    // the last one everything from 2^28 ns (268 ms) up.
+    static constexpr int TIME_BUCKETS = 20;
+    // Callback time over buffer duration, 10% per bucket; the last is >= 150%.
+    static constexpr int LOAD_BUCKETS = 16;
+
+    /**
+     * snapshot() layout, all int64:
+     *   [0] SNAPSHOT_VERSION  [1] callbacks  [2] budget overruns
+     *   [3] total callback ns [4] total buffer (budget) ns
+     *   [5] max load, permille
+     *   LOAD_BUCKETS load histogram
+     *   callback time: count, total ns, max ns, TIME_BUCKETS buckets
+     *   per DspStage in enum order: the same four fields
+     */
+    static constexpr int SNAPSHOT_VERSION = 1;
+    static constexpr int TIMING_LONGS = 3 + TIME_BUCKETS;
+    static constexpr int SNAPSHOT_LONGS = 6 + LOAD_BUCKETS + TIMING_LONGS * (1 + DSP_STAGE_COUNT);
+
+    static bool enabled() { return g_dspProfilingEnabled.load(std::memory_order_relaxed); }
+
+    DspProfiler();
+
+    // Render thread
+    void beginCallback();
+    void addStage(DspStage stage, uint64_t ticks) {
+        pendingTicks[static_cast<int>(stage)] += ticks;
+        pendingStages |= 1u << static_cast<int>(stage);
+    }
+    void endCallback(int frameCount, int sampleRate);
+
+    // Any thread
+    void requestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+    void snapshot(int64_t* out) const; // SNAPSHOT_LONGS values
+
+private:
+    struct Timing {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint32_t> buckets[TIME_BUCKETS] = {};
+
+        void record(uint64_t ns);
+        void clear();
+        int64_t* copyTo(int64_t* out) const;
+    };
+
+    Timing callback;
+    Timing stages[DSP_STAGE_COUNT];
+    std::atomic<uint64_t> callbacks{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> busyNs{0};
+    std::atomic<uint64_t> budgetNs{0};
+    std::atomic<uint32_t> maxLoadPermille{0};
+    std::atomic<uint32_t> loadBuckets[LOAD_BUCKETS] = {};
+    std::atomic<bool> resetRequested{false};
+
+    // Render thread only
+    double nsPerTick;
+    uint64_t callbackStart = 0;
+    uint64_t pendingTicks[DSP_STAGE_COUNT] = {};
+    uint32_t pendingStages = 0; // bit per DspStage that ran this callback
+
+    void clear();
+};
+
+/**
+ * Times one stage into a profiler that may be null (profiling off).
+ */
+class StageTimer {
+public:
+    StageTimer(DspProfiler* profiler, DspStage stage)
+        : profiler(profiler), stage(stage), start(profiler != nullptr ? profileTicks() : 0) {}
+    ~StageTimer() {
+        if (profiler != nullptr) profiler->addStage(stage, profileTicks() - start);
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    DspProfiler* profiler;
+    DspStage stage;
+    uint64_t start;
+};
+
+/**
+ * Brackets a whole render callback; a no-op when profiling is off.
+ */
+class CallbackTimer {
+public:
+    CallbackTimer(DspProfiler& profiler, int frameCount, int sampleRate)
+        : profiler(DspProfiler::enabled() ? &profiler : nullptr), frameCount(frameCount), sampleRate(sampleRate) {
+        if (this->profiler != nullptr) this->profiler->beginCallback();
+    }
+    ~CallbackTimer() {
+        if (profiler != nullptr) profiler->endCallback(frameCount, sampleRate);
+    }
+
+    CallbackTimer(const CallbackTimer&) = delete;
+    CallbackTimer& operator=(const CallbackTimer&) = delete;
+
+    // Null while profiling is off; pass to StageTimer and DspGraph::run
+    DspProfiler* get() const { return profiler; }
+
+private:
+    DspProfiler* profiler;
+    int frameCount;
+    int sampleRate;
+};
+
+#endif // DSP_PROFILER_H
@@ -0,0 +1,42 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Cheap log2 / exp2 approximations for gain computers that work in the log
+ * domain. Exponent bits are handled exactly; the mantissa goes through a
+ * quartic polynomial (least-squares fit), giving |error| < 2.1e-4 in log2
+ * (about 0.0012 dB) and < 1e-5 relative in exp2.
+ */
+namespace fastmath {
+
+// Positive, finite x only.
+inline float log2(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const float exponent = static_cast<float>(static_cast<int32_t>((bits >> 23) & 0xFF) - 127);
+    bits = (bits & 0x007FFFFFu) | 0x3F800000u; // mantissa in [1, 2)
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    const float t = m - 1.0f;
+    const float poly = 2.0426987e-4f + t * (1.4360970f + t * (-0.66951213f + t * (0.31221123f + t * -0.079149475f)));
+    return exponent + poly;
+}
+
+inline float exp2(float x) {
+    if (x < -126.0f) return 0.0f;
+    if (x > 127.0f) x = 127.0f;
+    const float fl = static_cast<float>(static_cast<int32_t>(x) - (x < 0.0f ? 1 : 0));
+    const float t = x - fl; // [0, 1)
+    const float poly = 1.0000073f + t * (0.69293126f + t * (0.24171033f + t * (0.051666839f + t * 0.013676523f)));
+    const uint32_t scaleBits = static_cast<uint32_t>(static_cast<int32_t>(fl) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &scaleBits, sizeof(scale));
+    return poly * scale;
+}
+
+} // namespace fastmath
+
+#endif // FAST_MATH_H
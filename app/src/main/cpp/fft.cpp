@@ -0,0 +1,299 @@
+#include "fft.h"
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FFT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FFT_SSE2 1
+#endif
+
+namespace {
+
+// Four-lane float vector; the kernels below are written once against it.
+#if FFT_NEON
+using V4 = float32x4_t;
+inline V4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, V4 v) { vst1q_f32(p, v); }
+inline V4 add(V4 a, V4 b) { return vaddq_f32(a, b); }
+inline V4 sub(V4 a, V4 b) { return vsubq_f32(a, b); }
+inline V4 mul(V4 a, V4 b) { return vmulq_f32(a, b); }
+inline void transpose(V4& a, V4& b, V4& c, V4& d) {
+    const float32x4x2_t ab = vtrnq_f32(a, b); // {a0 b0 a2 b2}, {a1 b1 a3 b3}
+    const float32x4x2_t cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+#elif FFT_SSE2
+using V4 = __m128;
+inline V4 load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, V4 v) { _mm_storeu_ps(p, v); }
+inline V4 add(V4 a, V4 b) { return _mm_add_ps(a, b); }
+inline V4 sub(V4 a, V4 b) { return _mm_sub_ps(a, b); }
+inline V4 mul(V4 a, V4 b) { return _mm_mul_ps(a, b); }
+inline void transpose(V4& a, V4& b, V4& c, V4& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+#else
+struct V4 {
+    float v[4];
+};
+inline V4 load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(float* p, V4 x) { for (int i = 0; i < 4; ++i) p[i] = x.v[i]; }
+inline V4 add(V4 a, V4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline V4 sub(V4 a, V4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline V4 mul(V4 a, V4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+inline void transpose(V4& a, V4& b, V4& c, V4& d) {
+    const V4 r[4] = {a, b, c, d};
+    V4* out[4] = {&a, &b, &c, &d};
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) out[i]->v[j] = r[j].v[i];
+    }
+}
+#endif
+
+// (xr + i xi) * (wr + i wi), written back into xr / xi
+inline void cmul(V4& xr, V4& xi, V4 wr, V4 wi) {
+    const V4 r = sub(mul(xr, wr), mul(xi, wi));
+    xi = add(mul(xr, wi), mul(xi, wr));
+    xr = r;
+}
+
+/*
+ * Forward radix-4 butterfly (e^-i convention). The outputs come back in the
+ * order X0, X2, X1, X3, which makes each radix-4 stage identical to two
+ * radix-2 decimation-in-frequency stages, so the whole transform ends in
+ * plain bit-reversed order even when a radix-2 stage is mixed in.
+ */
+inline void butterfly4(V4& r0, V4& i0, V4& r1, V4& i1, V4& r2, V4& i2, V4& r3, V4& i3) {
+    const V4 t0r = add(r0, r2), t0i = add(i0, i2);
+    const V4 t1r = sub(r0, r2), t1i = sub(i0, i2);
+    const V4 t2r = add(r1, r3), t2i = add(i1, i3);
+    const V4 t3r = sub(r1, r3), t3i = sub(i1, i3);
+    r0 = add(t0r, t2r);
+    i0 = add(t0i, t2i);
+    r1 = sub(t0r, t2r);
+    i1 = sub(t0i, t2i);
+    r2 = add(t1r, t3i); // t1 - i * t3
+    i2 = sub(t1i, t3r);
+    r3 = sub(t1r, t3i); // t1 + i * t3
+    i3 = add(t1i, t3r);
+}
+
+// Leading radix-2 stage over the whole array: x[j] += x[j + h], x[j + h] = diff * W^j
+void radix2Stage(float* re, float* im, int h, const float* tw) {
+    for (int j = 0; j < h; j += 4) {
+        const V4 ar = load(re + j), ai = load(im + j);
+        const V4 br = load(re + j + h), bi = load(im + j + h);
+        V4 dr = sub(ar, br), di = sub(ai, bi);
+        cmul(dr, di, load(tw + j), load(tw + h + j));
+        store(re + j, add(ar, br));
+        store(im + j, add(ai, bi));
+        store(re + j + h, dr);
+        store(im + j + h, di);
+    }
+}
+
+// Radix-4 stage on groups of 4 * q points, q >= 4: four butterflies per iteration
+void radix4Stage(float* re, float* im, int total, int q, const float* tw) {
+    const float* w1r = tw;
+    const float* w1i = tw + q;
+    const float* w2r = tw + 2 * q;
+    const float* w2i = tw + 3 * q;
+    const float* w3r = tw + 4 * q;
+    const float* w3i = tw + 5 * q;
+    for (int g = 0; g < total; g += 4 * q) {
+        float* r = re + g;
+        float* i = im + g;
+        for (int j = 0; j < q; j += 4) {
+            V4 r0 = load(r + j), i0 = load(i + j);
+            V4 r1 = load(r + j + q), i1 = load(i + j + q);
+            V4 r2 = load(r + j + 2 * q), i2 = load(i + j + 2 * q);
+            V4 r3 = load(r + j + 3 * q), i3 = load(i + j + 3 * q);
+            butterfly4(r0, i0, r1, i1, r2, i2, r3, i3);
+            cmul(r1, i1, load(w2r + j), load(w2i + j));
+            cmul(r2, i2, load(w1r + j), load(w1i + j));
+            cmul(r3, i3, load(w3r + j), load(w3i + j));
+            store(r + j, r0);
+            store(i + j, i0);
+            store(r + j + q, r1);
+            store(i + j + q, i1);
+            store(r + j + 2 * q, r2);
+            store(i + j + 2 * q, i2);
+            store(r + j + 3 * q, r3);
+            store(i + j + 3 * q, i3);
+        }
+    }
+}
+
+// Final radix-4 stage (q == 1, no twiddles): four 4-point groups per iteration via transposes
+void radix4Last(float* re, float* im, int total) {
+    for (int g = 0; g < total; g += 16) {
+        V4 r0 = load(re + g), r1 = load(re + g + 4), r2 = load(re + g + 8), r3 = load(re + g + 12);
+        V4 i0 = load(im + g), i1 = load(im + g + 4), i2 = load(im + g + 8), i3 = load(im + g + 12);
+        transpose(r0, r1, r2, r3);
+        transpose(i0, i1, i2, i3);
+        butterfly4(r0, i0, r1, i1, r2, i2, r3, i3);
+        transpose(r0, r1, r2, r3);
+        transpose(i0, i1, i2, i3);
+        store(re + g, r0);
+        store(re + g + 4, r1);
+        store(re + g + 8, r2);
+        store(re + g + 12, r3);
+        store(im + g, i0);
+        store(im + g + 4, i1);
+        store(im + g + 8, i2);
+        store(im + g + 12, i3);
+    }
+}
+
+} // namespace
+
+struct RealFft::Plan {
+    int half = 0;
+    bool leadingRadix2 = false;
+    std::vector<float> radix2Twiddles;  // cos, then -sin, half / 2 entries each
+    std::vector<int> quarters;          // q of every twiddled radix-4 stage, in order
+    std::vector<size_t> offsets;        // start of each stage's six twiddle rows
+    std::vector<float> twiddles;
+    std::vector<int> bitReverse;        // complex FFT output order
+    std::vector<float> splitCos;        // real split twiddles, half + 1 entries
+    std::vector<float> splitSin;
+
+    explicit Plan(int size) : half(size / 2), bitReverse(size / 2),
+                              splitCos(size / 2 + 1), splitSin(size / 2 + 1) {
+        int bits = 0;
+        while ((1 << bits) < half) ++bits;
+        for (int i = 0; i < half; ++i) {
+            int r = 0;
+            for (int b = 0; b < bits; ++b) {
+                if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+            }
+            bitReverse[i] = r;
+        }
+
+        int span = half;
+        if (bits % 2 != 0) {
+            leadingRadix2 = true;
+            const int h = half / 2;
+            radix2Twiddles.resize(static_cast<size_t>(2) * h);
+            for (int j = 0; j < h; ++j) {
+                const double angle = 2.0 * M_PI * j / half;
+                radix2Twiddles[j] = static_cast<float>(std::cos(angle));
+                radix2Twiddles[h + j] = static_cast<float>(-std::sin(angle));
+            }
+            span = h;
+        }
+        for (; span >= 16; span /= 4) {
+            const int q = span / 4;
+            quarters.push_back(q);
+            offsets.push_back(twiddles.size());
+            twiddles.resize(twiddles.size() + static_cast<size_t>(6) * q);
+            float* row = twiddles.data() + offsets.back();
+            for (int j = 0; j < q; ++j) {
+                for (int m = 1; m <= 3; ++m) {
+                    const double angle = 2.0 * M_PI * m * j / span;
+                    row[(2 * m - 2) * q + j] = static_cast<float>(std::cos(angle));
+                    row[(2 * m - 1) * q + j] = static_cast<float>(-std::sin(angle));
+                }
+            }
+        }
+
+        for (int k = 0; k <= half; ++k) {
+            const double angle = 2.0 * M_PI * k / size;
+            splitCos[k] = static_cast<float>(std::cos(angle));
+            splitSin[k] = static_cast<float>(std::sin(angle));
+        }
+    }
+};
+
+const RealFft::Plan* RealFft::planFor(int size) {
+    static std::mutex planMutex;
+    static std::unique_ptr<Plan> plans[32];
+
+    int bits = 0;
+    while ((1 << bits) < size) ++bits;
+    std::lock_guard<std::mutex> lock(planMutex);
+    if (!plans[bits]) plans[bits].reset(new Plan(1 << bits));
+    return plans[bits].get();
+}
+
+RealFft::RealFft(int size) {
+    int rounded = MIN_SIZE;
+    while (rounded < size && rounded < MAX_SIZE) rounded <<= 1;
+    n = rounded;
+    half = rounded / 2;
+    plan = planFor(rounded);
+    workRe.assign(half, 0.0f);
+    workIm.assign(half, 0.0f);
+}
+
+// In-place forward complex FFT of size 'half', output in bit-reversed order.
+// Called with re and im swapped it computes the unscaled inverse instead.
+void RealFft::complexFft(float* re, float* im) const {
+    if (plan->leadingRadix2) radix2Stage(re, im, half / 2, plan->radix2Twiddles.data());
+    for (size_t s = 0; s < plan->quarters.size(); ++s) {
+        radix4Stage(re, im, half, plan->quarters[s], plan->twiddles.data() + plan->offsets[s]);
+    }
+    radix4Last(re, im, half);
+}
+
+void RealFft::forward(const float* time, float* re, float* im) {
+    float* zr = workRe.data();
+    float* zi = workIm.data();
+    for (int k = 0; k < half; ++k) {
+        zr[k] = time[2 * k];
+        zi[k] = time[2 * k + 1];
+    }
+    complexFft(zr, zi);
+
+    // X[k] = E[k] + W^k O[k], with E/O recovered from Z[k] and conj(Z[half - k])
+    const int* rev = plan->bitReverse.data();
+    const float* splitCos = plan->splitCos.data();
+    const float* splitSin = plan->splitSin.data();
+    for (int k = 0; k <= half; ++k) {
+        const int a = rev[k == half ? 0 : k];
+        const int b = rev[k == 0 ? 0 : half - k];
+        const float er = 0.5f * (zr[a] + zr[b]);
+        const float ei = 0.5f * (zi[a] - zi[b]);
+        const float orr = 0.5f * (zi[a] + zi[b]);
+        const float oi = -0.5f * (zr[a] - zr[b]);
+        const float wr = splitCos[k];
+        const float wi = -splitSin[k];
+        re[k] = er + orr * wr - oi * wi;
+        im[k] = ei + orr * wi + oi * wr;
+    }
+}
+
+void RealFft::inverse(const float* re, const float* im, float* time) {
+    float* zr = workRe.data();
+    float* zi = workIm.data();
+    const float* splitCos = plan->splitCos.data();
+    const float* splitSin = plan->splitSin.data();
+    for (int k = 0; k < half; ++k) {
+        const int b = half - k;
+        const float er = 0.5f * (re[k] + re[b]);
+        const float ei = 0.5f * (im[k] - im[b]);
+        const float dr = 0.5f * (re[k] - re[b]);
+        const float di = 0.5f * (im[k] + im[b]);
+        // O[k] = (X[k] - conj(X[half - k])) / 2 * W^-k
+        const float wr = splitCos[k];
+        const float wi = splitSin[k];
+        const float orr = dr * wr - di * wi;
+        const float oi = dr * wi + di * wr;
+        zr[k] = er - oi;
+        zi[k] = ei + orr;
+    }
+    complexFft(zi, zr);
+
+    const int* rev = plan->bitReverse.data();
+    const float scale = 1.0f / half;
+    for (int k = 0; k < half; ++k) {
+        time[2 * k] = zr[rev[k]] * scale;
+        time[2 * k + 1] = zi[rev[k]] * scale;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+/**
+ * Real-input FFT of a power-of-two size, computed as a half-size complex FFT
+ * plus a split step. Spectra use split format: re[] and im[] of size / 2 + 1
+ * bins each, which keeps frequency-domain multiply-accumulate loops
+ * vectorizable.
+ *
+ * The complex FFT is radix-4 decimation-in-frequency (with one leading
+ * radix-2 stage when log2(size / 2) is odd), four butterflies per SIMD
+ * instruction on NEON and SSE2. Its bit-reversed output order is undone
+ * inside the split step, so there is no separate permutation pass.
+ *
+ * Twiddle and permutation tables live in a plan that is built once per size
+ * and shared by every instance for the lifetime of the process. Constructing
+ * an instance allocates its scratch; forward/inverse never allocate. An
+ * instance must be used by one thread at a time.
+ */
+class RealFft {
+public:
+    static constexpr int MIN_SIZE = 64;
+    static constexpr int MAX_SIZE = 65536;
+
+    // size: power of two in [MIN_SIZE, MAX_SIZE]; other values are rounded up into range
+    explicit RealFft(int size);
+
+    int size() const { return n; }
+    int bins() const { return n / 2 + 1; }
+
+    // time[size] -> re/im[bins], unscaled
+    void forward(const float* time, float* re, float* im);
+    // re/im[bins] -> time[size], scaled by 1 / size so inverse(forward(x)) == x
+    void inverse(const float* re, const float* im, float* time);
+
+private:
+    struct Plan;
+
+    const Plan* plan;
+    int n;
+    int half;
+    std::vector<float> workRe;
+    std::vector<float> workIm;
+
+    static const Plan* planFor(int size);
+    void complexFft(float* re, float* im) const;
+};
+
+#endif // FFT_H
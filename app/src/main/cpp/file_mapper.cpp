@@ -1,14 +1,61 @@
 #include <jni.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+#include <string>
 #include <android/log.h>
+#include "audio_file.h"
+#include "jni_util.h"
+#include "loudness_index.h"
+#include "loudness_scanner.h"
+#include "mapped_file.h"
+#include "waveform_cache.h"
+#include "waveform_pyramid.h"
+#include "worker_pool.h"
 
 #define TAG "NativeFileMapper"
 
+// ============================================================================
+// Waveforms: full-rate min/max/RMS pyramids of mapped files
+// ============================================================================
+
+static WaveformPyramid* waveformFromHandle(jlong handle) {
+    return reinterpret_cast<WaveformPyramid*>(static_cast<intptr_t>(handle));
+}
+
+/**
+ * Builds the pyramid of the file at path on 'threads' threads. WAV, AIFF and
+ * FLAC are supported; 'unsupported' is set for files in any other format.
+ */
+static bool buildWaveform(const char *path, int threads, WaveformPyramid& pyramid, bool& unsupported) {
+    unsupported = false;
+    MappedFile file(path);
+    if (!file.isOpen()) return false;
+    PcmReader reader;
+    if (!reader.open(file.data(), file.size())) {
+        __android_log_print(ANDROID_LOG_WARN, TAG, "Unsupported audio format (%s). Waveforms support WAV, AIFF and FLAC.", path);
+        unsupported = true;
+        return false;
+    }
+    return pyramid.build(reader, threads);
+}
+
+static bool buildWaveform(JNIEnv *env, jstring file_path, WaveformPyramid& pyramid, bool& unsupported) {
+    unsupported = false;
+    const char *path = env->GetStringUTFChars(file_path, nullptr);
+    if (path == nullptr) return false;
+    const bool built = buildWaveform(path, 0, pyramid, unsupported);
+    env->ReleaseStringUTFChars(file_path, path);
+    return built;
+}
+
+/**
+ * Peak amplitude (max |sample|) of num_points even slices of the file.
+ * Returns an empty array for unsupported formats and null on error.
+ */
 extern "C"
 JNIEXPORT jfloatArray JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nExtractWaveform(JNIEnv *env, jobject thiz,
@@ -16,108 +63,250 @@ Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nExtractWaveform(JNIEnv *en
     if (file_path == nullptr || num_points <= 0) {
         return nullptr;
     }
-    
-    const char *path = env->GetStringUTFChars(file_path, nullptr);
-    if (path == nullptr) {
-        return nullptr;
+    WaveformPyramid pyramid;
+    bool unsupported;
+    if (!buildWaveform(env, file_path, pyramid, unsupported)) {
+        return unsupported ? env->NewFloatArray(0) : nullptr;
     }
-    
-    int fd = open(path, O_RDONLY);
-    if (fd < 0) {
-        env->ReleaseStringUTFChars(file_path, path);
-        return nullptr;
+
+    const int count = static_cast<int>(std::min<int64_t>(num_points, pyramid.frames()));
+    std::vector<WaveformPoint> points(static_cast<size_t>(count));
+    pyramid.points(0, pyramid.frames(), count, points.data());
+    std::vector<float> peaks(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        peaks[i] = std::max(std::abs(points[i].min), std::abs(points[i].max));
     }
 
-    struct stat st;
-    if (fstat(fd, &st) < 0) {
-        close(fd);
-        env->ReleaseStringUTFChars(file_path, path);
-        return nullptr;
+    jfloatArray result = env->NewFloatArray(count);
+    if (result != nullptr) {
+        env->SetFloatArrayRegion(result, 0, count, peaks.data());
     }
+    return result;
+}
 
-    size_t size = static_cast<size_t>(st.st_size);
-    if (size < 12) { // Need at least some bytes for header check
-        close(fd);
-        env->ReleaseStringUTFChars(file_path, path);
-        return nullptr;
+/**
+ * Scans the file once so that nWaveformPoints can serve any zoom without
+ * touching it again. Returns 0 if the file cannot be read or is in an
+ * unsupported format.
+ */
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nOpenWaveform(JNIEnv *env, jobject thiz, jstring file_path) {
+    if (file_path == nullptr) return 0;
+    auto *pyramid = new WaveformPyramid();
+    bool unsupported;
+    if (!buildWaveform(env, file_path, *pyramid, unsupported)) {
+        delete pyramid;
+        return 0;
     }
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(pyramid));
+}
 
-    // MMAP the file!
-    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
-    if (addr == MAP_FAILED) {
-        close(fd);
-        env->ReleaseStringUTFChars(file_path, path);
-        return nullptr;
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nCloseWaveform(JNIEnv *env, jobject thiz, jlong handle) {
+    delete waveformFromHandle(handle);
+}
+
+/**
+ * num_points (min, max, rms) triples spread over [start, end) of the track,
+ * given as fractions of its length, or null for an empty range.
+ */
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nWaveformPoints(JNIEnv *env, jobject thiz, jlong handle,
+                                                                   jdouble start, jdouble end, jint num_points) {
+    WaveformPyramid *pyramid = waveformFromHandle(handle);
+    if (pyramid == nullptr || num_points <= 0 || num_points > (1 << 20)) return nullptr;
+    const auto total = static_cast<double>(pyramid->frames());
+    std::vector<WaveformPoint> points(static_cast<size_t>(num_points));
+    const int count = pyramid->points(static_cast<int64_t>(std::clamp(start, 0.0, 1.0) * total),
+                                      static_cast<int64_t>(std::clamp(end, 0.0, 1.0) * total),
+                                      num_points, points.data());
+    if (count == 0) return nullptr;
+
+    jfloatArray result = env->NewFloatArray(count * 3);
+    if (result != nullptr) {
+        static_assert(sizeof(WaveformPoint) == 3 * sizeof(float), "points are passed as float triples");
+        env->SetFloatArrayRegion(result, 0, count * 3, reinterpret_cast<const float *>(points.data()));
     }
+    return result;
+}
+
+// Sidecar store for batch extraction; replaced wholesale by nConfigureWaveformCache
+static std::mutex waveformCacheLock;
+static std::shared_ptr<WaveformCache> waveformCache;
 
-    // Basic Header Check for compressed formats
-    const uint8_t* header = static_cast<const uint8_t*>(addr);
-    bool isCompressed = false;
-    
-    // Check for ID3 (MP3)
-    if (header[0] == 'I' && header[1] == 'D' && header[2] == '3') isCompressed = true;
-    // Check for fLaC
-    else if (header[0] == 'f' && header[1] == 'L' && header[2] == 'a' && header[3] == 'C') isCompressed = true;
-    // Check for MP4/AAC (ftyp)
-    else if (size > 12 && header[4] == 'f' && header[5] == 't' && header[6] == 'y' && header[7] == 'p') isCompressed = true;
-    // Check for Ogg
-    else if (header[0] == 'O' && header[1] == 'g' && header[2] == 'g' && header[3] == 'S') isCompressed = true;
-
-    if (isCompressed) {
-        __android_log_print(ANDROID_LOG_WARN, TAG, "Compressed file detected (%s). nExtractWaveform only supports raw PCM.", path);
-        munmap(addr, size);
-        close(fd);
-        env->ReleaseStringUTFChars(file_path, path);
-        // Return empty array to indicate unsupported format
-        return env->NewFloatArray(0);
+// Batches are mostly I/O-bound cache hits with the odd full scan; a few
+// threads keep the disk busy without competing with playback
+static constexpr int WAVEFORM_BATCH_THREADS = 4;
+
+static std::shared_ptr<WaveformCache> currentWaveformCache() {
+    std::lock_guard<std::mutex> guard(waveformCacheLock);
+    return waveformCache;
+}
+
+/**
+ * Keeps waveform sidecars in 'directory' (created if missing) under
+ * budget_bytes. Until this is called, batches compute every waveform.
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nConfigureWaveformCache(JNIEnv *env, jobject thiz,
+                                                                           jstring directory, jlong budget_bytes) {
+    if (directory == nullptr || budget_bytes <= 0) return;
+    const char *dir = env->GetStringUTFChars(directory, nullptr);
+    if (dir == nullptr) return;
+    auto cache = std::make_shared<WaveformCache>(dir, static_cast<int64_t>(budget_bytes));
+    env->ReleaseStringUTFChars(directory, dir);
+    std::lock_guard<std::mutex> guard(waveformCacheLock);
+    waveformCache = std::move(cache);
+}
+
+/**
+ * For each path, num_points (min, max, rms) triples over the whole track,
+ * or null where the file cannot be read or is in an unsupported format.
+ * Cached waveforms are read from their sidecars; the rest are scanned
+ * concurrently and cached. Either way points come from the cached levels
+ * (WaveformCache::CACHED_FIRST_LEVEL up), so a file's result is the same
+ * whether or not it was a hit. Blocks until all are done, so call it off the main thread.
+ */
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nExtractWaveforms(JNIEnv *env, jobject thiz,
+                                                                     jobjectArray file_paths, jint num_points) {
+    if (file_paths == nullptr || num_points <= 0 || num_points > (1 << 16)) return nullptr;
+    std::vector<std::string> paths;
+    if (!readStringArray(env, file_paths, paths)) return nullptr;
+
+    const std::shared_ptr<WaveformCache> cache = currentWaveformCache();
+    std::vector<std::vector<WaveformPoint>> results(paths.size());
+    parallelFor(paths.size(), WAVEFORM_BATCH_THREADS, [&](size_t i) {
+        WaveformSource source;
+        if (!WaveformSource::describe(paths[i].c_str(), source)) return;
+        WaveformPyramid pyramid;
+        if (cache == nullptr || !cache->find(source, pyramid)) {
+            bool unsupported;
+            if (!buildWaveform(paths[i].c_str(), 1, pyramid, unsupported)) return;
+            if (cache != nullptr) cache->store(source, pyramid);
+            // Draw from the levels a hit would load, so results never depend on the cache
+            pyramid.dropLevelsBelow(WaveformCache::CACHED_FIRST_LEVEL);
+        }
+        results[i].resize(static_cast<size_t>(num_points));
+        pyramid.points(0, pyramid.frames(), num_points, results[i].data());
+    });
+
+    jclass floatArrayClass = env->FindClass("[F");
+    if (floatArrayClass == nullptr) return nullptr;
+    jobjectArray out = env->NewObjectArray(static_cast<jsize>(paths.size()), floatArrayClass, nullptr);
+    if (out == nullptr) return nullptr;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].empty()) continue;
+        const jsize count = num_points * 3;
+        jfloatArray points = env->NewFloatArray(count);
+        if (points == nullptr) return nullptr;
+        env->SetFloatArrayRegion(points, 0, count, reinterpret_cast<const float *>(results[i].data()));
+        env->SetObjectArrayElement(out, static_cast<jsize>(i), points);
+        env->DeleteLocalRef(points);
     }
+    return out;
+}
 
-    // For demonstration, we assume it's a raw 16-bit PCM file (or we treat any file as bytes)
-    // and extract "energy" levels by scanning chunks.
-    const int16_t *data = static_cast<const int16_t*>(addr);
-    size_t num_samples = size / sizeof(int16_t);
-    
-    // Ensure we have enough samples
-    if (num_samples == 0) {
-        munmap(addr, size);
-        close(fd);
-        env->ReleaseStringUTFChars(file_path, path);
-        return nullptr;
+// ============================================================================
+// Library loudness: batch scan into a persistent index, O(1) lookups
+// ============================================================================
+
+static LoudnessIndex* loudnessIndexFromHandle(jlong handle) {
+    return reinterpret_cast<LoudnessIndex*>(static_cast<intptr_t>(handle));
+}
+
+/**
+ * Measures songIds[i] from filePaths[i] on 'threads' workers (<= 0: one per
+ * core) and merges the results into the index at indexPath, replacing older
+ * entries for the same songs. Files that cannot be measured keep whatever
+ * the index already held. Blocks for the whole scan, so call it off the main
+ * thread. Returns the number of files measured, or -1 if the arguments are
+ * invalid or the index could not be written.
+ */
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nScanLoudness(JNIEnv *env, jobject thiz,
+                                                                  jobjectArray song_ids, jobjectArray file_paths,
+                                                                  jstring index_path, jint threads) {
+    if (song_ids == nullptr || file_paths == nullptr || index_path == nullptr ||
+        env->GetArrayLength(song_ids) != env->GetArrayLength(file_paths)) {
+        return -1;
     }
-    
-    // Clamp num_points to available samples
-    size_t actual_points = std::min(static_cast<size_t>(num_points), num_samples);
-    
-    std::vector<float> waveform(actual_points, 0.0f);
-    size_t samples_per_point = num_samples / actual_points;
-
-    if (samples_per_point > 0) {
-        for (size_t i = 0; i < actual_points; ++i) {
-            float max_val = 0.0f;
-            size_t start = i * samples_per_point;
-            size_t end = std::min((i + 1) * samples_per_point, num_samples);
-            
-            // Scan chunk for peak
-            // Performance: Since it's mmap-ed, the OS handles the IO efficiently.
-            for (size_t j = start; j < end; j += 100) { // Sub-sample for speed
-                if (j < num_samples) { // Bounds check
-                    float val = std::abs(data[j]) / 32768.0f;
-                    if (val > max_val) max_val = val;
-                }
-            }
-            waveform[i] = max_val;
-        }
+    std::vector<std::string> ids, paths;
+    if (!readStringArray(env, song_ids, ids) || !readStringArray(env, file_paths, paths)) return -1;
+    const char *indexPath = env->GetStringUTFChars(index_path, nullptr);
+    if (indexPath == nullptr) return -1;
+
+    std::vector<TrackLoudness> results;
+    std::vector<uint8_t> measured;
+    loudness_scan::measureFiles(paths, threads, results, measured);
+
+    std::vector<LoudnessIndex::Entry> entries;
+    LoudnessIndex(indexPath).entries(entries);
+    jint count = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!measured[i]) continue;
+        entries.push_back({ids[i], results[i]});
+        ++count;
+    }
+    const bool written = LoudnessIndex::write(indexPath, entries);
+    if (!written) {
+        __android_log_print(ANDROID_LOG_WARN, TAG, "Cannot write loudness index %s", indexPath);
     }
+    env->ReleaseStringUTFChars(index_path, indexPath);
+    return written ? count : -1;
+}
 
-    // Clean up mmap
-    munmap(addr, size);
-    close(fd);
-    env->ReleaseStringUTFChars(file_path, path);
+/**
+ * Returns 0 if the file is missing or not a valid index.
+ */
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nOpenLoudnessIndex(JNIEnv *env, jobject thiz, jstring index_path) {
+    if (index_path == nullptr) return 0;
+    const char *indexPath = env->GetStringUTFChars(index_path, nullptr);
+    if (indexPath == nullptr) return 0;
+    auto *index = new LoudnessIndex(indexPath);
+    env->ReleaseStringUTFChars(index_path, indexPath);
+    if (!index->isOpen()) {
+        delete index;
+        return 0;
+    }
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(index));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nCloseLoudnessIndex(JNIEnv *env, jobject thiz, jlong handle) {
+    delete loudnessIndexFromHandle(handle);
+}
+
+/**
+ * [integrated LUFS, loudness range LU, true peak (linear), ReplayGain dB],
+ * or null if the song is not in the index.
+ */
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nLoudnessIndexLookup(JNIEnv *env, jobject thiz,
+                                                                         jlong handle, jstring song_id) {
+    LoudnessIndex *index = loudnessIndexFromHandle(handle);
+    if (index == nullptr || song_id == nullptr) return nullptr;
+    const char *id = env->GetStringUTFChars(song_id, nullptr);
+    if (id == nullptr) return nullptr;
+    TrackLoudness loudness;
+    const bool found = index->find(id, std::strlen(id), loudness);
+    env->ReleaseStringUTFChars(song_id, id);
+    if (!found) return nullptr;
 
-    // Return the float array to Java
-    jfloatArray result = env->NewFloatArray(static_cast<jsize>(actual_points));
+    const float values[4] = {loudness.integratedLufs, loudness.loudnessRangeLu, loudness.truePeak, loudness.gainDb};
+    jfloatArray result = env->NewFloatArray(4);
     if (result != nullptr) {
-        env->SetFloatArrayRegion(result, 0, static_cast<jsize>(actual_points), waveform.data());
+        env->SetFloatArrayRegion(result, 0, 4, values);
     }
     return result;
 }
@@ -0,0 +1,53 @@
+#ifndef FILE_UTIL_H
+#define FILE_UTIL_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <initializer_list>
+#include <string>
+#include <unistd.h>
+
+struct FilePart {
+    const void* data;
+    size_t size;
+};
+
+/**
+ * Writes the parts back to back to a temporary next to path (unique per
+ * call, ending in ".tmp"), syncs it and renames it over path, so readers
+ * (including ones that map the file) see either the old contents or the
+ * new, never a mix. False on any error, with the temporary removed.
+ */
+inline bool writeFileAtomically(const char* path, std::initializer_list<FilePart> parts) {
+    static std::atomic<uint32_t> sequence{0};
+    const std::string temp = std::string(path) + "." + std::to_string(getpid()) + "-" +
+                             std::to_string(sequence.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+    const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (const FilePart& part : parts) {
+        const auto* p = static_cast<const uint8_t*>(part.data);
+        size_t left = part.size;
+        while (ok && left > 0) {
+            const ssize_t written = write(fd, p, left);
+            if (written < 0 && errno == EINTR) continue;
+            ok = written > 0;
+            if (ok) {
+                p += written;
+                left -= static_cast<size_t>(written);
+            }
+        }
+    }
+    ok = ok && fsync(fd) == 0;
+    if (close(fd) != 0 || !ok || std::rename(temp.c_str(), path) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif // FILE_UTIL_H
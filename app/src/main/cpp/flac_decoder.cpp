@@ -0,0 +1,380 @@
+#include "flac_decoder.h"
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr std::array<uint8_t, 256> makeCrc8Table() {
+    std::array<uint8_t, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+        uint8_t crc = static_cast<uint8_t>(i);
+        for (int bit = 0; bit < 8; ++bit) crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint16_t, 256> makeCrc16Table() {
+    std::array<uint16_t, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+        uint16_t crc = static_cast<uint16_t>(i << 8);
+        for (int bit = 0; bit < 8; ++bit) crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> CRC8_TABLE = makeCrc8Table();
+constexpr std::array<uint16_t, 256> CRC16_TABLE = makeCrc16Table();
+
+uint8_t crc8(const uint8_t* p, size_t n) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < n; ++i) crc = CRC8_TABLE[crc ^ p[i]];
+    return crc;
+}
+
+uint16_t crc16(const uint8_t* p, size_t n) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; ++i) crc = static_cast<uint16_t>((crc << 8) ^ CRC16_TABLE[(crc >> 8) ^ p[i]]);
+    return crc;
+}
+
+bool isFrameSync(const uint8_t* p) { return p[0] == 0xFF && (p[1] & 0xFE) == 0xF8; }
+
+constexpr int CHANNELS_LEFT_SIDE = 8;
+constexpr int CHANNELS_SIDE_RIGHT = 9;
+constexpr int CHANNELS_MID_SIDE = 10;
+
+} // namespace
+
+/**
+ * MSB-first bit reader with a 64-bit cache. Reading past the end yields
+ * zeros and sets overrun(), which callers check once per subframe.
+ */
+class FlacDecoder::BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) { refill(); }
+
+    // n <= 32
+    uint32_t read(int n) {
+        if (n == 0) return 0;
+        if (available < n) {
+            refill();
+            if (available < n) {
+                failed = true;
+                available = 0;
+                cache = 0;
+                return 0;
+            }
+        }
+        const auto value = static_cast<uint32_t>(cache >> (64 - n));
+        cache <<= n;
+        available -= n;
+        return value;
+    }
+
+    int32_t readSigned(int n) {
+        if (n == 0) return 0;
+        const uint32_t value = read(n);
+        const int shift = 32 - n;
+        return static_cast<int32_t>(value << shift) >> shift;
+    }
+
+    // Number of zero bits before the next one bit, which is consumed
+    uint32_t readUnary() {
+        uint32_t zeros = 0;
+        for (;;) {
+            if (cache != 0) {
+                const int leading = __builtin_clzll(cache);
+                if (leading < available) {
+                    cache = (cache << leading) << 1; // leading + 1 can be 64
+                    available -= leading + 1;
+                    return zeros + static_cast<uint32_t>(leading);
+                }
+            }
+            zeros += static_cast<uint32_t>(available);
+            cache = 0;
+            available = 0;
+            refill();
+            if (available == 0) {
+                failed = true;
+                return 0;
+            }
+        }
+    }
+
+    void alignToByte() {
+        const int drop = available & 7;
+        cache <<= drop;
+        available -= drop;
+    }
+
+    // Bytes consumed so far; only meaningful when byte-aligned
+    size_t bytePosition() const { return position - static_cast<size_t>(available / 8); }
+
+    bool overrun() const { return failed; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    uint64_t cache = 0;
+    int available = 0;
+    bool failed = false;
+
+    void refill() {
+        while (available <= 56 && position < size) {
+            cache |= static_cast<uint64_t>(data[position++]) << (56 - available);
+            available += 8;
+        }
+    }
+};
+
+bool FlacDecoder::open(const uint8_t* file, size_t fileSize) {
+    data = nullptr;
+    size_t pos = 0;
+    if (fileSize >= 10 && std::memcmp(file, "ID3", 3) == 0) {
+        // ID3v2 tag: synchsafe size, plus a footer if flagged
+        const size_t tagSize = (static_cast<size_t>(file[6] & 0x7F) << 21) | (static_cast<size_t>(file[7] & 0x7F) << 14) |
+                               (static_cast<size_t>(file[8] & 0x7F) << 7) | static_cast<size_t>(file[9] & 0x7F);
+        pos = 10 + tagSize + ((file[5] & 0x10) ? 10 : 0);
+    }
+    if (pos + 8 > fileSize || std::memcmp(file + pos, "fLaC", 4) != 0) return false;
+    pos += 4;
+
+    bool haveInfo = false;
+    for (bool last = false; !last;) {
+        if (pos + 4 > fileSize) return false;
+        last = (file[pos] & 0x80) != 0;
+        const int type = file[pos] & 0x7F;
+        const size_t length = (static_cast<size_t>(file[pos + 1]) << 16) | (static_cast<size_t>(file[pos + 2]) << 8) | file[pos + 3];
+        const size_t body = pos + 4;
+        if (length > fileSize - body) return false;
+        if (type == 0) { // STREAMINFO
+            if (length < 34) return false;
+            const uint8_t* info = file + body;
+            maxBlock = (info[2] << 8) | info[3];
+            uint64_t packed = 0;
+            for (int i = 10; i < 18; ++i) packed = (packed << 8) | info[i];
+            rate = static_cast<int>(packed >> 44);
+            numChannels = static_cast<int>((packed >> 41) & 7) + 1;
+            bits = static_cast<int>((packed >> 36) & 31) + 1;
+            total = static_cast<int64_t>(packed & ((uint64_t{1} << 36) - 1));
+            haveInfo = true;
+        }
+        pos = body + length;
+    }
+    if (!haveInfo || rate <= 0 || bits < 4 || maxBlock < 16) return false;
+
+    data = file;
+    size = fileSize;
+    position = pos;
+    samples.assign(static_cast<size_t>(maxBlock) * numChannels, 0);
+    return true;
+}
+
+int FlacDecoder::decodeFrame() {
+    if (data == nullptr) return 0;
+    while (position + 2 <= size) {
+        size_t end;
+        int blockFrames;
+        if (isFrameSync(data + position) && decodeFrameAt(position, end, blockFrames)) {
+            position = end;
+            return blockFrames;
+        }
+        // Damaged or not a frame: resume at the next sync code
+        ++position;
+        while (position + 2 <= size && !isFrameSync(data + position)) ++position;
+    }
+    return 0;
+}
+
+bool FlacDecoder::decodeFrameAt(size_t offset, size_t& end, int& blockFrames) {
+    BitReader reader(data + offset, size - offset);
+    reader.read(15); // sync code and a reserved bit
+    reader.read(1);  // blocking strategy: the frame number format does not matter here
+    const uint32_t blockCode = reader.read(4);
+    const uint32_t rateCode = reader.read(4);
+    const uint32_t channelCode = reader.read(4);
+    const uint32_t sizeCode = reader.read(3);
+    if (reader.read(1) != 0 || blockCode == 0 || rateCode == 15 || channelCode > CHANNELS_MID_SIDE ||
+        sizeCode == 3) {
+        return false;
+    }
+
+    // Frame or sample number, UTF-8 style
+    const uint32_t lead = reader.read(8);
+    int extra = 0;
+    if (lead >= 0x80) {
+        if ((lead & 0xC0) == 0x80 || lead == 0xFF) return false;
+        while (lead & (0x40u >> extra)) ++extra;
+    }
+    for (int i = 0; i < extra; ++i) {
+        if ((reader.read(8) & 0xC0) != 0x80) return false;
+    }
+
+    if (blockCode == 1) blockFrames = 192;
+    else if (blockCode <= 5) blockFrames = 576 << (blockCode - 2);
+    else if (blockCode == 6) blockFrames = static_cast<int>(reader.read(8)) + 1;
+    else if (blockCode == 7) blockFrames = static_cast<int>(reader.read(16)) + 1;
+    else blockFrames = 256 << (blockCode - 8);
+
+    if (rateCode == 12) reader.read(8);
+    else if (rateCode == 13 || rateCode == 14) reader.read(16);
+
+    const size_t headerBytes = reader.bytePosition();
+    if (reader.read(8) != crc8(data + offset, headerBytes) || reader.overrun()) return false;
+
+    static constexpr int SAMPLE_BITS[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+    const int frameBits = sizeCode == 0 ? bits : SAMPLE_BITS[sizeCode];
+    const int frameChannels = channelCode < CHANNELS_LEFT_SIDE ? static_cast<int>(channelCode) + 1 : 2;
+    // Mid-stream format changes are legal but unheard of; treat them as damage
+    if (frameBits != bits || frameChannels != numChannels || blockFrames > maxBlock) return false;
+    if (channelCode >= CHANNELS_LEFT_SIDE && bits > 31) return false;
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        const bool side = (channelCode == CHANNELS_LEFT_SIDE && ch == 1) ||
+                          (channelCode == CHANNELS_SIDE_RIGHT && ch == 0) ||
+                          (channelCode == CHANNELS_MID_SIDE && ch == 1);
+        int32_t* out = samples.data() + static_cast<size_t>(ch) * maxBlock;
+        if (!decodeSubframe(reader, bits + (side ? 1 : 0), blockFrames, out)) return false;
+    }
+
+    reader.alignToByte();
+    const size_t frameBytes = reader.bytePosition();
+    const uint32_t crc = reader.read(16);
+    if (reader.overrun() || crc != crc16(data + offset, frameBytes)) return false;
+    end = offset + frameBytes + 2;
+
+    int32_t* a = samples.data();
+    int32_t* b = samples.data() + maxBlock;
+    switch (channelCode) {
+        case CHANNELS_LEFT_SIDE:
+            for (int i = 0; i < blockFrames; ++i) b[i] = static_cast<int32_t>(static_cast<int64_t>(a[i]) - b[i]);
+            break;
+        case CHANNELS_SIDE_RIGHT:
+            for (int i = 0; i < blockFrames; ++i) a[i] = static_cast<int32_t>(static_cast<int64_t>(a[i]) + b[i]);
+            break;
+        case CHANNELS_MID_SIDE:
+            for (int i = 0; i < blockFrames; ++i) {
+                const int64_t side = b[i];
+                const int64_t mid = (static_cast<int64_t>(a[i]) * 2) | (side & 1);
+                a[i] = static_cast<int32_t>((mid + side) >> 1);
+                b[i] = static_cast<int32_t>((mid - side) >> 1);
+            }
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+bool FlacDecoder::decodeSubframe(BitReader& reader, int sampleBits, int blockFrames, int32_t* out) {
+    if (reader.read(1) != 0) return false;
+    const uint32_t type = reader.read(6);
+    int wasted = 0;
+    if (reader.read(1)) {
+        wasted = static_cast<int>(reader.readUnary()) + 1;
+        if (wasted >= sampleBits) return false;
+        sampleBits -= wasted;
+    }
+    if (sampleBits > 32) return false;
+
+    if (type == 0) { // constant
+        const int32_t value = reader.readSigned(sampleBits);
+        for (int i = 0; i < blockFrames; ++i) out[i] = value;
+    } else if (type == 1) { // verbatim
+        for (int i = 0; i < blockFrames; ++i) out[i] = reader.readSigned(sampleBits);
+    } else if (type >= 8 && type <= 12) { // fixed predictor
+        const int order = static_cast<int>(type) - 8;
+        if (order > blockFrames) return false;
+        for (int i = 0; i < order; ++i) out[i] = reader.readSigned(sampleBits);
+        if (!decodeResidual(reader, blockFrames, order, out)) return false;
+        switch (order) {
+            case 1:
+                for (int i = 1; i < blockFrames; ++i)
+                    out[i] = static_cast<int32_t>(static_cast<int64_t>(out[i]) + out[i - 1]);
+                break;
+            case 2:
+                for (int i = 2; i < blockFrames; ++i)
+                    out[i] = static_cast<int32_t>(out[i] + 2 * static_cast<int64_t>(out[i - 1]) - out[i - 2]);
+                break;
+            case 3:
+                for (int i = 3; i < blockFrames; ++i)
+                    out[i] = static_cast<int32_t>(out[i] + 3 * (static_cast<int64_t>(out[i - 1]) - out[i - 2]) + out[i - 3]);
+                break;
+            case 4:
+                for (int i = 4; i < blockFrames; ++i)
+                    out[i] = static_cast<int32_t>(out[i] + 4 * (static_cast<int64_t>(out[i - 1]) + out[i - 3]) -
+                                                  6 * static_cast<int64_t>(out[i - 2]) - out[i - 4]);
+                break;
+            default:
+                break;
+        }
+    } else if (type >= 32) { // LPC
+        const int order = static_cast<int>(type & 31) + 1;
+        if (order > blockFrames) return false;
+        for (int i = 0; i < order; ++i) out[i] = reader.readSigned(sampleBits);
+        const int precision = static_cast<int>(reader.read(4)) + 1;
+        const int shift = reader.readSigned(5);
+        if (precision == 16 || shift < 0) return false;
+        int32_t coefficients[32];
+        for (int j = 0; j < order; ++j) coefficients[j] = reader.readSigned(precision);
+        if (!decodeResidual(reader, blockFrames, order, out)) return false;
+        // 16-bit sources fit the prediction in 32 bits, which is much cheaper on
+        // 32-bit ARM. Unsigned, so that a damaged frame's garbage (rejected by
+        // the CRC-16 afterwards) wraps rather than overflowing.
+        const int orderBits = 32 - __builtin_clz(static_cast<uint32_t>(order));
+        if (sampleBits + precision + orderBits <= 32) {
+            for (int i = order; i < blockFrames; ++i) {
+                uint32_t prediction = 0;
+                for (int j = 0; j < order; ++j)
+                    prediction += static_cast<uint32_t>(coefficients[j]) * static_cast<uint32_t>(out[i - 1 - j]);
+                out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) +
+                                              static_cast<uint32_t>(static_cast<int32_t>(prediction) >> shift));
+            }
+        } else {
+            for (int i = order; i < blockFrames; ++i) {
+                int64_t prediction = 0;
+                for (int j = 0; j < order; ++j) prediction += static_cast<int64_t>(coefficients[j]) * out[i - 1 - j];
+                out[i] = static_cast<int32_t>(out[i] + (prediction >> shift));
+            }
+        }
+    } else {
+        return false;
+    }
+
+    if (wasted > 0) {
+        for (int i = 0; i < blockFrames; ++i) out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+    }
+    return !reader.overrun();
+}
+
+// Rice-coded residual into out[order..blockFrames)
+bool FlacDecoder::decodeResidual(BitReader& reader, int blockFrames, int order, int32_t* out) {
+    const uint32_t method = reader.read(2);
+    if (method > 1) return false;
+    const int parameterBits = method == 0 ? 4 : 5;
+    const uint32_t escape = method == 0 ? 15 : 31;
+    const int partitionOrder = static_cast<int>(reader.read(4));
+    const int partitions = 1 << partitionOrder;
+    const int partitionFrames = blockFrames >> partitionOrder;
+    if ((partitionFrames << partitionOrder) != blockFrames || partitionFrames < order) return false;
+
+    int i = order;
+    for (int p = 0; p < partitions; ++p) {
+        const int end = (p + 1) * partitionFrames;
+        const uint32_t parameter = reader.read(parameterBits);
+        if (parameter == escape) {
+            const int rawBits = static_cast<int>(reader.read(5));
+            for (; i < end; ++i) out[i] = reader.readSigned(rawBits);
+        } else {
+            for (; i < end; ++i) {
+                const uint32_t value = (reader.readUnary() << parameter) | reader.read(static_cast<int>(parameter));
+                out[i] = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+            }
+        }
+        if (reader.overrun()) return false;
+    }
+    return true;
+}
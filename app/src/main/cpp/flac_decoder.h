@@ -0,0 +1,59 @@
+#ifndef FLAC_DECODER_H
+#define FLAC_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Streaming FLAC decoder over a file held in memory (typically a
+ * MappedFile), one frame at a time.
+ *
+ * Handles everything the format allows up to 8 channels and 32-bit samples
+ * (stereo decorrelation needs 31 bits or fewer): constant, verbatim, fixed
+ * and LPC subframes, wasted bits, both Rice coding methods and escaped
+ * partitions. Frame headers are checked with their CRC-8 and whole frames
+ * with their CRC-16; a frame that fails is skipped by searching for the next
+ * header, so damage costs a block of audio rather than the stream. The MD5
+ * signature of the whole stream is not checked.
+ *
+ * Memory is one decoded frame: STREAMINFO's maximum block size per channel.
+ */
+class FlacDecoder {
+public:
+    static constexpr int MAX_CHANNELS = 8;
+
+    // Parses the stream header (after an optional ID3v2 tag). False if this
+    // is not a FLAC stream the decoder supports.
+    bool open(const uint8_t* file, size_t size);
+
+    int channels() const { return numChannels; }
+    int sampleRate() const { return rate; }
+    int bitsPerSample() const { return bits; }
+    int64_t totalFrames() const { return total; } // 0 if the stream does not say
+
+    // Decodes the next frame; returns its length in frames, 0 at the end
+    int decodeFrame();
+
+    // Samples of the last decoded frame, left-justified to bitsPerSample()
+    const int32_t* channelData(int channel) const { return samples.data() + static_cast<size_t>(channel) * maxBlock; }
+
+private:
+    class BitReader;
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t position = 0; // next frame header
+    int numChannels = 0;
+    int rate = 0;
+    int bits = 0;
+    int maxBlock = 0;
+    int64_t total = 0;
+    std::vector<int32_t> samples; // planar, maxBlock per channel
+
+    bool decodeFrameAt(size_t offset, size_t& end, int& blockFrames);
+    bool decodeSubframe(BitReader& reader, int sampleBits, int blockFrames, int32_t* out);
+    static bool decodeResidual(BitReader& reader, int blockFrames, int order, int32_t* out);
+};
+
+#endif // FLAC_DECODER_H
@@ -0,0 +1,320 @@
+#include "hrir_set.h"
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <android/log.h>
+
+#define TAG "HrirSet"
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'U', 'V', 'H', 'R', 'I', 'R', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 32;
+constexpr uint32_t MAX_FILE_IR_LENGTH = 4096;
+constexpr uint32_t MAX_FILE_DIRECTIONS = 16384;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t irLength;
+    uint32_t numDirections;
+    uint32_t reserved[2];
+};
+static_assert(sizeof(FileHeader) == HEADER_SIZE, "unexpected header padding");
+
+constexpr float DEG = static_cast<float>(M_PI / 180.0);
+
+// Output rates that get a band-limited copy of every set recorded above them
+constexpr int COMMON_SAMPLE_RATES[] = {44100, 48000, 88200, 96000};
+
+// Windowed-sinc resampling kernel: Blackman-windowed sinc over SINC_ZEROS zero
+// crossings each side, tabulated at SINC_RESOLUTION points per crossing
+constexpr int SINC_ZEROS = 16;
+constexpr int SINC_RESOLUTION = 256;
+constexpr double SINC_ROLLOFF = 0.95; // cutoff, as a fraction of the output Nyquist
+
+std::vector<float> sincTable() {
+    std::vector<float> table(SINC_ZEROS * SINC_RESOLUTION + 2, 0.0f);
+    for (int i = 0; i <= SINC_ZEROS * SINC_RESOLUTION; ++i) {
+        const double u = static_cast<double>(i) / SINC_RESOLUTION;
+        const double sinc = i == 0 ? 1.0 : std::sin(M_PI * u) / (M_PI * u);
+        const double w = u / SINC_ZEROS;
+        table[i] = static_cast<float>(sinc * (0.42 + 0.5 * std::cos(M_PI * w) + 0.08 * std::cos(2.0 * M_PI * w)));
+    }
+    return table;
+}
+
+/*
+ * Resamples one IR from inRate down to outRate: each output sample is the
+ * input convolved with a sinc low-passed just below the output Nyquist, so
+ * content above it is removed instead of aliasing. Scaled by inRate/outRate
+ * so the filter keeps its gain with fewer taps.
+ */
+void resampleIr(const float* in, int inLength, int inRate, float* out, int outLength, int outRate,
+                const std::vector<float>& table) {
+    const double step = static_cast<double>(inRate) / outRate;
+    const double cutoff = SINC_ROLLOFF / step;      // in units of the input Nyquist
+    const double halfWidth = SINC_ZEROS / cutoff;   // input samples
+    for (int n = 0; n < outLength; ++n) {
+        const double pos = n * step;
+        const int first = std::max(0, static_cast<int>(std::ceil(pos - halfWidth)));
+        const int last = std::min(inLength - 1, static_cast<int>(std::floor(pos + halfWidth)));
+        double sum = 0.0;
+        for (int k = first; k <= last; ++k) {
+            const double u = std::fabs(pos - k) * cutoff * SINC_RESOLUTION;
+            const int i = static_cast<int>(u);
+            if (i >= SINC_ZEROS * SINC_RESOLUTION) continue;
+            const double frac = u - i;
+            sum += in[k] * (table[i] + (table[i + 1] - table[i]) * frac);
+        }
+        out[n] = static_cast<float>(sum * cutoff * step);
+    }
+}
+
+} // namespace
+
+std::unique_ptr<HrirSet> HrirSet::loadFile(const char* path) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        __android_log_print(ANDROID_LOG_WARN, TAG, "Cannot open HRIR file %s", path);
+        return nullptr;
+    }
+    const size_t size = file.size();
+    if (size < HEADER_SIZE) return nullptr;
+
+    FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const bool headerOk = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                          header.version == VERSION &&
+                          header.sampleRate >= 8000 && header.sampleRate <= 192000 &&
+                          header.irLength >= 16 && header.irLength <= MAX_FILE_IR_LENGTH &&
+                          header.numDirections >= 1 && header.numDirections <= MAX_FILE_DIRECTIONS;
+    const size_t expected = HEADER_SIZE + static_cast<size_t>(header.numDirections) * sizeof(Direction) +
+                            static_cast<size_t>(header.numDirections) * 2 * header.irLength * sizeof(float);
+    if (!headerOk || size < expected) {
+        __android_log_print(ANDROID_LOG_WARN, TAG, "Malformed HRIR file %s", path);
+        return nullptr;
+    }
+
+    std::unique_ptr<HrirSet> set(new HrirSet());
+    set->rate = static_cast<int>(header.sampleRate);
+    set->length = static_cast<int>(header.irLength);
+    set->count = static_cast<int>(header.numDirections);
+    const uint8_t* base = file.data();
+    set->directions = reinterpret_cast<const Direction*>(base + HEADER_SIZE);
+    set->data = reinterpret_cast<const float*>(base + HEADER_SIZE + set->count * sizeof(Direction));
+    set->file = std::move(file);
+    set->finishSetup();
+    set->prepareRates();
+    return set;
+}
+
+const HrirSet* HrirSet::forRate(int sampleRate) const {
+    for (const auto& copy : resampled) {
+        if (copy->rate == sampleRate) return copy.get();
+    }
+    return this;
+}
+
+void HrirSet::prepareRates() {
+    const std::vector<float> table = sincTable();
+    for (int outRate : COMMON_SAMPLE_RATES) {
+        if (outRate >= rate) continue;
+        std::unique_ptr<HrirSet> copy(new HrirSet());
+        copy->rate = outRate;
+        copy->length = std::max(1, static_cast<int>(std::ceil(static_cast<double>(length) * outRate / rate)));
+        copy->count = count;
+        copy->ownedDirections.assign(directions, directions + count);
+        copy->ownedData.assign(static_cast<size_t>(count) * 2 * copy->length, 0.0f);
+        for (int d = 0; d < count; ++d) {
+            for (int ear = 0; ear < 2; ++ear) {
+                float* out = copy->ownedData.data() + (static_cast<size_t>(d) * 2 + ear) * copy->length;
+                resampleIr(ir(d, ear), length, rate, out, copy->length, outRate, table);
+            }
+        }
+        copy->directions = copy->ownedDirections.data();
+        copy->data = copy->ownedData.data();
+        copy->finishSetup();
+        resampled.push_back(std::move(copy));
+    }
+}
+
+/*
+ * Spherical-head model after Brown & Duda (1998): a one-pole/one-zero head
+ * shadow whose high-frequency gain depends on the angle to the ear, the
+ * Woodworth ray-tracing delay around the head, and five pinna echoes whose
+ * delays vary with elevation. Built in the frequency domain so that the
+ * delays stay fractional.
+ */
+std::unique_ptr<HrirSet> HrirSet::createSphericalHead(int sampleRate) {
+    constexpr int LENGTH = 256;
+    constexpr int FFT_SIZE = 2 * LENGTH;
+    constexpr float HEAD_RADIUS = 0.0875f;
+    constexpr float SPEED_OF_SOUND = 343.0f;
+    constexpr float PINNA_RHO[5] = {0.5f, -1.0f, 0.5f, -0.25f, 0.25f};
+    constexpr float PINNA_A[5] = {1.0f, 5.0f, 5.0f, 5.0f, 5.0f};
+    constexpr float PINNA_B[5] = {2.0f, 4.0f, 7.0f, 11.0f, 13.0f};
+    constexpr float PINNA_D[5] = {1.0f, 0.5f, 0.5f, 0.5f, 0.5f};
+
+    std::unique_ptr<HrirSet> set(new HrirSet());
+    for (int el = -45; el <= 75; el += 15) {
+        for (int az = -180; az < 180; az += 15) {
+            set->ownedDirections.push_back({az * DEG, el * DEG});
+        }
+    }
+    set->ownedDirections.push_back({0.0f, 90.0f * DEG});
+
+    set->rate = sampleRate;
+    set->length = LENGTH;
+    set->count = static_cast<int>(set->ownedDirections.size());
+    set->ownedData.assign(static_cast<size_t>(set->count) * 2 * LENGTH, 0.0f);
+
+    RealFft fft(FFT_SIZE);
+    const int bins = fft.bins();
+    std::vector<float> re(bins), im(bins), time(FFT_SIZE);
+    const float headDelay = HEAD_RADIUS / SPEED_OF_SOUND;
+    const float omega0 = SPEED_OF_SOUND / HEAD_RADIUS;
+    const float bulkDelay = std::ceil(headDelay * sampleRate) + 4.0f; // keeps every IR causal
+
+    for (int d = 0; d < set->count; ++d) {
+        const Direction dir = set->ownedDirections[d];
+        const float sx = std::sin(dir.azimuth) * std::cos(dir.elevation);
+        for (int ear = 0; ear < 2; ++ear) {
+            // Angle between the source and the ear axis
+            const float earX = ear == 0 ? -1.0f : 1.0f;
+            const float theta = std::acos(std::max(-1.0f, std::min(1.0f, sx * earX)));
+            const float alpha = 1.05f + 0.95f * std::cos(theta * (180.0f / 150.0f));
+            const float delay = theta < static_cast<float>(M_PI / 2)
+                                ? -headDelay * std::cos(theta)
+                                : headDelay * (theta - static_cast<float>(M_PI / 2));
+            const float delaySamples = bulkDelay + delay * sampleRate;
+
+            // Pinna echo delays are specified in samples at 44.1 kHz
+            const float earAzimuth = ear == 0 ? -dir.azimuth : dir.azimuth;
+            float echoDelay[5];
+            for (int k = 0; k < 5; ++k) {
+                const float tau = PINNA_A[k] * std::cos(earAzimuth / 2.0f) *
+                                  std::sin(PINNA_D[k] * (static_cast<float>(M_PI / 2) - dir.elevation)) + PINNA_B[k];
+                echoDelay[k] = tau * sampleRate / 44100.0f;
+            }
+
+            for (int k = 0; k < bins; ++k) {
+                const float omega = 2.0f * static_cast<float>(M_PI) * k / FFT_SIZE; // rad/sample
+                const float omegaHz = omega * sampleRate;
+                const std::complex<float> shadow(1.0f, alpha * omegaHz / (2.0f * omega0));
+                const std::complex<float> pole(1.0f, omegaHz / (2.0f * omega0));
+                std::complex<float> pinna(1.0f, 0.0f);
+                for (int e = 0; e < 5; ++e) pinna += PINNA_RHO[e] * std::polar(1.0f, -omega * echoDelay[e]);
+                const std::complex<float> h = shadow / pole * pinna * std::polar(1.0f, -omega * delaySamples);
+                re[k] = h.real();
+                im[k] = h.imag();
+            }
+            im[0] = 0.0f;
+            im[bins - 1] = 0.0f;
+            fft.inverse(re.data(), im.data(), time.data());
+
+            // Keep the first LENGTH samples with a short fade at the end
+            float* out = set->ownedData.data() + (static_cast<size_t>(d) * 2 + ear) * LENGTH;
+            constexpr int FADE = 32;
+            for (int i = 0; i < LENGTH; ++i) {
+                float w = 1.0f;
+                if (i >= LENGTH - FADE) w = 0.5f + 0.5f * std::cos(static_cast<float>(M_PI) * (i - (LENGTH - FADE)) / FADE);
+                out[i] = time[i] * w;
+            }
+        }
+    }
+
+    set->directions = set->ownedDirections.data();
+    set->data = set->ownedData.data();
+    set->finishSetup();
+    set->prepareRates();
+    return set;
+}
+
+void HrirSet::finishSetup() {
+    onsets.resize(static_cast<size_t>(count) * 2);
+    unitVectors.resize(static_cast<size_t>(count) * 3);
+    for (int d = 0; d < count; ++d) {
+        for (int ear = 0; ear < 2; ++ear) {
+            const float* h = ir(d, ear);
+            float peak = 0.0f;
+            for (int i = 0; i < length; ++i) peak = std::max(peak, std::fabs(h[i]));
+            int first = 0;
+            while (first < length - 1 && std::fabs(h[first]) < 0.1f * peak) ++first;
+            onsets[d * 2 + ear] = first;
+        }
+        const Direction& dir = directions[d];
+        unitVectors[d * 3] = std::sin(dir.azimuth) * std::cos(dir.elevation);
+        unitVectors[d * 3 + 1] = std::cos(dir.azimuth) * std::cos(dir.elevation);
+        unitVectors[d * 3 + 2] = std::sin(dir.elevation);
+    }
+}
+
+int HrirSet::nearest(float azimuth, float elevation, int* indices, float* weights) const {
+    const float x = std::sin(azimuth) * std::cos(elevation);
+    const float y = std::cos(azimuth) * std::cos(elevation);
+    const float z = std::sin(elevation);
+
+    // Largest dot products == smallest great-circle distances
+    float best[MAX_NEIGHBOURS];
+    int found = 0;
+    for (int d = 0; d < count; ++d) {
+        const float dot = x * unitVectors[d * 3] + y * unitVectors[d * 3 + 1] + z * unitVectors[d * 3 + 2];
+        int pos = found < MAX_NEIGHBOURS ? found : MAX_NEIGHBOURS;
+        while (pos > 0 && dot > best[pos - 1]) --pos;
+        if (pos >= MAX_NEIGHBOURS) continue;
+        const int last = std::min(found, MAX_NEIGHBOURS - 1);
+        for (int i = last; i > pos; --i) {
+            best[i] = best[i - 1];
+            indices[i] = indices[i - 1];
+        }
+        best[pos] = dot;
+        indices[pos] = d;
+        if (found < MAX_NEIGHBOURS) ++found;
+    }
+
+    const float nearestAngle = std::acos(std::max(-1.0f, std::min(1.0f, best[0])));
+    if (nearestAngle < 1e-4f) {
+        weights[0] = 1.0f;
+        return 1;
+    }
+    float total = 0.0f;
+    for (int i = 0; i < found; ++i) {
+        weights[i] = 1.0f / std::acos(std::max(-1.0f, std::min(1.0f, best[i])));
+        total += weights[i];
+    }
+    for (int i = 0; i < found; ++i) weights[i] /= total;
+    return found;
+}
+
+HrirLibrary& HrirLibrary::instance() {
+    static HrirLibrary library;
+    return library;
+}
+
+HrirLibrary::HrirLibrary() : builtIn(HrirSet::createSphericalHead(48000)) {
+    active.store(builtIn.get(), std::memory_order_release);
+}
+
+bool HrirLibrary::load(const char* path) {
+    std::lock_guard<std::mutex> lock(loadMutex);
+    for (auto& entry : loaded) {
+        if (entry.first == path) {
+            active.store(entry.second.get(), std::memory_order_release);
+            return true;
+        }
+    }
+    std::unique_ptr<HrirSet> set = HrirSet::loadFile(path);
+    if (!set) return false;
+    active.store(set.get(), std::memory_order_release);
+    loaded.emplace_back(path, std::move(set));
+    return true;
+}
+
+void HrirLibrary::useBuiltIn() {
+    active.store(builtIn.get(), std::memory_order_release);
+}
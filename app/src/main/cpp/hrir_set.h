@@ -0,0 +1,120 @@
+#ifndef HRIR_SET_H
+#define HRIR_SET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+/**
+ * Head-related impulse responses measured (or modelled) for a set of source
+ * directions. Angles are radians: azimuth is positive to the right of the
+ * listener, elevation positive upwards. Ear 0 is left, ear 1 is right.
+ *
+ * Binary file layout (".hrir", little endian), mapped read-only with mmap:
+ *
+ *   offset  size                    field
+ *   0       8                       magic "SUVHRIR1"
+ *   8       4                       version (1)
+ *   12      4                       sample rate (Hz)
+ *   16      4                       IR length in samples (16..4096)
+ *   20      4                       direction count (1..16384)
+ *   24      8                       reserved (0)
+ *   32      count * 8               {float azimuth, float elevation} per direction
+ *   ...     count * 2 * length * 4  float IRs: direction-major, left then right
+ *
+ * Creation also builds a band-limited (windowed-sinc) copy at each common
+ * output rate below the set's own, so playback at a lower rate never
+ * aliases the upper octave of the IRs into the audible band; forRate()
+ * picks it. That costs up to about three times the set's own size.
+ *
+ * Immutable after creation, so any number of render threads may read it.
+ */
+class HrirSet {
+public:
+    struct Direction {
+        float azimuth;
+        float elevation;
+    };
+
+    static constexpr int MAX_NEIGHBOURS = 3;
+
+    // nullptr if the file is missing or malformed
+    static std::unique_ptr<HrirSet> loadFile(const char* path);
+    // Built-in spherical-head model (Brown & Duda), used until a set is loaded
+    static std::unique_ptr<HrirSet> createSphericalHead(int sampleRate);
+
+    HrirSet(const HrirSet&) = delete;
+    HrirSet& operator=(const HrirSet&) = delete;
+
+    int sampleRate() const { return rate; }
+    int irLength() const { return length; }
+    int numDirections() const { return count; }
+    const Direction& direction(int index) const { return directions[index]; }
+    const float* ir(int index, int ear) const { return data + (static_cast<size_t>(index) * 2 + ear) * length; }
+    // First sample within 20 dB of the IR's peak; used to time-align before blending
+    int onset(int index, int ear) const { return onsets[index * 2 + ear]; }
+
+    /**
+     * Finds up to MAX_NEIGHBOURS measured directions closest (great-circle) to
+     * the requested one, with inverse-distance weights that sum to 1.
+     * Returns the number of neighbours written.
+     */
+    int nearest(float azimuth, float elevation, int* indices, float* weights) const;
+
+    // The copy prepared for sampleRate, or this set if there is none
+    const HrirSet* forRate(int sampleRate) const;
+
+private:
+    HrirSet() = default;
+
+    int rate = 0;
+    int length = 0;
+    int count = 0;
+    const Direction* directions = nullptr;
+    const float* data = nullptr;
+
+    MappedFile file;
+    std::vector<Direction> ownedDirections;
+    std::vector<float> ownedData;
+
+    std::vector<int> onsets;
+    std::vector<float> unitVectors; // x (right), y (front), z (up) per direction
+    std::vector<std::unique_ptr<HrirSet>> resampled;
+
+    void finishSetup();
+    void prepareRates();
+};
+
+/**
+ * Process-wide choice of HRIR set, shared by every engine's spatializer.
+ *
+ * Loaded sets stay mapped for the lifetime of the process, so the render
+ * thread can hold a plain pointer without reference counting; loading the
+ * same path twice reuses the existing mapping.
+ */
+class HrirLibrary {
+public:
+    static HrirLibrary& instance();
+
+    // Render thread: wait-free
+    const HrirSet* current() const { return active.load(std::memory_order_acquire); }
+
+    // Control thread
+    bool load(const char* path);
+    void useBuiltIn();
+
+private:
+    HrirLibrary();
+
+    std::mutex loadMutex;
+    std::vector<std::pair<std::string, std::unique_ptr<HrirSet>>> loaded;
+    std::unique_ptr<HrirSet> builtIn;
+    std::atomic<const HrirSet*> active{nullptr};
+};
+
+#endif // HRIR_SET_H
@@ -0,0 +1,203 @@
+#include "hrtf_renderer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Angle between two directions on the unit sphere
+float angularDistance(float az1, float el1, float az2, float el2) {
+    const float c = std::sin(el1) * std::sin(el2) + std::cos(el1) * std::cos(el2) * std::cos(az1 - az2);
+    return std::acos(std::max(-1.0f, std::min(1.0f, c)));
+}
+
+} // namespace
+
+HrtfRenderer::HrtfRenderer() : fft(FFT_SIZE), activeBank(0), hasFilter(false),
+                               filterSet(nullptr), filterRate(0), filterAzimuth(0.0f), filterElevation(0.0f),
+                               currentRate(0),
+                               fdlRe(static_cast<size_t>(SOURCES) * MAX_PARTITIONS * BINS, 0.0f),
+                               fdlIm(static_cast<size_t>(SOURCES) * MAX_PARTITIONS * BINS, 0.0f),
+                               fdlHead(0), blockPos(0),
+                               blendScratch(MAX_PARTITIONS * BLOCK * 2, 0.0f),
+                               irScratch(MAX_PARTITIONS * BLOCK, 0.0f) {
+    for (auto& bank : banks) {
+        bank.re.assign(static_cast<size_t>(SOURCES) * EARS * MAX_PARTITIONS * BINS, 0.0f);
+        bank.im.assign(static_cast<size_t>(SOURCES) * EARS * MAX_PARTITIONS * BINS, 0.0f);
+    }
+    clear();
+}
+
+void HrtfRenderer::clear() {
+    std::fill(fdlRe.begin(), fdlRe.end(), 0.0f);
+    std::fill(fdlIm.begin(), fdlIm.end(), 0.0f);
+    fdlHead = 0;
+    for (int s = 0; s < SOURCES; ++s) {
+        std::fill(history[s], history[s] + FFT_SIZE, 0.0f);
+        std::fill(blockIn[s], blockIn[s] + BLOCK, 0.0f);
+    }
+    for (int e = 0; e < EARS; ++e) std::fill(blockOut[e], blockOut[e] + BLOCK, 0.0f);
+    blockPos = 0;
+    hasFilter = false;
+}
+
+float* HrtfRenderer::binsOf(std::vector<float>& v, int source, int ear, int partition) {
+    return v.data() + ((static_cast<size_t>(source) * EARS + ear) * MAX_PARTITIONS + partition) * BINS;
+}
+
+const float* HrtfRenderer::binsOf(const std::vector<float>& v, int source, int ear, int partition) const {
+    return v.data() + ((static_cast<size_t>(source) * EARS + ear) * MAX_PARTITIONS + partition) * BINS;
+}
+
+void HrtfRenderer::process(float* buffer, int numFrames, float azimuth, float elevation, int sampleRate) {
+    if (sampleRate != currentRate) {
+        currentRate = sampleRate;
+        clear();
+    }
+
+    // Output lags input by exactly one block
+    for (int i = 0; i < numFrames; ++i) {
+        blockIn[0][blockPos] = buffer[i * 2];
+        blockIn[1][blockPos] = buffer[i * 2 + 1];
+        buffer[i * 2] = blockOut[0][blockPos];
+        buffer[i * 2 + 1] = blockOut[1][blockPos];
+        if (++blockPos == BLOCK) {
+            processBlock(azimuth, elevation);
+            blockPos = 0;
+        }
+    }
+}
+
+void HrtfRenderer::processBlock(float azimuth, float elevation) {
+    // 1. Push the new block's spectrum into the delay line
+    fdlHead = fdlHead == 0 ? MAX_PARTITIONS - 1 : fdlHead - 1;
+    for (int s = 0; s < SOURCES; ++s) {
+        std::copy(history[s] + BLOCK, history[s] + FFT_SIZE, history[s]);
+        std::copy(blockIn[s], blockIn[s] + BLOCK, history[s] + BLOCK);
+        float* re = fdlRe.data() + (static_cast<size_t>(s) * MAX_PARTITIONS + fdlHead) * BINS;
+        float* im = fdlIm.data() + (static_cast<size_t>(s) * MAX_PARTITIONS + fdlHead) * BINS;
+        fft.forward(history[s], re, im);
+    }
+
+    // 2. Filter maintenance: at most one rebuild per block
+    const HrirSet* set = HrirLibrary::instance().current();
+    if (set == nullptr) {
+        for (int e = 0; e < EARS; ++e) std::copy(blockIn[e], blockIn[e] + BLOCK, blockOut[e]);
+        return;
+    }
+    const bool stale = !hasFilter || set != filterSet || currentRate != filterRate ||
+                       angularDistance(azimuth, elevation, filterAzimuth, filterElevation) > REBUILD_ANGLE;
+    if (!stale) {
+        convolve(banks[activeBank], blockOut);
+        return;
+    }
+
+    const bool crossfade = hasFilter;
+    const int target = crossfade ? 1 - activeBank : activeBank;
+    buildFilter(banks[target], *set->forRate(currentRate), azimuth, elevation);
+    filterSet = set;
+    filterRate = currentRate;
+    filterAzimuth = azimuth;
+    filterElevation = elevation;
+    hasFilter = true;
+
+    if (!crossfade) {
+        convolve(banks[target], blockOut);
+        return;
+    }
+
+    // 3. Render the block with both filters and crossfade
+    convolve(banks[activeBank], fadeOut);
+    convolve(banks[target], blockOut);
+    for (int e = 0; e < EARS; ++e) {
+        for (int i = 0; i < BLOCK; ++i) {
+            const float ramp = (i + 0.5f) / BLOCK;
+            blockOut[e][i] = fadeOut[e][i] + (blockOut[e][i] - fadeOut[e][i]) * ramp;
+        }
+    }
+    activeBank = target;
+}
+
+void HrtfRenderer::convolve(const FilterBank& bank, float out[EARS][BLOCK]) {
+    for (int e = 0; e < EARS; ++e) {
+        std::fill(accRe, accRe + BINS, 0.0f);
+        std::fill(accIm, accIm + BINS, 0.0f);
+        for (int s = 0; s < SOURCES; ++s) {
+            for (int p = 0; p < bank.partitions; ++p) {
+                const int slot = (fdlHead + p) % MAX_PARTITIONS;
+                const float* xr = fdlRe.data() + (static_cast<size_t>(s) * MAX_PARTITIONS + slot) * BINS;
+                const float* xi = fdlIm.data() + (static_cast<size_t>(s) * MAX_PARTITIONS + slot) * BINS;
+                const float* hr = binsOf(bank.re, s, e, p);
+                const float* hi = binsOf(bank.im, s, e, p);
+                for (int k = 0; k < BINS; ++k) {
+                    accRe[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                    accIm[k] += xr[k] * hi[k] + xi[k] * hr[k];
+                }
+            }
+        }
+        fft.inverse(accRe, accIm, timeScratch);
+        // Overlap-save: the second half is the valid linear convolution
+        std::copy(timeScratch + BLOCK, timeScratch + FFT_SIZE, out[e]);
+    }
+}
+
+void HrtfRenderer::buildFilter(FilterBank& bank, const HrirSet& set, float azimuth, float elevation) {
+    const double ratio = static_cast<double>(currentRate) / set.sampleRate();
+    const int outLength = std::min(static_cast<int>(std::ceil(set.irLength() * ratio)), MAX_PARTITIONS * BLOCK);
+    bank.partitions = (outLength + BLOCK - 1) / BLOCK;
+
+    for (int s = 0; s < SOURCES; ++s) {
+        const float sourceAzimuth = azimuth + (s == 0 ? -SPEAKER_ANGLE : SPEAKER_ANGLE);
+        for (int e = 0; e < EARS; ++e) {
+            blendIr(set, sourceAzimuth, elevation, e, outLength);
+            for (int p = 0; p < bank.partitions; ++p) {
+                std::fill(timeScratch, timeScratch + FFT_SIZE, 0.0f);
+                const int first = p * BLOCK;
+                const int count = std::min(BLOCK, outLength - first);
+                std::copy(irScratch.begin() + first, irScratch.begin() + first + count, timeScratch);
+                fft.forward(timeScratch, binsOf(bank.re, s, e, p), binsOf(bank.im, s, e, p));
+            }
+        }
+    }
+}
+
+// Blends the neighbouring HRIRs with their onsets aligned into irScratch.
+// The set normally comes from HrirSet::forRate at the stream rate already;
+// otherwise (upsampling, or an uncommon output rate) it is resampled here by
+// linear interpolation, gain-corrected.
+void HrtfRenderer::blendIr(const HrirSet& set, float azimuth, float elevation, int ear, int outLength) {
+    int indices[HrirSet::MAX_NEIGHBOURS];
+    float weights[HrirSet::MAX_NEIGHBOURS];
+    const int n = set.nearest(azimuth, elevation, indices, weights);
+
+    const int length = std::min(set.irLength(), static_cast<int>(blendScratch.size()));
+    float meanOnset = 0.0f;
+    for (int i = 0; i < n; ++i) meanOnset += weights[i] * set.onset(indices[i], ear);
+    const int targetOnset = static_cast<int>(std::lround(meanOnset));
+
+    float* blended = blendScratch.data();
+    std::fill(blended, blended + length, 0.0f);
+    for (int i = 0; i < n; ++i) {
+        const float* h = set.ir(indices[i], ear);
+        const int shift = set.onset(indices[i], ear) - targetOnset;
+        const float w = weights[i] * SOURCE_GAIN;
+        const int from = std::max(0, -shift);
+        const int to = std::min(length, length - shift);
+        for (int t = from; t < to; ++t) blended[t] += w * h[t + shift];
+    }
+
+    if (set.sampleRate() == currentRate) {
+        const int count = std::min(outLength, length);
+        std::copy(blended, blended + count, irScratch.begin());
+        std::fill(irScratch.begin() + count, irScratch.begin() + outLength, 0.0f);
+        return;
+    }
+    const float step = static_cast<float>(set.sampleRate()) / currentRate;
+    for (int t = 0; t < outLength; ++t) {
+        const float pos = t * step;
+        const int i0 = static_cast<int>(pos);
+        const float frac = pos - i0;
+        const float a = i0 < length ? blended[i0] : 0.0f;
+        const float b = i0 + 1 < length ? blended[i0 + 1] : 0.0f;
+        irScratch[t] = (a + (b - a) * frac) * step;
+    }
+}
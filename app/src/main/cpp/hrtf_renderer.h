@@ -0,0 +1,92 @@
+#ifndef HRTF_RENDERER_H
+#define HRTF_RENDERER_H
+
+#include <vector>
+#include "fft.h"
+#include "hrir_set.h"
+
+/**
+ * Binaural renderer: plays the stereo input through two virtual speakers at
+ * +/-30 degrees around the requested azimuth/elevation, convolving each with
+ * the left- and right-ear HRIRs.
+ *
+ * Convolution is uniformly partitioned overlap-save: the input is cut into
+ * BLOCK-frame blocks, each block's spectrum is pushed into a frequency-domain
+ * delay line, and every ear output is one complex multiply-accumulate per
+ * partition followed by one inverse FFT. Cost per block is fixed by the IR
+ * length (at most MAX_PARTITIONS partitions), whatever the callback size.
+ *
+ * Filters are rebuilt at most once per block, when the direction moves by
+ * more than REBUILD_ANGLE or the HRIR set / sample rate changes. HRIRs are
+ * blended from the nearest measured directions after time-aligning their
+ * onsets. The block that switches filters is rendered with both and
+ * crossfaded, so head tracking never produces a discontinuity.
+ *
+ * Latency: BLOCK frames. Render thread only; nothing allocates after
+ * construction.
+ */
+class HrtfRenderer {
+public:
+    static constexpr int BLOCK = 128;
+    static constexpr int FFT_SIZE = 2 * BLOCK;
+    static constexpr int BINS = BLOCK + 1;
+    static constexpr int MAX_PARTITIONS = 16; // IRs up to 2048 taps at the stream rate
+    static constexpr float SPEAKER_ANGLE = 0.5235988f; // 30 degrees
+    static constexpr float REBUILD_ANGLE = 0.0174533f; // 1 degree
+    static constexpr float SOURCE_GAIN = 0.7071068f;   // two speakers into each ear
+
+    HrtfRenderer();
+
+    // Interleaved stereo, processed in place.
+    void process(float* buffer, int numFrames, float azimuth, float elevation, int sampleRate);
+    void clear();
+
+private:
+    static constexpr int SOURCES = 2;
+    static constexpr int EARS = 2;
+
+    struct FilterBank {
+        std::vector<float> re; // [source][ear][partition][bin]
+        std::vector<float> im;
+        int partitions = 0;
+    };
+
+    RealFft fft;
+    FilterBank banks[2];
+    int activeBank;
+    bool hasFilter;
+
+    const HrirSet* filterSet;
+    int filterRate;
+    float filterAzimuth;
+    float filterElevation;
+    int currentRate;
+
+    // Frequency-domain delay line: [source][slot][bin], slot 'fdlHead' is newest
+    std::vector<float> fdlRe;
+    std::vector<float> fdlIm;
+    int fdlHead;
+
+    // Time-domain block buffering
+    float history[SOURCES][FFT_SIZE]; // previous block then current block
+    float blockIn[SOURCES][BLOCK];
+    float blockOut[EARS][BLOCK];
+    int blockPos;
+
+    // Scratch
+    std::vector<float> blendScratch;
+    std::vector<float> irScratch;
+    float timeScratch[FFT_SIZE];
+    float accRe[BINS];
+    float accIm[BINS];
+    float fadeOut[EARS][BLOCK];
+
+    void processBlock(float azimuth, float elevation);
+    void buildFilter(FilterBank& bank, const HrirSet& set, float azimuth, float elevation);
+    void blendIr(const HrirSet& set, float azimuth, float elevation, int ear, int outLength);
+    void convolve(const FilterBank& bank, float out[EARS][BLOCK]);
+    float* binsOf(std::vector<float>& v, int source, int ear, int partition);
+    const float* binsOf(const std::vector<float>& v, int source, int ear, int partition) const;
+};
+
+#endif // HRTF_RENDERER_H
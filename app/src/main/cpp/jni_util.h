@@ -0,0 +1,24 @@
+#ifndef JNI_UTIL_H
+#define JNI_UTIL_H
+
+#include <jni.h>
+#include <string>
+#include <vector>
+
+// Appends the elements of a String[] to out; false on a null element
+inline bool readStringArray(JNIEnv *env, jobjectArray array, std::vector<std::string>& out) {
+    const jsize count = env->GetArrayLength(array);
+    out.reserve(out.size() + static_cast<size_t>(count));
+    for (jsize i = 0; i < count; ++i) {
+        auto element = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+        if (element == nullptr) return false;
+        const char *chars = env->GetStringUTFChars(element, nullptr);
+        if (chars == nullptr) return false;
+        out.emplace_back(chars);
+        env->ReleaseStringUTFChars(element, chars);
+        env->DeleteLocalRef(element);
+    }
+    return true;
+}
+
+#endif // JNI_UTIL_H
@@ -1,150 +1,215 @@
 #include "limiter.h"
+#include "fast_math.h"
 
-Limiter::Limiter() : enabled(false), threshold(1.0f), ratio(1.0f), 
-                     attackCoeff(0.0f), releaseCoeff(0.0f), makeupGain(1.0f),
-                     delayWriteIndex(0), delayLength(0), envelope(0.0f),
-                     currentGain(1.0f), attackMs_(0.1f), releaseMs_(100.0f), currentSampleRate(0), currentNumChannels(0), balance(0.0f) {
+Limiter::Limiter() : enabled(false), truePeakEnabled(true), resetPending(false), releaseCoeff(0.0f),
+                     delayBuffer((MAX_LOOKAHEAD_FRAMES + Oversampler::MAX_LATENCY_FRAMES) * MAX_CHANNELS, 0.0f),
+                     delayWriteIndex(0), delayLength(1), lookaheadFrames(2), detectTruePeak(true),
+                     peakQueueValue(MAX_LOOKAHEAD_FRAMES + 1, 0.0f),
+                     peakQueueFrame(MAX_LOOKAHEAD_FRAMES + 1, 0),
+                     peakQueueHead(0), peakQueueSize(0), frameCounter(0),
+                     cachedPeak(-1.0f), cachedGain(1.0f), gainThreshold(-1.0f), gainRatio(-1.0f),
+                     thresholdLog2(0.0f), ratioSlope(0.0f), releasedGain(1.0f),
+                     attackRing(MAX_LOOKAHEAD_FRAMES, 1.0f), attackIndex(0), attackFrames(1),
+                     attackSum(1.0), coeffAttackMs(-1.0f), coeffReleaseMs(-1.0f),
+                     currentSampleRate(0), currentNumChannels(0) {
+    params.update([](Params& p) { p.balance = 0.0f; });
     setParams(-0.1f, 20.0f, 0.1f, 100.0f, 0.0f);
 }
 
 void Limiter::setParams(float thresholdDb, float ratio, float attackMs, float releaseMs, float makeupGainDb) {
-    std::lock_guard<std::mutex> lock(mtx);
-    this->threshold = pow(10.0f, thresholdDb / 20.0f);
-    this->ratio = ratio;
-    this->makeupGain = pow(10.0f, makeupGainDb / 20.0f);
-    
-    this->attackMs_ = attackMs;
-    this->releaseMs_ = releaseMs;
+    float linearThreshold = pow(10.0f, thresholdDb / 20.0f);
+    float linearMakeup = pow(10.0f, makeupGainDb / 20.0f);
+    params.update([&](Params& p) {
+        p.threshold = linearThreshold;
+        p.ratio = ratio;
+        p.makeupGain = linearMakeup;
+        p.attackMs = attackMs;
+        p.releaseMs = releaseMs;
+    });
+    notifyDspConfigChanged();
 }
 
 void Limiter::setBalance(float balance) {
-    std::lock_guard<std::mutex> lock(mtx);
-    this->balance = std::max(-1.0f, std::min(1.0f, balance));
+    float clamped = std::max(-1.0f, std::min(1.0f, balance));
+    bool changed = false;
+    params.update([&](Params& p) {
+        changed = p.balance != clamped;
+        p.balance = clamped;
+    });
+    // Called on every audio callback from Kotlin; only recompile on real changes
+    if (changed) notifyDspConfigChanged();
 }
 
-void Limiter::process(float* buffer, int numFrames, int numChannels, int sampleRate) {
-    if (!enabled.load(std::memory_order_relaxed)) return;
+// Balance attenuates the opposite channel: right bias lowers L, left bias lowers R
+static void balanceGains(float balance, float& balGainL, float& balGainR) {
+    balGainL = 1.0f;
+    balGainR = 1.0f;
+    if (balance > 0.0f) {
+        balGainL = 1.0f - balance;
+    } else if (balance < 0.0f) {
+        balGainR = 1.0f + balance;
+    }
+}
+
+void Limiter::getPreGains(float& gainL, float& gainR) {
+    const Params& p = params.acquire();
+    balanceGains(p.balance, gainL, gainR);
+    gainL *= p.makeupGain;
+    gainR *= p.makeupGain;
+}
 
-    // Local copies of parameters to minimize lock time
-    float localThreshold, localRatio, localMakeupGain, localBalance;
-    float localAttackMs, localReleaseMs;
-    {
-        std::lock_guard<std::mutex> lock(mtx);
-        localThreshold = threshold;
-        localRatio = ratio;
-        localMakeupGain = makeupGain;
-        localBalance = balance;
-        localAttackMs = attackMs_;
-        localReleaseMs = releaseMs_;
+// Static gain curve: ratio compression above the threshold, then a hard
+// ceiling so that peak * gain never exceeds OUTPUT_CEILING. The ceiling
+// applies below the threshold too, which can sit above it.
+float Limiter::computeGain(float peak) const {
+    float gain = peak <= gainThreshold ? 1.0f : fastmath::exp2((fastmath::log2(peak) - thresholdLog2) * ratioSlope);
+    if (peak * gain > OUTPUT_CEILING) gain = OUTPUT_CEILING / peak;
+    return gain;
+}
+
+// Monotonic deque: values decrease from head to tail, so the head is the
+// maximum of the last lookaheadFrames peaks. Amortized O(1) per frame.
+void Limiter::pushPeak(float peak) {
+    const int capacity = static_cast<int>(peakQueueValue.size());
+    while (peakQueueSize > 0 &&
+           frameCounter - peakQueueFrame[peakQueueHead] >= static_cast<uint32_t>(lookaheadFrames)) {
+        if (++peakQueueHead == capacity) peakQueueHead = 0;
+        --peakQueueSize;
     }
+    while (peakQueueSize > 0) {
+        int back = peakQueueHead + peakQueueSize - 1;
+        if (back >= capacity) back -= capacity;
+        if (peakQueueValue[back] > peak) break;
+        --peakQueueSize;
+    }
+    int slot = peakQueueHead + peakQueueSize;
+    if (slot >= capacity) slot -= capacity;
+    peakQueueValue[slot] = peak;
+    peakQueueFrame[slot] = frameCounter;
+    ++peakQueueSize;
+    ++frameCounter;
+}
 
-    if (sampleRate != currentSampleRate || numChannels != currentNumChannels) {
+/*
+ * Look-ahead brickwall limiter.
+ *
+ * For each input frame the gain computer sees the maximum peak of the window
+ * [n - L + 1, n] (L = lookahead frames), and the audio is delayed by L - 1
+ * frames, so the oldest frame in the window is the one being output. With
+ * true-peak detection the frame peaks come from the oversampler and are
+ * themselves late by its latency, which is added to the delay line. That
+ * gain is released with a one-pole and then averaged over attackFrames <= L.
+ * Every value entering the average already covers the output frame, so the
+ * average does too: output samples never exceed OUTPUT_CEILING, without any
+ * clipper, and inter-sample peaks stay within the reconstruction error of
+ * the gain change. The final clamp only absorbs float rounding.
+ */
+void Limiter::process(float* buffer, int numFrames, int numChannels, int sampleRate, bool applyPreGain) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    if (resetPending.exchange(false, std::memory_order_acq_rel)) clearState();
+
+    // Wait-free view of the latest published parameters
+    const Params& p = params.acquire();
+    int safeChannels = std::min(numChannels, MAX_CHANNELS);
+
+    const bool truePeak = truePeakEnabled.load(std::memory_order_relaxed);
+    if (sampleRate != currentSampleRate || numChannels != currentNumChannels || truePeak != detectTruePeak) {
         currentSampleRate = sampleRate;
         currentNumChannels = numChannels;
-        delayLength = (int)(LOOKAHEAD_MS * sampleRate / 1000.0f);
-        delayBuffer.assign(delayLength * numChannels, 0.0f);
-        delayWriteIndex = 0;
-        
-        // Recalculate coeffs
-        float attackSamples = localAttackMs * sampleRate / 1000.0f;
-        float releaseSamples = localReleaseMs * sampleRate / 1000.0f;
-        
-        if (attackSamples < 1.0f) attackCoeff = 0.0f; 
-        else attackCoeff = exp(-1.0f / attackSamples);
-
-        if (releaseSamples < 1.0f) releaseCoeff = 0.0f;
-        else releaseCoeff = exp(-1.0f / releaseSamples);
+        detectTruePeak = truePeak;
+        truePeakDetector.setSampleRate(sampleRate);
+        lookaheadFrames = std::max(2, std::min((int)(LOOKAHEAD_MS * sampleRate / 1000.0f), MAX_LOOKAHEAD_FRAMES));
+        delayLength = lookaheadFrames - 1 + (detectTruePeak ? truePeakDetector.latencyFrames() : 0);
+        clearState();
+        coeffAttackMs = -1.0f; // force recalculation
+    }
+    if (p.attackMs != coeffAttackMs || p.releaseMs != coeffReleaseMs) {
+        updateCoefficients(sampleRate, p.attackMs, p.releaseMs);
+    }
+    if (p.threshold != gainThreshold || p.ratio != gainRatio) {
+        gainThreshold = p.threshold;
+        gainRatio = p.ratio;
+        thresholdLog2 = fastmath::log2(std::max(p.threshold, 1e-6f));
+        ratioSlope = p.ratio > 1.0f ? 1.0f / p.ratio - 1.0f : 0.0f;
+        cachedPeak = -1.0f; // invalidate the gain cache
     }
 
-    // Calculate balance gains
-    float balGainL = 1.0f;
-    float balGainR = 1.0f;
-    if (localBalance > 0.0f) { // Right bias, attenuate Left
-        balGainL = 1.0f - localBalance;
-    } else if (localBalance < 0.0f) { // Left bias, attenuate Right
-        balGainR = 1.0f + localBalance;
+    // Per-channel pre-gain: makeup, plus balance on the first two channels
+    float channelGain[MAX_CHANNELS];
+    float balGainL, balGainR;
+    balanceGains(applyPreGain ? p.balance : 0.0f, balGainL, balGainR);
+    for (int ch = 0; ch < safeChannels; ++ch) {
+        channelGain[ch] = applyPreGain ? p.makeupGain : 1.0f;
+    }
+    if (numChannels >= 2) {
+        channelGain[0] *= balGainL;
+        channelGain[1] *= balGainR;
     }
 
-    for (int i = 0; i < numFrames; ++i) {
-        float maxAbsInput = 0.0f;
-        
-        // Use a fixed-size array to avoid heap allocation in the loop
-        float inputFrame[16]; // Support up to 16 channels (standard for immersive audio)
-        int safeChannels = std::min(numChannels, 16);
-
-        for (int ch = 0; ch < safeChannels; ++ch) {
-            float val = buffer[i * numChannels + ch] * localMakeupGain;
-            
-            // Apply Balance (Stereo only)
-            if (numChannels >= 2) {
-                if (ch == 0) val *= balGainL;
-                if (ch == 1) val *= balGainR;
-            }
+    const float attackScale = 1.0f / attackFrames;
+    float gains[BLOCK_FRAMES];
+
+    for (int start = 0; start < numFrames; start += BLOCK_FRAMES) {
+        const int frames = std::min(BLOCK_FRAMES, numFrames - start);
+        float* block = buffer + start * numChannels;
 
-            inputFrame[ch] = val;
-            float absSample = fabs(val);
-            if (absSample > maxAbsInput) maxAbsInput = absSample;
+        // 1. Pre-gain and frame peaks
+        for (int i = 0; i < frames; ++i) {
+            float* frame = block + i * numChannels;
+            for (int ch = 0; ch < safeChannels; ++ch) frame[ch] *= channelGain[ch];
         }
-        
-        // 2. Update envelope (peak detector)
-        if (maxAbsInput > envelope) {
-            envelope = attackCoeff * envelope + (1.0f - attackCoeff) * maxAbsInput;
+        float peaks[BLOCK_FRAMES];
+        if (detectTruePeak) {
+            truePeakDetector.framePeaks(block, frames, numChannels, peaks);
         } else {
-            envelope = releaseCoeff * envelope + (1.0f - releaseCoeff) * maxAbsInput;
-        }
-        
-        // 3. Calculate target gain reduction
-        float targetGain = 1.0f;
-        if (envelope > localThreshold) {
-            float envDb = 20.0f * log10(envelope + 1e-6f);
-            float threshDb = 20.0f * log10(localThreshold + 1e-6f);
-            float excessDb = envDb - threshDb;
-            
-            float reductionDb = excessDb * (1.0f / localRatio - 1.0f);
-            targetGain = pow(10.0f, reductionDb / 20.0f);
+            for (int i = 0; i < frames; ++i) {
+                const float* frame = block + i * numChannels;
+                float peak = 0.0f;
+                for (int ch = 0; ch < safeChannels; ++ch) peak = std::max(peak, std::fabs(frame[ch]));
+                peaks[i] = peak;
+            }
         }
 
-        // 4. Smooth the gain change to prevent crackling (zipper noise)
-        // Using a 1ms smoothing time constant
-        float smoothingCoeff = 0.95f; 
-        currentGain = smoothingCoeff * currentGain + (1.0f - smoothingCoeff) * targetGain;
-        
-        // 5. Apply Look-ahead Delay and Smoothed Gain
-        for (int ch = 0; ch < safeChannels; ++ch) {
-            float inputSample = inputFrame[ch];
-
-            // Write to delay buffer
-            int writePos = (delayWriteIndex * numChannels) + ch;
-            float delayedSample = delayBuffer[writePos];
-            delayBuffer[writePos] = inputSample;
-            
-            // Output = Delayed * Smoothed Gain
-            float rawOutput = delayedSample * currentGain;
-            
-            float outputSample;
-            if (rawOutput < -1.5f) {
-                outputSample = -1.0f;
-            } else if (rawOutput > 1.5f) {
-                outputSample = 1.0f;
+        // 2. Gain envelope for the block
+        for (int i = 0; i < frames; ++i) {
+            pushPeak(peaks[i]);
+            const float windowPeak = peakQueueValue[peakQueueHead];
+            if (windowPeak != cachedPeak) {
+                cachedPeak = windowPeak;
+                cachedGain = computeGain(windowPeak);
+            }
+
+            // Instant attack into the release stage keeps releasedGain <= target
+            if (cachedGain < releasedGain) {
+                releasedGain = cachedGain;
             } else {
-                // Cubic soft-clipper
-                outputSample = rawOutput - (0.1481f * rawOutput * rawOutput * rawOutput);
-                
-                // Hard clamp the result to be absolutely safe
-                if (outputSample > 1.0f) outputSample = 1.0f;
-                if (outputSample < -1.0f) outputSample = -1.0f;
+                releasedGain = cachedGain + (releasedGain - cachedGain) * releaseCoeff;
             }
 
-            buffer[i * numChannels + ch] = outputSample;
+            attackSum += releasedGain - attackRing[attackIndex];
+            attackRing[attackIndex] = releasedGain;
+            if (++attackIndex == attackFrames) attackIndex = 0;
+            gains[i] = static_cast<float>(attackSum) * attackScale;
+        }
+
+        // 3. Delay line and gain
+        for (int i = 0; i < frames; ++i) {
+            float* frame = block + i * numChannels;
+            float* delayed = delayBuffer.data() + delayWriteIndex * safeChannels;
+            const float gain = gains[i];
+            for (int ch = 0; ch < safeChannels; ++ch) {
+                const float out = delayed[ch] * gain;
+                delayed[ch] = frame[ch];
+                frame[ch] = std::max(-OUTPUT_CEILING, std::min(OUTPUT_CEILING, out));
+            }
+            if (++delayWriteIndex == delayLength) delayWriteIndex = 0;
         }
-        
-        delayWriteIndex++;
-        if (delayWriteIndex >= delayLength) delayWriteIndex = 0;
     }
 }
 
 void Limiter::setEnabled(bool enabled) {
     this->enabled.store(enabled, std::memory_order_relaxed);
+    notifyDspConfigChanged();
     if (!enabled) {
         reset();
     }
@@ -154,14 +219,52 @@ bool Limiter::isEnabled() const {
     return enabled.load(std::memory_order_relaxed);
 }
 
+void Limiter::setTruePeakEnabled(bool enabled) {
+    truePeakEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Limiter::isTruePeakEnabled() const {
+    return truePeakEnabled.load(std::memory_order_relaxed);
+}
+
+// Control thread: the render thread clears its state on the next callback.
 void Limiter::reset() {
-    std::lock_guard<std::mutex> lock(mtx);
-    envelope = 0.0f;
-    currentGain = 1.0f;
+    resetPending.store(true, std::memory_order_release);
+}
+
+void Limiter::clearState() {
     std::fill(delayBuffer.begin(), delayBuffer.end(), 0.0f);
     delayWriteIndex = 0;
+    truePeakDetector.reset();
+    peakQueueHead = 0;
+    peakQueueSize = 0;
+    frameCounter = 0;
+    cachedPeak = -1.0f;
+    releasedGain = 1.0f;
+    std::fill(attackRing.begin(), attackRing.end(), 1.0f);
+    attackIndex = 0;
+    attackSum = attackFrames;
 }
 
-void Limiter::updateCoefficients(int sampleRate) {
-    // Already handled in process() check
-}
\ No newline at end of file
+void Limiter::updateCoefficients(int sampleRate, float attackMs, float releaseMs) {
+    coeffAttackMs = attackMs;
+    coeffReleaseMs = releaseMs;
+
+    float releaseSamples = releaseMs * sampleRate / 1000.0f;
+    if (releaseSamples < 1.0f) releaseCoeff = 0.0f;
+    else releaseCoeff = exp(-1.0f / releaseSamples);
+
+    // The attack ramp must fit inside the look-ahead window
+    int frames = (int)(attackMs * sampleRate / 1000.0f + 0.5f);
+    frames = std::max(1, std::min(frames, lookaheadFrames));
+    if (frames != attackFrames) {
+        // Restart the average at the lowest pending gain so that frames
+        // already in the delay line stay covered
+        float lowest = releasedGain;
+        for (int i = 0; i < attackFrames; ++i) lowest = std::min(lowest, attackRing[i]);
+        attackFrames = frames;
+        std::fill(attackRing.begin(), attackRing.begin() + attackFrames, lowest);
+        attackIndex = 0;
+        attackSum = static_cast<double>(lowest) * attackFrames;
+    }
+}
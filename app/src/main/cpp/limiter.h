@@ -4,49 +4,100 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
-#include <mutex>
 #include <atomic>
+#include "param_snapshot.h"
+#include "oversampler.h"
 
 class Limiter {
 public:
     Limiter();
     
     // Process audio in-place. Buffer is interleaved [L, R, L, R...]
-    void process(float* buffer, int numFrames, int numChannels, int sampleRate);
+    // Pass applyPreGain = false when makeup gain and balance were already
+    // applied upstream (fused into a stereo matrix by the DSP graph).
+    void process(float* buffer, int numFrames, int numChannels, int sampleRate, bool applyPreGain = true);
+
+    // Render thread: linear makeup gain combined with balance for L and R.
+    void getPreGains(float& gainL, float& gainR);
     
     void setParams(float thresholdDb, float ratio, float attackMs, float releaseMs, float makeupGainDb);
     void setEnabled(bool enabled);
     bool isEnabled() const;
     void setBalance(float balance);
+    // Detect inter-sample peaks (BS.1770 oversampling) instead of sample
+    // peaks. Adds Oversampler::latencyFrames() of delay. On by default.
+    void setTruePeakEnabled(bool enabled);
+    bool isTruePeakEnabled() const;
     void reset();
 
 private:
-    std::mutex mtx;
+    struct Params {
+        float threshold; // Linear
+        float ratio;
+        float attackMs;
+        float releaseMs;
+        float makeupGain; // Linear
+        float balance; // -1.0 (Left) to 1.0 (Right)
+    };
+
+    // Constants
+    static constexpr float LOOKAHEAD_MS = 5.0f; // 5ms lookahead
+    static constexpr int MAX_CHANNELS = 16; // standard for immersive audio
+    static constexpr int MAX_LOOKAHEAD_FRAMES = 960; // 5ms at 192kHz
+    static constexpr int BLOCK_FRAMES = Oversampler::BLOCK_FRAMES;
+    static constexpr float OUTPUT_CEILING = 1.0f; // 0 dBFS, never exceeded
+
     std::atomic<bool> enabled;
-    float threshold; // Linear
-    float ratio;
-    float attackCoeff;
+    std::atomic<bool> truePeakEnabled;
+    std::atomic<bool> resetPending;
+    ParamSnapshot<Params> params;
+
+    // Render-thread state
     float releaseCoeff;
-    float makeupGain; // Linear
-    
-    // Look-ahead buffer
+
+    // Look-ahead: the gain applied to a sample is computed from the peak of
+    // the next lookaheadFrames input frames, so the delay line is one frame
+    // shorter than the window, plus the true-peak detector's own latency.
+    // Both are preallocated for the highest rate.
     std::vector<float> delayBuffer;
     int delayWriteIndex;
     int delayLength; // In frames
-    
-    float envelope;
-    float currentGain;
-    
-    // Constants
-    const float LOOKAHEAD_MS = 5.0f; // 5ms lookahead
+    int lookaheadFrames;
+
+    Oversampler truePeakDetector;
+    bool detectTruePeak; // render-thread copy of truePeakEnabled
+
+    // Sliding-window maximum of frame peaks (monotonic deque over a ring)
+    std::vector<float> peakQueueValue;
+    std::vector<uint32_t> peakQueueFrame;
+    int peakQueueHead;
+    int peakQueueSize;
+    uint32_t frameCounter;
 
-    float attackMs_;
-    float releaseMs_;
+    // Gain computer cache: the window max only changes on some frames
+    float cachedPeak;
+    float cachedGain;
+    float gainThreshold;
+    float gainRatio;
+    float thresholdLog2;
+    float ratioSlope; // 1/ratio - 1
+
+    // Released gain, then a moving average over attackFrames (<= lookahead)
+    float releasedGain;
+    std::vector<float> attackRing;
+    int attackIndex;
+    int attackFrames;
+    double attackSum;
+
+    float coeffAttackMs;
+    float coeffReleaseMs;
     int currentSampleRate;
     int currentNumChannels;
-    float balance; // -1.0 (Left) to 1.0 (Right)
-    
-    void updateCoefficients(int sampleRate);
+
+    float computeGain(float peak) const;
+    void pushPeak(float peak);
+    void updateCoefficients(int sampleRate, float attackMs, float releaseMs);
+    void clearState();
 };
 
-#endif // LIMITER_H
\ No newline at end of file
+#endif // LIMITER_H
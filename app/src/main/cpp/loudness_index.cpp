@@ -0,0 +1,132 @@
+#include "loudness_index.h"
+#include "file_util.h"
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'U', 'V', 'L', 'U', 'F', 'S', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 32;
+constexpr uint32_t MIN_SLOTS = 16;
+constexpr uint32_t MAX_SLOTS = 1u << 24;
+constexpr size_t MAX_KEY_LENGTH = 0xFFFF;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t entryCount;
+    uint32_t keyBytes;
+    uint32_t reserved[2];
+};
+static_assert(sizeof(FileHeader) == HEADER_SIZE, "unexpected header padding");
+
+// FNV-1a; song IDs are short, so a byte loop is cheap enough
+uint64_t hashKey(const char* key, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<uint8_t>(key[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+LoudnessIndex::LoudnessIndex(const char* path) : file(path, MADV_RANDOM) {
+    if (!file.isOpen() || file.size() < HEADER_SIZE) return;
+
+    FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const bool headerOk = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                          header.version == VERSION &&
+                          header.slotCount >= MIN_SLOTS && header.slotCount <= MAX_SLOTS &&
+                          (header.slotCount & (header.slotCount - 1)) == 0 &&
+                          header.entryCount < header.slotCount;
+    const size_t expected = HEADER_SIZE + static_cast<size_t>(header.slotCount) * sizeof(Slot) + header.keyBytes;
+    if (!headerOk || file.size() < expected) return;
+
+    // The header is 32 bytes and the mapping page-aligned, so slots are aligned
+    slots = reinterpret_cast<const Slot*>(file.data() + HEADER_SIZE);
+    keys = reinterpret_cast<const char*>(slots + header.slotCount);
+    slotMask = header.slotCount - 1;
+    entryCount = header.entryCount;
+
+    // find() trusts key locations and relies on an empty slot ending every
+    // probe, so check both once here
+    uint32_t used = 0;
+    for (uint32_t i = 0; i <= slotMask; ++i) {
+        const Slot& slot = slots[i];
+        if (slot.keyLength == 0) continue;
+        ++used;
+        if (static_cast<size_t>(slot.keyOffset) + slot.keyLength > header.keyBytes) {
+            slots = nullptr;
+            return;
+        }
+    }
+    if (used != entryCount) slots = nullptr;
+}
+
+bool LoudnessIndex::find(const char* key, size_t keyLength, TrackLoudness& result) const {
+    if (slots == nullptr || keyLength == 0 || keyLength > MAX_KEY_LENGTH) return false;
+    const uint64_t hash = hashKey(key, keyLength);
+    // At most half full, so an empty slot always ends the probe
+    for (uint32_t i = static_cast<uint32_t>(hash) & slotMask;; i = (i + 1) & slotMask) {
+        const Slot& slot = slots[i];
+        if (slot.keyLength == 0) return false;
+        if (slot.hash == hash && slot.keyLength == keyLength &&
+            std::memcmp(keys + slot.keyOffset, key, keyLength) == 0) {
+            result = slot.loudness;
+            return true;
+        }
+    }
+}
+
+void LoudnessIndex::entries(std::vector<Entry>& out) const {
+    if (slots == nullptr) return;
+    out.reserve(out.size() + entryCount);
+    for (uint32_t i = 0; i <= slotMask; ++i) {
+        const Slot& slot = slots[i];
+        if (slot.keyLength != 0) out.push_back({std::string(keys + slot.keyOffset, slot.keyLength), slot.loudness});
+    }
+}
+
+bool LoudnessIndex::write(const char* path, const std::vector<Entry>& entries) {
+    // Deduplicate, last entry winning
+    std::unordered_map<std::string, size_t> latest;
+    latest.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const size_t length = entries[i].key.size();
+        if (length == 0 || length > MAX_KEY_LENGTH) continue;
+        latest[entries[i].key] = i;
+    }
+
+    if (latest.size() > MAX_SLOTS / 2) return false;
+    uint32_t slotCount = MIN_SLOTS;
+    while (slotCount < 2 * latest.size()) slotCount <<= 1;
+
+    std::vector<Slot> table(slotCount, Slot{});
+    std::string keyPool;
+    for (const auto& [key, index] : latest) {
+        const uint64_t hash = hashKey(key.data(), key.size());
+        uint32_t i = static_cast<uint32_t>(hash) & (slotCount - 1);
+        while (table[i].keyLength != 0) i = (i + 1) & (slotCount - 1);
+        table[i].hash = hash;
+        table[i].keyOffset = static_cast<uint32_t>(keyPool.size());
+        table[i].keyLength = static_cast<uint16_t>(key.size());
+        table[i].loudness = entries[index].loudness;
+        keyPool += key;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.slotCount = slotCount;
+    header.entryCount = static_cast<uint32_t>(latest.size());
+    header.keyBytes = static_cast<uint32_t>(keyPool.size());
+
+    return writeFileAtomically(path, {{&header, sizeof(header)},
+                                      {table.data(), table.size() * sizeof(Slot)},
+                                      {keyPool.data(), keyPool.size()}});
+}
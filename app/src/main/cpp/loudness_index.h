@@ -0,0 +1,62 @@
+#ifndef LOUDNESS_INDEX_H
+#define LOUDNESS_INDEX_H
+
+#include "loudness_scanner.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Persistent song ID -> TrackLoudness table, read through a memory map.
+ *
+ * The file is an open-addressing hash table: a 32-byte header, a power-of-two
+ * array of 32-byte slots (key hash, key location, the four measurements) at
+ * most half full, then the key bytes. A lookup hashes the ID and probes
+ * linearly from its slot, usually touching one cache line of the table and
+ * one of the keys, with no parsing at open.
+ *
+ * Files are written whole to a temporary and renamed over the old one, so an
+ * open index never sees a partial write; reopen to pick up a new version.
+ */
+class LoudnessIndex {
+public:
+    struct Entry {
+        std::string key;
+        TrackLoudness loudness;
+    };
+
+    LoudnessIndex() = default;
+    explicit LoudnessIndex(const char* path);
+
+    // False if the file is missing or not a valid index
+    bool isOpen() const { return slots != nullptr; }
+    uint32_t size() const { return entryCount; }
+
+    bool find(const char* key, size_t keyLength, TrackLoudness& result) const;
+
+    // Every entry, for merging new results into a rewritten index
+    void entries(std::vector<Entry>& out) const;
+
+    // Later duplicates of a key replace earlier ones
+    static bool write(const char* path, const std::vector<Entry>& entries);
+
+private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t keyOffset;
+        uint16_t keyLength; // 0: empty slot
+        uint16_t reserved;
+        TrackLoudness loudness;
+    };
+    static_assert(sizeof(Slot) == 32, "index slot layout");
+
+    MappedFile file; // MADV_RANDOM: each lookup touches one hashed slot
+    const Slot* slots = nullptr;
+    const char* keys = nullptr;
+    uint32_t slotMask = 0;
+    uint32_t entryCount = 0;
+};
+
+#endif // LOUDNESS_INDEX_H
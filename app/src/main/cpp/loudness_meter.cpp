@@ -0,0 +1,317 @@
+#include "loudness_meter.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LOUDNESS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LOUDNESS_SSE2 1
+#endif
+
+namespace {
+
+constexpr float NO_LOUDNESS = -std::numeric_limits<float>::infinity();
+
+float toLufs(double meanSquare) {
+    return meanSquare > 0.0 ? static_cast<float>(-0.691 + 10.0 * std::log10(meanSquare)) : NO_LOUDNESS;
+}
+
+// BS.1770 weights for Android's canonical channel orders
+void channelWeights(int numChannels, float* weights) {
+    constexpr float SURROUND = 1.41f;
+    for (int ch = 0; ch < numChannels; ++ch) weights[ch] = 1.0f;
+    switch (numChannels) {
+        case 4: // FL FR BL BR
+        case 5: // FL FR FC BL BR
+            weights[numChannels - 2] = SURROUND;
+            weights[numChannels - 1] = SURROUND;
+            break;
+        case 6: // FL FR FC LFE BL BR
+        case 7: // FL FR FC LFE BC SL SR
+        case 8: // FL FR FC LFE BL BR SL SR
+            weights[3] = 0.0f;
+            for (int ch = 4; ch < numChannels; ++ch) weights[ch] = SURROUND;
+            break;
+        default:
+            break;
+    }
+}
+
+#if LOUDNESS_SSE2
+inline __m128 loadPair(const float* p) { return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))); }
+inline void storePair(float* p, __m128 v) { _mm_store_sd(reinterpret_cast<double*>(p), _mm_castps_pd(v)); }
+#endif
+
+} // namespace
+
+void LoudnessMeter::Histogram::clear() {
+    std::fill(counts, counts + HISTOGRAM_BINS, 0u);
+    std::fill(energy, energy + HISTOGRAM_BINS, 0.0);
+    total = 0;
+}
+
+void LoudnessMeter::Histogram::add(double blockEnergy) {
+    const float lufs = toLufs(blockEnergy);
+    if (!(lufs > HISTOGRAM_MIN_LUFS)) return; // absolute gate
+    const int bin = std::min(HISTOGRAM_BINS - 1, static_cast<int>((lufs - HISTOGRAM_MIN_LUFS) / HISTOGRAM_STEP_LU));
+    ++counts[bin];
+    energy[bin] += blockEnergy;
+    ++total;
+}
+
+LoudnessMeter::LoudnessMeter() {
+    clear();
+}
+
+void LoudnessMeter::configure(int numChannels, int sampleRate) {
+    channels = numChannels;
+    rate = sampleRate;
+
+    // BS.1770 K-weighting, re-derived for any rate from the analog prototypes
+    // (coefficients as in libebur128)
+    const double fs = sampleRate;
+    double f0 = 1681.974450955533;
+    const double gainDb = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(M_PI * f0 / fs);
+    const double vh = std::pow(10.0, gainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf.b0 = static_cast<float>((vh + vb * k / q + k * k) / a0);
+    shelf.b1 = static_cast<float>(2.0 * (k * k - vh) / a0);
+    shelf.b2 = static_cast<float>((vh - vb * k / q + k * k) / a0);
+    shelf.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    shelf.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(M_PI * f0 / fs);
+    a0 = 1.0 + k / q + k * k;
+    highPass.b0 = 1.0f;
+    highPass.b1 = -2.0f;
+    highPass.b2 = 1.0f;
+    highPass.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    highPass.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+
+    std::fill(weights, weights + MAX_CHANNELS, 0.0f);
+    channelWeights(std::min(numChannels, MAX_CHANNELS), weights);
+    framesPerStep = std::max(1, sampleRate / 10);
+    clear();
+}
+
+void LoudnessMeter::clear() {
+    std::fill(shelfZ1, shelfZ1 + MAX_CHANNELS, 0.0f);
+    std::fill(shelfZ2, shelfZ2 + MAX_CHANNELS, 0.0f);
+    std::fill(highPassZ1, highPassZ1 + MAX_CHANNELS, 0.0f);
+    std::fill(highPassZ2, highPassZ2 + MAX_CHANNELS, 0.0f);
+    std::fill(stepSquares, stepSquares + MAX_CHANNELS, 0.0);
+    std::fill(stepEnergy, stepEnergy + STEPS_SHORT_TERM, 0.0);
+    stepFrames = 0;
+    steps = 0;
+    totalFrames = 0;
+    blocks.clear();
+    shortTermValues.clear();
+
+    momentary.store(NO_LOUDNESS, std::memory_order_relaxed);
+    shortTerm.store(NO_LOUDNESS, std::memory_order_relaxed);
+    integrated.store(NO_LOUDNESS, std::memory_order_relaxed);
+    range.store(0.0f, std::memory_order_relaxed);
+    seconds.store(0.0f, std::memory_order_relaxed);
+}
+
+void LoudnessMeter::addBlock(const float* buffer, int numFrames, int numChannels, int sampleRate) {
+    if (buffer == nullptr || numFrames <= 0 || numChannels <= 0 || sampleRate <= 0) return;
+    if (numChannels != channels || sampleRate != rate) configure(numChannels, sampleRate);
+    if (resetRequested.load(std::memory_order_relaxed)) {
+        resetRequested.store(false, std::memory_order_relaxed);
+        clear();
+    }
+
+    // Split at 100 ms step boundaries
+    for (int start = 0; start < numFrames;) {
+        const int frames = std::min(numFrames - start, framesPerStep - stepFrames);
+        filter(buffer + static_cast<size_t>(start) * numChannels, frames);
+        start += frames;
+        stepFrames += frames;
+        if (stepFrames == framesPerStep) finishStep();
+    }
+    totalFrames += static_cast<uint64_t>(numFrames);
+    seconds.store(static_cast<float>(static_cast<double>(totalFrames) / rate), std::memory_order_relaxed);
+}
+
+void LoudnessMeter::filter(const float* buffer, int numFrames) {
+    const Biquad s = shelf;
+    const Biquad h = highPass;
+
+    if (channels == 2) {
+#if LOUDNESS_NEON
+        const float32x2_t sb0 = vdup_n_f32(s.b0), sb1 = vdup_n_f32(s.b1), sb2 = vdup_n_f32(s.b2);
+        const float32x2_t sa1 = vdup_n_f32(s.a1), sa2 = vdup_n_f32(s.a2);
+        const float32x2_t ha1 = vdup_n_f32(h.a1), ha2 = vdup_n_f32(h.a2);
+        float32x2_t z1 = vld1_f32(shelfZ1), z2 = vld1_f32(shelfZ2);
+        float32x2_t w1 = vld1_f32(highPassZ1), w2 = vld1_f32(highPassZ2);
+        float32x2_t squares = vdup_n_f32(0.0f);
+        for (int i = 0; i < numFrames; ++i) {
+            const float32x2_t x = vld1_f32(buffer + i * 2);
+            const float32x2_t y = vmla_f32(z1, sb0, x);
+            z1 = vmls_f32(vmla_f32(z2, sb1, x), sa1, y);
+            z2 = vmls_f32(vmul_f32(sb2, x), sa2, y);
+            // RLB high-pass: b = {1, -2, 1}
+            const float32x2_t k = vadd_f32(y, w1);
+            w1 = vmls_f32(vsub_f32(w2, vadd_f32(y, y)), ha1, k);
+            w2 = vmls_f32(y, ha2, k);
+            squares = vmla_f32(squares, k, k);
+        }
+        vst1_f32(shelfZ1, z1);
+        vst1_f32(shelfZ2, z2);
+        vst1_f32(highPassZ1, w1);
+        vst1_f32(highPassZ2, w2);
+        stepSquares[0] += vget_lane_f32(squares, 0);
+        stepSquares[1] += vget_lane_f32(squares, 1);
+        return;
+#elif LOUDNESS_SSE2
+        // Lanes 0/1 carry L/R; the upper lanes stay zero
+        const __m128 sb0 = _mm_set1_ps(s.b0), sb1 = _mm_set1_ps(s.b1), sb2 = _mm_set1_ps(s.b2);
+        const __m128 sa1 = _mm_set1_ps(s.a1), sa2 = _mm_set1_ps(s.a2);
+        const __m128 ha1 = _mm_set1_ps(h.a1), ha2 = _mm_set1_ps(h.a2);
+        __m128 z1 = loadPair(shelfZ1), z2 = loadPair(shelfZ2);
+        __m128 w1 = loadPair(highPassZ1), w2 = loadPair(highPassZ2);
+        __m128 squares = _mm_setzero_ps();
+        for (int i = 0; i < numFrames; ++i) {
+            const __m128 x = loadPair(buffer + i * 2);
+            const __m128 y = _mm_add_ps(_mm_mul_ps(sb0, x), z1);
+            z1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(sb1, x), z2), _mm_mul_ps(sa1, y));
+            z2 = _mm_sub_ps(_mm_mul_ps(sb2, x), _mm_mul_ps(sa2, y));
+            // RLB high-pass: b = {1, -2, 1}
+            const __m128 k = _mm_add_ps(y, w1);
+            w1 = _mm_sub_ps(_mm_sub_ps(w2, _mm_add_ps(y, y)), _mm_mul_ps(ha1, k));
+            w2 = _mm_sub_ps(y, _mm_mul_ps(ha2, k));
+            squares = _mm_add_ps(squares, _mm_mul_ps(k, k));
+        }
+        storePair(shelfZ1, z1);
+        storePair(shelfZ2, z2);
+        storePair(highPassZ1, w1);
+        storePair(highPassZ2, w2);
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, squares);
+        stepSquares[0] += lanes[0];
+        stepSquares[1] += lanes[1];
+        return;
+#endif
+    }
+
+    const int measured = std::min(channels, MAX_CHANNELS);
+    for (int ch = 0; ch < measured; ++ch) {
+        if (weights[ch] == 0.0f) continue;
+        float z1 = shelfZ1[ch], z2 = shelfZ2[ch], w1 = highPassZ1[ch], w2 = highPassZ2[ch];
+        float squares = 0.0f;
+        for (int i = 0; i < numFrames; ++i) {
+            const float x = buffer[i * channels + ch];
+            const float y = s.b0 * x + z1;
+            z1 = s.b1 * x - s.a1 * y + z2;
+            z2 = s.b2 * x - s.a2 * y;
+            const float k = y + w1;
+            w1 = -2.0f * y - h.a1 * k + w2;
+            w2 = y - h.a2 * k;
+            squares += k * k;
+        }
+        shelfZ1[ch] = z1; shelfZ2[ch] = z2; highPassZ1[ch] = w1; highPassZ2[ch] = w2;
+        stepSquares[ch] += squares;
+    }
+}
+
+void LoudnessMeter::finishStep() {
+    double energy = 0.0;
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+        energy += weights[ch] * stepSquares[ch];
+        stepSquares[ch] = 0.0;
+    }
+    stepEnergy[steps % STEPS_SHORT_TERM] = energy / framesPerStep;
+    ++steps;
+    stepFrames = 0;
+
+    if (steps >= STEPS_MOMENTARY) {
+        const double block = recentEnergy(STEPS_MOMENTARY);
+        momentary.store(toLufs(block), std::memory_order_relaxed);
+        blocks.add(block);
+        integrated.store(integratedLoudness(blocks), std::memory_order_relaxed);
+    }
+    if (steps >= STEPS_SHORT_TERM) {
+        const double window = recentEnergy(STEPS_SHORT_TERM);
+        shortTerm.store(toLufs(window), std::memory_order_relaxed);
+        // Tech 3342 short-term values overlap by two thirds
+        if ((steps - STEPS_SHORT_TERM) % STEPS_PER_RANGE_VALUE == 0) {
+            shortTermValues.add(window);
+            range.store(loudnessRange(shortTermValues), std::memory_order_relaxed);
+        }
+    }
+}
+
+double LoudnessMeter::recentEnergy(int count) const {
+    double sum = 0.0;
+    for (int i = 1; i <= count; ++i) sum += stepEnergy[(steps - i) % STEPS_SHORT_TERM];
+    return sum / count;
+}
+
+float LoudnessMeter::integratedLoudness(const Histogram& h) {
+    if (h.total == 0) return NO_LOUDNESS;
+    double sum = 0.0;
+    for (int bin = 0; bin < HISTOGRAM_BINS; ++bin) sum += h.energy[bin];
+    const float threshold = toLufs(sum / static_cast<double>(h.total)) - 10.0f;
+
+    // A bin counts as above the relative gate when its centre is
+    const int first = std::max(0, static_cast<int>(std::ceil((threshold - HISTOGRAM_MIN_LUFS) / HISTOGRAM_STEP_LU - 0.5f)));
+    double gated = 0.0;
+    uint64_t count = 0;
+    for (int bin = first; bin < HISTOGRAM_BINS; ++bin) {
+        gated += h.energy[bin];
+        count += h.counts[bin];
+    }
+    return count > 0 ? toLufs(gated / static_cast<double>(count)) : NO_LOUDNESS;
+}
+
+float LoudnessMeter::loudnessRange(const Histogram& h) {
+    if (h.total == 0) return 0.0f;
+    double sum = 0.0;
+    for (int bin = 0; bin < HISTOGRAM_BINS; ++bin) sum += h.energy[bin];
+    const float threshold = toLufs(sum / static_cast<double>(h.total)) - 20.0f;
+
+    const int first = std::max(0, static_cast<int>(std::ceil((threshold - HISTOGRAM_MIN_LUFS) / HISTOGRAM_STEP_LU - 0.5f)));
+    uint64_t count = 0;
+    for (int bin = first; bin < HISTOGRAM_BINS; ++bin) count += h.counts[bin];
+    if (count == 0) return 0.0f;
+
+    // Bin centres at the 10th and 95th percentiles of the gated values
+    const uint64_t lowRank = static_cast<uint64_t>(0.10 * static_cast<double>(count - 1));
+    const uint64_t highRank = static_cast<uint64_t>(0.95 * static_cast<double>(count - 1));
+    float low = 0.0f, high = 0.0f;
+    uint64_t seen = 0;
+    bool haveLow = false;
+    for (int bin = first; bin < HISTOGRAM_BINS; ++bin) {
+        if (h.counts[bin] == 0) continue;
+        seen += h.counts[bin];
+        const float centre = HISTOGRAM_MIN_LUFS + (bin + 0.5f) * HISTOGRAM_STEP_LU;
+        if (!haveLow && seen > lowRank) {
+            low = centre;
+            haveLow = true;
+        }
+        if (seen > highRank) {
+            high = centre;
+            break;
+        }
+    }
+    return high - low;
+}
+
+LoudnessStats LoudnessMeter::latest() const {
+    return {momentary.load(std::memory_order_relaxed), shortTerm.load(std::memory_order_relaxed),
+            integrated.load(std::memory_order_relaxed), range.load(std::memory_order_relaxed),
+            seconds.load(std::memory_order_relaxed)};
+}
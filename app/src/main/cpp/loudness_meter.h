@@ -0,0 +1,105 @@
+#ifndef LOUDNESS_METER_H
+#define LOUDNESS_METER_H
+
+#include <atomic>
+#include <cstdint>
+
+struct LoudnessStats {
+    float momentaryLufs;   // 400 ms window
+    float shortTermLufs;   // 3 s window
+    float integratedLufs;  // gated, since the last reset
+    float loudnessRangeLu; // EBU Tech 3342 LRA, since the last reset
+    float measuredSeconds; // audio seen since the last reset
+};
+
+/**
+ * ITU-R BS.1770-4 / EBU R128 loudness, measured incrementally.
+ *
+ * Input is K-weighted (high-shelf pre-filter and RLB high-pass, stereo
+ * filtered as one 2-lane vector) and its mean square collected per 100 ms
+ * step. Momentary and short-term loudness are the last 4 and 30 steps.
+ * Integrated loudness gates 400 ms blocks at -70 LUFS and then 10 LU below
+ * the absolute-gated mean; loudness range takes the 10th to 95th percentile
+ * of short-term values (one per second) gated at -70 LUFS and 20 LU below
+ * their mean. Both keep block loudness in 0.1 LU histograms, so memory and
+ * per-step cost stay constant however long the programme runs, at the price
+ * of resolving the relative gates to 0.1 LU.
+ *
+ * Channel weights follow BS.1770 for the Android channel orders (LFE
+ * excluded, surrounds +1.5 dB); channels past MAX_CHANNELS are ignored.
+ * Loudness reads -infinity until enough audio has been measured.
+ *
+ * addBlock() belongs to one render thread; latest() and requestReset() may
+ * be called from any thread without blocking it. A change of channel count
+ * or sample rate starts a new measurement.
+ */
+class LoudnessMeter {
+public:
+    static constexpr int MAX_CHANNELS = 8;
+
+    LoudnessMeter();
+
+    // Render thread
+    void addBlock(const float* buffer, int numFrames, int numChannels, int sampleRate);
+
+    // Any thread
+    LoudnessStats latest() const;
+    void requestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+private:
+    static constexpr int STEPS_MOMENTARY = 4;
+    static constexpr int STEPS_SHORT_TERM = 30;
+    static constexpr int STEPS_PER_RANGE_VALUE = 10;
+    static constexpr float HISTOGRAM_MIN_LUFS = -70.0f;
+    static constexpr float HISTOGRAM_STEP_LU = 0.1f;
+    static constexpr int HISTOGRAM_BINS = 750; // up to +5 LUFS; louder blocks land in the top bin
+
+    struct Histogram {
+        uint32_t counts[HISTOGRAM_BINS];
+        double energy[HISTOGRAM_BINS]; // sum of block mean squares per bin
+        uint64_t total;
+
+        void clear();
+        void add(double blockEnergy);
+    };
+
+    struct Biquad {
+        float b0, b1, b2, a1, a2;
+    };
+
+    std::atomic<float> momentary;
+    std::atomic<float> shortTerm;
+    std::atomic<float> integrated;
+    std::atomic<float> range;
+    std::atomic<float> seconds{0.0f};
+    std::atomic<bool> resetRequested{false};
+
+    // Render thread only
+    int channels = 0;
+    int rate = 0;
+    Biquad shelf{};
+    Biquad highPass{};
+    float weights[MAX_CHANNELS] = {};
+    alignas(16) float shelfZ1[MAX_CHANNELS];
+    alignas(16) float shelfZ2[MAX_CHANNELS];
+    alignas(16) float highPassZ1[MAX_CHANNELS];
+    alignas(16) float highPassZ2[MAX_CHANNELS];
+    double stepSquares[MAX_CHANNELS];
+    int framesPerStep = 0;
+    int stepFrames = 0;
+    double stepEnergy[STEPS_SHORT_TERM]; // ring of weighted 100 ms mean squares
+    uint64_t steps = 0;
+    uint64_t totalFrames = 0;
+    Histogram blocks;
+    Histogram shortTermValues;
+
+    void configure(int numChannels, int sampleRate);
+    void clear();
+    void filter(const float* buffer, int numFrames);
+    void finishStep();
+    double recentEnergy(int count) const;
+    static float integratedLoudness(const Histogram& h);
+    static float loudnessRange(const Histogram& h);
+};
+
+#endif // LOUDNESS_METER_H
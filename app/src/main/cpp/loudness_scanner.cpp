@@ -0,0 +1,70 @@
+#include "loudness_scanner.h"
+#include "audio_file.h"
+#include "loudness_meter.h"
+#include "mapped_file.h"
+#include "oversampler.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+constexpr int SCAN_BLOCK_FRAMES = 1024;
+
+// Per-file state, on the heap: the meter's histograms and the oversampler's
+// per-channel filters are too large for a worker's stack
+struct ScanState {
+    LoudnessMeter meter;
+    Oversampler truePeak;
+    float block[SCAN_BLOCK_FRAMES * Oversampler::MAX_CHANNELS];
+    float framePeaks[Oversampler::BLOCK_FRAMES];
+};
+
+} // namespace
+
+namespace loudness_scan {
+
+bool measureFile(const char* path, TrackLoudness& result) {
+    MappedFile file(path);
+    PcmReader reader;
+    if (!file.isOpen() || !reader.open(file.data(), file.size())) return false;
+    const int channels = reader.channels();
+    const int sampleRate = reader.sampleRate();
+    if (channels > Oversampler::MAX_CHANNELS || reader.frames() == 0) return false;
+
+    auto state = std::make_unique<ScanState>();
+    state->truePeak.setSampleRate(sampleRate);
+    float peak = 0.0f;
+
+    for (;;) {
+        const int frames = reader.read(state->block, SCAN_BLOCK_FRAMES);
+        if (frames <= 0) break;
+        state->meter.addBlock(state->block, frames, channels, sampleRate);
+        for (int sub = 0; sub < frames; sub += Oversampler::BLOCK_FRAMES) {
+            const int n = std::min(Oversampler::BLOCK_FRAMES, frames - sub);
+            state->truePeak.framePeaks(state->block + sub * channels, n, channels, state->framePeaks);
+            for (int i = 0; i < n; ++i) peak = std::max(peak, state->framePeaks[i]);
+        }
+        if (frames < SCAN_BLOCK_FRAMES) break;
+    }
+
+    const LoudnessStats stats = state->meter.latest();
+    if (!std::isfinite(stats.integratedLufs)) return false;
+    result.integratedLufs = stats.integratedLufs;
+    result.loudnessRangeLu = stats.loudnessRangeLu;
+    result.truePeak = peak;
+    result.gainDb = REPLAY_GAIN_REFERENCE_LUFS - stats.integratedLufs;
+    return true;
+}
+
+void measureFiles(const std::vector<std::string>& paths, int threads,
+                  std::vector<TrackLoudness>& results, std::vector<uint8_t>& measured) {
+    results.assign(paths.size(), TrackLoudness{});
+    measured.assign(paths.size(), 0);
+    parallelFor(paths.size(), threads, [&](size_t i) {
+        measured[i] = measureFile(paths[i].c_str(), results[i]) ? 1 : 0;
+    });
+}
+
+} // namespace loudness_scan
@@ -0,0 +1,38 @@
+#ifndef LOUDNESS_SCANNER_H
+#define LOUDNESS_SCANNER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TrackLoudness {
+    float integratedLufs;  // EBU R128 integrated loudness
+    float loudnessRangeLu; // EBU Tech 3342
+    float truePeak;        // linear, 4x oversampled below 96 kHz
+    float gainDb;          // ReplayGain 2.0 track gain (to -18 LUFS)
+};
+
+/**
+ * Offline loudness measurement of whole files, for normalizing tracks
+ * before their first play.
+ *
+ * Files are memory-mapped and decoded block by block straight from the
+ * mapping (see audio_file.h for the supported containers), so a scan
+ * allocates only per-file scratch.
+ */
+namespace loudness_scan {
+
+constexpr float REPLAY_GAIN_REFERENCE_LUFS = -18.0f;
+
+// False if the file cannot be read, is not a supported format or holds no
+// gated audio (e.g. silence).
+bool measureFile(const char* path, TrackLoudness& result);
+
+// Measures every path on a worker pool (threads <= 0: one per core).
+// measured[i] tells whether results[i] is valid.
+void measureFiles(const std::vector<std::string>& paths, int threads,
+                  std::vector<TrackLoudness>& results, std::vector<uint8_t>& measured);
+
+} // namespace loudness_scan
+
+#endif // LOUDNESS_SCANNER_H
@@ -0,0 +1,75 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Read-only memory map of a whole file, unmapped on destruction. The page
+ * cache does the I/O, so sequential scans need no read buffers of their own.
+ * isOpen() is false if the file is missing, empty or cannot be mapped.
+ *
+ * 'advice' is passed to madvise: the default MADV_SEQUENTIAL reads ahead and
+ * drops pages behind, which suits a front-to-back scan; files probed by
+ * lookup should ask for MADV_RANDOM.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const char* path, int advice = MADV_SEQUENTIAL) {
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                base = static_cast<const uint8_t*>(addr);
+                length = static_cast<size_t>(st.st_size);
+                modifiedTime = static_cast<int64_t>(st.st_mtime);
+                madvise(addr, length, advice);
+            }
+        }
+        close(fd); // the mapping keeps its own reference
+    }
+
+    ~MappedFile() {
+        if (base != nullptr) munmap(const_cast<uint8_t*>(base), length);
+    }
+
+    MappedFile(MappedFile&& other) noexcept : base(other.base), length(other.length), modifiedTime(other.modifiedTime) {
+        other.base = nullptr;
+        other.length = 0;
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            if (base != nullptr) munmap(const_cast<uint8_t*>(base), length);
+            base = other.base;
+            length = other.length;
+            modifiedTime = other.modifiedTime;
+            other.base = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return base != nullptr; }
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    int64_t mtime() const { return modifiedTime; } // seconds since the epoch
+
+private:
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    int64_t modifiedTime = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,78 @@
+#ifndef PARAM_SNAPSHOT_H
+#define PARAM_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+/**
+ * Wait-free parameter publication between control threads (UI / JNI setters)
+ * and the audio render thread.
+ *
+ * Implemented as a triple buffer: writers fill a private back slot and swap it
+ * into the shared middle slot; the render thread swaps the middle slot into
+ * its private front slot only when a new snapshot has been published. Neither
+ * side ever blocks the other and nothing is allocated after construction.
+ *
+ * Writers are serialized among themselves with a mutex that the render thread
+ * never touches, so concurrent setters (e.g. a slider drag racing
+ * AIAudioProcessor::applyState) stay consistent.
+ */
+template <typename T>
+class ParamSnapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots must be trivially copyable");
+
+public:
+    explicit ParamSnapshot(const T& initial = T()) : latest(initial), middle(1), frontIndex(0), backIndex(2) {
+        for (auto& slot : slots) slot = initial;
+    }
+
+    // Control thread: read-modify-write the latest parameters and publish them.
+    template <typename Fn>
+    void update(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        fn(latest);
+        slots[backIndex] = latest;
+        backIndex = middle.exchange(backIndex | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Control thread: copy of the most recently written parameters.
+    T read() const {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        return latest;
+    }
+
+    // Render thread only: wait-free view of the newest published snapshot.
+    // The reference stays valid until the next call to acquire().
+    const T& acquire() {
+        if (middle.load(std::memory_order_relaxed) & DIRTY) {
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+        return slots[frontIndex];
+    }
+
+private:
+    static constexpr uint32_t DIRTY = 0x4;
+    static constexpr uint32_t INDEX_MASK = 0x3;
+
+    mutable std::mutex writerMutex;
+    T latest;
+    T slots[3];
+    std::atomic<uint32_t> middle;
+    uint32_t frontIndex; // owned by the render thread
+    uint32_t backIndex;  // owned by writers (under writerMutex)
+};
+
+/**
+ * Bumped by every setter that can change which stages are active or how they
+ * fuse. Render threads recompile their DSP graph when it moves; a spurious
+ * bump only costs one recompile.
+ */
+inline std::atomic<uint32_t> g_dspConfigVersion{1};
+
+inline void notifyDspConfigChanged() {
+    g_dspConfigVersion.fetch_add(1, std::memory_order_release);
+}
+
+#endif // PARAM_SNAPSHOT_H
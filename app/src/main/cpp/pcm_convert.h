@@ -0,0 +1,235 @@
+#ifndef PCM_CONVERT_H
+#define PCM_CONVERT_H
+
+#include <cstdint>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_CONVERT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PCM_CONVERT_SSE2 1
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define PCM_CONVERT_SSSE3 1
+#endif
+#endif
+
+/**
+ * Interleaved integer PCM <-> float conversion kernels for the render path.
+ *
+ * Input is normalized to [-1, 1); output is clamped to [-1, 1] and rounded to
+ * the nearest integer code. All functions take a sample count (frames *
+ * channels) and work on unaligned little-endian buffers, which is what Media3
+ * hands to SpatialAudioProcessor. 24-bit PCM is packed (3 bytes per sample).
+ */
+namespace pcm {
+
+static constexpr float S16_IN_SCALE = 1.0f / 32768.0f;
+static constexpr float S16_OUT_SCALE = 32767.0f;
+static constexpr float S24_IN_SCALE = 1.0f / 8388608.0f;
+static constexpr float S24_OUT_SCALE = 8388607.0f;
+static constexpr float S32_IN_SCALE = 1.0f / 2147483648.0f;
+// Largest float below 2^31: 2147483647.0f rounds up to 2^31 and would overflow.
+static constexpr float S32_OUT_MAX = 2147483520.0f;
+
+static inline float clampUnit(float x) {
+    return x < -1.0f ? -1.0f : (x > 1.0f ? 1.0f : x);
+}
+
+static inline int32_t readS24(const uint8_t* p) {
+    return static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) |
+                                (static_cast<uint32_t>(p[1]) << 16) |
+                                (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+}
+
+static inline void writeS24(uint8_t* p, int32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+}
+
+#if PCM_CONVERT_NEON
+static inline int32x4_t roundToInt(float32x4_t v) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    // ARMv7 only has truncating conversion: bias by +/-0.5 first
+    uint32x4_t negative = vcltq_f32(v, vdupq_n_f32(0.0f));
+    float32x4_t bias = vbslq_f32(negative, vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(v, bias));
+#endif
+}
+#endif
+
+// ---- int16 ----
+
+static inline void s16ToFloat(const int16_t* in, float* out, int n) {
+    int i = 0;
+#if PCM_CONVERT_NEON
+    const float32x4_t scale = vdupq_n_f32(S16_IN_SCALE);
+    for (; i + 7 < n; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#elif PCM_CONVERT_SSE2
+    const __m128 scale = _mm_set1_ps(S16_IN_SCALE);
+    for (; i + 7 < n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by unpacking into the high half and shifting back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; i < n; ++i) out[i] = static_cast<float>(in[i]) * S16_IN_SCALE;
+}
+
+static inline void floatToS16(const float* in, int16_t* out, int n) {
+    int i = 0;
+#if PCM_CONVERT_NEON
+    const float32x4_t scale = vdupq_n_f32(S16_OUT_SCALE);
+    const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+    for (; i + 7 < n; i += 8) {
+        float32x4_t a = vminq_f32(vmaxq_f32(vld1q_f32(in + i), lo), hi);
+        float32x4_t b = vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), lo), hi);
+        int16x4_t ia = vqmovn_s32(roundToInt(vmulq_f32(a, scale)));
+        int16x4_t ib = vqmovn_s32(roundToInt(vmulq_f32(b, scale)));
+        vst1q_s16(out + i, vcombine_s16(ia, ib));
+    }
+#elif PCM_CONVERT_SSE2
+    const __m128 scale = _mm_set1_ps(S16_OUT_SCALE);
+    const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+    for (; i + 7 < n; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)),
+                                         _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+#endif
+    for (; i < n; ++i) out[i] = static_cast<int16_t>(lrintf(clampUnit(in[i]) * S16_OUT_SCALE));
+}
+
+// ---- packed int24 ----
+
+static inline void s24ToFloat(const uint8_t* in, float* out, int n) {
+    int i = 0;
+#if PCM_CONVERT_NEON
+    const float32x4_t scale = vdupq_n_f32(S24_IN_SCALE);
+    for (; i + 15 < n; i += 16) {
+        uint8x16x3_t b = vld3q_u8(in + i * 3);
+        // Low 16 bits are unsigned byte pairs, high 16 bits come from the signed top byte
+        uint16x8_t low0 = vorrq_u16(vmovl_u8(vget_low_u8(b.val[0])), vshlq_n_u16(vmovl_u8(vget_low_u8(b.val[1])), 8));
+        uint16x8_t low1 = vorrq_u16(vmovl_u8(vget_high_u8(b.val[0])), vshlq_n_u16(vmovl_u8(vget_high_u8(b.val[1])), 8));
+        int16x8_t high0 = vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(b.val[2])));
+        int16x8_t high1 = vmovl_s8(vget_high_s8(vreinterpretq_s8_u8(b.val[2])));
+        int32x4_t s[4] = {
+            vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(high0)), 16), vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low0)))),
+            vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(high0)), 16), vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low0)))),
+            vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(high1)), 16), vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low1)))),
+            vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(high1)), 16), vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low1)))),
+        };
+        for (int k = 0; k < 4; ++k) vst1q_f32(out + i + k * 4, vmulq_f32(vcvtq_f32_s32(s[k]), scale));
+    }
+#elif PCM_CONVERT_SSSE3
+    const __m128 scale = _mm_set1_ps(S24_IN_SCALE);
+    // Place the 3 bytes of each sample in the top of a 32-bit lane, then shift down arithmetically
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    // Each 16-byte load consumes 12 bytes; stop early so the load never runs past the buffer
+    for (; i + 5 < n; i += 4) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 3));
+        __m128i v = _mm_srai_epi32(_mm_shuffle_epi8(raw, shuffle), 8);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+    for (; i < n; ++i) out[i] = static_cast<float>(readS24(in + i * 3)) * S24_IN_SCALE;
+}
+
+static inline void floatToS24(const float* in, uint8_t* out, int n) {
+    int i = 0;
+#if PCM_CONVERT_NEON
+    const float32x4_t scale = vdupq_n_f32(S24_OUT_SCALE);
+    const float32x4_t lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+    for (; i + 15 < n; i += 16) {
+        int32x4_t s[4];
+        for (int k = 0; k < 4; ++k) {
+            float32x4_t v = vminq_f32(vmaxq_f32(vld1q_f32(in + i + k * 4), lo), hi);
+            s[k] = roundToInt(vmulq_f32(v, scale));
+        }
+        uint8x16x3_t b;
+        for (int byte = 0; byte < 3; ++byte) {
+            const int32x4_t shift = vdupq_n_s32(-8 * byte);
+            uint16x8_t h0 = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(s[0], shift))),
+                                         vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(s[1], shift))));
+            uint16x8_t h1 = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(s[2], shift))),
+                                         vmovn_u32(vreinterpretq_u32_s32(vshlq_s32(s[3], shift))));
+            b.val[byte] = vcombine_u8(vmovn_u16(h0), vmovn_u16(h1));
+        }
+        vst3q_u8(out + i * 3, b);
+    }
+#elif PCM_CONVERT_SSSE3
+    const __m128 scale = _mm_set1_ps(S24_OUT_SCALE);
+    const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+    // Drop the top byte of each 32-bit lane and pack the remaining 12 bytes
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for (; i + 3 < n; i += 4) {
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+        __m128i packed = _mm_shuffle_epi8(_mm_cvtps_epi32(_mm_mul_ps(v, scale)), shuffle);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * 3), packed);
+        int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        __builtin_memcpy(out + i * 3 + 8, &tail, 4);
+    }
+#endif
+    for (; i < n; ++i) writeS24(out + i * 3, static_cast<int32_t>(lrintf(clampUnit(in[i]) * S24_OUT_SCALE)));
+}
+
+// ---- int32 ----
+
+static inline void s32ToFloat(const int32_t* in, float* out, int n) {
+    int i = 0;
+#if PCM_CONVERT_NEON
+    const float32x4_t scale = vdupq_n_f32(S32_IN_SCALE);
+    for (; i + 3 < n; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(in + i)), scale));
+    }
+#elif PCM_CONVERT_SSE2
+    const __m128 scale = _mm_set1_ps(S32_IN_SCALE);
+    for (; i + 3 < n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+    for (; i < n; ++i) out[i] = static_cast<float>(in[i]) * S32_IN_SCALE;
+}
+
+static inline void floatToS32(const float* in, int32_t* out, int n) {
+    int i = 0;
+#if PCM_CONVERT_NEON
+    const float32x4_t scale = vdupq_n_f32(2147483648.0f);
+    const float32x4_t lo = vdupq_n_f32(-2147483648.0f), hi = vdupq_n_f32(S32_OUT_MAX);
+    for (; i + 3 < n; i += 4) {
+        float32x4_t v = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(in + i), scale), lo), hi);
+        vst1q_s32(out + i, roundToInt(v));
+    }
+#elif PCM_CONVERT_SSE2
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    const __m128 lo = _mm_set1_ps(-2147483648.0f), hi = _mm_set1_ps(S32_OUT_MAX);
+    for (; i + 3 < n; i += 4) {
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), lo), hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(v));
+    }
+#endif
+    for (; i < n; ++i) {
+        float v = in[i] * 2147483648.0f;
+        v = v < -2147483648.0f ? -2147483648.0f : (v > S32_OUT_MAX ? S32_OUT_MAX : v);
+        out[i] = static_cast<int32_t>(lrintf(v));
+    }
+}
+
+} // namespace pcm
+
+#endif // PCM_CONVERT_H
@@ -1,108 +1,125 @@
 #ifndef PITCH_SHIFTER_H
 #define PITCH_SHIFTER_H
 
-#include <vector>
-#include <cmath>
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <mutex>
+#include "param_snapshot.h"
+#include "time_stretcher.h"
 
 /**
- * High-quality Pitch Shifter using dual delay-line technique with crossfading.
- * This provides much smoother results than simple resampling for pitch adjustment.
+ * In-place pitch stage of the effect chain: a TimeStretcher at tempo 1.
+ *
+ * The chain needs exactly as many frames out as in, so the stage runs at a
+ * fixed latency. After every reset it first emits latencyFrames() of silence,
+ * which leaves enough output buffered that later callbacks never run dry
+ * whatever their size. Works at the stream's own sample rate and any channel
+ * count up to MAX_CHANNELS.
+ *
+ * Tempo changes need a variable-length stream and live in the Media3 time
+ * stretch processor instead.
  */
 class PitchShifter {
 public:
-    PitchShifter() : enabled(false), pitchRatio(1.0f), sampleRate(44100) {
-        delayBuffer.resize(8192 * 2, 0.0f); // Large enough for low pitch
-        reset();
+    static constexpr int MAX_CHANNELS = 8;
+    static constexpr int MAX_SAMPLE_RATE = 192000;
+
+    PitchShifter() : enabled(false), resetPending(false), stretcher(nullptr) {}
+    ~PitchShifter() { delete stretcher.load(std::memory_order_acquire); }
+
+    PitchShifter(const PitchShifter&) = delete;
+    PitchShifter& operator=(const PitchShifter&) = delete;
+
+    // Control thread. The stretcher (a few MB at the maximum format) is only
+    // allocated the first time a pitch other than 1 is requested.
+    void setParams(float pitch) {
+        const float ratio = std::max(TimeStretcher::MIN_PITCH, std::min(TimeStretcher::MAX_PITCH, pitch));
+        const bool active = std::abs(ratio - 1.0f) > 0.01f;
+        {
+            std::lock_guard<std::mutex> lock(createMutex);
+            TimeStretcher* s = stretcher.load(std::memory_order_acquire);
+            if (s == nullptr && active) {
+                s = new TimeStretcher(MAX_CHANNELS, MAX_SAMPLE_RATE);
+                s->setParams(1.0f, ratio, TimeStretcher::Mode::Music);
+                stretcher.store(s, std::memory_order_release);
+            } else if (s != nullptr) {
+                s->setParams(1.0f, ratio, TimeStretcher::Mode::Music);
+            }
+        }
+        // Coming back from bypass must not replay stale buffered audio
+        if (active && !enabled.load(std::memory_order_acquire)) reset();
+        enabled.store(active, std::memory_order_release);
+        notifyDspConfigChanged();
     }
 
-    void setParams(float pitch, int sr) {
-        std::lock_guard<std::mutex> lock(mtx);
-        this->pitchRatio = std::max(0.1f, std::min(5.0f, pitch));
-        if (sr > 0) this->sampleRate = sr;
-        enabled = (std::abs(pitchRatio - 1.0f) > 0.01f);
+    bool isActive(int numChannels) {
+        return numChannels > 0 && numChannels <= MAX_CHANNELS && enabled.load(std::memory_order_acquire) &&
+               stretcher.load(std::memory_order_acquire) != nullptr;
     }
 
-    void process(float* buffer, int numFrames, int numChannels) {
-        if (!enabled.load(std::memory_order_acquire)) return;
-        if (numChannels <= 0 || numChannels > 2) return; // Simplified for Mono/Stereo
-
-        std::lock_guard<std::mutex> lock(mtx);
-
-        if (numChannels != currentNumChannels) {
-            currentNumChannels = numChannels;
-            reset(); // writeIndex = 0, clears buffer
+    void process(float* buffer, int numFrames, int numChannels, int sampleRate) {
+        TimeStretcher* s = stretcher.load(std::memory_order_acquire);
+        if (s == nullptr || !enabled.load(std::memory_order_acquire)) return;
+        if (numChannels <= 0 || numChannels > MAX_CHANNELS) return;
+
+        // Both touch only numChannels x one frame of the stretcher's buffers and
+        // use precomputed windows, so re-engaging costs microseconds, not a sweep
+        // of the few MB sized for MAX_CHANNELS at MAX_SAMPLE_RATE
+        const bool formatChanged = numChannels != s->channels() || sampleRate != s->sampleRate();
+        if (resetPending.exchange(false, std::memory_order_acq_rel) || formatChanged || !primed) {
+            if (formatChanged) {
+                if (!s->setFormat(numChannels, sampleRate)) return; // rate out of range: bypass
+            } else {
+                s->clear();
+            }
+            primeRemaining = s->latencyFrames();
+            primed = true;
         }
 
-        float rate = 1.0f - pitchRatio;
-        int bufferSize = delayBuffer.size() / numChannels;
-
-        for (int i = 0; i < numFrames; ++i) {
-            for (int ch = 0; ch < numChannels; ++ch) {
-                float input = buffer[i * numChannels + ch];
-                
-                // Write to delay line
-                delayBuffer[writeIndex * numChannels + ch] = input;
-
-                // Dual delay line pitch shifting
-                float offset1 = pos1;
-                float offset2 = pos2;
-
-                // Triangular crossfade window
-                float crossfade = std::abs(pos1 - (MAX_DELAY / 2.0f)) / (MAX_DELAY / 2.0f);
-                
-                float out1 = readDelay(ch, offset1, numChannels);
-                float out2 = readDelay(ch, offset2, numChannels);
-
-                buffer[i * numChannels + ch] = out1 * (1.0f - crossfade) + out2 * crossfade;
+        // Output overwrites only frames whose input has already been taken
+        int consumed = 0;
+        int written = 0;
+        while (written < numFrames) {
+            int progress = 0;
+            if (consumed < numFrames) {
+                const int n = s->put(buffer + consumed * numChannels, numFrames - consumed);
+                consumed += n;
+                progress += n;
             }
-
-            // Update delay positions
-            pos1 += rate;
-            while (pos1 >= MAX_DELAY) pos1 -= MAX_DELAY;
-            while (pos1 < 0) pos1 += MAX_DELAY;
-
-            pos2 = pos1 + (MAX_DELAY / 2.0f);
-            while (pos2 >= MAX_DELAY) pos2 -= MAX_DELAY;
-            
-            writeIndex = (writeIndex + 1) % bufferSize;
+            const int room = consumed - written;
+            if (room > 0 && primeRemaining > 0) {
+                const int n = std::min(room, primeRemaining);
+                std::fill(buffer + written * numChannels, buffer + (written + n) * numChannels, 0.0f);
+                primeRemaining -= n;
+                written += n;
+                continue;
+            }
+            if (room > 0) {
+                const int n = s->receive(buffer + written * numChannels, room);
+                written += n;
+                progress += n;
+            }
+            if (progress == 0) break;
+        }
+        // Underrun (e.g. right after a pitch change): pad rather than glitch the whole chain
+        if (written < numFrames) {
+            std::fill(buffer + written * numChannels, buffer + numFrames * numChannels, 0.0f);
         }
     }
 
-    void reset() {
-        std::fill(delayBuffer.begin(), delayBuffer.end(), 0.0f);
-        writeIndex = 0;
-        pos1 = 0;
-        pos2 = MAX_DELAY / 2.0f;
-    }
+    // Control thread: the stream is cleared by the render thread on its next callback.
+    void reset() { resetPending.store(true, std::memory_order_release); }
 
 private:
-    std::mutex mtx;
     std::atomic<bool> enabled;
-    float pitchRatio;
-    int sampleRate;
-    int currentNumChannels = 2;
-    
-    std::vector<float> delayBuffer;
-    int writeIndex = 0;
-    float pos1 = 0, pos2 = 0;
-    const float MAX_DELAY = 4096.0f;
+    std::atomic<bool> resetPending;
+    std::mutex createMutex;
+    std::atomic<TimeStretcher*> stretcher; // created once, owned until destruction
 
-    float readDelay(int channel, float offset, int numChannels) {
-        int bufferSize = delayBuffer.size() / numChannels;
-        float readIdx = (float)writeIndex - offset;
-        while (readIdx < 0) readIdx += (float)bufferSize;
-        
-        int i1 = (int)readIdx % bufferSize;
-        int i2 = (i1 + 1) % bufferSize;
-        float frac = readIdx - (float)((int)readIdx);
-
-        float v1 = delayBuffer[i1 * numChannels + channel];
-        float v2 = delayBuffer[i2 * numChannels + channel];
-        return v1 + frac * (v2 - v1);
-    }
+    // Render-thread state
+    int primeRemaining = 0;
+    bool primed = false;
 };
 
 #endif // PITCH_SHIFTER_H
@@ -0,0 +1,621 @@
+#include "recommendation_kernels.h"
+#include "worker_pool.h"
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RECO_KERNELS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RECO_KERNELS_SSE2 1
+#endif
+
+// AVX2/FMA and AVX-512 kernels are compiled with target attributes and only
+// called when the CPU reports them, so the baseline build flags stay as they are
+#if defined(RECO_KERNELS_SSE2) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RECO_KERNELS_AVX 1
+#endif
+
+// Same for SVE; its intrinsics need clang 17+ (NDK r26+) outside -march=+sve
+#if defined(__aarch64__) && defined(__linux__) && defined(__clang__) && __clang_major__ >= 17
+#include <arm_sve.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1 << 22)
+#endif
+#define RECO_KERNELS_SVE 1
+#endif
+
+namespace {
+
+/*
+ * Score terms. Features are in SoA (column-major) layout:
+ *   feature[featureIndex * N + candidateIndex]
+ *
+ *   Feature indices:
+ *     0  = artistAffinity      (0.0–1.0)
+ *     1  = freshnessFlag       (0.0 or 1.0)
+ *     2  = skipFlag             (0.0 or 1.0)
+ *     3  = likedSongFlag        (0.0 or 1.0)
+ *     4  = likedArtistFlag      (0.0 or 1.0)
+ *     5  = timeOfDayWeight      (0.0–1.0)
+ *     6  = varietyPenalty        (0.0–N, count above 2)
+ *     7  = genreSimilarity      (0.0–1.0, cosine sim)
+ *     8  = recentGenreSimilarity(0.0–1.0, cosine sim)
+ *     9  = skipGenrePenalty     (0.0–1.0, cosine sim)
+ *     10 = (reserved)          (0.0)
+ *
+ * weights[0] is the base score and weights[j + 1] the weight of feature j.
+ * The score adds the positive signals, then subtracts the penalties (2, 6
+ * and 9), and is clamped to [0, 1].
+ */
+constexpr int SCORED_FEATURES = 10;
+constexpr int SCORE_ORDER[SCORED_FEATURES] = {0, 1, 3, 4, 5, 7, 8, 2, 6, 9};
+constexpr int FIRST_PENALTY = 7;
+
+/**
+ * One call's worth of scoring input: candidate i scores
+ * clamp01(base + sum over k of column[k][i] * weight[k]), penalties carrying
+ * negated weights. Every kernel sums the terms in this order.
+ */
+struct ScoreTerms {
+    float base;
+    const float* column[SCORED_FEATURES];
+    float weight[SCORED_FEATURES];
+
+    // Candidates from 'first' of a table whose columns are 'stride' long
+    ScoreTerms(const float* features, int stride, int first, const float* weights) : base(weights[0]) {
+        for (int k = 0; k < SCORED_FEATURES; k++) {
+            const int feature = SCORE_ORDER[k];
+            column[k] = features + static_cast<size_t>(feature) * stride + first;
+            weight[k] = k < FIRST_PENALTY ? weights[feature + 1] : -weights[feature + 1];
+        }
+    }
+
+    float scalar(int i) const {
+        float s = base;
+        for (int k = 0; k < SCORED_FEATURES; k++) s += column[k][i] * weight[k];
+        return clamp01(s);
+    }
+};
+
+inline float cosineFrom(float dot, float magA, float magB) {
+    const float denom = sqrtf(magA) * sqrtf(magB);
+    return (denom > 1e-8f) ? (dot / denom) : 0.0f;
+}
+
+// Each instruction set supplies a scorer and dot(a, b) with |b|^2 in one pass
+using ScoreFn = void (*)(const ScoreTerms& terms, int count, float* scores);
+using DotNormFn = void (*)(const float* a, const float* b, int dim, float& dot, float& norm);
+
+// Cosine of a against 'count' packed rows, with |a| computed once
+template <DotNormFn DotNorm>
+void cosineRows(const float* a, const float* rows, int count, int dim, float* out) {
+    float unused, magA;
+    DotNorm(a, a, dim, unused, magA);
+    for (int r = 0; r < count; r++) {
+        float dot, magB;
+        DotNorm(a, rows + static_cast<size_t>(r) * dim, dim, dot, magB);
+        out[r] = cosineFrom(dot, magA, magB);
+    }
+}
+
+// --- Scalar: the reference every other kernel is tested against ---
+
+void scoreScalar(const ScoreTerms& t, int count, float* scores) {
+    for (int i = 0; i < count; i++) scores[i] = t.scalar(i);
+}
+
+void dotNormScalar(const float* a, const float* b, int dim, float& dot, float& norm) {
+    dot = norm = 0.0f;
+    for (int i = 0; i < dim; i++) {
+        dot += a[i] * b[i];
+        norm += b[i] * b[i];
+    }
+}
+
+#if RECO_KERNELS_NEON
+// --- NEON: 4 candidates at a time, part of the ARM baseline ---
+
+inline float horizontalSum(float32x4_t v) {
+    const float32x2_t half = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+void scoreNeon(const ScoreTerms& t, int count, float* scores) {
+    float32x4_t weight[SCORED_FEATURES];
+    for (int k = 0; k < SCORED_FEATURES; k++) weight[k] = vdupq_n_f32(t.weight[k]);
+    const float32x4_t vBase = vdupq_n_f32(t.base);
+    const float32x4_t vZero = vdupq_n_f32(0.0f);
+    const float32x4_t vOne = vdupq_n_f32(1.0f);
+
+    int i = 0;
+    for (; i + 3 < count; i += 4) {
+        float32x4_t s = vBase;
+        for (int k = 0; k < SCORED_FEATURES; k++) s = vmlaq_f32(s, vld1q_f32(t.column[k] + i), weight[k]);
+        vst1q_f32(scores + i, vminq_f32(vmaxq_f32(s, vZero), vOne));
+    }
+    for (; i < count; i++) scores[i] = t.scalar(i);
+}
+
+void dotNormNeon(const float* a, const float* b, int dim, float& dot, float& norm) {
+    float32x4_t vDot = vdupq_n_f32(0.0f);
+    float32x4_t vNorm = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 3 < dim; i += 4) {
+        const float32x4_t va = vld1q_f32(a + i);
+        const float32x4_t vb = vld1q_f32(b + i);
+        vDot = vmlaq_f32(vDot, va, vb);
+        vNorm = vmlaq_f32(vNorm, vb, vb);
+    }
+    dot = horizontalSum(vDot);
+    norm = horizontalSum(vNorm);
+    for (; i < dim; i++) {
+        dot += a[i] * b[i];
+        norm += b[i] * b[i];
+    }
+}
+#endif
+
+#if RECO_KERNELS_SSE2
+// --- SSE2: 4 candidates at a time, part of the x86 baseline ---
+
+inline float horizontalSum(__m128 v) {
+    const __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+void scoreSse2(const ScoreTerms& t, int count, float* scores) {
+    __m128 weight[SCORED_FEATURES];
+    for (int k = 0; k < SCORED_FEATURES; k++) weight[k] = _mm_set1_ps(t.weight[k]);
+    const __m128 vBase = _mm_set1_ps(t.base);
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128 vOne = _mm_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 3 < count; i += 4) {
+        __m128 s = vBase;
+        for (int k = 0; k < SCORED_FEATURES; k++) s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(t.column[k] + i), weight[k]));
+        _mm_storeu_ps(scores + i, _mm_min_ps(_mm_max_ps(s, vZero), vOne));
+    }
+    for (; i < count; i++) scores[i] = t.scalar(i);
+}
+
+void dotNormSse2(const float* a, const float* b, int dim, float& dot, float& norm) {
+    __m128 vDot = _mm_setzero_ps();
+    __m128 vNorm = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 3 < dim; i += 4) {
+        const __m128 va = _mm_loadu_ps(a + i);
+        const __m128 vb = _mm_loadu_ps(b + i);
+        vDot = _mm_add_ps(vDot, _mm_mul_ps(va, vb));
+        vNorm = _mm_add_ps(vNorm, _mm_mul_ps(vb, vb));
+    }
+    dot = horizontalSum(vDot);
+    norm = horizontalSum(vNorm);
+    for (; i < dim; i++) {
+        dot += a[i] * b[i];
+        norm += b[i] * b[i];
+    }
+}
+#endif
+
+#if RECO_KERNELS_AVX
+// --- AVX2 + FMA: 8 candidates at a time ---
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+__attribute__((target("avx2,fma"))) inline float horizontalSum(__m256 v) {
+    return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+__attribute__((target("avx2,fma"))) void scoreAvx2(const ScoreTerms& t, int count, float* scores) {
+    __m256 weight[SCORED_FEATURES];
+    for (int k = 0; k < SCORED_FEATURES; k++) weight[k] = _mm256_set1_ps(t.weight[k]);
+    const __m256 vBase = _mm256_set1_ps(t.base);
+    const __m256 vZero = _mm256_setzero_ps();
+    const __m256 vOne = _mm256_set1_ps(1.0f);
+
+    int i = 0;
+    for (; i + 7 < count; i += 8) {
+        __m256 s = vBase;
+        for (int k = 0; k < SCORED_FEATURES; k++) s = _mm256_fmadd_ps(_mm256_loadu_ps(t.column[k] + i), weight[k], s);
+        _mm256_storeu_ps(scores + i, _mm256_min_ps(_mm256_max_ps(s, vZero), vOne));
+    }
+    for (; i < count; i++) scores[i] = t.scalar(i);
+}
+
+__attribute__((target("avx2,fma"))) void dotNormAvx2(const float* a, const float* b, int dim, float& dot,
+                                                     float& norm) {
+    __m256 vDot = _mm256_setzero_ps();
+    __m256 vNorm = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 7 < dim; i += 8) {
+        const __m256 va = _mm256_loadu_ps(a + i);
+        const __m256 vb = _mm256_loadu_ps(b + i);
+        vDot = _mm256_fmadd_ps(va, vb, vDot);
+        vNorm = _mm256_fmadd_ps(vb, vb, vNorm);
+    }
+    dot = horizontalSum(vDot);
+    norm = horizontalSum(vNorm);
+    for (; i < dim; i++) {
+        dot += a[i] * b[i];
+        norm += b[i] * b[i];
+    }
+}
+
+// --- AVX-512: 16 candidates at a time, the remainder under a mask ---
+
+bool hasAvx512() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+
+__attribute__((target("avx512f"))) inline __mmask16 remainderMask(int left) {
+    return left >= 16 ? static_cast<__mmask16>(0xFFFF) : static_cast<__mmask16>((1u << left) - 1);
+}
+
+// GCC 12's unmasked max/min/extract/cast/reduce intrinsics start from an
+// undefined register and trip -Wmaybe-uninitialized, so these use the zero-masked forms
+constexpr __mmask16 ALL_LANES = 0xFFFF;
+
+__attribute__((target("avx512f"))) inline float horizontalSum(__m512 v) {
+    const __m512d halves = _mm512_castps_pd(v);
+    const __m256 low = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, halves, 0));
+    const __m256 high = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, halves, 1));
+    return horizontalSum(_mm256_add_ps(low, high));
+}
+
+__attribute__((target("avx512f"))) void scoreAvx512(const ScoreTerms& t, int count, float* scores) {
+    __m512 weight[SCORED_FEATURES];
+    for (int k = 0; k < SCORED_FEATURES; k++) weight[k] = _mm512_set1_ps(t.weight[k]);
+    const __m512 vBase = _mm512_set1_ps(t.base);
+    const __m512 vZero = _mm512_setzero_ps();
+    const __m512 vOne = _mm512_set1_ps(1.0f);
+
+    for (int i = 0; i < count; i += 16) {
+        const __mmask16 mask = remainderMask(count - i);
+        __m512 s = vBase;
+        for (int k = 0; k < SCORED_FEATURES; k++) {
+            s = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, t.column[k] + i), weight[k], s);
+        }
+        const __m512 clamped = _mm512_maskz_min_ps(ALL_LANES, _mm512_maskz_max_ps(ALL_LANES, s, vZero), vOne);
+        _mm512_mask_storeu_ps(scores + i, mask, clamped);
+    }
+}
+
+__attribute__((target("avx512f"))) void dotNormAvx512(const float* a, const float* b, int dim, float& dot,
+                                                      float& norm) {
+    __m512 vDot = _mm512_setzero_ps();
+    __m512 vNorm = _mm512_setzero_ps();
+    for (int i = 0; i < dim; i += 16) {
+        const __mmask16 mask = remainderMask(dim - i);
+        const __m512 va = _mm512_maskz_loadu_ps(mask, a + i);
+        const __m512 vb = _mm512_maskz_loadu_ps(mask, b + i);
+        vDot = _mm512_fmadd_ps(va, vb, vDot);
+        vNorm = _mm512_fmadd_ps(vb, vb, vNorm);
+    }
+    dot = horizontalSum(vDot);
+    norm = horizontalSum(vNorm);
+}
+#endif
+
+#if RECO_KERNELS_SVE
+// --- SVE: one vector length at a time, the remainder under a predicate ---
+
+bool hasSve() { return (getauxval(AT_HWCAP) & HWCAP_SVE) != 0; }
+
+__attribute__((target("sve"))) void scoreSve(const ScoreTerms& t, int count, float* scores) {
+    const int lanes = static_cast<int>(svcntw());
+    for (int i = 0; i < count; i += lanes) {
+        const svbool_t pg = svwhilelt_b32_s32(i, count);
+        svfloat32_t s = svdup_n_f32(t.base);
+        for (int k = 0; k < SCORED_FEATURES; k++) s = svmla_n_f32_x(pg, s, svld1_f32(pg, t.column[k] + i), t.weight[k]);
+        svst1_f32(pg, scores + i, svmin_n_f32_x(pg, svmax_n_f32_x(pg, s, 0.0f), 1.0f));
+    }
+}
+
+__attribute__((target("sve"))) void dotNormSve(const float* a, const float* b, int dim, float& dot, float& norm) {
+    const int lanes = static_cast<int>(svcntw());
+    svfloat32_t vDot = svdup_n_f32(0.0f);
+    svfloat32_t vNorm = svdup_n_f32(0.0f);
+    for (int i = 0; i < dim; i += lanes) {
+        const svbool_t pg = svwhilelt_b32_s32(i, dim);
+        const svfloat32_t va = svld1_f32(pg, a + i);
+        const svfloat32_t vb = svld1_f32(pg, b + i);
+        vDot = svmla_f32_m(pg, vDot, va, vb);
+        vNorm = svmla_f32_m(pg, vNorm, vb, vb);
+    }
+    dot = svaddv_f32(svptrue_b32(), vDot);
+    norm = svaddv_f32(svptrue_b32(), vNorm);
+}
+#endif
+
+bool always() { return true; }
+
+struct KernelSet {
+    const char* isa;
+    bool (*available)();
+    ScoreFn score;
+    void (*cosineRows)(const float* a, const float* rows, int count, int dim, float* out);
+};
+
+// Best first. The scalar reference comes last and always runs.
+const KernelSet KERNEL_SETS[] = {
+#if RECO_KERNELS_AVX
+    {"avx512", hasAvx512, scoreAvx512, cosineRows<dotNormAvx512>},
+    {"avx2", hasAvx2, scoreAvx2, cosineRows<dotNormAvx2>},
+#endif
+#if RECO_KERNELS_SVE
+    {"sve", hasSve, scoreSve, cosineRows<dotNormSve>},
+#endif
+#if RECO_KERNELS_NEON
+    {"neon", always, scoreNeon, cosineRows<dotNormNeon>},
+#elif RECO_KERNELS_SSE2
+    {"sse2", always, scoreSse2, cosineRows<dotNormSse2>},
+#endif
+    {"scalar", always, scoreScalar, cosineRows<dotNormScalar>},
+};
+
+const KernelSet& scalarKernels() { return KERNEL_SETS[std::size(KERNEL_SETS) - 1]; }
+
+const KernelSet* findKernels(const char* isa) {
+    for (const KernelSet& set : KERNEL_SETS) {
+        if (std::strcmp(set.isa, isa) == 0) return &set;
+    }
+    return nullptr;
+}
+
+// Deterministic test values in [lo, hi)
+void fillTestValues(float* out, int count, uint32_t seed, float lo, float hi) {
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        out[i] = lo + (hi - lo) * static_cast<float>(seed >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+/**
+ * Runs a kernel set against the scalar reference over every count and
+ * dimension up to a few vector widths, from unaligned starts. Results may
+ * only differ by rounding (FMA, summation order).
+ */
+bool selfTest(const KernelSet& set) {
+    constexpr float TOLERANCE = 1e-5f;
+    constexpr int STRIDE = 80;
+    constexpr int FIRST = 3;
+    constexpr int MAX_DIM = 70;
+    constexpr int ROWS = 3;
+
+    std::vector<float> features(static_cast<size_t>(NUM_FEATURES) * STRIDE);
+    float weights[NUM_WEIGHTS];
+    fillTestValues(features.data(), static_cast<int>(features.size()), 1u, 0.0f, 1.0f);
+    fillTestValues(weights, NUM_WEIGHTS, 2u, -0.5f, 1.0f); // reaches both clamps
+    float expected[STRIDE];
+    float actual[STRIDE];
+    for (int count = 1; count <= STRIDE - FIRST; count++) {
+        const ScoreTerms terms(features.data(), STRIDE, FIRST, weights);
+        scalarKernels().score(terms, count, expected);
+        set.score(terms, count, actual);
+        for (int i = 0; i < count; i++) {
+            if (!(std::fabs(expected[i] - actual[i]) <= TOLERANCE)) return false;
+        }
+    }
+
+    // The middle row is zero, whose similarity is defined as 0
+    std::vector<float> vectors((ROWS + 1) * MAX_DIM + 1);
+    fillTestValues(vectors.data(), static_cast<int>(vectors.size()), 3u, -1.0f, 1.0f);
+    const float* a = vectors.data() + 1;
+    float* rows = vectors.data() + 1 + MAX_DIM;
+    for (int dim = 1; dim <= MAX_DIM; dim++) {
+        std::fill(rows + dim, rows + 2 * dim, 0.0f);
+        scalarKernels().cosineRows(a, rows, ROWS, dim, expected);
+        set.cosineRows(a, rows, ROWS, dim, actual);
+        for (int r = 0; r < ROWS; r++) {
+            if (!(std::fabs(expected[r] - actual[r]) <= TOLERANCE)) return false;
+        }
+    }
+    return true;
+}
+
+// The best set this CPU runs that also passes its self-test, chosen once
+const KernelSet& bestKernels() {
+    static const KernelSet& best = []() -> const KernelSet& {
+        for (const KernelSet& set : KERNEL_SETS) {
+            if (set.available() && selfTest(set)) return set;
+        }
+        return scalarKernels();
+    }();
+    return best;
+}
+
+std::atomic<const KernelSet*> forcedKernels{nullptr};
+
+const KernelSet& activeKernels() {
+    const KernelSet* forced = forcedKernels.load(std::memory_order_acquire);
+    return forced ? *forced : bestKernels();
+}
+
+} // namespace
+
+const char* scorer_kernel_isa() {
+    return activeKernels().isa;
+}
+
+int scorer_supported_isas(const char** names, int max) {
+    int found = 0;
+    for (const KernelSet& set : KERNEL_SETS) {
+        if (found < max && set.available()) names[found++] = set.isa;
+    }
+    return found;
+}
+
+bool scorer_kernel_self_test(const char* isa) {
+    const KernelSet* set = findKernels(isa);
+    return set && set->available() && selfTest(*set);
+}
+
+bool scorer_use_isa(const char* isa) {
+    if (isa == nullptr) {
+        forcedKernels.store(nullptr, std::memory_order_release);
+        return true;
+    }
+    const KernelSet* set = findKernels(isa);
+    if (!set || !set->available()) return false;
+    forcedKernels.store(set, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Compute cosine similarity between two vectors of given dimension.
+ * Returns 0 if either vector has zero magnitude.
+ */
+float cosine_similarity(const float* a, const float* b, int dim) {
+    float sim;
+    activeKernels().cosineRows(a, b, 1, dim, &sim);
+    return sim;
+}
+
+void batch_cosine_similarity(const float* a, const float* rows, int count, int dim, float* out) {
+    if (count <= 0) return;
+    activeKernels().cosineRows(a, rows, count, dim, out);
+}
+
+/**
+ * Scores the N candidates from 'first' of a table whose columns are
+ * 'stride' candidates long, so parallel callers can split one table.
+ */
+static void score_range(const float* features, int stride, int first, int N, const float* weights, float* scores) {
+    if (N <= 0) return;
+    activeKernels().score(ScoreTerms(features, stride, first, weights), N, scores);
+}
+
+void score_candidates(const float* features, int N, const float* weights, float* scores) {
+    score_range(features, N, 0, N, weights, scores);
+}
+
+namespace {
+
+// Candidates per parallel task: enough that handing out a task and merging
+// its heap are noise next to scoring it, few enough to balance across cores
+constexpr int TASK_CANDIDATES = 16384;
+
+// Candidates scored per pass before they are ranked (16 KB of scores)
+constexpr int SCORE_BLOCK = 4096;
+
+// Below this, one thread is enough: 65536 candidates take ~300 us to score
+// at the ~4-5 ns/item dsp_bench measures single-threaded, against a few us to
+// wake the pool and merge the per-task heaps
+constexpr int PARALLEL_MIN_CANDIDATES = 65536;
+
+struct Ranked {
+    float score;
+    int index;
+};
+
+// The ranking order: higher score first, then lower index, so ties come
+// out the same on every run and for every thread count
+inline bool ranksBefore(const Ranked& a, const Ranked& b) {
+    return a.score > b.score || (a.score == b.score && a.index < b.index);
+}
+
+/**
+ * The best 'capacity' of the candidates offered, in caller storage. A heap
+ * with the worst kept candidate on top, so most offers cost one compare.
+ */
+class BoundedHeap {
+public:
+    BoundedHeap(Ranked* storage, int capacity) : items(storage), capacity(capacity) {}
+
+    void offer(float score, int index) {
+        // NaN would break the ordering: rank it below everything
+        const Ranked candidate{score == score ? score : -INFINITY, index};
+        if (count < capacity) {
+            items[count++] = candidate;
+            std::push_heap(items, items + count, ranksBefore);
+        } else if (capacity > 0 && ranksBefore(candidate, items[0])) {
+            std::pop_heap(items, items + count, ranksBefore);
+            items[count - 1] = candidate;
+            std::push_heap(items, items + count, ranksBefore);
+        }
+    }
+
+    int size() const { return count; }
+
+private:
+    Ranked* items;
+    int capacity;
+    int count = 0;
+};
+
+} // namespace
+
+/**
+ * Top-K selection with a K-entry bounded heap: one pass over the scores and
+ * O(N log K) only in the worst case, since most candidates fail the first
+ * compare. Ties break by lower index.
+ */
+void top_k_indices(const float* scores, int N, int K, int* outIndices) {
+    K = std::max(0, std::min(K, N));
+    std::vector<Ranked> kept(K);
+    BoundedHeap heap(kept.data(), K);
+    for (int i = 0; i < N; i++) heap.offer(scores[i], i);
+    std::sort(kept.begin(), kept.end(), ranksBefore);
+    for (int i = 0; i < K; i++) outIndices[i] = kept[i].index;
+}
+
+/**
+ * Fused scoring and top-K. Candidates are split into TASK_CANDIDATES chunks
+ * on the worker pool; each task scores its chunk a block at a time and feeds
+ * a heap of its own while the scores are still in cache. The per-task heaps are then merged:
+ * at most tasks * K entries, cut to K with nth_element and sorted. Small
+ * pools run as a single task on the calling thread.
+ */
+void parallel_score_top_k(const float* features, int N, const float* weights, int K, int threads,
+                          float* scores, int* outIndices) {
+    if (N <= 0) return;
+    K = std::max(0, std::min(K, N));
+    if (threads <= 0) threads = WorkerPool::shared().concurrency();
+    // Splitting only pays when the tasks really run side by side
+    const int taskSize = (threads == 1 || N < PARALLEL_MIN_CANDIDATES) ? N : TASK_CANDIDATES;
+    const int tasks = (N + taskSize - 1) / taskSize;
+    const int perTask = std::min(K, taskSize);
+    std::vector<Ranked> kept(static_cast<size_t>(tasks) * perTask);
+    std::vector<int> keptCount(tasks);
+
+    parallelFor(static_cast<size_t>(tasks), tasks == 1 ? 1 : threads, [&](size_t task) {
+        const int first = static_cast<int>(task) * taskSize;
+        const int end = first + std::min(taskSize, N - first);
+        BoundedHeap heap(kept.data() + task * perTask, perTask);
+        // Score a block, then rank it while it is still in L1
+        float block[SCORE_BLOCK];
+        for (int begin = first; begin < end; begin += SCORE_BLOCK) {
+            const int count = std::min(SCORE_BLOCK, end - begin);
+            float* out = scores ? scores + begin : block;
+            score_range(features, N, begin, count, weights, out);
+            for (int i = 0; i < count; i++) heap.offer(out[i], begin + i);
+        }
+        keptCount[task] = heap.size();
+    });
+
+    // Close the gaps left by tasks that kept fewer than perTask
+    size_t total = 0;
+    for (int task = 0; task < tasks; task++) {
+        std::memmove(kept.data() + total, kept.data() + static_cast<size_t>(task) * perTask,
+                     static_cast<size_t>(keptCount[task]) * sizeof(Ranked));
+        total += keptCount[task];
+    }
+    const auto end = kept.begin() + static_cast<ptrdiff_t>(total);
+    if (total > static_cast<size_t>(K)) std::nth_element(kept.begin(), kept.begin() + K, end, ranksBefore);
+    std::sort(kept.begin(), kept.begin() + K, ranksBefore);
+    for (int i = 0; i < K; i++) outIndices[i] = kept[i].index;
+}
@@ -0,0 +1,63 @@
+#ifndef RECOMMENDATION_KERNELS_H
+#define RECOMMENDATION_KERNELS_H
+
+/**
+ * SIMD scoring kernels behind NativeRecommendationScorer, kept free of JNI so
+ * they can also be built and benchmarked on the host. Layouts are described
+ * in recommendation_scorer.cpp and at each definition.
+ */
+
+// Number of scoring features per candidate
+constexpr int NUM_FEATURES = 11;
+
+// Number of weight values expected
+constexpr int NUM_WEIGHTS = 11;
+
+/**
+ * Clamp a float to [0, 1].
+ */
+inline float clamp01(float x) {
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+// Cosine similarity of two dim-length vectors; 0 if either has zero magnitude
+float cosine_similarity(const float* a, const float* b, int dim);
+
+// cosine_similarity of a against each of 'count' dim-length rows packed in rows
+void batch_cosine_similarity(const float* a, const float* rows, int count, int dim, float* out);
+
+// Weighted, clamped score of N candidates from SoA features [NUM_FEATURES * N]
+void score_candidates(const float* features, int N, const float* weights, float* scores);
+
+// Indices of the K best scores (K <= N), by descending score; ties go to
+// the lower index
+void top_k_indices(const float* scores, int N, int K, int* outIndices);
+
+// score_candidates and top_k_indices in one pass, split across up to
+// 'threads' threads (<= 0: one per core) for large N. Writes all N scores
+// to 'scores' unless it is null. Same ranking as top_k_indices.
+void parallel_score_top_k(const float* features, int N, const float* weights, int K, int threads,
+                          float* scores, int* outIndices);
+
+/*
+ * The kernels pick an instruction set at run time: the best of "avx512",
+ * "avx2" (with FMA), "sve", "neon", "sse2" and "scalar" that this CPU
+ * supports and that matches the scalar reference on a self-test run on
+ * first use.
+ */
+
+// Instruction set the kernels currently run on
+const char* scorer_kernel_isa();
+
+// Names of the instruction sets this CPU supports, best first (at most max)
+int scorer_supported_isas(const char** names, int max);
+
+// Checks one instruction set's kernels against the scalar reference; false
+// if they disagree or the CPU lacks it
+bool scorer_kernel_self_test(const char* isa);
+
+// Forces an instruction set (for benchmarks), or restores the automatic
+// choice when isa is null. False if the CPU lacks it.
+bool scorer_use_isa(const char* isa);
+
+#endif // RECOMMENDATION_KERNELS_H
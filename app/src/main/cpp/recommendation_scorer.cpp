@@ -1,7 +1,8 @@
 /**
  * recommendation_scorer.cpp — Native SIMD-accelerated recommendation scoring engine
  *
- * Processes candidate songs in batches using ARM NEON (or SSE on x86) for vectorized
+ * Processes candidate songs in batches using the best SIMD kernels the CPU runs (NEON or
+ * SVE on ARM, SSE2, AVX2 or AVX-512 on x86; see recommendation_kernels.h) for vectorized
  * weighted scoring. Accepts flat SoA (Structure of Arrays) feature data from JNI and
  * returns top-K candidate indices sorted by descending score.
  *
@@ -26,321 +27,43 @@
 
 #include <jni.h>
 #include <cstdlib>
-#include <cmath>
 #include <algorithm>
 #include <vector>
 #include <android/log.h>
-
-#ifdef __ARM_NEON__
-#include <arm_neon.h>
-#elif defined(__SSE__)
-#include <xmmintrin.h>
-#include <emmintrin.h>
-#endif
+#include "candidate_feature_store.h"
+#include "jni_util.h"
+#include "recommendation_kernels.h"
+#include "vector_index.h"
 
 #define LOG_TAG "NativeRecoScorer"
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
-// Number of scoring features per candidate
-static constexpr int NUM_FEATURES = 11;
-
-// Number of weight values expected
-static constexpr int NUM_WEIGHTS = 11;
-
-/**
- * Clamp a float to [0, 1].
- */
-static inline float clamp01(float x) {
-    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+static CandidateFeatureStore* storeFromHandle(jlong handle) {
+    return reinterpret_cast<CandidateFeatureStore*>(static_cast<intptr_t>(handle));
 }
 
-/**
- * Compute cosine similarity between two vectors of given dimension.
- * Returns 0 if either vector has zero magnitude.
- */
-static float cosine_similarity(const float* a, const float* b, int dim) {
-    float dot = 0.0f, magA = 0.0f, magB = 0.0f;
-
-#ifdef __ARM_NEON__
-    // NEON: process 4 floats at a time
-    int i = 0;
-    float32x4_t vDot = vdupq_n_f32(0.0f);
-    float32x4_t vMagA = vdupq_n_f32(0.0f);
-    float32x4_t vMagB = vdupq_n_f32(0.0f);
-
-    for (; i + 3 < dim; i += 4) {
-        float32x4_t va = vld1q_f32(a + i);
-        float32x4_t vb = vld1q_f32(b + i);
-        vDot = vmlaq_f32(vDot, va, vb);
-        vMagA = vmlaq_f32(vMagA, va, va);
-        vMagB = vmlaq_f32(vMagB, vb, vb);
-    }
-
-    // Horizontal sum
-    float32x2_t dLow = vget_low_f32(vDot);
-    float32x2_t dHigh = vget_high_f32(vDot);
-    dLow = vadd_f32(dLow, dHigh);
-    dot = vget_lane_f32(vpadd_f32(dLow, dLow), 0);
-
-    float32x2_t aLow = vget_low_f32(vMagA);
-    float32x2_t aHigh = vget_high_f32(vMagA);
-    aLow = vadd_f32(aLow, aHigh);
-    magA = vget_lane_f32(vpadd_f32(aLow, aLow), 0);
-
-    float32x2_t bLow = vget_low_f32(vMagB);
-    float32x2_t bHigh = vget_high_f32(vMagB);
-    bLow = vadd_f32(bLow, bHigh);
-    magB = vget_lane_f32(vpadd_f32(bLow, bLow), 0);
-
-    // Handle remainder
-    for (; i < dim; i++) {
-        dot += a[i] * b[i];
-        magA += a[i] * a[i];
-        magB += b[i] * b[i];
-    }
-
-#elif defined(__SSE__)
-    int i = 0;
-    __m128 sDot = _mm_setzero_ps();
-    __m128 sMagA = _mm_setzero_ps();
-    __m128 sMagB = _mm_setzero_ps();
-
-    for (; i + 3 < dim; i += 4) {
-        __m128 va = _mm_loadu_ps(a + i);
-        __m128 vb = _mm_loadu_ps(b + i);
-        sDot = _mm_add_ps(sDot, _mm_mul_ps(va, vb));
-        sMagA = _mm_add_ps(sMagA, _mm_mul_ps(va, va));
-        sMagB = _mm_add_ps(sMagB, _mm_mul_ps(vb, vb));
-    }
-
-    // Horizontal sum (SSE3 hadd would be better but SSE2 is more portable)
-    float tmpDot[4], tmpA[4], tmpB[4];
-    _mm_storeu_ps(tmpDot, sDot);
-    _mm_storeu_ps(tmpA, sMagA);
-    _mm_storeu_ps(tmpB, sMagB);
-    dot = tmpDot[0] + tmpDot[1] + tmpDot[2] + tmpDot[3];
-    magA = tmpA[0] + tmpA[1] + tmpA[2] + tmpA[3];
-    magB = tmpB[0] + tmpB[1] + tmpB[2] + tmpB[3];
-
-    for (; i < dim; i++) {
-        dot += a[i] * b[i];
-        magA += a[i] * a[i];
-        magB += b[i] * b[i];
-    }
-
-#else
-    // Scalar fallback
-    for (int i = 0; i < dim; i++) {
-        dot += a[i] * b[i];
-        magA += a[i] * a[i];
-        magB += b[i] * b[i];
-    }
-#endif
-
-    float denom = sqrtf(magA) * sqrtf(magB);
-    return (denom > 1e-8f) ? (dot / denom) : 0.0f;
+static VectorIndex* indexFromHandle(jlong handle) {
+    return reinterpret_cast<VectorIndex*>(static_cast<intptr_t>(handle));
 }
 
-/**
- * Score N candidates using weighted feature vectors.
- *
- * Features are in SoA (column-major) layout:
- *   feature[featureIndex * N + candidateIndex]
- *
- *   Feature indices:
- *     0  = artistAffinity      (0.0–1.0)
- *     1  = freshnessFlag       (0.0 or 1.0)
- *     2  = skipFlag             (0.0 or 1.0)
- *     3  = likedSongFlag        (0.0 or 1.0)
- *     4  = likedArtistFlag      (0.0 or 1.0)
- *     5  = timeOfDayWeight      (0.0–1.0)
- *     6  = varietyPenalty        (0.0–N, count above 2)
- *     7  = genreSimilarity      (0.0–1.0, cosine sim)
- *     8  = recentGenreSimilarity(0.0–1.0, cosine sim)
- *     9  = skipGenrePenalty     (0.0–1.0, cosine sim)
- *     10 = (reserved)          (0.0)
- *
- * weights[0..10] maps to base + per-feature weights
- */
-static void score_candidates(
-    const float* features,  // SoA: [NUM_FEATURES * N]
-    int N,
-    const float* weights,   // [NUM_WEIGHTS]
-    float* scores           // output: [N]
-) {
-    const float base       = weights[0];
-    const float wArtist    = weights[1];
-    const float wFresh     = weights[2];
-    const float wSkip      = weights[3];
-    const float wLikedSong = weights[4];
-    const float wLikedArt  = weights[5];
-    const float wTime      = weights[6];
-    const float wVariety   = weights[7];
-    const float wGenre     = weights[8];
-    const float wRecGenre  = weights[9];
-    const float wSkipGenre = weights[10];
-
-    // Feature column pointers (SoA)
-    const float* artistAff   = features + 0 * N;
-    const float* freshness   = features + 1 * N;
-    const float* skipFlag    = features + 2 * N;
-    const float* likedSong   = features + 3 * N;
-    const float* likedArt    = features + 4 * N;
-    const float* timeWeight  = features + 5 * N;
-    const float* variety     = features + 6 * N;
-    const float* genreSim    = features + 7 * N;
-    const float* recGenreSim = features + 8 * N;
-    const float* skipGenre   = features + 9 * N;
-
-#ifdef __ARM_NEON__
-    // NEON: process 4 candidates at a time
-    float32x4_t vBase       = vdupq_n_f32(base);
-    float32x4_t vWArtist    = vdupq_n_f32(wArtist);
-    float32x4_t vWFresh     = vdupq_n_f32(wFresh);
-    float32x4_t vWSkip      = vdupq_n_f32(wSkip);
-    float32x4_t vWLikedSong = vdupq_n_f32(wLikedSong);
-    float32x4_t vWLikedArt  = vdupq_n_f32(wLikedArt);
-    float32x4_t vWTime      = vdupq_n_f32(wTime);
-    float32x4_t vWVariety   = vdupq_n_f32(wVariety);
-    float32x4_t vWGenre     = vdupq_n_f32(wGenre);
-    float32x4_t vWRecGenre  = vdupq_n_f32(wRecGenre);
-    float32x4_t vWSkipGenre = vdupq_n_f32(wSkipGenre);
-    float32x4_t vZero       = vdupq_n_f32(0.0f);
-    float32x4_t vOne        = vdupq_n_f32(1.0f);
-
-    int i = 0;
-    for (; i + 3 < N; i += 4) {
-        float32x4_t s = vBase;
-
-        // Positive signals: accumulate weighted features
-        s = vmlaq_f32(s, vld1q_f32(artistAff + i),   vWArtist);
-        s = vmlaq_f32(s, vld1q_f32(freshness + i),   vWFresh);
-        s = vmlaq_f32(s, vld1q_f32(likedSong + i),   vWLikedSong);
-        s = vmlaq_f32(s, vld1q_f32(likedArt + i),    vWLikedArt);
-        s = vmlaq_f32(s, vld1q_f32(timeWeight + i),  vWTime);
-        s = vmlaq_f32(s, vld1q_f32(genreSim + i),    vWGenre);
-        s = vmlaq_f32(s, vld1q_f32(recGenreSim + i), vWRecGenre);
-
-        // Negative signals: subtract
-        s = vmlsq_f32(s, vld1q_f32(skipFlag + i),    vWSkip);
-        s = vmlsq_f32(s, vld1q_f32(variety + i),     vWVariety);
-        s = vmlsq_f32(s, vld1q_f32(skipGenre + i),   vWSkipGenre);
-
-        // Clamp to [0, 1]
-        s = vmaxq_f32(s, vZero);
-        s = vminq_f32(s, vOne);
-
-        vst1q_f32(scores + i, s);
-    }
-
-    // Handle remaining candidates
-    for (; i < N; i++) {
-        float s = base
-            + artistAff[i]   * wArtist
-            + freshness[i]   * wFresh
-            + likedSong[i]   * wLikedSong
-            + likedArt[i]    * wLikedArt
-            + timeWeight[i]  * wTime
-            + genreSim[i]    * wGenre
-            + recGenreSim[i] * wRecGenre
-            - skipFlag[i]    * wSkip
-            - variety[i]     * wVariety
-            - skipGenre[i]   * wSkipGenre;
-        scores[i] = clamp01(s);
-    }
-
-#elif defined(__SSE__)
-    __m128 vBase       = _mm_set1_ps(base);
-    __m128 vWArtist    = _mm_set1_ps(wArtist);
-    __m128 vWFresh     = _mm_set1_ps(wFresh);
-    __m128 vWSkip      = _mm_set1_ps(wSkip);
-    __m128 vWLikedSong = _mm_set1_ps(wLikedSong);
-    __m128 vWLikedArt  = _mm_set1_ps(wLikedArt);
-    __m128 vWTime      = _mm_set1_ps(wTime);
-    __m128 vWVariety   = _mm_set1_ps(wVariety);
-    __m128 vWGenre     = _mm_set1_ps(wGenre);
-    __m128 vWRecGenre  = _mm_set1_ps(wRecGenre);
-    __m128 vWSkipGenre = _mm_set1_ps(wSkipGenre);
-    __m128 vZero       = _mm_setzero_ps();
-    __m128 vOne        = _mm_set1_ps(1.0f);
-
-    int i = 0;
-    for (; i + 3 < N; i += 4) {
-        __m128 s = vBase;
-
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(artistAff + i),   vWArtist));
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(freshness + i),   vWFresh));
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(likedSong + i),   vWLikedSong));
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(likedArt + i),    vWLikedArt));
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(timeWeight + i),  vWTime));
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(genreSim + i),    vWGenre));
-        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(recGenreSim + i), vWRecGenre));
-
-        s = _mm_sub_ps(s, _mm_mul_ps(_mm_loadu_ps(skipFlag + i),    vWSkip));
-        s = _mm_sub_ps(s, _mm_mul_ps(_mm_loadu_ps(variety + i),     vWVariety));
-        s = _mm_sub_ps(s, _mm_mul_ps(_mm_loadu_ps(skipGenre + i),   vWSkipGenre));
-
-        s = _mm_max_ps(s, vZero);
-        s = _mm_min_ps(s, vOne);
-
-        _mm_storeu_ps(scores + i, s);
-    }
-
-    for (; i < N; i++) {
-        float s = base
-            + artistAff[i]   * wArtist
-            + freshness[i]   * wFresh
-            + likedSong[i]   * wLikedSong
-            + likedArt[i]    * wLikedArt
-            + timeWeight[i]  * wTime
-            + genreSim[i]    * wGenre
-            + recGenreSim[i] * wRecGenre
-            - skipFlag[i]    * wSkip
-            - variety[i]     * wVariety
-            - skipGenre[i]   * wSkipGenre;
-        scores[i] = clamp01(s);
-    }
-
-#else
-    // Pure scalar fallback
-    for (int i = 0; i < N; i++) {
-        float s = base
-            + artistAff[i]   * wArtist
-            + freshness[i]   * wFresh
-            + likedSong[i]   * wLikedSong
-            + likedArt[i]    * wLikedArt
-            + timeWeight[i]  * wTime
-            + genreSim[i]    * wGenre
-            + recGenreSim[i] * wRecGenre
-            - skipFlag[i]    * wSkip
-            - variety[i]     * wVariety
-            - skipGenre[i]   * wSkipGenre;
-        scores[i] = clamp01(s);
-    }
-#endif
-}
+static constexpr uint32_t ALL_FEATURES_MASK = (1u << NUM_FEATURES) - 1;
 
 /**
- * Partial top-K selection using partial_sort.
- * Returns the indices of the top K candidates sorted by descending score.
+ * Address of a direct buffer holding at least 'count' elements of T from its
+ * start (position is ignored); null if the buffer is not direct, too small or
+ * misaligned for T.
  */
-static void top_k_indices(const float* scores, int N, int K, int* outIndices) {
-    // Create index array
-    std::vector<int> indices(N);
-    for (int i = 0; i < N; i++) indices[i] = i;
-
-    K = std::min(K, N);
-
-    // Partial sort: only sort the top K elements
-    std::partial_sort(indices.begin(), indices.begin() + K, indices.end(),
-        [&scores](int a, int b) {
-            return scores[a] > scores[b]; // Descending
-        });
-
-    for (int i = 0; i < K; i++) {
-        outIndices[i] = indices[i];
+template<typename T>
+static T* directBuffer(JNIEnv* env, jobject buffer, jlong count) {
+    if (!buffer) return nullptr;
+    void* address = env->GetDirectBufferAddress(buffer);
+    const jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!address || capacity < count * static_cast<jlong>(sizeof(T)) ||
+        reinterpret_cast<uintptr_t>(address) % alignof(T) != 0) {
+        return nullptr;
     }
+    return static_cast<T*>(address);
 }
 
 // ============================================================================
@@ -398,16 +121,10 @@ Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nScoreCandi
         return env->NewIntArray(0);
     }
 
-    // Allocate score buffer
-    std::vector<float> scores(numCandidates);
-
-    // Run SIMD scoring
-    score_candidates(features, numCandidates, weights, scores.data());
-
-    // Top-K selection
-    int K = std::min((int)topK, (int)numCandidates);
+    // SIMD scoring fused with top-K selection, across cores for large pools
+    int K = std::max(0, std::min((int)topK, (int)numCandidates));
     std::vector<int> topIndices(K);
-    top_k_indices(scores.data(), numCandidates, K, topIndices.data());
+    parallel_score_top_k(features, numCandidates, weights, K, 0, nullptr, topIndices.data());
 
     // Release input arrays
     env->ReleaseFloatArrayElements(jFeatures, features, JNI_ABORT);
@@ -440,19 +157,20 @@ Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nCosineSimi
     jfloatArray jVecB,
     jint dim
 ) {
-    jfloat* vecA = env->GetFloatArrayElements(jVecA, nullptr);
-    jfloat* vecB = env->GetFloatArrayElements(jVecB, nullptr);
-
-    if (!vecA || !vecB) {
-        if (vecA) env->ReleaseFloatArrayElements(jVecA, vecA, JNI_ABORT);
-        if (vecB) env->ReleaseFloatArrayElements(jVecB, vecB, JNI_ABORT);
+    if (!jVecA || !jVecB || dim <= 0 ||
+        env->GetArrayLength(jVecA) < dim || env->GetArrayLength(jVecB) < dim) {
         return 0.0f;
     }
 
-    float sim = cosine_similarity(vecA, vecB, dim);
+    // Vectors are tiny: pin them rather than copy, and release straight away
+    auto* vecA = static_cast<jfloat*>(env->GetPrimitiveArrayCritical(jVecA, nullptr));
+    auto* vecB = static_cast<jfloat*>(env->GetPrimitiveArrayCritical(jVecB, nullptr));
 
-    env->ReleaseFloatArrayElements(jVecA, vecA, JNI_ABORT);
-    env->ReleaseFloatArrayElements(jVecB, vecB, JNI_ABORT);
+    float sim = 0.0f;
+    if (vecA && vecB) sim = cosine_similarity(vecA, vecB, dim);
+
+    if (vecB) env->ReleasePrimitiveArrayCritical(jVecB, vecB, JNI_ABORT);
+    if (vecA) env->ReleasePrimitiveArrayCritical(jVecA, vecA, JNI_ABORT);
 
     // Genre vectors are non-negative, so similarity is [0, 1]
     return clamp01(sim);
@@ -487,8 +205,10 @@ Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nBatchCosin
     }
 
     std::vector<float> sims(numCandidates);
-    for (int i = 0; i < numCandidates; i++) {
-        sims[i] = clamp01(cosine_similarity(userVec, candidateVecs + i * dim, dim));
+    if (env->GetArrayLength(jUserVec) >= dim &&
+        env->GetArrayLength(jCandidateVecs) / dim >= numCandidates) {
+        batch_cosine_similarity(userVec, candidateVecs, numCandidates, dim, sims.data());
+        for (float& sim : sims) sim = clamp01(sim);
     }
 
     env->ReleaseFloatArrayElements(jUserVec, userVec, JNI_ABORT);
@@ -499,4 +219,469 @@ Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nBatchCosin
     return result;
 }
 
+// ============================================================================
+// DIRECT BYTEBUFFER VARIANTS
+//
+// Inputs and outputs live in caller-owned direct buffers in native byte
+// order, read and written in place from offset 0: nothing is copied or
+// allocated on either side of the call.
+// ============================================================================
+
+/**
+ * Score candidates into caller buffers.
+ *
+ * @param features      Direct buffer of floats [NUM_FEATURES * numCandidates], SoA layout
+ * @param numCandidates Number of candidate songs
+ * @param weights       Direct buffer of floats [NUM_WEIGHTS]
+ * @param scoresOut     Direct buffer of floats [numCandidates] — receives every score
+ * @param topKOut       Direct buffer of ints [min(topK, numCandidates)] — receives
+ *                      the top-K indices by descending score
+ * @param topK          How many top results to return
+ * @return Number of indices written, or -1 if a buffer is missing or too small
+ */
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nScoreCandidatesDirect(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jFeatures,
+    jint numCandidates,
+    jobject jWeights,
+    jobject jScoresOut,
+    jobject jTopKOut,
+    jint topK
+) {
+    if (numCandidates < 0 || topK < 0) return -1;
+    if (numCandidates == 0) return 0;
+    const int K = std::min(static_cast<int>(topK), static_cast<int>(numCandidates));
+    const auto* features = directBuffer<float>(env, jFeatures, static_cast<jlong>(NUM_FEATURES) * numCandidates);
+    const auto* weights = directBuffer<float>(env, jWeights, NUM_WEIGHTS);
+    auto* scores = directBuffer<float>(env, jScoresOut, numCandidates);
+    auto* topIndices = directBuffer<int32_t>(env, jTopKOut, K);
+    if (!features || !weights || !scores || !topIndices) {
+        LOGE("Invalid direct buffers for N=%d, K=%d", numCandidates, K);
+        return -1;
+    }
+
+    parallel_score_top_k(features, numCandidates, weights, K, 0, scores, topIndices);
+    return K;
+}
+
+/**
+ * Cosine similarity of two direct float buffers of dim elements.
+ *
+ * @return Similarity in [0, 1], or 0 if a buffer is missing or too small
+ */
+JNIEXPORT jfloat JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nCosineSimilarityDirect(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jVecA,
+    jobject jVecB,
+    jint dim
+) {
+    if (dim <= 0) return 0.0f;
+    const auto* vecA = directBuffer<float>(env, jVecA, dim);
+    const auto* vecB = directBuffer<float>(env, jVecB, dim);
+    if (!vecA || !vecB) return 0.0f;
+    return clamp01(cosine_similarity(vecA, vecB, dim));
+}
+
+/**
+ * Batch cosine similarities of one user vector against N packed candidate
+ * vectors, all in direct float buffers.
+ *
+ * @param userVec       [dim]
+ * @param candidateVecs [numCandidates * dim]
+ * @param simsOut       [numCandidates] — receives the similarities, in [0, 1]
+ * @return false if a buffer is missing or too small
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nBatchCosineSimilarityDirect(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jUserVec,
+    jobject jCandidateVecs,
+    jint numCandidates,
+    jint dim,
+    jobject jSimsOut
+) {
+    if (numCandidates < 0 || dim <= 0) return JNI_FALSE;
+    const auto* userVec = directBuffer<float>(env, jUserVec, dim);
+    const auto* candidateVecs = directBuffer<float>(env, jCandidateVecs, static_cast<jlong>(numCandidates) * dim);
+    auto* sims = directBuffer<float>(env, jSimsOut, numCandidates);
+    if (!userVec || !candidateVecs || !sims) return JNI_FALSE;
+
+    batch_cosine_similarity(userVec, candidateVecs, numCandidates, dim, sims);
+    for (int i = 0; i < numCandidates; i++) sims[i] = clamp01(sims[i]);
+    return JNI_TRUE;
+}
+
+// ============================================================================
+// RESIDENT FEATURE STORE
+// ============================================================================
+
+JNIEXPORT jlong JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nCreateFeatureStore(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(new CandidateFeatureStore()));
+}
+
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nReleaseFeatureStore(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    delete storeFromHandle(handle);
+}
+
+/**
+ * Write some feature columns of a batch of songs, adding songs not yet stored.
+ *
+ * @param songIds    String[N] — song IDs
+ * @param columnMask Bit j set = feature j is given
+ * @param values     FloatArray [popcount(columnMask) * N] — one run of N values
+ *                   per given feature, in ascending feature order
+ * @return IntArray[N] — each song's slot, or null on invalid input
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nFeatureStoreUpsert(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jobjectArray jSongIds,
+    jint columnMask,
+    jfloatArray jValues
+) {
+    CandidateFeatureStore* store = storeFromHandle(handle);
+    const auto mask = static_cast<uint32_t>(columnMask);
+    if (!store || !jSongIds || !jValues || (mask & ~ALL_FEATURES_MASK) != 0) return nullptr;
+
+    std::vector<std::string> ids;
+    if (!readStringArray(env, jSongIds, ids)) return nullptr;
+    const int N = static_cast<int>(ids.size());
+    const jsize expected = static_cast<jsize>(__builtin_popcount(mask)) * N;
+    if (env->GetArrayLength(jValues) < expected) {
+        LOGE("Upsert values too small: expected %d, got %d", expected, env->GetArrayLength(jValues));
+        return nullptr;
+    }
+
+    std::vector<float> values(expected);
+    env->GetFloatArrayRegion(jValues, 0, expected, values.data());
+    std::vector<int32_t> slots(N);
+    store->upsert(ids.data(), N, mask, values.data(), slots.data());
+
+    jintArray result = env->NewIntArray(N);
+    if (result) env->SetIntArrayRegion(result, 0, N, slots.data());
+    return result;
+}
+
+/**
+ * Drop songs from the store, freeing their slots for reuse.
+ *
+ * @return How many of the songs were stored
+ */
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nFeatureStoreRemove(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jobjectArray jSongIds
+) {
+    CandidateFeatureStore* store = storeFromHandle(handle);
+    std::vector<std::string> ids;
+    if (!store || !jSongIds || !readStringArray(env, jSongIds, ids)) return 0;
+    return store->remove(ids.data(), static_cast<int>(ids.size()));
+}
+
+/**
+ * Score stored songs and return top-K. Only the per-request parts cross JNI:
+ * the candidates' slots, the features that depend on the request and the
+ * weights.
+ *
+ * @param slots        IntArray[N] — candidates, as returned by nFeatureStoreUpsert
+ * @param overrideMask Bit j set = feature j comes from overrides, not the store
+ * @param overrides    FloatArray [popcount(overrideMask) * N], or null for mask 0
+ * @param weights      FloatArray [NUM_WEIGHTS] — scoring weights
+ * @param topK         How many top results to return
+ * @return IntArray of positions in slots sorted by descending score, or null
+ *         if a slot is not stored or the input is invalid
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nFeatureStoreScore(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jintArray jSlots,
+    jint overrideMask,
+    jfloatArray jOverrides,
+    jfloatArray jWeights,
+    jint topK
+) {
+    CandidateFeatureStore* store = storeFromHandle(handle);
+    const auto mask = static_cast<uint32_t>(overrideMask);
+    if (!store || !jSlots || !jWeights || (mask & ~ALL_FEATURES_MASK) != 0) return nullptr;
+    const int N = env->GetArrayLength(jSlots);
+    const jsize overrideCount = static_cast<jsize>(__builtin_popcount(mask)) * N;
+    if (N == 0) return env->NewIntArray(0);
+    if (env->GetArrayLength(jWeights) < NUM_WEIGHTS ||
+        (overrideCount > 0 && (!jOverrides || env->GetArrayLength(jOverrides) < overrideCount))) {
+        LOGE("Invalid score params: N=%d, overrideMask=%#x", N, mask);
+        return nullptr;
+    }
+
+    std::vector<int32_t> slots(N);
+    std::vector<float> overrides(overrideCount);
+    float weights[NUM_WEIGHTS];
+    env->GetIntArrayRegion(jSlots, 0, N, slots.data());
+    if (overrideCount > 0) env->GetFloatArrayRegion(jOverrides, 0, overrideCount, overrides.data());
+    env->GetFloatArrayRegion(jWeights, 0, NUM_WEIGHTS, weights);
+
+    std::vector<float> features(static_cast<size_t>(NUM_FEATURES) * N);
+    if (!store->gather(slots.data(), N, mask, overrides.data(), features.data())) {
+        LOGE("Score request names a slot that is not stored");
+        return nullptr;
+    }
+    const int K = std::max(0, std::min(static_cast<int>(topK), N));
+    std::vector<int> topIndices(K);
+    parallel_score_top_k(features.data(), N, weights, K, 0, nullptr, topIndices.data());
+
+    jintArray result = env->NewIntArray(K);
+    if (result) env->SetIntArrayRegion(result, 0, K, topIndices.data());
+    return result;
+}
+
+// ============================================================================
+// VECTOR INDEX (HNSW) — approximate nearest genre vectors
+// ============================================================================
+
+/**
+ * Create an empty index of dim-length vectors.
+ *
+ * @param m              Links per node and layer (2m on layer 0); more is
+ *                       better recall, more memory and slower inserts
+ * @param efConstruction Candidates considered per insert
+ * @return Handle, or 0 for an invalid dim
+ */
+JNIEXPORT jlong JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nCreateVectorIndex(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jint dim,
+    jint m,
+    jint efConstruction
+) {
+    if (dim <= 0) return 0;
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(new VectorIndex(dim, m, efConstruction)));
+}
+
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nReleaseVectorIndex(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    delete indexFromHandle(handle);
+}
+
+/**
+ * Add songs, or replace the vectors of ones already indexed.
+ *
+ * @param songIds String[N]
+ * @param vectors FloatArray [N * dim], packed
+ * @return false on invalid input or a full index
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexAdd(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jobjectArray jSongIds,
+    jfloatArray jVectors
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    std::vector<std::string> ids;
+    if (!index || !jSongIds || !jVectors || !readStringArray(env, jSongIds, ids)) return JNI_FALSE;
+    const jsize length = static_cast<jsize>(ids.size()) * index->dim();
+    if (env->GetArrayLength(jVectors) < length) return JNI_FALSE;
+    std::vector<float> vectors(length);
+    env->GetFloatArrayRegion(jVectors, 0, length, vectors.data());
+    return index->add(ids.data(), static_cast<int>(ids.size()), vectors.data()) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Remove songs from the index.
+ *
+ * @return How many of them were indexed
+ */
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexRemove(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jobjectArray jSongIds
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    std::vector<std::string> ids;
+    if (!index || !jSongIds || !readStringArray(env, jSongIds, ids)) return 0;
+    return index->remove(ids.data(), static_cast<int>(ids.size()));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexSize(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong handle
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    return index ? index->size() : 0;
+}
+
+static jobjectArray newStringArray(JNIEnv* env, const std::string* strings, int count) {
+    jclass stringClass = env->FindClass("java/lang/String");
+    if (!stringClass) return nullptr;
+    jobjectArray array = env->NewObjectArray(count, stringClass, nullptr);
+    env->DeleteLocalRef(stringClass);
+    for (int i = 0; array && i < count; i++) {
+        jstring element = env->NewStringUTF(strings[i].c_str());
+        if (!element) return nullptr;
+        env->SetObjectArrayElement(array, i, element);
+        env->DeleteLocalRef(element);
+    }
+    return array;
+}
+
+/**
+ * @return String[] — IDs of every indexed song, or null on failure
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexIds(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    if (!index) return nullptr;
+    std::vector<std::string> ids;
+    index->liveIds(ids);
+    return newStringArray(env, ids.data(), static_cast<int>(ids.size()));
+}
+
+/**
+ * Approximate k nearest songs to a query vector by cosine similarity.
+ *
+ * @param query    FloatArray [dim]
+ * @param ef       Search width (at least topK is used); higher = better recall, slower
+ * @param simsOut  Optional FloatArray [topK] — receives the similarities
+ * @return String[] of up to topK song IDs, most similar first, or null on invalid input
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexSearch(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jfloatArray jQuery,
+    jint topK,
+    jint ef,
+    jfloatArray jSimsOut
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    if (!index || !jQuery || topK < 0 || env->GetArrayLength(jQuery) < index->dim() ||
+        (jSimsOut && env->GetArrayLength(jSimsOut) < topK)) {
+        return nullptr;
+    }
+    // Bounds the allocations below whatever Java passes
+    topK = std::min(topK, index->size());
+    std::vector<float> query(index->dim());
+    env->GetFloatArrayRegion(jQuery, 0, index->dim(), query.data());
+    std::vector<std::string> ids(topK);
+    std::vector<float> sims(topK);
+    const int found = index->search(query.data(), topK, ef, ids.data(), sims.data());
+    if (jSimsOut) env->SetFloatArrayRegion(jSimsOut, 0, found, sims.data());
+    return newStringArray(env, ids.data(), found);
+}
+
+/**
+ * Like nVectorIndexSearch, restricted to a candidate list: the retrieval step
+ * before fine scoring. Candidates that are not indexed are skipped.
+ *
+ * @param songIds  String[N] — the candidates
+ * @param simsOut  Optional FloatArray [topK] — receives the similarities
+ * @return IntArray of up to topK positions in songIds, most similar first,
+ *         or null on invalid input
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexSearchAmong(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jfloatArray jQuery,
+    jobjectArray jSongIds,
+    jint topK,
+    jint ef,
+    jfloatArray jSimsOut
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    std::vector<std::string> ids;
+    if (!index || !jQuery || !jSongIds || topK < 0 || env->GetArrayLength(jQuery) < index->dim() ||
+        (jSimsOut && env->GetArrayLength(jSimsOut) < topK) || !readStringArray(env, jSongIds, ids)) {
+        return nullptr;
+    }
+    topK = std::min(topK, static_cast<jint>(ids.size()));
+    std::vector<float> query(index->dim());
+    env->GetFloatArrayRegion(jQuery, 0, index->dim(), query.data());
+    std::vector<int32_t> positions(topK);
+    std::vector<float> sims(topK);
+    const int found = index->searchAmong(query.data(), ids.data(), static_cast<int>(ids.size()), topK, ef,
+                                         positions.data(), sims.data());
+    if (jSimsOut) env->SetFloatArrayRegion(jSimsOut, 0, found, sims.data());
+    jintArray result = env->NewIntArray(found);
+    if (result) env->SetIntArrayRegion(result, 0, found, positions.data());
+    return result;
+}
+
+/**
+ * Write the index to path (atomically, via a temporary).
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexSave(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jstring jPath
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    if (!index || !jPath) return JNI_FALSE;
+    const char* path = env->GetStringUTFChars(jPath, nullptr);
+    if (!path) return JNI_FALSE;
+    const bool saved = index->save(path);
+    env->ReleaseStringUTFChars(jPath, path);
+    if (!saved) LOGE("Failed to save vector index");
+    return saved ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Replace the index's contents with a saved one of the same dim and m.
+ *
+ * @return false (index unchanged) if the file is missing, corrupt or built
+ *         with other parameters
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_suvojeet_suvmusic_recommendation_NativeRecommendationScorer_nVectorIndexLoad(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong handle,
+    jstring jPath
+) {
+    VectorIndex* index = indexFromHandle(handle);
+    if (!index || !jPath) return JNI_FALSE;
+    const char* path = env->GetStringUTFChars(jPath, nullptr);
+    if (!path) return JNI_FALSE;
+    const bool loaded = index->load(path);
+    env->ReleaseStringUTFChars(jPath, path);
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
 } // extern "C"
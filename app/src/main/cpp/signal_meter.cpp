@@ -0,0 +1,91 @@
+#include "signal_meter.h"
+#include "pcm_convert.h"
+#include <algorithm>
+#include <cmath>
+
+void SignalMeter::publish(const Accumulator& acc, int totalSamples) {
+    float rms = std::sqrt(acc.sumSquares / (float)totalSamples);
+
+    // Simple EMA (Exponential Moving Average) for smoothing
+    peakLevel.store(peakLevel.load(std::memory_order_relaxed) * 0.9f + acc.peak * 0.1f, std::memory_order_relaxed);
+    rmsLevel.store(rmsLevel.load(std::memory_order_relaxed) * 0.9f + rms * 0.1f, std::memory_order_relaxed);
+    truePeakLevel.store(truePeakLevel.load(std::memory_order_relaxed) * 0.9f + acc.truePeak * 0.1f, std::memory_order_relaxed);
+}
+
+// Sample peak, sum of squares and oversampled true peak, 64 frames at a time
+void SignalMeter::accumulate(const float* buffer, int numFrames, int numChannels, Accumulator& acc) {
+    const int totalSamples = numFrames * numChannels;
+    for (int i = 0; i < totalSamples; ++i) {
+        float absSample = std::abs(buffer[i]);
+        if (absSample > acc.peak) acc.peak = absSample;
+        acc.sumSquares += buffer[i] * buffer[i];
+    }
+
+    float framePeaks[Oversampler::BLOCK_FRAMES];
+    for (int start = 0; start < numFrames; start += Oversampler::BLOCK_FRAMES) {
+        const int frames = std::min(Oversampler::BLOCK_FRAMES, numFrames - start);
+        truePeakDetector.framePeaks(buffer + start * numChannels, frames, numChannels, framePeaks);
+        for (int i = 0; i < frames; ++i) acc.truePeak = std::max(acc.truePeak, framePeaks[i]);
+    }
+}
+
+void SignalMeter::update(const float* buffer, int numFrames, int numChannels, int sampleRate) {
+    addBlock(buffer, numFrames, numChannels, sampleRate);
+    commit();
+}
+
+void SignalMeter::addBlock(const float* buffer, int numFrames, int numChannels, int sampleRate) {
+    if (!buffer || numFrames <= 0 || numChannels <= 0) return;
+
+    truePeakDetector.setSampleRate(sampleRate);
+    accumulate(buffer, numFrames, numChannels, pending);
+    pendingSamples += numFrames * numChannels;
+}
+
+void SignalMeter::commit() {
+    if (pendingSamples > 0) publish(pending, pendingSamples);
+    pending = Accumulator();
+    pendingSamples = 0;
+}
+
+// Converts integer PCM through a small stack buffer; convert(firstSample, count, out)
+template <typename Convert>
+void SignalMeter::updateConverted(Convert convert, int numFrames, int numChannels, int sampleRate) {
+    constexpr int CHUNK_SAMPLES = Oversampler::BLOCK_FRAMES * Oversampler::MAX_CHANNELS;
+    if (numFrames <= 0 || numChannels <= 0 || numChannels > CHUNK_SAMPLES) return;
+
+    truePeakDetector.setSampleRate(sampleRate);
+    float chunk[CHUNK_SAMPLES];
+    const int chunkFrames = std::min(Oversampler::BLOCK_FRAMES, CHUNK_SAMPLES / numChannels);
+    Accumulator acc;
+    for (int start = 0; start < numFrames; start += chunkFrames) {
+        const int frames = std::min(chunkFrames, numFrames - start);
+        convert(start * numChannels, frames * numChannels, chunk);
+        accumulate(chunk, frames, numChannels, acc);
+    }
+    publish(acc, numFrames * numChannels);
+}
+
+void SignalMeter::updatePcm16(const int16_t* buffer, int numFrames, int numChannels, int sampleRate) {
+    if (!buffer) return;
+    updateConverted([buffer](int first, int count, float* out) { pcm::s16ToFloat(buffer + first, out, count); },
+                    numFrames, numChannels, sampleRate);
+}
+
+void SignalMeter::updatePcm24(const uint8_t* buffer, int numFrames, int numChannels, int sampleRate) {
+    if (!buffer) return;
+    updateConverted([buffer](int first, int count, float* out) { pcm::s24ToFloat(buffer + first * 3, out, count); },
+                    numFrames, numChannels, sampleRate);
+}
+
+void SignalMeter::updatePcm32(const int32_t* buffer, int numFrames, int numChannels, int sampleRate) {
+    if (!buffer) return;
+    updateConverted([buffer](int first, int count, float* out) { pcm::s32ToFloat(buffer + first, out, count); },
+                    numFrames, numChannels, sampleRate);
+}
+
+AudioSignalStats SignalMeter::latest() const {
+    return {peakLevel.load(std::memory_order_relaxed), rmsLevel.load(std::memory_order_relaxed),
+            truePeakLevel.load(std::memory_order_relaxed)};
+}
+
@@ -0,0 +1,57 @@
+#ifndef SIGNAL_METER_H
+#define SIGNAL_METER_H
+
+#include <atomic>
+#include <cstdint>
+#include "oversampler.h"
+
+struct AudioSignalStats {
+    float peakLevel;
+    float rmsLevel;
+    float truePeakLevel; // Linear, ITU-R BS.1770 inter-sample peak
+};
+
+/**
+ * Smoothed peak/RMS of one engine's output. Written only by that engine's
+ * render thread and read by the UI; plain atomics keep the audio path
+ * lock-free.
+ */
+class SignalMeter {
+public:
+    void update(const float* buffer, int numFrames, int numChannels, int sampleRate);
+    // Integer variants for buffers that bypass the float chain entirely
+    void updatePcm16(const int16_t* buffer, int numFrames, int numChannels, int sampleRate);
+    void updatePcm24(const uint8_t* buffer, int numFrames, int numChannels, int sampleRate);
+    void updatePcm32(const int32_t* buffer, int numFrames, int numChannels, int sampleRate);
+
+    // update() split for chains that render a callback in sub-blocks: add each
+    // block in order while it is still in cache, then commit() once, so the
+    // smoothing still advances once per callback.
+    void addBlock(const float* buffer, int numFrames, int numChannels, int sampleRate);
+    void commit();
+
+    AudioSignalStats latest() const;
+
+private:
+    struct Accumulator {
+        float peak = 0.0f;
+        float truePeak = 0.0f;
+        float sumSquares = 0.0f;
+    };
+
+    std::atomic<float> peakLevel{0.0f};
+    std::atomic<float> rmsLevel{0.0f};
+    std::atomic<float> truePeakLevel{0.0f};
+
+    // Render thread only
+    Oversampler truePeakDetector;
+    Accumulator pending;
+    int pendingSamples = 0;
+
+    void accumulate(const float* buffer, int numFrames, int numChannels, Accumulator& acc);
+    template <typename Convert>
+    void updateConverted(Convert convert, int numFrames, int numChannels, int sampleRate);
+    void publish(const Accumulator& acc, int totalSamples);
+};
+
+#endif // SIGNAL_METER_H
@@ -4,37 +4,29 @@
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
-#include <mutex>
 #include "limiter.h"
 #include "biquad.h"
 #include "pitch_shifter.h"
 #include "spatial_audio_bridge.h"
 #include "audio_engine_components.h"
 #include "ai_audio_processor.h"
+#include "audio_engine.h"
+#include "dsp_profiler.h"
+#include "hrir_set.h"
+#include "pcm_convert.h"
+#include "time_stretcher.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-static Spatializer spatializer;
-static Limiter limiter;
-static Crossfeed crossfeed;
-static ParametricEQ equalizer;
-static BassBoost bassBoost;
-static Virtualizer virtualizer;
-static PitchShifter pitchShifter;
-static std::vector<float> processingBuffer;
-static std::mutex processingMutex;
+// Backs the legacy handle-less calls used by the main player
+static AudioEngine defaultEngine;
 
-static constexpr int MAX_TOTAL_SAMPLES = 48000 * 8; // max 48kHz * 8 channels = 1 second cap
-
-extern "C"
-JNIEXPORT void JNICALL
-Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nApplyAIState(JNIEnv *env, jobject thiz, 
-    jboolean eqEnabled, jfloatArray eqBands, jfloat bassBoost, jfloat virtualizer, 
-    jboolean spatialEnabled, jboolean crossfeedEnabled, 
-    jfloat limiterThreshold, jfloat limiterRatio, jfloat limiterAttack, jfloat limiterRelease, jfloat limiterGain) {
-    
+static AIAudioState buildState(JNIEnv *env, jboolean eqEnabled, jfloatArray eqBands, jfloat bassBoost, jfloat virtualizer,
+                               jboolean spatialEnabled, jboolean crossfeedEnabled,
+                               jfloat limiterThreshold, jfloat limiterRatio, jfloat limiterAttack,
+                               jfloat limiterRelease, jfloat limiterGain) {
     AIAudioState state;
     state.eqEnabled = eqEnabled;
     state.bassBoost = bassBoost;
@@ -53,20 +45,132 @@ Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nApplyAIState(JNIEnv *env,
         state.eqBands[i] = bands[i];
     }
     env->ReleaseFloatArrayElements(eqBands, bands, JNI_ABORT);
+    return state;
+}
 
-    AIAudioProcessor::applyState(state);
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nApplyAIState(JNIEnv *env, jobject thiz, 
+    jboolean eqEnabled, jfloatArray eqBands, jfloat bassBoost, jfloat virtualizer, 
+    jboolean spatialEnabled, jboolean crossfeedEnabled, 
+    jfloat limiterThreshold, jfloat limiterRatio, jfloat limiterAttack, jfloat limiterRelease, jfloat limiterGain) {
+    
+    AIAudioState state = buildState(env, eqEnabled, eqBands, bassBoost, virtualizer, spatialEnabled, crossfeedEnabled,
+                                    limiterThreshold, limiterRatio, limiterAttack, limiterRelease, limiterGain);
+    AIAudioProcessor::applyState(defaultEngine, state);
 }
 
 extern "C"
 JNIEXPORT jfloat JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetPeakLevel(JNIEnv *env, jobject thiz) {
-    return AIAudioProcessor::getLatestStats().peakLevel;
+    return defaultEngine.meter().latest().peakLevel;
 }
 
 extern "C"
 JNIEXPORT jfloat JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetRmsLevel(JNIEnv *env, jobject thiz) {
-    return AIAudioProcessor::getLatestStats().rmsLevel;
+    return defaultEngine.meter().latest().rmsLevel;
+}
+
+/**
+ * Smoothed inter-sample peak (linear, ITU-R BS.1770 oversampling); convert
+ * with 20 * log10 for dBTP.
+ */
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetTruePeakLevel(JNIEnv *env, jobject thiz) {
+    return defaultEngine.meter().latest().truePeakLevel;
+}
+
+/**
+ * EBU R128 loudness of the engine's input as
+ * [momentary LUFS, short-term LUFS, integrated LUFS, LRA in LU, seconds measured].
+ * Loudness is -infinity until enough audio has been seen.
+ */
+static jfloatArray loudnessArray(JNIEnv *env, const LoudnessStats& stats) {
+    const jfloat values[] = {stats.momentaryLufs, stats.shortTermLufs, stats.integratedLufs,
+                             stats.loudnessRangeLu, stats.measuredSeconds};
+    jfloatArray result = env->NewFloatArray(5);
+    if (result != nullptr) env->SetFloatArrayRegion(result, 0, 5, values);
+    return result;
+}
+
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetLoudness(JNIEnv *env, jobject thiz) {
+    return loudnessArray(env, defaultEngine.loudness().latest());
+}
+
+/**
+ * Starts a new integrated measurement (e.g. at a track change) from the next
+ * rendered buffer.
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nResetLoudness(JNIEnv *env, jobject thiz) {
+    defaultEngine.loudness().requestReset();
+}
+
+/**
+ * Validates a direct PCM buffer and returns its address, or nullptr if the
+ * call should be ignored. Also rejects buffers too small for the frame count.
+ */
+static void* getPcmBuffer(JNIEnv *env, jobject buffer, jint frameCount, jint channelCount,
+                          int bytesPerSample) {
+    if (buffer == nullptr || frameCount <= 0 || channelCount <= 0) {
+        return nullptr;
+    }
+
+    void *pcmData = env->GetDirectBufferAddress(buffer);
+    if (pcmData == nullptr) {
+        return nullptr;
+    }
+
+    const int64_t totalSamples = static_cast<int64_t>(frameCount) * channelCount;
+    if (env->GetDirectBufferCapacity(buffer) < totalSamples * bytesPerSample) {
+        return nullptr;
+    }
+    return pcmData;
+}
+
+// Media3 C.ENCODING_* values accepted by nProcess
+static constexpr jint ENCODING_PCM_16BIT = 2;
+static constexpr jint ENCODING_PCM_FLOAT = 4;
+static constexpr jint ENCODING_PCM_24BIT = 0x15;
+static constexpr jint ENCODING_PCM_32BIT = 0x16;
+
+/**
+ * Dispatches one buffer to an engine by encoding. Lock-free: components read
+ * wait-free parameter snapshots, and each engine's DSP state is owned by the
+ * single thread that renders it.
+ */
+static void processBuffer(JNIEnv *env, AudioEngine& engine, jobject buffer, jint encoding,
+                          jint frameCount, jint channelCount, jint sampleRate,
+                          jfloat azimuth, jfloat elevation) {
+    switch (encoding) {
+        case ENCODING_PCM_16BIT: {
+            auto *pcmData = static_cast<int16_t *>(getPcmBuffer(env, buffer, frameCount, channelCount, 2));
+            if (pcmData) engine.processPcm16(pcmData, frameCount, channelCount, sampleRate, azimuth, elevation);
+            break;
+        }
+        case ENCODING_PCM_24BIT: {
+            auto *pcmData = static_cast<uint8_t *>(getPcmBuffer(env, buffer, frameCount, channelCount, 3));
+            if (pcmData) engine.processPcm24(pcmData, frameCount, channelCount, sampleRate, azimuth, elevation);
+            break;
+        }
+        case ENCODING_PCM_32BIT: {
+            auto *pcmData = static_cast<int32_t *>(getPcmBuffer(env, buffer, frameCount, channelCount, 4));
+            if (pcmData) engine.processPcm32(pcmData, frameCount, channelCount, sampleRate, azimuth, elevation);
+            break;
+        }
+        case ENCODING_PCM_FLOAT: {
+            auto *floatData = static_cast<float *>(getPcmBuffer(env, buffer, frameCount, channelCount, 4));
+            if (floatData) engine.processFloat(floatData, frameCount, channelCount, sampleRate, azimuth, elevation);
+            break;
+        }
+        default:
+            break;
+    }
 }
 
 extern "C"
@@ -78,112 +182,427 @@ Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nProcessPcm16(JNIEnv *env,
                                                                    jint sampleRate,
                                                                    jfloat azimuth,
                                                                    jfloat elevation) {
-    if (buffer == nullptr || frameCount <= 0 || channelCount <= 0) {
-        return;
-    }
+    processBuffer(env, defaultEngine, buffer, ENCODING_PCM_16BIT, frameCount, channelCount, sampleRate, azimuth, elevation);
+}
 
-    auto *pcmData = static_cast<int16_t *>(env->GetDirectBufferAddress(buffer));
-    if (pcmData == nullptr) {
-        return;
-    }
+/**
+ * Packed little-endian 24-bit PCM (Media3 C.ENCODING_PCM_24BIT).
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nProcessPcm24(JNIEnv *env, jobject thiz,
+                                                                   jobject buffer,
+                                                                   jint frameCount,
+                                                                   jint channelCount,
+                                                                   jint sampleRate,
+                                                                   jfloat azimuth,
+                                                                   jfloat elevation) {
+    processBuffer(env, defaultEngine, buffer, ENCODING_PCM_24BIT, frameCount, channelCount, sampleRate, azimuth, elevation);
+}
+
+/**
+ * 32-bit integer PCM (Media3 C.ENCODING_PCM_32BIT).
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nProcessPcm32(JNIEnv *env, jobject thiz,
+                                                                   jobject buffer,
+                                                                   jint frameCount,
+                                                                   jint channelCount,
+                                                                   jint sampleRate,
+                                                                   jfloat azimuth,
+                                                                   jfloat elevation) {
+    processBuffer(env, defaultEngine, buffer, ENCODING_PCM_32BIT, frameCount, channelCount, sampleRate, azimuth, elevation);
+}
+
+/**
+ * 32-bit float PCM (Media3 C.ENCODING_PCM_FLOAT), processed without conversion.
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nProcessFloat(JNIEnv *env, jobject thiz,
+                                                                   jobject buffer,
+                                                                   jint frameCount,
+                                                                   jint channelCount,
+                                                                   jint sampleRate,
+                                                                   jfloat azimuth,
+                                                                   jfloat elevation) {
+    processBuffer(env, defaultEngine, buffer, ENCODING_PCM_FLOAT, frameCount, channelCount, sampleRate, azimuth, elevation);
+}
+
+// ============================================================================
+// Engine handles: independent chains for crossfades and preview players
+// ============================================================================
+
+static AudioEngine* fromHandle(jlong handle) {
+    return reinterpret_cast<AudioEngine*>(static_cast<intptr_t>(handle));
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nCreateEngine(JNIEnv *env, jobject thiz) {
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(new AudioEngine()));
+}
 
-    const int totalSamples = frameCount * channelCount;
-    if (totalSamples <= 0 || totalSamples > MAX_TOTAL_SAMPLES) {
-        return;
+/**
+ * The caller must guarantee no nProcess call on this handle is in flight.
+ */
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nDestroyEngine(JNIEnv *env, jobject thiz, jlong handle) {
+    delete fromHandle(handle);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nProcess(JNIEnv *env, jobject thiz,
+                                                              jlong handle,
+                                                              jobject buffer,
+                                                              jint encoding,
+                                                              jint frameCount,
+                                                              jint channelCount,
+                                                              jint sampleRate,
+                                                              jfloat azimuth,
+                                                              jfloat elevation) {
+    AudioEngine *engine = fromHandle(handle);
+    if (engine == nullptr) return;
+    processBuffer(env, *engine, buffer, encoding, frameCount, channelCount, sampleRate, azimuth, elevation);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineApplyAIState(JNIEnv *env, jobject thiz, jlong handle,
+    jboolean eqEnabled, jfloatArray eqBands, jfloat bassBoost, jfloat virtualizer,
+    jboolean spatialEnabled, jboolean crossfeedEnabled,
+    jfloat limiterThreshold, jfloat limiterRatio, jfloat limiterAttack, jfloat limiterRelease, jfloat limiterGain) {
+    AudioEngine *engine = fromHandle(handle);
+    if (engine == nullptr) return;
+
+    AIAudioState state = buildState(env, eqEnabled, eqBands, bassBoost, virtualizer, spatialEnabled, crossfeedEnabled,
+                                    limiterThreshold, limiterRatio, limiterAttack, limiterRelease, limiterGain);
+    AIAudioProcessor::applyState(*engine, state);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineSetPlaybackParams(JNIEnv *env, jobject thiz, jlong handle,
+                                                                              jfloat pitch) {
+    AudioEngine *engine = fromHandle(handle);
+    if (engine != nullptr) engine->pitchShifter().setParams(pitch);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineReset(JNIEnv *env, jobject thiz, jlong handle) {
+    AudioEngine *engine = fromHandle(handle);
+    if (engine != nullptr) engine->reset();
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineGetPeakLevel(JNIEnv *env, jobject thiz, jlong handle) {
+    AudioEngine *engine = fromHandle(handle);
+    return engine != nullptr ? engine->meter().latest().peakLevel : 0.0f;
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineGetTruePeakLevel(JNIEnv *env, jobject thiz, jlong handle) {
+    AudioEngine *engine = fromHandle(handle);
+    return engine != nullptr ? engine->meter().latest().truePeakLevel : 0.0f;
+}
+
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineGetLoudness(JNIEnv *env, jobject thiz, jlong handle) {
+    AudioEngine *engine = fromHandle(handle);
+    return engine != nullptr ? loudnessArray(env, engine->loudness().latest()) : nullptr;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineResetLoudness(JNIEnv *env, jobject thiz, jlong handle) {
+    AudioEngine *engine = fromHandle(handle);
+    if (engine != nullptr) engine->loudness().requestReset();
+}
+
+// ============================================================================
+// DSP profiling: per-stage timing and callback budget, off by default
+// ============================================================================
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetDspProfilingEnabled(JNIEnv *env, jobject thiz, jboolean enabled) {
+    g_dspProfilingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * Copies an engine's profile (DspProfiler::snapshot layout) without touching
+ * the render thread; reset clears it from the next callback on.
+ */
+static jlongArray profileSnapshot(JNIEnv *env, AudioEngine& engine, jboolean reset) {
+    jlong values[DspProfiler::SNAPSHOT_LONGS];
+    engine.profiler().snapshot(reinterpret_cast<int64_t*>(values));
+    if (reset) engine.profiler().requestReset();
+
+    jlongArray result = env->NewLongArray(DspProfiler::SNAPSHOT_LONGS);
+    if (result != nullptr) env->SetLongArrayRegion(result, 0, DspProfiler::SNAPSHOT_LONGS, values);
+    return result;
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetDspProfile(JNIEnv *env, jobject thiz, jboolean reset) {
+    return profileSnapshot(env, defaultEngine, reset);
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nEngineGetDspProfile(JNIEnv *env, jobject thiz, jlong handle,
+                                                                          jboolean reset) {
+    AudioEngine *engine = fromHandle(handle);
+    return engine != nullptr ? profileSnapshot(env, *engine, reset) : nullptr;
+}
+
+// ============================================================================
+// Time stretch: variable-length tempo/pitch streams for the Media3 processor
+// ============================================================================
+
+static TimeStretcher* stretcherFromHandle(jlong handle) {
+    return reinterpret_cast<TimeStretcher*>(static_cast<intptr_t>(handle));
+}
+
+static int bytesPerSample(jint encoding) {
+    switch (encoding) {
+        case ENCODING_PCM_16BIT: return 2;
+        case ENCODING_PCM_24BIT: return 3;
+        case ENCODING_PCM_32BIT:
+        case ENCODING_PCM_FLOAT: return 4;
+        default: return 0;
     }
+}
 
-    std::lock_guard<std::mutex> lock(processingMutex);
+/**
+ * Address of frame 'offsetFrames' in a direct buffer that must hold
+ * 'frames' more frames, or nullptr.
+ */
+static uint8_t* stretchBuffer(JNIEnv *env, jobject buffer, jint offsetFrames, jint frames, int frameBytes) {
+    if (buffer == nullptr || offsetFrames < 0 || frames <= 0 || frameBytes <= 0) return nullptr;
+    auto *base = static_cast<uint8_t *>(env->GetDirectBufferAddress(buffer));
+    if (base == nullptr) return nullptr;
+    const int64_t end = (static_cast<int64_t>(offsetFrames) + frames) * frameBytes;
+    if (env->GetDirectBufferCapacity(buffer) < end) return nullptr;
+    return base + static_cast<int64_t>(offsetFrames) * frameBytes;
+}
+
+// Integer PCM goes through a stack chunk; float is handed over directly
+static constexpr int STRETCH_CHUNK_SAMPLES = 4096;
 
-    if (processingBuffer.size() < static_cast<size_t>(totalSamples)) {
-        processingBuffer.resize(static_cast<size_t>(totalSamples));
+static void toFloat(const uint8_t* in, jint encoding, float* out, int samples) {
+    switch (encoding) {
+        case ENCODING_PCM_16BIT: pcm::s16ToFloat(reinterpret_cast<const int16_t *>(in), out, samples); break;
+        case ENCODING_PCM_24BIT: pcm::s24ToFloat(in, out, samples); break;
+        case ENCODING_PCM_32BIT: pcm::s32ToFloat(reinterpret_cast<const int32_t *>(in), out, samples); break;
+        default: break;
     }
+}
 
-    float *floatData = processingBuffer.data();
-    for (int i = 0; i < totalSamples; ++i) {
-        floatData[i] = static_cast<float>(pcmData[i]) / 32768.0f;
+static void fromFloat(const float* in, jint encoding, uint8_t* out, int samples) {
+    switch (encoding) {
+        case ENCODING_PCM_16BIT: pcm::floatToS16(in, reinterpret_cast<int16_t *>(out), samples); break;
+        case ENCODING_PCM_24BIT: pcm::floatToS24(in, out, samples); break;
+        case ENCODING_PCM_32BIT: pcm::floatToS32(in, reinterpret_cast<int32_t *>(out), samples); break;
+        default: break;
     }
+}
 
-    crossfeed.process(floatData, frameCount, channelCount, sampleRate);
-    equalizer.process(floatData, frameCount, channelCount, sampleRate);
-    bassBoost.process(floatData, frameCount, channelCount);
-    virtualizer.process(floatData, frameCount, channelCount);
-    pitchShifter.process(floatData, frameCount, channelCount);
-    spatializer.process(floatData, frameCount, channelCount, azimuth, elevation, sampleRate);
-    limiter.process(floatData, frameCount, channelCount, sampleRate);
+/**
+ * Returns 0 if the format is outside what the stretcher supports
+ * (1..16 channels, 8..192 kHz).
+ */
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nCreateTimeStretcher(JNIEnv *env, jobject thiz,
+                                                                          jint channelCount, jint sampleRate) {
+    if (channelCount <= 0 || channelCount > 16 || sampleRate < 8000 || sampleRate > 192000) return 0;
+    auto *stretcher = new TimeStretcher(channelCount, sampleRate);
+    stretcher->setFormat(channelCount, sampleRate);
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(stretcher));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nDestroyTimeStretcher(JNIEnv *env, jobject thiz, jlong handle) {
+    delete stretcherFromHandle(handle);
+}
 
-    // AI Analyzer - Direct signal feedback
-    AIAudioProcessor::updateStats(floatData, frameCount, channelCount);
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nTimeStretcherSetParams(JNIEnv *env, jobject thiz, jlong handle,
+                                                                             jfloat tempo, jfloat pitch, jboolean speech) {
+    TimeStretcher *stretcher = stretcherFromHandle(handle);
+    if (stretcher == nullptr) return;
+    stretcher->setParams(tempo, pitch, speech ? TimeStretcher::Mode::Speech : TimeStretcher::Mode::Music);
+}
 
-    for (int i = 0; i < totalSamples; ++i) {
-        float sample = std::max(-1.0f, std::min(1.0f, floatData[i]));
-        pcmData[i] = static_cast<int16_t>(sample * 32767.0f);
+/**
+ * Feeds up to frameCount frames starting at frame offsetFrames of a direct
+ * buffer. Returns the number of frames taken; drain with
+ * nTimeStretcherReceive and call again for the rest.
+ */
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nTimeStretcherPut(JNIEnv *env, jobject thiz, jlong handle,
+                                                                       jobject buffer, jint offsetFrames,
+                                                                       jint frameCount, jint encoding) {
+    TimeStretcher *stretcher = stretcherFromHandle(handle);
+    if (stretcher == nullptr) return 0;
+    const int channels = stretcher->channels();
+    const int sampleBytes = bytesPerSample(encoding);
+    uint8_t *data = stretchBuffer(env, buffer, offsetFrames, frameCount, sampleBytes * channels);
+    if (data == nullptr) return 0;
+
+    if (encoding == ENCODING_PCM_FLOAT) {
+        return stretcher->put(reinterpret_cast<const float *>(data), frameCount);
     }
+    float chunk[STRETCH_CHUNK_SAMPLES];
+    const int chunkFrames = STRETCH_CHUNK_SAMPLES / channels;
+    int taken = 0;
+    while (taken < frameCount) {
+        const int n = std::min(chunkFrames, frameCount - taken);
+        toFloat(data + static_cast<size_t>(taken) * channels * sampleBytes, encoding, chunk, n * channels);
+        const int accepted = stretcher->put(chunk, n);
+        taken += accepted;
+        if (accepted < n) break;
+    }
+    return taken;
+}
+
+/**
+ * Writes up to maxFrames frames at frame offsetFrames of a direct buffer.
+ * Returns the number written.
+ */
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nTimeStretcherReceive(JNIEnv *env, jobject thiz, jlong handle,
+                                                                           jobject buffer, jint offsetFrames,
+                                                                           jint maxFrames, jint encoding) {
+    TimeStretcher *stretcher = stretcherFromHandle(handle);
+    if (stretcher == nullptr) return 0;
+    const int channels = stretcher->channels();
+    const int sampleBytes = bytesPerSample(encoding);
+    uint8_t *data = stretchBuffer(env, buffer, offsetFrames, maxFrames, sampleBytes * channels);
+    if (data == nullptr) return 0;
+
+    if (encoding == ENCODING_PCM_FLOAT) {
+        return stretcher->receive(reinterpret_cast<float *>(data), maxFrames);
+    }
+    float chunk[STRETCH_CHUNK_SAMPLES];
+    const int chunkFrames = STRETCH_CHUNK_SAMPLES / channels;
+    int written = 0;
+    while (written < maxFrames) {
+        const int n = stretcher->receive(chunk, std::min(chunkFrames, maxFrames - written));
+        if (n == 0) break;
+        fromFloat(chunk, encoding, data + static_cast<size_t>(written) * channels * sampleBytes, n * channels);
+        written += n;
+    }
+    return written;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nTimeStretcherFlush(JNIEnv *env, jobject thiz, jlong handle) {
+    TimeStretcher *stretcher = stretcherFromHandle(handle);
+    if (stretcher != nullptr) stretcher->flush();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nTimeStretcherClear(JNIEnv *env, jobject thiz, jlong handle) {
+    TimeStretcher *stretcher = stretcherFromHandle(handle);
+    if (stretcher != nullptr) stretcher->clear();
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetEqEnabled(JNIEnv *env, jobject thiz, jboolean enabled) {
-    equalizer.setEnabled(enabled);
+    defaultEngine.equalizer().setEnabled(enabled);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetEqBand(JNIEnv *env, jobject thiz, jint bandIndex, jfloat gainDb) {
-    equalizer.setBandGain(bandIndex, gainDb);
+    defaultEngine.equalizer().setBandGain(bandIndex, gainDb);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetEqPreamp(JNIEnv *env, jobject thiz, jfloat gainDb) {
-    equalizer.setPreamp(gainDb);
+    defaultEngine.equalizer().setPreamp(gainDb);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetBassBoost(JNIEnv *env, jobject thiz, jfloat strength) {
-    bassBoost.setStrength(strength);
+    defaultEngine.bassBoost().setStrength(strength);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetVirtualizer(JNIEnv *env, jobject thiz, jfloat strength) {
-    virtualizer.setStrength(strength);
+    defaultEngine.virtualizer().setStrength(strength);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetCrossfeedParams(JNIEnv *env, jobject thiz, jboolean enabled, jfloat strength) {
-    crossfeed.setParams(enabled, strength);
+    defaultEngine.crossfeed().setParams(enabled, strength);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetPlaybackParams(JNIEnv *env, jobject thiz, jfloat pitch) {
-    pitchShifter.setParams(pitch, 44100);
+    defaultEngine.pitchShifter().setParams(pitch);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nReset(JNIEnv *env, jobject thiz) {
-    spatializer.reset();
-    limiter.reset();
-    crossfeed.reset();
-    equalizer.reset();
-    bassBoost.reset();
-    virtualizer.reset();
-    pitchShifter.reset();
+    defaultEngine.reset();
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetSpatializerEnabled(JNIEnv *env, jobject thiz, jboolean enabled) {
-    spatializer.setEnabled(enabled);
+    defaultEngine.spatializer().setEnabled(enabled);
+}
+
+/**
+ * Maps an HRIR set (see hrir_set.h for the file layout) and makes it the
+ * active one for every engine. Returns false if the file is missing or
+ * malformed, leaving the current set in place.
+ */
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nLoadHrtf(JNIEnv *env, jobject thiz, jstring path) {
+    if (path == nullptr) return JNI_FALSE;
+    const char *nativePath = env->GetStringUTFChars(path, nullptr);
+    if (nativePath == nullptr) return JNI_FALSE;
+    bool loaded = HrirLibrary::instance().load(nativePath);
+    env->ReleaseStringUTFChars(path, nativePath);
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nUseBuiltInHrtf(JNIEnv *env, jobject thiz) {
+    HrirLibrary::instance().useBuiltIn();
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetLimiterEnabled(JNIEnv *env, jobject thiz, jboolean enabled) {
-    limiter.setEnabled(enabled);
+    defaultEngine.limiter().setEnabled(enabled);
 }
 
 extern "C"
@@ -192,48 +611,55 @@ Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetLimiterParams(JNIEnv *e
                                                                        jfloat thresholdDb, jfloat ratio, 
                                                                        jfloat attackMs, jfloat releaseMs, 
                                                                        jfloat makeupGainDb) {
-    limiter.setParams(thresholdDb, ratio, attackMs, releaseMs, makeupGainDb);
+    defaultEngine.limiter().setParams(thresholdDb, ratio, attackMs, releaseMs, makeupGainDb);
 }
 
 extern "C"
 JNIEXPORT void JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetLimiterBalance(JNIEnv *env, jobject thiz, jfloat balance) {
-    limiter.setBalance(balance);
+    defaultEngine.limiter().setBalance(balance);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nSetLimiterTruePeak(JNIEnv *env, jobject thiz, jboolean enabled) {
+    defaultEngine.limiter().setTruePeakEnabled(enabled);
 }
 
 extern "C"
 JNIEXPORT jfloat JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetEqBand(JNIEnv *env, jobject thiz, jint index) {
-    return equalizer.getBandGain(index);
+    return defaultEngine.equalizer().getBandGain(index);
 }
 
 extern "C"
 JNIEXPORT jboolean JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nIsEqEnabled(JNIEnv *env, jobject thiz) {
-    return equalizer.isEnabled();
+    return defaultEngine.equalizer().isEnabled();
 }
 
 extern "C"
 JNIEXPORT jfloat JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetBassBoost(JNIEnv *env, jobject thiz) {
-    return bassBoost.getStrength();
+    return defaultEngine.bassBoost().getStrength();
 }
 
 extern "C"
 JNIEXPORT jfloat JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nGetVirtualizer(JNIEnv *env, jobject thiz) {
-    return virtualizer.getStrength();
+    return defaultEngine.virtualizer().getStrength();
 }
 
 extern "C"
 JNIEXPORT jboolean JNICALL
 Java_com_suvojeet_suvmusic_player_NativeSpatialAudio_nIsSpatializerEnabled(JNIEnv *env, jobject thiz) {
-    return spatializer.isEnabled();
+    return defaultEngine.spatializer().isEnabled();
 }
 
-ParametricEQ& getEngineEqualizer() { return equalizer; }
-BassBoost& getEngineBassBoost() { return bassBoost; }
-Virtualizer& getEngineVirtualizer() { return virtualizer; }
-Spatializer& getEngineSpatializer() { return spatializer; }
-Crossfeed& getEngineCrossfeed() { return crossfeed; }
-Limiter& getEngineLimiter() { return limiter; }
+AudioEngine& getDefaultEngine() { return defaultEngine; }
+ParametricEQ& getEngineEqualizer() { return defaultEngine.equalizer(); }
+BassBoost& getEngineBassBoost() { return defaultEngine.bassBoost(); }
+Virtualizer& getEngineVirtualizer() { return defaultEngine.virtualizer(); }
+Spatializer& getEngineSpatializer() { return defaultEngine.spatializer(); }
+Crossfeed& getEngineCrossfeed() { return defaultEngine.crossfeed(); }
+Limiter& getEngineLimiter() { return defaultEngine.limiter(); }
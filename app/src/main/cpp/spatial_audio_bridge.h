@@ -3,6 +3,11 @@
 
 #include "audio_engine_components.h"
 
+class AudioEngine;
+
+// The engine behind the legacy (handle-less) NativeSpatialAudio calls
+AudioEngine& getDefaultEngine();
+
 ParametricEQ& getEngineEqualizer();
 BassBoost& getEngineBassBoost();
 Virtualizer& getEngineVirtualizer();
@@ -0,0 +1,552 @@
+#include "time_stretcher.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TIME_STRETCHER_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TIME_STRETCHER_SSE2 1
+#endif
+
+namespace {
+
+constexpr float TWO_PI = 6.283185307f;
+constexpr float SPEECH_SEGMENT_SECONDS = 0.024f;
+constexpr float SPEECH_SEARCH_SECONDS = 0.008f;
+constexpr int SPEECH_SEARCH_RATE = 12000; // coarse correlation runs at about this rate
+constexpr int PV_SIZES[3] = {2048, 4096, 8192};
+
+// FFT size giving ~43 ms frames at the stream rate
+int musicFrameLength(int sampleRate) {
+    if (sampleRate <= 56000) return PV_SIZES[0];
+    if (sampleRate <= 112000) return PV_SIZES[1];
+    return PV_SIZES[2];
+}
+
+int speechFrameLength(int sampleRate) {
+    return 2 * static_cast<int>(std::lround(sampleRate * SPEECH_SEGMENT_SECONDS / 2.0f));
+}
+
+int speechSearchRadius(int sampleRate) {
+    return static_cast<int>(std::lround(sampleRate * SPEECH_SEARCH_SECONDS));
+}
+
+// Periodic Hann; analysis and synthesis both apply it
+void hannWindow(float* window, int length) {
+    for (int i = 0; i < length; ++i) window[i] = 0.5f - 0.5f * std::cos(TWO_PI * i / length);
+}
+
+// Same, by the cosine recurrence cos((i+1)t) = 2 cos(t) cos(it) - cos((i-1)t):
+// one libm call instead of one per sample, for lengths set on the render thread
+void hannWindowRecurrence(float* window, int length) {
+    const double twoCos = 2.0 * std::cos(2.0 * M_PI / length);
+    double previous = std::cos(2.0 * M_PI / length); // cos(-t)
+    double current = 1.0;
+    for (int i = 0; i < length; ++i) {
+        window[i] = static_cast<float>(0.5 - 0.5 * current);
+        const double next = twoCos * current - previous;
+        previous = current;
+        current = next;
+    }
+}
+
+inline float principalArgument(float x) {
+    return x - TWO_PI * std::nearbyint(x / TWO_PI);
+}
+
+float dot(const float* a, const float* b, int n) {
+    int i = 0;
+    float sum = 0.0f;
+#if TIME_STRETCHER_NEON
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum = vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1) + vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3);
+#elif TIME_STRETCHER_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+} // namespace
+
+TimeStretcher::TimeStretcher(int maxChannels, int maxSampleRate)
+    : params(Params{1.0f, 1.0f, Mode::Music}), activeMode(Mode::Music),
+      maxChannels(std::max(1, maxChannels)), maxRate(std::max(8000, maxSampleRate)),
+      numChannels(std::max(1, std::min(2, maxChannels))), rate(std::min(48000, maxRate)),
+      frameLength(0), hop(0), searchRadius(0), decimation(1), fft(nullptr) {
+    maxFrameLength = std::max(musicFrameLength(maxRate), speechFrameLength(maxRate));
+    const int maxHop = maxFrameLength / 2;
+    const int maxRadius = speechSearchRadius(maxRate);
+
+    // Analysis can run up to 4 frames ahead per hop (speed 8); see compactInput()
+    inCapacity = 8 * maxFrameLength + 2 * maxRadius;
+    midCapacity = maxHop + 8;
+    outCapacity = 2 * (static_cast<int>(maxHop / MIN_PITCH) + 8) + 4096;
+
+    input.assign(static_cast<size_t>(this->maxChannels) * inCapacity, 0.0f);
+    ola.assign(static_cast<size_t>(this->maxChannels) * maxFrameLength, 0.0f);
+    olaNorm.assign(maxFrameLength, 0.0f);
+    window.assign(maxFrameLength, 0.0f);
+    mid.assign(static_cast<size_t>(this->maxChannels) * midCapacity, 0.0f);
+    output.assign(static_cast<size_t>(this->maxChannels) * outCapacity, 0.0f);
+
+    const int maxBins = musicFrameLength(maxRate) / 2 + 1;
+    for (int i = 0; i < 3 && PV_SIZES[i] <= musicFrameLength(maxRate); ++i) {
+        ffts[i].reset(new RealFft(PV_SIZES[i]));
+        musicWindows[i].resize(PV_SIZES[i]);
+        hannWindow(musicWindows[i].data(), PV_SIZES[i]);
+    }
+    specRe.assign(static_cast<size_t>(this->maxChannels) * maxBins, 0.0f);
+    specIm.assign(static_cast<size_t>(this->maxChannels) * maxBins, 0.0f);
+    magnitude.assign(maxBins, 0.0f);
+    phase.assign(maxBins, 0.0f);
+    prevAnalysisPhase.assign(maxBins, 0.0f);
+    prevSynthesisPhase.assign(maxBins, 0.0f);
+    rotationCos.assign(maxBins, 1.0f);
+    rotationSin.assign(maxBins, 0.0f);
+    peaks.assign(maxBins, 0);
+    timeScratch.assign(maxFrameLength, 0.0f);
+
+    monoTemplate.assign(2 * maxFrameLength + 8, 0.0f);
+    monoSearch.assign(2 * (maxFrameLength + 2 * maxRadius) + 8, 0.0f);
+
+    configureGeometry();
+    std::fill(input.begin(), input.end(), 0.0f);
+    std::fill(ola.begin(), ola.end(), 0.0f);
+    std::fill(mid.begin(), mid.end(), 0.0f);
+    clear();
+}
+
+void TimeStretcher::setParams(float tempo, float pitch, Mode mode) {
+    params.update([&](Params& p) {
+        p.tempo = std::max(MIN_TEMPO, std::min(MAX_TEMPO, tempo));
+        p.pitch = std::max(MIN_PITCH, std::min(MAX_PITCH, pitch));
+        p.mode = mode;
+    });
+}
+
+bool TimeStretcher::setFormat(int channels, int sampleRate) {
+    if (channels <= 0 || channels > maxChannels || sampleRate < 8000 || sampleRate > maxRate) {
+        return false;
+    }
+    numChannels = channels;
+    rate = sampleRate;
+    configureGeometry();
+    clear();
+    return true;
+}
+
+void TimeStretcher::configureGeometry() {
+    if (activeMode == Mode::Music) {
+        frameLength = musicFrameLength(rate);
+        hop = frameLength / 4;
+        searchRadius = 0;
+        decimation = 1;
+        fft = nullptr;
+        for (int i = 0; i < 3; ++i) {
+            if (ffts[i] && ffts[i]->size() == frameLength) {
+                fft = ffts[i].get();
+                std::copy(musicWindows[i].begin(), musicWindows[i].end(), window.begin());
+            }
+        }
+    } else {
+        frameLength = speechFrameLength(rate);
+        hop = frameLength / 2;
+        searchRadius = speechSearchRadius(rate);
+        decimation = std::max(1, rate / SPEECH_SEARCH_RATE);
+        hannWindowRecurrence(window.data(), frameLength);
+    }
+}
+
+// Only what the next frames can read is zeroed: every buffer is read below
+// its fill level alone, so clearing costs channels x frameLength, not the
+// capacity of the maximum format.
+void TimeStretcher::clear() {
+    // Half a frame of silence in front centres the first frame on the first
+    // input sample; the matching half frame of output is dropped.
+    inFill = frameLength / 2;
+    analysisPos = 0.0;
+    dropFrames = frameLength / 2;
+    midFill = 1; // one sample of history for the interpolator
+    resamplePos = 1.0;
+    for (int c = 0; c < numChannels; ++c) {
+        std::fill(channelInput(c), channelInput(c) + inFill, 0.0f);
+        std::fill(channelOla(c), channelOla(c) + frameLength, 0.0f);
+        std::fill(channelMid(c), channelMid(c) + midFill, 0.0f);
+    }
+    std::fill(olaNorm.begin(), olaNorm.begin() + frameLength, 0.0f);
+
+    outRead = 0;
+    outFill = 0;
+    expectedOutput = 0.0;
+    producedOutput = 0.0;
+    draining = false;
+    drained = false;
+
+    const int bins = frameLength / 2 + 1;
+    std::fill(prevAnalysisPhase.begin(), prevAnalysisPhase.begin() + bins, 0.0f);
+    std::fill(prevSynthesisPhase.begin(), prevSynthesisPhase.begin() + bins, 0.0f);
+    prevFramePos = 0;
+    prevSegmentPos = 0;
+    firstFrame = true;
+}
+
+int TimeStretcher::latencyFrames() const {
+    return static_cast<int>((frameLength + hop + 2 * searchRadius) / MIN_PITCH) + 8;
+}
+
+int TimeStretcher::put(const float* in, int frames) {
+    if (draining || frames <= 0) return 0;
+    const float tempo = currentParams().tempo; // a pending mode change clears the stream first
+    compactInput();
+
+    const int n = std::min(frames, inCapacity - inFill);
+    for (int c = 0; c < numChannels; ++c) {
+        float* dst = channelInput(c) + inFill;
+        for (int i = 0; i < n; ++i) dst[i] = in[i * numChannels + c];
+    }
+    inFill += n;
+    expectedOutput += n / tempo;
+    run();
+    return n;
+}
+
+int TimeStretcher::receive(float* out, int maxFrames) {
+    const int n = std::min(maxFrames, outFill - outRead);
+    if (n <= 0) return 0;
+    std::memcpy(out, output.data() + static_cast<size_t>(outRead) * numChannels,
+                sizeof(float) * static_cast<size_t>(n) * numChannels);
+    outRead += n;
+    if (outRead == outFill) {
+        outRead = 0;
+        outFill = 0;
+    }
+    run(); // the space just freed may unblock buffered input
+    return n;
+}
+
+void TimeStretcher::flush() {
+    if (draining) return;
+    draining = true;
+    run();
+}
+
+bool TimeStretcher::hasInputForFrame() const {
+    const int pos = static_cast<int>(analysisPos);
+    if (activeMode == Mode::Music || firstFrame) return pos + frameLength <= inFill;
+    return pos + searchRadius + frameLength <= inFill && prevSegmentPos + hop + frameLength <= inFill;
+}
+
+// Drops input that no future frame can reach
+void TimeStretcher::compactInput() {
+    int keep = static_cast<int>(analysisPos) - searchRadius;
+    if (activeMode == Mode::Speech && !firstFrame) keep = std::min(keep, prevSegmentPos + hop);
+    keep = std::min(keep, inFill);
+    if (keep <= 0) return;
+    for (int c = 0; c < numChannels; ++c) {
+        float* ch = channelInput(c);
+        std::memmove(ch, ch + keep, sizeof(float) * (inFill - keep));
+    }
+    inFill -= keep;
+    analysisPos -= keep;
+    prevFramePos -= keep;
+    prevSegmentPos -= keep;
+}
+
+const TimeStretcher::Params& TimeStretcher::currentParams() {
+    const Params& p = params.acquire();
+    if (p.mode != activeMode) {
+        activeMode = p.mode;
+        configureGeometry();
+        clear();
+    }
+    return p;
+}
+
+void TimeStretcher::run() {
+    const Params& p = currentParams();
+    const float speed = p.tempo / p.pitch;
+    const int hopOutput = static_cast<int>(hop / p.pitch) + 4;
+
+    while (!drained) {
+        if (draining && producedOutput >= expectedOutput) {
+            // Trim the zero-padded tail so output length == input / tempo
+            const int excess = static_cast<int>(producedOutput - std::ceil(expectedOutput));
+            outFill = std::max(outRead, outFill - excess);
+            drained = true;
+            break;
+        }
+        if (outCapacity - outFill < hopOutput) {
+            if (outRead == 0) break;
+            std::memmove(output.data(), output.data() + static_cast<size_t>(outRead) * numChannels,
+                         sizeof(float) * static_cast<size_t>(outFill - outRead) * numChannels);
+            outFill -= outRead;
+            outRead = 0;
+            if (outCapacity - outFill < hopOutput) break;
+        }
+        if (!hasInputForFrame()) {
+            if (!draining) break;
+            compactInput();
+            const int pad = std::min(frameLength, inCapacity - inFill);
+            if (pad <= 0) break;
+            for (int c = 0; c < numChannels; ++c) std::fill(channelInput(c) + inFill, channelInput(c) + inFill + pad, 0.0f);
+            inFill += pad;
+            continue;
+        }
+        synthesizeFrame(speed);
+        emitHop(p.pitch);
+    }
+}
+
+void TimeStretcher::synthesizeFrame(float speed) {
+    const int target = static_cast<int>(analysisPos);
+    if (activeMode == Mode::Music) {
+        phaseVocoderFrame(target);
+    } else {
+        const int pos = firstFrame ? target : findSegment(target);
+        for (int c = 0; c < numChannels; ++c) {
+            const float* x = channelInput(c) + pos;
+            float* acc = channelOla(c);
+            for (int i = 0; i < frameLength; ++i) acc[i] += x[i] * window[i];
+        }
+        for (int i = 0; i < frameLength; ++i) olaNorm[i] += window[i];
+        prevSegmentPos = pos;
+        firstFrame = false;
+    }
+    analysisPos += hop * speed;
+}
+
+void TimeStretcher::phaseVocoderFrame(int pos) {
+    const int bins = frameLength / 2 + 1;
+
+    for (int c = 0; c < numChannels; ++c) {
+        const float* x = channelInput(c) + pos;
+        for (int i = 0; i < frameLength; ++i) timeScratch[i] = x[i] * window[i];
+        fft->forward(timeScratch.data(), specRe.data() + static_cast<size_t>(c) * bins,
+                     specIm.data() + static_cast<size_t>(c) * bins);
+    }
+
+    // Phase decisions are made once, on the channel sum
+    for (int k = 0; k < bins; ++k) {
+        float sr = 0.0f, si = 0.0f;
+        for (int c = 0; c < numChannels; ++c) {
+            sr += specRe[static_cast<size_t>(c) * bins + k];
+            si += specIm[static_cast<size_t>(c) * bins + k];
+        }
+        magnitude[k] = std::sqrt(sr * sr + si * si);
+        phase[k] = std::atan2(si, sr);
+    }
+
+    if (firstFrame) {
+        std::copy(phase.begin(), phase.begin() + bins, prevSynthesisPhase.begin());
+        std::fill(rotationCos.begin(), rotationCos.begin() + bins, 1.0f);
+        std::fill(rotationSin.begin(), rotationSin.begin() + bins, 0.0f);
+    } else {
+        const float analysisHop = static_cast<float>(std::max(1, pos - prevFramePos));
+        auto propagate = [&](int k) {
+            const float omega = TWO_PI * k / frameLength;
+            const float deviation = principalArgument(phase[k] - prevAnalysisPhase[k] - omega * analysisHop);
+            return prevSynthesisPhase[k] + (omega + deviation / analysisHop) * hop - phase[k];
+        };
+
+        float floor = 0.0f;
+        for (int k = 0; k < bins; ++k) floor = std::max(floor, magnitude[k]);
+        floor *= 1e-5f;
+        int numPeaks = 0;
+        for (int k = 2; k < bins - 2; ++k) {
+            const float m = magnitude[k];
+            if (m > floor && m > magnitude[k - 1] && m >= magnitude[k + 1] &&
+                m > magnitude[k - 2] && m >= magnitude[k + 2]) {
+                peaks[numPeaks++] = k;
+            }
+        }
+
+        if (numPeaks == 0) {
+            for (int k = 0; k < bins; ++k) {
+                const float rotation = propagate(k);
+                rotationCos[k] = std::cos(rotation);
+                rotationSin[k] = std::sin(rotation);
+                prevSynthesisPhase[k] = principalArgument(phase[k] + rotation);
+            }
+        } else {
+            // Identity phase locking: every bin takes the rotation of the peak
+            // whose region (bounded by the magnitude minima) it belongs to.
+            int start = 0;
+            for (int i = 0; i < numPeaks; ++i) {
+                const int peak = peaks[i];
+                int end = bins;
+                if (i + 1 < numPeaks) {
+                    end = peak + 1;
+                    for (int k = peak + 1; k < peaks[i + 1]; ++k) {
+                        if (magnitude[k] < magnitude[end]) end = k;
+                    }
+                }
+                const float rotation = propagate(peak);
+                const float rc = std::cos(rotation);
+                const float rs = std::sin(rotation);
+                for (int k = start; k < end; ++k) {
+                    rotationCos[k] = rc;
+                    rotationSin[k] = rs;
+                    prevSynthesisPhase[k] = principalArgument(phase[k] + rotation);
+                }
+                start = end;
+            }
+        }
+        // DC and Nyquist stay real
+        rotationCos[0] = 1.0f;
+        rotationSin[0] = 0.0f;
+        rotationCos[bins - 1] = 1.0f;
+        rotationSin[bins - 1] = 0.0f;
+    }
+    std::copy(phase.begin(), phase.begin() + bins, prevAnalysisPhase.begin());
+    prevFramePos = pos;
+    firstFrame = false;
+
+    for (int c = 0; c < numChannels; ++c) {
+        float* re = specRe.data() + static_cast<size_t>(c) * bins;
+        float* im = specIm.data() + static_cast<size_t>(c) * bins;
+        for (int k = 0; k < bins; ++k) {
+            const float r = re[k] * rotationCos[k] - im[k] * rotationSin[k];
+            im[k] = re[k] * rotationSin[k] + im[k] * rotationCos[k];
+            re[k] = r;
+        }
+        fft->inverse(re, im, timeScratch.data());
+        float* acc = channelOla(c);
+        for (int i = 0; i < frameLength; ++i) acc[i] += timeScratch[i] * window[i];
+    }
+    for (int i = 0; i < frameLength; ++i) olaNorm[i] += window[i] * window[i];
+}
+
+/*
+ * WSOLA search: the segment within +/-searchRadius of 'target' that best
+ * matches the natural continuation of the previous segment. Coarse search on
+ * a box-decimated mono mix, then a full-rate refinement around the winner.
+ */
+int TimeStretcher::findSegment(int target) {
+    const int templatePos = prevSegmentPos + hop;
+    const int low = std::max(0, target - searchRadius);
+    const int high = target + searchRadius;
+    const int regionLength = high - low + frameLength;
+
+    float* tmpl = monoTemplate.data();
+    float* region = monoSearch.data();
+    std::fill(tmpl, tmpl + frameLength, 0.0f);
+    std::fill(region, region + regionLength, 0.0f);
+    for (int c = 0; c < numChannels; ++c) {
+        const float* x = channelInput(c);
+        for (int i = 0; i < frameLength; ++i) tmpl[i] += x[templatePos + i];
+        for (int i = 0; i < regionLength; ++i) region[i] += x[low + i];
+    }
+
+    // Coarse: decimated copies live after the full-rate ones
+    const int d = decimation;
+    const int tmplCoarseLength = frameLength / d;
+    const int regionCoarseLength = regionLength / d;
+    float* tmplCoarse = tmpl + frameLength;
+    float* regionCoarse = region + regionLength;
+    for (int i = 0; i < tmplCoarseLength; ++i) {
+        float s = 0.0f;
+        for (int j = 0; j < d; ++j) s += tmpl[i * d + j];
+        tmplCoarse[i] = s;
+    }
+    for (int i = 0; i < regionCoarseLength; ++i) {
+        float s = 0.0f;
+        for (int j = 0; j < d; ++j) s += region[i * d + j];
+        regionCoarse[i] = s;
+    }
+
+    int best = target - low;
+    float bestScore = -1e30f;
+    const int coarseCandidates = regionCoarseLength - tmplCoarseLength + 1;
+    if (coarseCandidates > 0) {
+        float energy = dot(regionCoarse, regionCoarse, tmplCoarseLength);
+        for (int i = 0; i < coarseCandidates; ++i) {
+            const float score = dot(tmplCoarse, regionCoarse + i, tmplCoarseLength) / std::sqrt(energy + 1e-9f);
+            if (score > bestScore) {
+                bestScore = score;
+                best = i * d;
+            }
+            if (i + 1 < coarseCandidates) {
+                const float leaving = regionCoarse[i];
+                const float entering = regionCoarse[i + tmplCoarseLength];
+                energy = std::max(0.0f, energy - leaving * leaving + entering * entering);
+            }
+        }
+    }
+
+    // Fine: full rate within one decimation step of the coarse winner
+    if (d > 1) {
+        const int from = std::max(0, best - d);
+        const int to = std::min(high - low, best + d);
+        bestScore = -1e30f;
+        for (int offset = from; offset <= to; ++offset) {
+            const float* candidate = region + offset;
+            const float score = dot(tmpl, candidate, frameLength) /
+                                std::sqrt(dot(candidate, candidate, frameLength) + 1e-9f);
+            if (score > bestScore) {
+                bestScore = score;
+                best = offset;
+            }
+        }
+    }
+    return low + best;
+}
+
+// Releases one hop of finished overlap-add output through the pitch resampler
+void TimeStretcher::emitHop(float pitch) {
+    const int drop = std::min(dropFrames, hop);
+    dropFrames -= drop;
+    const int keep = hop - drop;
+    for (int c = 0; c < numChannels; ++c) {
+        float* acc = channelOla(c);
+        float* dst = channelMid(c) + midFill;
+        for (int i = 0; i < keep; ++i) {
+            const float norm = olaNorm[drop + i];
+            dst[i] = norm > 1e-3f ? acc[drop + i] / norm : 0.0f;
+        }
+        std::memmove(acc, acc + hop, sizeof(float) * (frameLength - hop));
+        std::fill(acc + frameLength - hop, acc + frameLength, 0.0f);
+    }
+    std::memmove(olaNorm.data(), olaNorm.data() + hop, sizeof(float) * (frameLength - hop));
+    std::fill(olaNorm.begin() + (frameLength - hop), olaNorm.begin() + frameLength, 0.0f);
+    midFill += keep;
+
+    // 4-point Hermite; needs one sample behind and two ahead of the read position
+    float* out = output.data() + static_cast<size_t>(outFill) * numChannels;
+    int produced = 0;
+    while (true) {
+        const int i = static_cast<int>(resamplePos);
+        if (i + 2 >= midFill) break;
+        const float f = static_cast<float>(resamplePos - i);
+        for (int c = 0; c < numChannels; ++c) {
+            const float* x = channelMid(c) + i;
+            const float xm1 = x[-1], x0 = x[0], x1 = x[1], x2 = x[2];
+            const float c1 = 0.5f * (x1 - xm1);
+            const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+            const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+            out[produced * numChannels + c] = ((c3 * f + c2) * f + c1) * f + x0;
+        }
+        ++produced;
+        resamplePos += pitch;
+    }
+    outFill += produced;
+    producedOutput += produced;
+
+    const int consumed = static_cast<int>(resamplePos) - 1;
+    if (consumed > 0) {
+        for (int c = 0; c < numChannels; ++c) {
+            float* x = channelMid(c);
+            std::memmove(x, x + consumed, sizeof(float) * (midFill - consumed));
+        }
+        midFill -= consumed;
+        resamplePos -= consumed;
+    }
+}
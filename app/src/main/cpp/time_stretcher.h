@@ -0,0 +1,158 @@
+#ifndef TIME_STRETCHER_H
+#define TIME_STRETCHER_H
+
+#include <memory>
+#include <vector>
+#include "fft.h"
+#include "param_snapshot.h"
+
+/**
+ * Streaming tempo / pitch changer with independent controls, for any sample
+ * rate and channel count up to the capacity given at construction.
+ *
+ * Two time-scale algorithms, selected by Mode:
+ *  - Music: phase vocoder (Hann, 75% overlap, ~43 ms frames) with identity
+ *    phase locking (Laroche & Dolson). Peaks are picked on the channel sum,
+ *    and every channel gets the same per-bin phase rotation, so inter-channel
+ *    phase differences and the stereo image survive the stretch.
+ *  - Speech: WSOLA (24 ms Hann segments, 50% overlap). Each segment is the
+ *    one within +/-8 ms of its nominal position that best continues the
+ *    previous segment, found by normalized cross-correlation on a decimated
+ *    mono mix and then refined at full rate.
+ *
+ * Pitch is applied by stretching by pitch / tempo and then resampling by
+ * pitch (4-point Hermite). A pure tempo change does no resampling at all.
+ *
+ * Usage: put() consumes as much input as fits and returns the frame count
+ * taken; receive() drains output and makes room for more. Alternate the two
+ * until the input is consumed. flush() marks end of stream: the tail is
+ * released and the total output is trimmed to input / tempo. Output lags
+ * input by latencyFrames() while streaming.
+ *
+ * setParams() may be called from any thread. Everything else belongs to the
+ * one processing thread. Nothing allocates after construction, and
+ * setFormat(), clear() and mode changes only touch the active channels'
+ * current frame, so they are safe on a real-time thread even at the maximum
+ * format.
+ */
+class TimeStretcher {
+public:
+    enum class Mode : int { Music = 0, Speech = 1 };
+
+    static constexpr float MIN_TEMPO = 0.25f;
+    static constexpr float MAX_TEMPO = 4.0f;
+    static constexpr float MIN_PITCH = 0.5f;
+    static constexpr float MAX_PITCH = 2.0f;
+
+    TimeStretcher(int maxChannels, int maxSampleRate);
+
+    // Values are clamped to the ranges above. A mode change clears the stream.
+    void setParams(float tempo, float pitch, Mode mode);
+
+    // Clears the stream. Returns false (and keeps the old format) if the
+    // format exceeds the construction capacity.
+    bool setFormat(int channels, int sampleRate);
+    int channels() const { return numChannels; }
+    int sampleRate() const { return rate; }
+
+    // Interleaved float
+    int put(const float* input, int frames);
+    int receive(float* output, int maxFrames);
+    int available() const { return outFill - outRead; }
+
+    void flush();
+    void clear();
+
+    // Worst-case lag of output behind input, in output frames at pitch MIN_PITCH
+    int latencyFrames() const;
+
+private:
+    struct Params {
+        float tempo;
+        float pitch;
+        Mode mode;
+    };
+
+    ParamSnapshot<Params> params;
+    Mode activeMode;
+
+    int maxChannels;
+    int maxRate;
+    int numChannels;
+    int rate;
+
+    // Geometry for the current mode and rate
+    int frameLength; // PV FFT size or WSOLA segment length
+    int hop;         // synthesis hop
+    int searchRadius;
+    int decimation;
+
+    // Input: planar per channel, analysis positions relative to index 0
+    int inCapacity;
+    std::vector<float> input;
+    int inFill;
+    double analysisPos;
+
+    // Overlap-add accumulators [channel][maxFrameLength] plus window-power sum
+    int maxFrameLength;
+    std::vector<float> ola;
+    std::vector<float> olaNorm;
+    std::vector<float> window;
+    int dropFrames; // stretched frames still to discard (pre-roll)
+
+    // Stretched signal awaiting the pitch resampler: planar, [channel][midCapacity]
+    int midCapacity;
+    std::vector<float> mid;
+    int midFill;
+    double resamplePos;
+
+    // Output FIFO, interleaved
+    int outCapacity;
+    std::vector<float> output;
+    int outRead;
+    int outFill;
+
+    // End-of-stream bookkeeping, in output frames
+    double expectedOutput;
+    double producedOutput;
+    bool draining;
+    bool drained;
+
+    // Phase vocoder
+    std::unique_ptr<RealFft> ffts[3]; // one per frame length this rate range can need
+    std::vector<float> musicWindows[3]; // Hann window for each of ffts
+    RealFft* fft;
+    std::vector<float> specRe;       // [channel][bins]
+    std::vector<float> specIm;
+    std::vector<float> magnitude;    // channel-sum spectrum
+    std::vector<float> phase;
+    std::vector<float> prevAnalysisPhase;
+    std::vector<float> prevSynthesisPhase;
+    std::vector<float> rotationCos;
+    std::vector<float> rotationSin;
+    std::vector<int> peaks;
+    std::vector<float> timeScratch;
+    int prevFramePos;
+    bool firstFrame;
+
+    // WSOLA
+    std::vector<float> monoTemplate;
+    std::vector<float> monoSearch;
+    int prevSegmentPos;
+
+    const Params& currentParams();
+    void configureGeometry();
+    bool hasInputForFrame() const;
+    void run();
+    void synthesizeFrame(float speed);
+    void phaseVocoderFrame(int pos);
+    int findSegment(int target);
+    void emitHop(float pitch);
+    void compactInput();
+
+    float* channelInput(int c) { return input.data() + static_cast<size_t>(c) * inCapacity; }
+    float* channelOla(int c) { return ola.data() + static_cast<size_t>(c) * maxFrameLength; }
+    float* channelMid(int c) { return mid.data() + static_cast<size_t>(c) * midCapacity; }
+};
+
+#endif // TIME_STRETCHER_H
@@ -0,0 +1,569 @@
+#include "vector_index.h"
+#include "file_util.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'U', 'V', 'H', 'N', 'S', 'W', '1'};
+constexpr uint32_t VERSION = 1;
+constexpr int MAX_LEVEL = 16;
+constexpr int MIN_M = 4;
+constexpr int MAX_M = 64;
+constexpr int MAX_EF = 1 << 16;
+constexpr int MAX_DIM = 4096;
+constexpr uint32_t MAX_NODES = 1u << 24;
+constexpr size_t MAX_ID_LENGTH = 0xFFFF;
+
+// A rebuild re-inserts every live song, so small amounts of garbage wait
+constexpr int MIN_REBUILD_DELETED = 1024;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t dim;
+    int32_t m;
+    int32_t efConstruction;
+    uint32_t nodeCount;
+    int32_t entryPoint;
+    int32_t topLevel;
+    uint32_t upperLinkCount; // int32s in the upper-layer block
+    uint32_t idBytes;
+    uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 48, "unexpected header padding");
+
+// File layout after the header: levels and deleted flags (one byte per node
+// each), vectors, layer-0 links, upper-layer links in node order, ID lengths
+// (uint32 per node), ID bytes
+
+float dot(const float* a, const float* b, int dim) {
+    // Four sums so the additions overlap
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int i = 0;
+    for (; i + 3 < dim; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < dim; ++i) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+// Unit-length copy; zero (similar to nothing) for zero or non-finite input
+void normalize(const float* in, int dim, float* out) {
+    const float norm = std::sqrt(dot(in, in, dim));
+    if (!(norm > 1e-8f) || !std::isfinite(norm)) {
+        std::fill(out, out + dim, 0.0f);
+        return;
+    }
+    const float scale = 1.0f / norm;
+    for (int i = 0; i < dim; ++i) out[i] = in[i] * scale;
+}
+
+// Per-thread visit marks: a node is visited in the current search when its
+// mark equals the epoch, so searches never clear a node-sized array
+struct VisitMarks {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+};
+thread_local VisitMarks visitMarks;
+
+// Per-thread node flags and positions for searchAmong, reset after each use
+struct AmongScratch {
+    std::vector<uint8_t> allowed;
+    std::vector<int32_t> position;
+};
+thread_local AmongScratch amongScratch;
+
+uint32_t beginVisit(size_t nodes) {
+    if (visitMarks.marks.size() < nodes) visitMarks.marks.resize(nodes, 0);
+    if (++visitMarks.epoch == 0) {
+        std::fill(visitMarks.marks.begin(), visitMarks.marks.end(), 0);
+        visitMarks.epoch = 1;
+    }
+    return visitMarks.epoch;
+}
+
+} // namespace
+
+VectorIndex::VectorIndex(int dim, int m, int efConstruction)
+    : dimension(std::clamp(dim, 1, MAX_DIM)),
+      m(std::clamp(m, MIN_M, MAX_M)),
+      efConstruction(std::clamp(efConstruction, this->m, MAX_EF)),
+      levelScale(1.0 / std::log(static_cast<double>(this->m))) {}
+
+int VectorIndex::size() const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    return static_cast<int>(nodeById.size());
+}
+
+int32_t* VectorIndex::links(int32_t node, int level) {
+    if (level == 0) return baseLinks.data() + static_cast<size_t>(node) * (2 * m + 1);
+    return upperLinks[node].data() + static_cast<size_t>(level - 1) * (m + 1);
+}
+
+const int32_t* VectorIndex::links(int32_t node, int level) const {
+    return const_cast<VectorIndex*>(this)->links(node, level);
+}
+
+float VectorIndex::similarity(const float* query, int32_t node) const {
+    return dot(query, vectors.data() + static_cast<size_t>(node) * dimension, dimension);
+}
+
+int VectorIndex::randomLevel() {
+    // Level l with probability ~ m^-l
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const double draw = -std::log(1.0 - unit(rng)) * levelScale;
+    return static_cast<int>(std::min(draw, static_cast<double>(MAX_LEVEL)));
+}
+
+int32_t VectorIndex::insertNode(const std::string& id, const float* normalized) {
+    const auto node = static_cast<int32_t>(nodeIds.size());
+    const int level = randomLevel();
+    vectors.insert(vectors.end(), normalized, normalized + dimension);
+    levels.push_back(static_cast<uint8_t>(level));
+    deleted.push_back(0);
+    baseLinks.resize(baseLinks.size() + 2 * m + 1, 0);
+    upperLinks.emplace_back(static_cast<size_t>(level) * (m + 1), 0);
+    nodeIds.push_back(id);
+    nodeById[id] = node;
+    linkNode(node);
+    return node;
+}
+
+void VectorIndex::linkNode(int32_t node) {
+    const int level = levels[node];
+    if (entryPoint < 0) {
+        entryPoint = node;
+        topLevel = level;
+        return;
+    }
+    const float* query = vectors.data() + static_cast<size_t>(node) * dimension;
+    int32_t entry = greedyDescent(query, entryPoint, level);
+    std::vector<Match> found;
+    for (int l = std::min(level, topLevel); l >= 0; --l) {
+        searchLayer(query, entry, efConstruction, l, false, nullptr, found);
+        selectNeighbours(found, m);
+        // The closest stays first, and starts the search one layer down
+        entry = found.front().node;
+
+        int32_t* own = links(node, l);
+        own[0] = static_cast<int32_t>(found.size());
+        for (size_t i = 0; i < found.size(); ++i) own[i + 1] = found[i].node;
+        for (const Match& neighbour : found) addLink(neighbour.node, l, node);
+    }
+    if (level > topLevel) {
+        entryPoint = node;
+        topLevel = level;
+    }
+}
+
+/**
+ * The HNSW neighbour heuristic: walking candidates from the closest, keeps
+ * one only if it is closer to the base than to every one already kept, so
+ * links spread out in different directions instead of into one cluster.
+ * Leaves candidates best first.
+ */
+void VectorIndex::selectNeighbours(std::vector<Match>& candidates, int limit) const {
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Match& a, const Match& b) { return a.similarity > b.similarity; });
+    if (static_cast<int>(candidates.size()) <= limit) return;
+    std::vector<Match> kept;
+    kept.reserve(limit);
+    for (const Match& candidate : candidates) {
+        if (static_cast<int>(kept.size()) == limit) break;
+        const float* vector = vectors.data() + static_cast<size_t>(candidate.node) * dimension;
+        bool diverse = true;
+        for (const Match& other : kept) {
+            if (similarity(vector, other.node) > candidate.similarity) {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse) kept.push_back(candidate);
+    }
+    candidates.swap(kept);
+}
+
+void VectorIndex::addLink(int32_t node, int level, int32_t neighbour) {
+    int32_t* list = links(node, level);
+    if (list[0] < maxLinks(level)) {
+        list[++list[0]] = neighbour;
+        return;
+    }
+    // Full: re-select among the current links and the newcomer
+    const float* base = vectors.data() + static_cast<size_t>(node) * dimension;
+    std::vector<Match> candidates;
+    candidates.reserve(list[0] + 1);
+    for (int i = 1; i <= list[0]; ++i) candidates.push_back({similarity(base, list[i]), list[i]});
+    candidates.push_back({similarity(base, neighbour), neighbour});
+    selectNeighbours(candidates, maxLinks(level));
+    list[0] = static_cast<int32_t>(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) list[i + 1] = candidates[i].node;
+}
+
+// Greedy walk from the top layer down to (not into) stopLevel
+int32_t VectorIndex::greedyDescent(const float* query, int32_t entry, int stopLevel) const {
+    int32_t current = entry;
+    float best = similarity(query, current);
+    for (int level = topLevel; level > stopLevel; --level) {
+        for (bool moved = true; moved;) {
+            moved = false;
+            const int32_t* list = links(current, level);
+            for (int i = 1; i <= list[0]; ++i) {
+                const float sim = similarity(query, list[i]);
+                if (sim > best) {
+                    best = sim;
+                    current = list[i];
+                    moved = true;
+                }
+            }
+        }
+    }
+    return current;
+}
+
+/**
+ * Best-first search of one layer from entry, leaving the ef most similar
+ * eligible nodes in results (unordered). Every node routes the search;
+ * eligible ones are those not skipped as deleted and, if allowed is given,
+ * flagged in it.
+ */
+void VectorIndex::searchLayer(const float* query, int32_t entry, int ef, int level, bool skipDeleted,
+                              const uint8_t* allowed, std::vector<Match>& results) const {
+    // Heaps: the frontier keeps its best on top, the results their worst
+    const auto bestOnTop = [](const Match& a, const Match& b) { return a.similarity < b.similarity; };
+    const auto worstOnTop = [](const Match& a, const Match& b) { return a.similarity > b.similarity; };
+    const auto eligible = [&](int32_t node) {
+        return (!skipDeleted || !deleted[node]) && (allowed == nullptr || allowed[node]);
+    };
+
+    const uint32_t epoch = beginVisit(nodeIds.size());
+    uint32_t* marks = visitMarks.marks.data();
+    std::vector<Match> frontier;
+    results.clear();
+
+    const Match start{similarity(query, entry), entry};
+    marks[entry] = epoch;
+    frontier.push_back(start);
+    if (eligible(entry)) results.push_back(start);
+
+    while (!frontier.empty()) {
+        std::pop_heap(frontier.begin(), frontier.end(), bestOnTop);
+        const Match current = frontier.back();
+        frontier.pop_back();
+        const bool full = static_cast<int>(results.size()) >= ef;
+        if (full && current.similarity < results.front().similarity) break;
+
+        const int32_t* list = links(current.node, level);
+        for (int i = 1; i <= list[0]; ++i) {
+            const int32_t next = list[i];
+            if (marks[next] == epoch) continue;
+            marks[next] = epoch;
+            const float sim = similarity(query, next);
+            if (static_cast<int>(results.size()) >= ef && sim <= results.front().similarity) continue;
+
+            frontier.push_back({sim, next});
+            std::push_heap(frontier.begin(), frontier.end(), bestOnTop);
+            if (!eligible(next)) continue;
+            results.push_back({sim, next});
+            std::push_heap(results.begin(), results.end(), worstOnTop);
+            if (static_cast<int>(results.size()) > ef) {
+                std::pop_heap(results.begin(), results.end(), worstOnTop);
+                results.pop_back();
+            }
+        }
+    }
+}
+
+void VectorIndex::searchNodes(const float* query, int k, int ef, const uint8_t* allowed, size_t eligibleCount,
+                              std::vector<Match>& out) const {
+    out.clear();
+    if (entryPoint < 0 || k <= 0 || eligibleCount == 0) return;
+    std::vector<float> normalized(dimension);
+    normalize(query, dimension, normalized.data());
+    const int width = std::clamp(ef, k, MAX_EF);
+    if (eligibleCount <= static_cast<size_t>(width) * 2 * m) {
+        // A layer-0 search visits about this many nodes anyway: scanning is
+        // as fast, and exact
+        out.reserve(eligibleCount);
+        for (size_t node = 0; node < nodeIds.size(); ++node) {
+            if (deleted[node] || (allowed != nullptr && !allowed[node])) continue;
+            out.push_back({similarity(normalized.data(), static_cast<int32_t>(node)), static_cast<int32_t>(node)});
+        }
+    } else {
+        const int32_t entry = greedyDescent(normalized.data(), entryPoint, 0);
+        searchLayer(normalized.data(), entry, width, 0, true, allowed, out);
+    }
+    // Ties by node, so equal vectors come back in a stable order
+    const auto better = [](const Match& a, const Match& b) {
+        return a.similarity > b.similarity || (a.similarity == b.similarity && a.node < b.node);
+    };
+    if (static_cast<int>(out.size()) > k) {
+        std::partial_sort(out.begin(), out.begin() + k, out.end(), better);
+        out.resize(k);
+    } else {
+        std::sort(out.begin(), out.end(), better);
+    }
+}
+
+bool VectorIndex::add(const std::string* ids, int count, const float* input) {
+    std::unique_lock<std::shared_mutex> guard(lock);
+    std::vector<float> normalized(dimension);
+    for (int i = 0; i < count; ++i) {
+        if (ids[i].empty() || ids[i].size() > MAX_ID_LENGTH) continue;
+        normalize(input + static_cast<size_t>(i) * dimension, dimension, normalized.data());
+        auto it = nodeById.find(ids[i]);
+        if (it != nodeById.end()) {
+            const float* stored = vectors.data() + static_cast<size_t>(it->second) * dimension;
+            if (std::memcmp(stored, normalized.data(), dimension * sizeof(float)) == 0) continue;
+            // Links were chosen for the old vector: retire the node and insert afresh
+            deleted[it->second] = 1;
+            ++deletedCount;
+            nodeById.erase(it);
+        }
+        if (nodeIds.size() >= MAX_NODES) {
+            if (deletedCount == 0) return false;
+            rebuild();
+        }
+        insertNode(ids[i], normalized.data());
+    }
+    if (deletedCount >= MIN_REBUILD_DELETED && deletedCount > static_cast<int>(nodeById.size())) rebuild();
+    return true;
+}
+
+int VectorIndex::remove(const std::string* ids, int count) {
+    std::unique_lock<std::shared_mutex> guard(lock);
+    int removed = 0;
+    for (int i = 0; i < count; ++i) {
+        auto it = nodeById.find(ids[i]);
+        if (it == nodeById.end()) continue;
+        deleted[it->second] = 1;
+        ++deletedCount;
+        nodeById.erase(it);
+        ++removed;
+    }
+    if (deletedCount >= MIN_REBUILD_DELETED && deletedCount > static_cast<int>(nodeById.size())) rebuild();
+    return removed;
+}
+
+void VectorIndex::rebuild() {
+    std::vector<std::string> ids;
+    std::vector<float> live;
+    ids.reserve(nodeById.size());
+    live.reserve(nodeById.size() * dimension);
+    for (size_t node = 0; node < nodeIds.size(); ++node) {
+        if (deleted[node]) continue;
+        ids.push_back(std::move(nodeIds[node]));
+        const float* vector = vectors.data() + node * dimension;
+        live.insert(live.end(), vector, vector + dimension);
+    }
+
+    vectors.clear();
+    levels.clear();
+    deleted.clear();
+    baseLinks.clear();
+    upperLinks.clear();
+    nodeIds.clear();
+    nodeById.clear();
+    entryPoint = -1;
+    topLevel = -1;
+    deletedCount = 0;
+    for (size_t i = 0; i < ids.size(); ++i) insertNode(ids[i], live.data() + i * dimension);
+}
+
+int VectorIndex::search(const float* query, int k, int ef, std::string* ids, float* similarities) const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    std::vector<Match> found;
+    searchNodes(query, k, ef, nullptr, nodeById.size(), found);
+    for (size_t i = 0; i < found.size(); ++i) {
+        ids[i] = nodeIds[found[i].node];
+        if (similarities) similarities[i] = found[i].similarity;
+    }
+    return static_cast<int>(found.size());
+}
+
+int VectorIndex::searchAmong(const float* query, const std::string* ids, int count, int k, int ef,
+                             int32_t* positions, float* similarities) const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    std::vector<uint8_t>& allowed = amongScratch.allowed;
+    std::vector<int32_t>& positionOf = amongScratch.position;
+    if (allowed.size() < nodeIds.size()) {
+        allowed.resize(nodeIds.size(), 0);
+        positionOf.resize(nodeIds.size(), 0);
+    }
+    std::vector<int32_t> nodes;
+    nodes.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const auto it = nodeById.find(ids[i]);
+        if (it == nodeById.end() || allowed[it->second]) continue;
+        allowed[it->second] = 1;
+        positionOf[it->second] = i;
+        nodes.push_back(it->second);
+    }
+
+    std::vector<Match> found;
+    searchNodes(query, k, ef, allowed.data(), nodes.size(), found);
+    for (size_t i = 0; i < found.size(); ++i) {
+        positions[i] = positionOf[found[i].node];
+        if (similarities) similarities[i] = found[i].similarity;
+    }
+    for (int32_t node : nodes) allowed[node] = 0;
+    return static_cast<int>(found.size());
+}
+
+void VectorIndex::liveIds(std::vector<std::string>& out) const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    out.reserve(out.size() + nodeById.size());
+    for (size_t node = 0; node < nodeIds.size(); ++node) {
+        if (!deleted[node]) out.push_back(nodeIds[node]);
+    }
+}
+
+bool VectorIndex::save(const char* path) const {
+    std::shared_lock<std::shared_mutex> guard(lock);
+    const auto nodeCount = static_cast<uint32_t>(nodeIds.size());
+
+    std::vector<int32_t> upper;
+    for (const auto& list : upperLinks) upper.insert(upper.end(), list.begin(), list.end());
+    std::vector<uint32_t> idLengths(nodeCount);
+    std::string idBytes;
+    for (uint32_t node = 0; node < nodeCount; ++node) {
+        idLengths[node] = static_cast<uint32_t>(nodeIds[node].size());
+        idBytes += nodeIds[node];
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.dim = dimension;
+    header.m = m;
+    header.efConstruction = efConstruction;
+    header.nodeCount = nodeCount;
+    header.entryPoint = entryPoint;
+    header.topLevel = topLevel;
+    header.upperLinkCount = static_cast<uint32_t>(upper.size());
+    header.idBytes = static_cast<uint32_t>(idBytes.size());
+    return writeFileAtomically(path, {
+        {&header, sizeof(header)},
+        {levels.data(), levels.size()},
+        {deleted.data(), deleted.size()},
+        {vectors.data(), vectors.size() * sizeof(float)},
+        {baseLinks.data(), baseLinks.size() * sizeof(int32_t)},
+        {upper.data(), upper.size() * sizeof(int32_t)},
+        {idLengths.data(), idLengths.size() * sizeof(uint32_t)},
+        {idBytes.data(), idBytes.size()},
+    });
+}
+
+bool VectorIndex::load(const char* path) {
+    MappedFile file(path);
+    if (!file.isOpen() || file.size() < sizeof(FileHeader)) return false;
+    FileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.dim != dimension || header.m != m || header.nodeCount > MAX_NODES) {
+        return false;
+    }
+    // Sized in 64 bits: a 32-bit size_t could wrap on a hostile header and
+    // pass the check. The header limits keep this sum far from wrapping.
+    static_assert(uint64_t{MAX_NODES} * (2 + MAX_DIM * sizeof(float) + (2 * MAX_M + 1) * sizeof(int32_t) +
+                                         sizeof(uint32_t)) + 2 * (uint64_t{UINT32_MAX} * sizeof(int32_t)) <
+                      (uint64_t{1} << 48),
+                  "index size arithmetic can overflow");
+    const uint64_t nodeCount = header.nodeCount;
+    const uint64_t expected = sizeof(FileHeader) + 2 * nodeCount + nodeCount * dimension * sizeof(float) +
+                              nodeCount * (2 * static_cast<uint64_t>(m) + 1) * sizeof(int32_t) +
+                              uint64_t{header.upperLinkCount} * sizeof(int32_t) +
+                              nodeCount * sizeof(uint32_t) + header.idBytes;
+    if (static_cast<uint64_t>(file.size()) != expected) return false;
+    // Everything below is bounded by the mapped length, so fits in size_t
+    const size_t nodes = header.nodeCount;
+    const size_t baseStride = 2 * static_cast<size_t>(m) + 1;
+    if (nodes == 0 ? header.entryPoint != -1 || header.topLevel != -1
+                   : header.entryPoint < 0 || static_cast<size_t>(header.entryPoint) >= nodes) {
+        return false;
+    }
+
+    // Copy section by section, checking everything searches trust
+    const uint8_t* p = file.data() + sizeof(FileHeader);
+    std::vector<uint8_t> newLevels(p, p + nodes);
+    p += nodes;
+    std::vector<uint8_t> newDeleted(p, p + nodes);
+    p += nodes;
+    std::vector<float> newVectors(nodes * dimension);
+    std::memcpy(newVectors.data(), p, newVectors.size() * sizeof(float));
+    p += newVectors.size() * sizeof(float);
+    std::vector<int32_t> newBase(nodes * baseStride);
+    std::memcpy(newBase.data(), p, newBase.size() * sizeof(int32_t));
+    p += newBase.size() * sizeof(int32_t);
+    std::vector<int32_t> upper(header.upperLinkCount);
+    std::memcpy(upper.data(), p, upper.size() * sizeof(int32_t));
+    p += upper.size() * sizeof(int32_t);
+    std::vector<uint32_t> idLengths(nodes);
+    std::memcpy(idLengths.data(), p, idLengths.size() * sizeof(uint32_t));
+    p += idLengths.size() * sizeof(uint32_t);
+    const char* idBytes = reinterpret_cast<const char*>(p);
+
+    const auto validList = [&](const int32_t* list, int limit, int level) {
+        if (list[0] < 0 || list[0] > limit) return false;
+        for (int i = 1; i <= list[0]; ++i) {
+            if (list[i] < 0 || static_cast<size_t>(list[i]) >= nodes || newLevels[list[i]] < level) return false;
+        }
+        return true;
+    };
+    std::vector<std::vector<int32_t>> newUpper(nodes);
+    size_t upperUsed = 0;
+    int newTop = -1;
+    for (size_t node = 0; node < nodes; ++node) {
+        const int level = newLevels[node];
+        if (level > MAX_LEVEL) return false;
+        newTop = std::max(newTop, level);
+        if (!validList(newBase.data() + node * baseStride, 2 * m, 0)) return false;
+        const size_t length = static_cast<size_t>(level) * (m + 1);
+        if (upperUsed + length > upper.size()) return false;
+        newUpper[node].assign(upper.begin() + upperUsed, upper.begin() + upperUsed + length);
+        upperUsed += length;
+        for (int l = 1; l <= level; ++l) {
+            if (!validList(newUpper[node].data() + static_cast<size_t>(l - 1) * (m + 1), m, l)) return false;
+        }
+    }
+    if (upperUsed != upper.size() || (nodes > 0 && (header.topLevel != newTop ||
+                                                     newLevels[header.entryPoint] != newTop))) {
+        return false;
+    }
+
+    std::vector<std::string> newIds(nodes);
+    std::unordered_map<std::string, int32_t> newById;
+    int newDeletedCount = 0;
+    size_t offset = 0;
+    for (size_t node = 0; node < nodes; ++node) {
+        if (idLengths[node] > MAX_ID_LENGTH || offset + idLengths[node] > header.idBytes) return false;
+        newIds[node].assign(idBytes + offset, idLengths[node]);
+        offset += idLengths[node];
+        if (newDeleted[node]) {
+            ++newDeletedCount;
+        } else if (!newById.emplace(newIds[node], static_cast<int32_t>(node)).second) {
+            return false;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> guard(lock);
+    efConstruction = std::clamp(header.efConstruction, m, MAX_EF);
+    vectors.swap(newVectors);
+    levels.swap(newLevels);
+    deleted.swap(newDeleted);
+    baseLinks.swap(newBase);
+    upperLinks.swap(newUpper);
+    nodeIds.swap(newIds);
+    nodeById.swap(newById);
+    entryPoint = header.entryPoint;
+    topLevel = header.topLevel;
+    deletedCount = newDeletedCount;
+    return true;
+}
@@ -0,0 +1,120 @@
+#ifndef VECTOR_INDEX_H
+#define VECTOR_INDEX_H
+
+#include <cstdint>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Approximate nearest-neighbour index over song vectors (genre affinities),
+ * by cosine similarity: a Hierarchical Navigable Small World graph (Malkov &
+ * Yashunin, 2016).
+ *
+ * Every song is a node on layer 0 and, with geometrically falling odds, on
+ * the layers above, each layer linking a node to up to m close neighbours
+ * (2m on layer 0). A query walks greedily down from the top layer, then
+ * runs a best-first search over layer 0 that keeps the ef best nodes seen:
+ * ef trades recall for time, m trades recall for memory and insert time.
+ *
+ * Vectors are stored normalised, so similarity is a dot product. Removal
+ * marks a node deleted: it still routes searches but is never returned,
+ * and its ID can be added again. Once deleted nodes outnumber live ones
+ * the graph is rebuilt from the live ones.
+ *
+ * save() writes the whole graph to one file (atomically); load() maps a
+ * file and copies it in, so a restart skips rebuilding.
+ *
+ * Thread-safe: searches run concurrently, changes run alone.
+ */
+class VectorIndex {
+public:
+    static constexpr int DEFAULT_M = 16;
+    static constexpr int DEFAULT_EF_CONSTRUCTION = 100;
+
+    // dim >= 1; m and efConstruction are clamped to sensible ranges
+    VectorIndex(int dim, int m, int efConstruction);
+
+    int dim() const { return dimension; }
+
+    // Live (not deleted) songs
+    int size() const;
+
+    /**
+     * Adds count songs, or replaces the vectors of ones already present.
+     * vectors holds count * dim floats, packed. False if the index filled up
+     * before all were added.
+     */
+    bool add(const std::string* ids, int count, const float* vectors);
+
+    // Removes the ids; returns how many were present
+    int remove(const std::string* ids, int count);
+
+    /**
+     * The up to k songs most similar to query (dim floats), best first, with
+     * their similarities. Explores max(ef, k) candidates. Returns how many
+     * were written.
+     */
+    int search(const float* query, int k, int ef, std::string* ids, float* similarities) const;
+
+    /**
+     * Like search, restricted to the count songs in ids: writes positions in
+     * ids rather than IDs. IDs the index does not hold are skipped.
+     */
+    int searchAmong(const float* query, const std::string* ids, int count, int k, int ef,
+                    int32_t* positions, float* similarities) const;
+
+    // IDs of every live song
+    void liveIds(std::vector<std::string>& out) const;
+
+    bool save(const char* path) const;
+
+    // Replaces the contents with a saved index of the same dim and m; false
+    // (leaving the index unchanged) if the file is missing or does not match
+    bool load(const char* path);
+
+private:
+    struct Match {
+        float similarity;
+        int32_t node;
+    };
+
+    int maxLinks(int level) const { return level == 0 ? 2 * m : m; }
+    int32_t* links(int32_t node, int level);
+    const int32_t* links(int32_t node, int level) const;
+    float similarity(const float* query, int32_t node) const;
+
+    int randomLevel();
+    int32_t insertNode(const std::string& id, const float* normalized);
+    void linkNode(int32_t node);
+    void selectNeighbours(std::vector<Match>& candidates, int limit) const;
+    void addLink(int32_t node, int level, int32_t neighbour);
+    int32_t greedyDescent(const float* query, int32_t entry, int stopLevel) const;
+    void searchLayer(const float* query, int32_t entry, int ef, int level, bool skipDeleted,
+                     const uint8_t* allowed, std::vector<Match>& results) const;
+    void searchNodes(const float* query, int k, int ef, const uint8_t* allowed, size_t eligibleCount,
+                     std::vector<Match>& out) const;
+    void rebuild();
+
+    const int dimension;
+    int m;
+    int efConstruction;
+    double levelScale;
+
+    mutable std::shared_mutex lock;
+    std::mt19937 rng{42};
+    std::vector<float> vectors;                 // nodeCount * dim, normalised
+    std::vector<uint8_t> levels;                // top layer of each node
+    std::vector<uint8_t> deleted;
+    std::vector<int32_t> baseLinks;             // per node: count, then 2m neighbours
+    std::vector<std::vector<int32_t>> upperLinks; // per node: (count, m neighbours) per layer above 0
+    std::vector<std::string> nodeIds;
+    std::unordered_map<std::string, int32_t> nodeById;
+    int32_t entryPoint = -1;
+    int topLevel = -1;
+    int deletedCount = 0;
+};
+
+#endif // VECTOR_INDEX_H
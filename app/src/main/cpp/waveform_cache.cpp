@@ -0,0 +1,185 @@
+#include "waveform_cache.h"
+#include "file_util.h"
+#include "mapped_file.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'U', 'V', 'W', 'F', 'C', '0', '1'};
+constexpr char SUFFIX[] = ".wf";
+constexpr size_t SUFFIX_LENGTH = sizeof(SUFFIX) - 1;
+constexpr uint32_t MAX_PATH_LENGTH = 4096;
+
+struct SidecarHeader {
+    char magic[8];
+    uint32_t pathLength; // source path follows, padded to 8 bytes
+    uint32_t reserved;
+    int64_t sourceSize;
+    int64_t sourceModifiedNanos;
+};
+static_assert(sizeof(SidecarHeader) == 32, "unexpected header padding");
+
+size_t paddedPathLength(size_t length) { return (length + 7) & ~size_t{7}; }
+
+int64_t nowNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool endsWith(const char* name, const char* suffix, size_t suffixLength) {
+    const size_t length = std::strlen(name);
+    return length > suffixLength && std::memcmp(name + length - suffixLength, suffix, suffixLength) == 0;
+}
+
+} // namespace
+
+bool WaveformSource::describe(const char* path, WaveformSource& source) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    source.path = path;
+    source.size = static_cast<int64_t>(st.st_size);
+    source.modifiedNanos = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+WaveformCache::WaveformCache(std::string directory, int64_t byteBudget)
+    : directory(std::move(directory)), budget(byteBudget) {
+    mkdir(this->directory.c_str(), 0755);
+}
+
+std::string WaveformCache::fileName(const WaveformSource& source) const {
+    // FNV-1a over path, size and mtime
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= p[i];
+            hash *= 0x100000001b3ULL;
+        }
+    };
+    mix(source.path.data(), source.path.size());
+    mix(&source.size, sizeof(source.size));
+    mix(&source.modifiedNanos, sizeof(source.modifiedNanos));
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(hash), SUFFIX);
+    return name;
+}
+
+bool WaveformCache::find(const WaveformSource& source, WaveformPyramid& pyramid) {
+    const std::string name = fileName(source);
+    const std::string path = directory + "/" + name;
+    // Views read the levels they zoom to, not the file in order
+    MappedFile file(path.c_str(), MADV_RANDOM);
+    if (!file.isOpen()) return false;
+
+    SidecarHeader header;
+    bool valid = file.size() >= sizeof(header);
+    size_t offset = 0;
+    if (valid) {
+        std::memcpy(&header, file.data(), sizeof(header));
+        offset = sizeof(header) + paddedPathLength(header.pathLength);
+        // The hash in the name can collide; the header says what was cached
+        valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                header.pathLength == source.path.size() && file.size() >= offset &&
+                header.sourceSize == source.size && header.sourceModifiedNanos == source.modifiedNanos &&
+                std::memcmp(file.data() + sizeof(header), source.path.data(), source.path.size()) == 0;
+    }
+    if (!valid || !pyramid.load(std::move(file), offset)) {
+        return false;
+    }
+
+    const int64_t now = nowNanos();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!scanned) scanLocked();
+        auto it = entries.find(name);
+        if (it != entries.end()) it->second.lastUsed = now;
+    }
+    // Persist the use for the next process's LRU order
+    const timespec times[2] = {{0, UTIME_OMIT}, {now / 1000000000, static_cast<long>(now % 1000000000)}};
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+    return true;
+}
+
+bool WaveformCache::store(const WaveformSource& source, const WaveformPyramid& pyramid) {
+    if (source.path.size() > MAX_PATH_LENGTH) return false;
+    std::vector<uint8_t> blob(pyramid.serializedSize(CACHED_FIRST_LEVEL));
+    if (blob.empty()) return false;
+    pyramid.serialize(CACHED_FIRST_LEVEL, blob.data());
+
+    SidecarHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.pathLength = static_cast<uint32_t>(source.path.size());
+    header.sourceSize = source.size;
+    header.sourceModifiedNanos = source.modifiedNanos;
+    const char padding[8] = {};
+    const size_t pad = paddedPathLength(source.path.size()) - source.path.size();
+
+    const std::string name = fileName(source);
+    const std::string path = directory + "/" + name;
+    if (!writeFileAtomically(path.c_str(), {{&header, sizeof(header)},
+                                            {source.path.data(), source.path.size()},
+                                            {padding, pad},
+                                            {blob.data(), blob.size()}})) {
+        return false;
+    }
+
+    const auto bytes = static_cast<int64_t>(sizeof(header) + source.path.size() + pad + blob.size());
+    std::lock_guard<std::mutex> guard(lock);
+    if (!scanned) scanLocked();
+    auto [it, inserted] = entries.try_emplace(name, Entry{0, 0});
+    totalBytes += bytes - it->second.bytes;
+    it->second = {bytes, nowNanos()};
+    evictLocked();
+    return true;
+}
+
+// Rebuilds the bookkeeping from the directory; runs once per process
+void WaveformCache::scanLocked() {
+    scanned = true;
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) return;
+    while (const dirent* item = readdir(dir)) {
+        const bool sidecar = endsWith(item->d_name, SUFFIX, SUFFIX_LENGTH);
+        const bool temporary = endsWith(item->d_name, ".tmp", 4);
+        if (!sidecar && !temporary) continue;
+        const std::string path = directory + "/" + item->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (temporary) {
+            // Left behind by a write that never finished
+            if (nowNanos() / 1000000000 - st.st_mtim.tv_sec > 60) unlink(path.c_str());
+            continue;
+        }
+        const auto bytes = static_cast<int64_t>(st.st_size);
+        const int64_t used = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        auto [it, inserted] = entries.try_emplace(item->d_name, Entry{0, 0});
+        totalBytes += bytes - it->second.bytes;
+        it->second = {bytes, std::max(used, it->second.lastUsed)};
+    }
+    closedir(dir);
+    evictLocked();
+}
+
+void WaveformCache::evictLocked() {
+    if (totalBytes <= budget) return;
+    std::vector<std::pair<int64_t, std::string>> byAge;
+    byAge.reserve(entries.size());
+    for (const auto& [name, entry] : entries) byAge.emplace_back(entry.lastUsed, name);
+    std::sort(byAge.begin(), byAge.end());
+    for (const auto& [lastUsed, name] : byAge) {
+        if (totalBytes <= budget) break;
+        unlink((directory + "/" + name).c_str());
+        totalBytes -= entries[name].bytes;
+        entries.erase(name);
+    }
+}
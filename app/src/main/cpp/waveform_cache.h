@@ -0,0 +1,65 @@
+#ifndef WAVEFORM_CACHE_H
+#define WAVEFORM_CACHE_H
+
+#include "waveform_pyramid.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Identity of a source file: a cached waveform is valid while all three match
+struct WaveformSource {
+    std::string path;
+    int64_t size = 0;
+    int64_t modifiedNanos = 0;
+
+    // False if the file does not exist
+    static bool describe(const char* path, WaveformSource& source);
+};
+
+/**
+ * Waveform pyramids persisted as one sidecar file per source in a cache
+ * directory, so lists of tracks can draw waveforms without reading audio.
+ *
+ * Sidecars hold levels from CACHED_FIRST_LEVEL up (4096-frame buckets,
+ * ~85 ms at 48 kHz: a few hundred KB per hour of audio) and are read back
+ * through a memory map. Their names hash the source path, size and mtime, so
+ * an edited or replaced file simply misses. The directory is kept under a
+ * byte budget by evicting the least recently used sidecars; use is recorded
+ * in the sidecars' mtimes, so the order survives restarts.
+ *
+ * Thread-safe: lookups and stores from several threads only serialize on
+ * the bookkeeping, never on file I/O.
+ */
+class WaveformCache {
+public:
+    static constexpr int CACHED_FIRST_LEVEL = 4;
+
+    WaveformCache(std::string directory, int64_t byteBudget);
+
+    // Loads the cached pyramid of 'source' into 'pyramid'; false on a miss
+    bool find(const WaveformSource& source, WaveformPyramid& pyramid);
+
+    // Persists 'pyramid' for 'source', evicting older sidecars over budget
+    bool store(const WaveformSource& source, const WaveformPyramid& pyramid);
+
+private:
+    struct Entry {
+        int64_t bytes;
+        int64_t lastUsed; // wall-clock ns
+    };
+
+    const std::string directory;
+    const int64_t budget;
+
+    std::mutex lock;
+    std::unordered_map<std::string, Entry> entries; // by sidecar file name
+    int64_t totalBytes = 0;
+    bool scanned = false;
+
+    std::string fileName(const WaveformSource& source) const;
+    void scanLocked();
+    void evictLocked();
+};
+
+#endif // WAVEFORM_CACHE_H
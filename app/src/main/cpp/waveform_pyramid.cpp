@@ -0,0 +1,313 @@
+#include "waveform_pyramid.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define WAVEFORM_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define WAVEFORM_SSE2 1
+#endif
+
+namespace {
+
+// Level-0 buckets per parallel task: 256K frames, a few hundred tasks for a
+// typical track, so the pool balances well without per-task overhead showing
+constexpr size_t CHUNK_BUCKETS = 1024;
+
+constexpr uint32_t SERIALIZED_MAGIC = 0x59505753; // "SWPY"
+constexpr uint32_t MAX_LEVEL = 40;
+
+struct SerializedHeader {
+    uint32_t magic;
+    uint32_t channels;
+    int64_t frames;
+    uint32_t sampleRate;
+    uint32_t firstLevel; // absolute level of the first one stored
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(SerializedHeader) == 32, "unexpected header padding");
+
+} // namespace
+
+void WaveformPyramid::reduce(const float* samples, int n, float& min, float& max, float& sumSquares) {
+    if (n <= 0) {
+        min = max = sumSquares = 0.0f;
+        return;
+    }
+    int i = 0;
+    float lo = samples[0], hi = samples[0], squares = 0.0f;
+
+#if WAVEFORM_NEON
+    if (n >= 8) {
+        // Two accumulator sets hide the min/max/multiply-add latency
+        float32x4_t lo0 = vdupq_n_f32(lo), lo1 = lo0, hi0 = lo0, hi1 = lo0;
+        float32x4_t sq0 = vdupq_n_f32(0.0f), sq1 = sq0;
+        for (; i + 8 <= n; i += 8) {
+            const float32x4_t a = vld1q_f32(samples + i);
+            const float32x4_t b = vld1q_f32(samples + i + 4);
+            lo0 = vminq_f32(lo0, a);
+            lo1 = vminq_f32(lo1, b);
+            hi0 = vmaxq_f32(hi0, a);
+            hi1 = vmaxq_f32(hi1, b);
+            sq0 = vmlaq_f32(sq0, a, a);
+            sq1 = vmlaq_f32(sq1, b, b);
+        }
+        float l[4], h[4], s[4];
+        vst1q_f32(l, vminq_f32(lo0, lo1));
+        vst1q_f32(h, vmaxq_f32(hi0, hi1));
+        vst1q_f32(s, vaddq_f32(sq0, sq1));
+        lo = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+        hi = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+        squares = (s[0] + s[1]) + (s[2] + s[3]);
+    }
+#elif WAVEFORM_SSE2
+    if (n >= 8) {
+        __m128 lo0 = _mm_set1_ps(lo), lo1 = lo0, hi0 = lo0, hi1 = lo0;
+        __m128 sq0 = _mm_setzero_ps(), sq1 = sq0;
+        for (; i + 8 <= n; i += 8) {
+            const __m128 a = _mm_loadu_ps(samples + i);
+            const __m128 b = _mm_loadu_ps(samples + i + 4);
+            lo0 = _mm_min_ps(lo0, a);
+            lo1 = _mm_min_ps(lo1, b);
+            hi0 = _mm_max_ps(hi0, a);
+            hi1 = _mm_max_ps(hi1, b);
+            sq0 = _mm_add_ps(sq0, _mm_mul_ps(a, a));
+            sq1 = _mm_add_ps(sq1, _mm_mul_ps(b, b));
+        }
+        float l[4], h[4], s[4];
+        _mm_storeu_ps(l, _mm_min_ps(lo0, lo1));
+        _mm_storeu_ps(h, _mm_max_ps(hi0, hi1));
+        _mm_storeu_ps(s, _mm_add_ps(sq0, sq1));
+        lo = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+        hi = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+        squares = (s[0] + s[1]) + (s[2] + s[3]);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        lo = std::min(lo, samples[i]);
+        hi = std::max(hi, samples[i]);
+        squares += samples[i] * samples[i];
+    }
+    min = lo;
+    max = hi;
+    sumSquares = squares;
+}
+
+size_t WaveformPyramid::bucketsAt(int64_t frames, int level) {
+    const int64_t bucketFrames = int64_t{BASE_FRAMES} << level;
+    return static_cast<size_t>((frames + bucketFrames - 1) / bucketFrames);
+}
+
+// Points the level views at 'data': per level, its mins, maxes and sums of
+// squares back to back
+void WaveformPyramid::layOut(const float* data, int firstLevel, int count) {
+    levels.clear();
+    baseLevel = firstLevel;
+    for (int level = firstLevel; level < firstLevel + count; ++level) {
+        const size_t buckets = bucketsAt(totalFrames, level);
+        levels.push_back({data, data + buckets, data + 2 * buckets, buckets, int64_t{BASE_FRAMES} << level});
+        data += 3 * buckets;
+    }
+}
+
+// Sets up empty storage and level views for a stream of 'frames' frames
+bool WaveformPyramid::allocate(int64_t frames, int channels, int sampleRate) {
+    levels.clear();
+    mapping = MappedFile();
+    if (frames <= 0 || channels <= 0) return false;
+    totalFrames = frames;
+    numChannels = channels;
+    rate = sampleRate;
+
+    int levelTotal = 1;
+    size_t floats = 3 * bucketsAt(totalFrames, 0);
+    while (bucketsAt(totalFrames, levelTotal - 1) > 1) floats += 3 * bucketsAt(totalFrames, levelTotal++);
+    storage.assign(floats, 0.0f);
+    layOut(storage.data(), 0, levelTotal);
+    return true;
+}
+
+bool WaveformPyramid::build(const uint8_t* data, const PcmStreamInfo& info, int threads) {
+    if (!allocate(info.frames, info.channels, info.sampleRate)) return false;
+
+    float* baseMin = storage.data();
+    float* baseMax = baseMin + levels[0].count;
+    float* baseSquares = baseMax + levels[0].count;
+    const size_t buckets = levels[0].count;
+    const int frameBytes = info.frameBytes();
+    const size_t chunks = (buckets + CHUNK_BUCKETS - 1) / CHUNK_BUCKETS;
+    parallelFor(chunks, threads, [&](size_t chunk) {
+        std::vector<float> scratch(static_cast<size_t>(BASE_FRAMES) * numChannels);
+        const size_t end = std::min(buckets, (chunk + 1) * CHUNK_BUCKETS);
+        for (size_t b = chunk * CHUNK_BUCKETS; b < end; ++b) {
+            const int64_t first = static_cast<int64_t>(b) * BASE_FRAMES;
+            const int samples = static_cast<int>(std::min<int64_t>(BASE_FRAMES, totalFrames - first)) * numChannels;
+            samplesToFloat(data + first * frameBytes, info, scratch.data(), samples);
+            reduce(scratch.data(), samples, baseMin[b], baseMax[b], baseSquares[b]);
+        }
+    });
+    mergeUpperLevels();
+    return true;
+}
+
+bool WaveformPyramid::build(PcmReader& reader, int threads) {
+    if (const PcmStreamInfo* info = reader.pcm()) return build(reader.data() + info->dataOffset, *info, threads);
+
+    // Compressed streams only decode in order, and may not say how long they
+    // are: reduce bucket by bucket, then lay the pyramid out
+    const int channels = reader.channels();
+    if (channels <= 0) return false;
+    std::vector<float> scratch(static_cast<size_t>(BASE_FRAMES) * channels);
+    std::vector<float> mins, maxes, squares;
+    if (reader.frames() > 0) {
+        const size_t expected = bucketsAt(reader.frames(), 0);
+        mins.reserve(expected);
+        maxes.reserve(expected);
+        squares.reserve(expected);
+    }
+    int64_t frames = 0;
+    for (;;) {
+        const int n = reader.read(scratch.data(), BASE_FRAMES);
+        if (n <= 0) break;
+        float lo, hi, sum;
+        reduce(scratch.data(), n * channels, lo, hi, sum);
+        mins.push_back(lo);
+        maxes.push_back(hi);
+        squares.push_back(sum);
+        frames += n;
+        if (n < BASE_FRAMES) break;
+    }
+
+    if (!allocate(frames, channels, reader.sampleRate())) return false;
+    const size_t bytes = mins.size() * sizeof(float);
+    std::memcpy(const_cast<float*>(levels[0].min), mins.data(), bytes);
+    std::memcpy(const_cast<float*>(levels[0].max), maxes.data(), bytes);
+    std::memcpy(const_cast<float*>(levels[0].sumSquares), squares.data(), bytes);
+    mergeUpperLevels();
+    return true;
+}
+
+// Upper levels pair up the buckets below; an odd last bucket stands alone
+void WaveformPyramid::mergeUpperLevels() {
+    for (size_t level = 1; level < levels.size(); ++level) {
+        const Level& src = levels[level - 1];
+        const Level& dst = levels[level];
+        auto* min = const_cast<float*>(dst.min);
+        auto* max = const_cast<float*>(dst.max);
+        auto* squares = const_cast<float*>(dst.sumSquares);
+        for (size_t i = 0; i < dst.count; ++i) {
+            const size_t a = 2 * i;
+            if (a + 1 < src.count) {
+                min[i] = std::min(src.min[a], src.min[a + 1]);
+                max[i] = std::max(src.max[a], src.max[a + 1]);
+                squares[i] = src.sumSquares[a] + src.sumSquares[a + 1];
+            } else {
+                min[i] = src.min[a];
+                max[i] = src.max[a];
+                squares[i] = src.sumSquares[a];
+            }
+        }
+    }
+}
+
+// Index into levels of absolute level 'level', clamped to those present
+int WaveformPyramid::levelIndex(int level) const {
+    return std::clamp(level - baseLevel, 0, levelCount() - 1);
+}
+
+size_t WaveformPyramid::serializedSize(int firstLevel) const {
+    if (levels.empty()) return 0;
+    size_t floats = 0;
+    for (int i = levelIndex(firstLevel); i < levelCount(); ++i) floats += 3 * levels[i].count;
+    return sizeof(SerializedHeader) + floats * sizeof(float);
+}
+
+void WaveformPyramid::serialize(int firstLevel, uint8_t* out) const {
+    if (levels.empty()) return;
+    const int first = levelIndex(firstLevel);
+    SerializedHeader header{};
+    header.magic = SERIALIZED_MAGIC;
+    header.frames = totalFrames;
+    header.channels = static_cast<uint32_t>(numChannels);
+    header.sampleRate = static_cast<uint32_t>(rate);
+    header.firstLevel = static_cast<uint32_t>(baseLevel + first);
+    header.levelCount = static_cast<uint32_t>(levelCount() - first);
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (int i = first; i < levelCount(); ++i) {
+        const size_t bytes = levels[i].count * sizeof(float);
+        std::memcpy(out, levels[i].min, bytes);
+        std::memcpy(out + bytes, levels[i].max, bytes);
+        std::memcpy(out + 2 * bytes, levels[i].sumSquares, bytes);
+        out += 3 * bytes;
+    }
+}
+
+void WaveformPyramid::dropLevelsBelow(int firstLevel) {
+    if (levels.empty()) return;
+    const int first = levelIndex(firstLevel);
+    levels.erase(levels.begin(), levels.begin() + first);
+    baseLevel += first;
+}
+
+bool WaveformPyramid::load(MappedFile&& file, size_t offset) {
+    levels.clear();
+    storage.clear();
+    mapping = std::move(file);
+    if (!mapping.isOpen() || offset % alignof(float) != 0 || mapping.size() < offset + sizeof(SerializedHeader)) return false;
+
+    SerializedHeader header;
+    std::memcpy(&header, mapping.data() + offset, sizeof(header));
+    if (header.magic != SERIALIZED_MAGIC || header.frames <= 0 || header.channels == 0 ||
+        header.firstLevel > MAX_LEVEL || header.levelCount == 0 || header.firstLevel + header.levelCount > MAX_LEVEL + 1 ||
+        bucketsAt(header.frames, static_cast<int>(header.firstLevel + header.levelCount - 1)) != 1) {
+        return false;
+    }
+    totalFrames = header.frames;
+    numChannels = static_cast<int>(header.channels);
+    rate = static_cast<int>(header.sampleRate);
+
+    size_t floats = 0;
+    for (uint32_t i = 0; i < header.levelCount; ++i) floats += 3 * bucketsAt(totalFrames, static_cast<int>(header.firstLevel + i));
+    if (mapping.size() - offset - sizeof(SerializedHeader) < floats * sizeof(float)) return false;
+    layOut(reinterpret_cast<const float*>(mapping.data() + offset + sizeof(SerializedHeader)),
+           static_cast<int>(header.firstLevel), static_cast<int>(header.levelCount));
+    return true;
+}
+
+int WaveformPyramid::points(int64_t startFrame, int64_t endFrame, int numPoints, WaveformPoint* out) const {
+    if (levels.empty() || numPoints <= 0) return 0;
+    const int64_t start = std::clamp<int64_t>(startFrame, 0, totalFrames);
+    const int64_t end = std::clamp<int64_t>(endFrame, start, totalFrames);
+    if (end <= start) return 0;
+
+    const double span = static_cast<double>(end - start) / numPoints;
+    size_t level = 0;
+    while (level + 1 < levels.size() && static_cast<double>(levels[level + 1].bucketFrames) <= span) ++level;
+    const Level& src = levels[level];
+    const int64_t bucketFrames = src.bucketFrames;
+
+    for (int p = 0; p < numPoints; ++p) {
+        const int64_t a = start + static_cast<int64_t>(p * span);
+        const int64_t b = std::max(a + 1, std::min(end, start + static_cast<int64_t>((p + 1) * span)));
+        const size_t first = static_cast<size_t>(a / bucketFrames);
+        const size_t last = static_cast<size_t>((b - 1) / bucketFrames);
+
+        float lo = src.min[first], hi = src.max[first], squares = 0.0f;
+        for (size_t i = first; i <= last; ++i) {
+            lo = std::min(lo, src.min[i]);
+            hi = std::max(hi, src.max[i]);
+            squares += src.sumSquares[i];
+        }
+        const int64_t covered = std::min(totalFrames, static_cast<int64_t>(last + 1) * bucketFrames) -
+                                static_cast<int64_t>(first) * bucketFrames;
+        out[p] = {lo, hi, std::sqrt(squares / static_cast<float>(covered * numChannels))};
+    }
+    return numPoints;
+}
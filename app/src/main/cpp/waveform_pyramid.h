@@ -0,0 +1,95 @@
+#ifndef WAVEFORM_PYRAMID_H
+#define WAVEFORM_PYRAMID_H
+
+#include "audio_file.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct WaveformPoint {
+    float min;
+    float max;
+    float rms;
+};
+
+/**
+ * Min / max / RMS of a whole track at every power-of-two zoom level.
+ *
+ * Level 0 holds one bucket per BASE_FRAMES frames (all channels together),
+ * computed from every sample in one SIMD pass; the track is cut into
+ * bucket-aligned chunks reduced in parallel. Each further level merges pairs
+ * of buckets of the one below until a single bucket covers the track, so the
+ * pyramid is under twice the size of level 0 and any view of the track can
+ * be drawn from the level closest to its zoom without touching the audio.
+ *
+ * A pyramid can be serialized from any level up and read back in place from
+ * a mapping, which is how WaveformCache serves hits without copying.
+ */
+class WaveformPyramid {
+public:
+    static constexpr int BASE_FRAMES = 256;
+
+    // Reduces the stream at 'data' (as described by parseWav) on up to
+    // 'threads' threads (<= 0: one per core). False if it holds no frames.
+    bool build(const uint8_t* data, const PcmStreamInfo& info, int threads);
+
+    // Reduces everything 'reader' yields: in parallel as above for
+    // uncompressed files, as it decodes for FLAC. False if it holds no frames.
+    bool build(PcmReader& reader, int threads);
+
+    // Serialized form of levels firstLevel and up (clamped to the levels
+    // present); out must hold serializedSize(firstLevel) bytes. Level 0 is
+    // the BASE_FRAMES one even in a pyramid loaded without it.
+    size_t serializedSize(int firstLevel) const;
+    void serialize(int firstLevel, uint8_t* out) const;
+
+    // Discards the levels below firstLevel (clamped the same way), leaving
+    // what a pyramid loaded from serialize(firstLevel) would hold
+    void dropLevelsBelow(int firstLevel);
+
+    // Reads a serialized pyramid at 'offset' (4-byte aligned) in 'file',
+    // which the pyramid then keeps mapped. False if it is malformed.
+    bool load(MappedFile&& file, size_t offset);
+
+    int64_t frames() const { return totalFrames; }
+    int channels() const { return numChannels; }
+    int sampleRate() const { return rate; }
+    int levelCount() const { return static_cast<int>(levels.size()); }
+
+    /**
+     * Fills numPoints points spread evenly over frames [startFrame, endFrame)
+     * from the coarsest level whose buckets are no wider than a point. When
+     * points are narrower than the finest bucket, neighbours repeat it.
+     * Returns the number of points written (0 for an empty range).
+     */
+    int points(int64_t startFrame, int64_t endFrame, int numPoints, WaveformPoint* out) const;
+
+    // Min, max and sum of squares of n samples. Exposed for benchmarking.
+    static void reduce(const float* samples, int n, float& min, float& max, float& sumSquares);
+
+private:
+    struct Level {
+        const float* min;
+        const float* max;
+        const float* sumSquares;
+        size_t count;
+        int64_t bucketFrames;
+    };
+
+    std::vector<Level> levels;  // finest first
+    std::vector<float> storage; // built pyramids
+    MappedFile mapping;         // loaded pyramids
+    int baseLevel = 0;          // absolute level of levels[0]
+    int64_t totalFrames = 0;
+    int numChannels = 0;
+    int rate = 0;
+
+    static size_t bucketsAt(int64_t frames, int level);
+    bool allocate(int64_t frames, int channels, int sampleRate);
+    void mergeUpperLevels();
+    void layOut(const float* data, int firstLevel, int count);
+    int levelIndex(int level) const;
+};
+
+#endif // WAVEFORM_PYRAMID_H
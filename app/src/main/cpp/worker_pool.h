@@ -0,0 +1,134 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Process-wide set of worker threads, started on first use and kept for the
+ * life of the process, so a parallel job costs a wake-up rather than thread
+ * creation and teardown.
+ *
+ * A job is run by the calling thread plus as many idle workers as it asks
+ * for and can get; the caller always works through the whole job itself if
+ * no worker is free, so jobs may be submitted from several threads at once,
+ * and from inside another job, without deadlocking.
+ */
+class WorkerPool {
+public:
+    static WorkerPool& shared() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    // Threads available to a job, counting the caller
+    int concurrency() const { return static_cast<int>(workers.size()) + 1; }
+
+    // See parallelFor
+    template <typename Fn>
+    void run(size_t count, int threads, Fn& fn) {
+        Job job;
+        job.fn = &fn;
+        job.call = [](void* f, size_t i) { (*static_cast<Fn*>(f))(i); };
+        job.count = count;
+        job.helpersWanted = std::min<size_t>(count, static_cast<size_t>(threads)) - 1;
+
+        if (job.helpersWanted > 0) {
+            std::lock_guard<std::mutex> guard(lock);
+            jobs.push_back(&job);
+        }
+        if (job.helpersWanted > 0) wake.notify_all();
+        job.work();
+        if (job.helpersWanted == 0) return;
+
+        std::unique_lock<std::mutex> guard(lock);
+        jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+        finished.wait(guard, [&] { return job.helpersActive == 0; });
+    }
+
+private:
+    struct Job {
+        void* fn;
+        void (*call)(void*, size_t);
+        size_t count;
+        std::atomic<size_t> next{0};
+        size_t helpersWanted;
+        size_t helpersJoined = 0; // under lock
+        size_t helpersActive = 0; // under lock
+
+        void work() {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) call(fn, i);
+        }
+    };
+
+    WorkerPool() {
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        workers.reserve(cores - 1);
+        for (unsigned w = 1; w < cores; ++w) workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) t.join();
+    }
+
+    // A queued job that still wants helpers and has items left, or nullptr
+    Job* claimable() const {
+        for (Job* job : jobs) {
+            if (job->helpersJoined < job->helpersWanted && job->next.load(std::memory_order_relaxed) < job->count) {
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            Job* job = nullptr;
+            wake.wait(guard, [&] { return stopping || (job = claimable()) != nullptr; });
+            if (stopping) return;
+            ++job->helpersJoined;
+            ++job->helpersActive;
+            guard.unlock();
+            job->work();
+            guard.lock();
+            if (--job->helpersActive == 0) finished.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::vector<Job*> jobs;
+    bool stopping = false;
+};
+
+/**
+ * Runs fn(i) for every i in [0, count) on up to `threads` threads (0: one
+ * per core; never more than one per core) and returns when all calls have
+ * finished. Items are handed out one at a time from a shared counter, so
+ * uneven item costs (files of different lengths) balance themselves. The
+ * calling thread works too; the others come from WorkerPool::shared().
+ *
+ * Off the audio thread only: the caller may block waiting for workers.
+ */
+template <typename Fn>
+void parallelFor(size_t count, int threads, Fn&& fn) {
+    if (count == 0) return;
+    WorkerPool& pool = WorkerPool::shared();
+    if (threads <= 0) threads = pool.concurrency();
+    pool.run(count, threads, fn);
+}
+
+#endif // WORKER_POOL_H
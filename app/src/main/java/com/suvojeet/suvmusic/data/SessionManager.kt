@@ -183,9 +183,15 @@ class SessionManager @Inject constructor(
         private val AUDIO_OFFLOAD_ENABLED_KEY = booleanPreferencesKey("audio_offload_enabled")
         private val VOLUME_BOOST_ENABLED_KEY = booleanPreferencesKey("volume_boost_enabled")
         private val VOLUME_BOOST_AMOUNT_KEY = intPreferencesKey("volume_boost_amount")
-        // JSON map of {songId -> measured RMS amplitude (0..1)} used for
-        // Spotify-style perceptual loudness normalization.
-        private val LOUDNESS_CACHE_KEY = stringPreferencesKey("loudness_cache_v1")
+        // JSON map of {songId -> integrated loudness (LUFS)} used for
+        // Spotify-style perceptual loudness normalization. v1 held unweighted
+        // RMS amplitudes and is no longer read.
+        private val LOUDNESS_CACHE_KEY = stringPreferencesKey("loudness_cache_v2")
+        private val LEGACY_LOUDNESS_CACHE_KEY = stringPreferencesKey("loudness_cache_v1")
+        // Range of plausible integrated loudness (the R128 absolute gate up to
+        // full-scale square waves)
+        private const val MIN_LOUDNESS_LUFS = -70f
+        private const val MAX_LOUDNESS_LUFS = 3f
         // Spatial audio strength 0..100. Drives how aggressively spatial
         // panning + crossfeed apply.
         private val SPATIAL_STRENGTH_KEY = intPreferencesKey("spatial_audio_strength")
@@ -2270,11 +2276,12 @@ class SessionManager @Inject constructor(
 
     // ----- Per-track loudness cache (volume normalization) -----
     //
-    // We persist a map {songId -> RMS amplitude (0..1)} measured the first
-    // time a track plays. On subsequent plays we apply a per-track gain to
-    // bring the song to a target perceived loudness, similar to Spotify's
+    // We persist a map {songId -> integrated loudness in LUFS (EBU R128)}
+    // measured the first time a track plays. On subsequent plays we apply a
+    // per-track gain to bring the song to a target loudness, like Spotify's
     // -14 LUFS reference. Cap entries to keep the JSON small.
     private val MAX_LOUDNESS_CACHE_ENTRIES = 5_000
+    private val LOUDNESS_CACHE_MIRROR = "loudness_cache_mirror_v2"
 
     suspend fun getLoudnessCache(): Map<String, Float> {
         val raw = context.dataStore.data.first()[LOUDNESS_CACHE_KEY] ?: return emptyMap()
@@ -2283,17 +2290,17 @@ class SessionManager @Inject constructor(
 
     fun getLoudnessCacheBlocking(): Map<String, Float> {
         return try {
-            val raw = encryptedPrefs.getString("loudness_cache_mirror", null) ?: return emptyMap()
+            val raw = encryptedPrefs.getString(LOUDNESS_CACHE_MIRROR, null) ?: return emptyMap()
             parseLoudnessJson(raw)
         } catch (_: Exception) {
             emptyMap()
         }
     }
 
-    suspend fun setLoudnessForSong(songId: String, rms: Float) {
-        if (songId.isBlank() || rms.isNaN() || rms <= 0f) return
+    suspend fun setLoudnessForSong(songId: String, lufs: Float) {
+        if (songId.isBlank() || !lufs.isFinite()) return
         val current = getLoudnessCache().toMutableMap()
-        current[songId] = rms.coerceIn(0.0001f, 1f)
+        current[songId] = lufs.coerceIn(MIN_LOUDNESS_LUFS, MAX_LOUDNESS_LUFS)
         // Trim oldest entries if we exceed the cap (LinkedHashMap preserves
         // insertion order, but we re-key into a fresh map of the most recent
         // N entries).
@@ -2303,13 +2310,19 @@ class SessionManager @Inject constructor(
                 .associate { it.key to it.value }
         } else current
         val json = serializeLoudnessJson(pruned)
-        context.dataStore.edit { it[LOUDNESS_CACHE_KEY] = json }
-        try { encryptedPrefs.edit().putString("loudness_cache_mirror", json).apply() } catch (_: Exception) {}
+        context.dataStore.edit {
+            it[LOUDNESS_CACHE_KEY] = json
+            it.remove(LEGACY_LOUDNESS_CACHE_KEY)
+        }
+        try { encryptedPrefs.edit().putString(LOUDNESS_CACHE_MIRROR, json).remove("loudness_cache_mirror").apply() } catch (_: Exception) {}
     }
 
     suspend fun clearLoudnessCache() {
-        context.dataStore.edit { it.remove(LOUDNESS_CACHE_KEY) }
-        try { encryptedPrefs.edit().remove("loudness_cache_mirror").apply() } catch (_: Exception) {}
+        context.dataStore.edit {
+            it.remove(LOUDNESS_CACHE_KEY)
+            it.remove(LEGACY_LOUDNESS_CACHE_KEY)
+        }
+        try { encryptedPrefs.edit().remove(LOUDNESS_CACHE_MIRROR).remove("loudness_cache_mirror").apply() } catch (_: Exception) {}
     }
 
     private fun parseLoudnessJson(raw: String): Map<String, Float> {
@@ -2318,7 +2331,7 @@ class SessionManager @Inject constructor(
             val out = mutableMapOf<String, Float>()
             obj.keys().forEach { k ->
                 val v = obj.optDouble(k, Double.NaN).toFloat()
-                if (!v.isNaN() && v > 0f) out[k] = v
+                if (v in MIN_LOUDNESS_LUFS..MAX_LOUDNESS_LUFS) out[k] = v
             }
             out
         } catch (_: Exception) {
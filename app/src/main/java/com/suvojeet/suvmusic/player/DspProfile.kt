@@ -0,0 +1,89 @@
+package com.suvojeet.suvmusic.player
+
+/**
+ * Snapshot of a native DSP chain's render timing, decoded from the flat array
+ * written by DspProfiler::snapshot (dsp_profiler.h).
+ *
+ * Times are per render callback: a stage's figures cover only the callbacks
+ * it ran in, summed over the callback's sub-blocks. "Load" is processing time
+ * over the duration of the buffer processed; above 100% the chain alone could
+ * not keep up in real time.
+ */
+data class DspProfile(
+    val callbacks: Long,
+    val budgetOverruns: Long,
+    val busyNanos: Long,
+    val budgetNanos: Long,
+    val maxLoadPercent: Float,
+    /** Callbacks per 10% load step; the last bucket holds everything from 150%. */
+    val loadHistogram: LongArray,
+    val callback: Timing,
+    val stages: Map<Stage, Timing>
+) {
+    enum class Stage { CONVERT, CROSSFEED, TONE, STEREO_MATRIX, PITCH_SHIFT, SPATIALIZE, LIMIT, METER }
+
+    class Timing(
+        val count: Long,
+        val totalNanos: Long,
+        val maxNanos: Long,
+        /** Log2 buckets: 0 is under 1 us, bucket b covers 2^(b+9)..2^(b+10) ns. */
+        val histogram: LongArray
+    ) {
+        val averageNanos: Long get() = if (count > 0) totalNanos / count else 0L
+
+        /** Upper bound of the bucket holding the given quantile (0..1), in ns. */
+        fun quantileNanos(q: Float): Long {
+            if (count <= 0) return 0L
+            val target = (q.coerceIn(0f, 1f) * count).toLong().coerceAtLeast(1L)
+            var seen = 0L
+            histogram.forEachIndexed { bucket, n ->
+                seen += n
+                if (seen >= target) return 1L shl (bucket + 10)
+            }
+            return maxNanos
+        }
+    }
+
+    /** Mean load across all profiled callbacks, in percent. */
+    val averageLoadPercent: Float
+        get() = if (budgetNanos > 0) 100f * busyNanos / budgetNanos else 0f
+
+    /** Stage with the largest total time, or null before any callback ran. */
+    val costliestStage: Stage?
+        get() = stages.filterValues { it.count > 0 }.maxByOrNull { it.value.totalNanos }?.key
+
+    companion object {
+        private const val VERSION = 1
+        private const val LOAD_BUCKETS = 16
+        private const val TIME_BUCKETS = 20
+        private const val HEADER = 6
+        private const val TIMING_LONGS = 3 + TIME_BUCKETS
+        private val SIZE = HEADER + LOAD_BUCKETS + TIMING_LONGS * (1 + Stage.entries.size)
+
+        /** Returns null for arrays from a native library with another layout. */
+        fun fromArray(values: LongArray?): DspProfile? {
+            if (values == null || values.size != SIZE || values[0] != VERSION.toLong()) return null
+
+            fun timingAt(offset: Int) = Timing(
+                count = values[offset],
+                totalNanos = values[offset + 1],
+                maxNanos = values[offset + 2],
+                histogram = values.copyOfRange(offset + 3, offset + TIMING_LONGS)
+            )
+
+            val timingsStart = HEADER + LOAD_BUCKETS
+            return DspProfile(
+                callbacks = values[1],
+                budgetOverruns = values[2],
+                busyNanos = values[3],
+                budgetNanos = values[4],
+                maxLoadPercent = values[5] / 10f,
+                loadHistogram = values.copyOfRange(HEADER, timingsStart),
+                callback = timingAt(timingsStart),
+                stages = Stage.entries.associateWith { stage ->
+                    timingAt(timingsStart + TIMING_LONGS * (1 + stage.ordinal))
+                }
+            )
+        }
+    }
+}
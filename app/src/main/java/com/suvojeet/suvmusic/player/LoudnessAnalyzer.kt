@@ -10,20 +10,22 @@ import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
 import javax.inject.Inject
 import javax.inject.Singleton
-import kotlin.math.log10
-import kotlin.math.max
-import kotlin.math.min
-import kotlin.math.pow
 
 /**
  * Spotify-style volume normalization.
  *
- * Tracks the running RMS of the currently playing song by sampling the
- * native engine's RMS readout, and persists the per-track average so we can
- * compute a stable per-track gain offset on subsequent plays. Computed in
- * [gainOffsetForRms] as `targetRms / measuredRms` expressed in dB and
- * clamped to a safe range so loud tracks aren't clipped and soft tracks
- * don't get pushed past the limiter's safety threshold.
+ * Measures each song's integrated loudness (ITU-R BS.1770 / EBU R128, in
+ * LUFS) with the native engine's gated K-weighted meter, and persists it
+ * so we can compute a stable per-track gain offset on subsequent plays.
+ * The meter reads the chain's input, so the normalization gain we apply
+ * never feeds back into the measurement. [gainOffsetForLufs] returns
+ * `targetLufs - measured` clamped to a safe range so loud tracks aren't
+ * clipped and soft tracks don't get pushed past the limiter's safety
+ * threshold.
+ *
+ * Songs with a local file usually have a whole-file measurement from
+ * [LoudnessScanner] before their first play; that takes precedence and
+ * skips the playback measurement.
  *
  * The analyzer is intentionally passive: it does not apply any gain
  * itself. [MusicPlayerService] reads [getCachedGainDb] when a song starts
@@ -34,6 +36,7 @@ import kotlin.math.pow
 class LoudnessAnalyzer @Inject constructor(
     private val nativeSpatialAudio: NativeSpatialAudio,
     private val sessionManager: SessionManager,
+    private val loudnessScanner: LoudnessScanner,
 ) {
 
     private val scope = CoroutineScope(Dispatchers.Default + SupervisorJob())
@@ -47,24 +50,25 @@ class LoudnessAnalyzer @Inject constructor(
     // after cold start wait for real measurements instead of returning 0 dB.
     private val cacheReady = CompletableDeferred<Unit>()
 
-    // Running stats for the song currently being measured.
+    // Measurement state for the song currently playing.
     @Volatile private var currentSongId: String? = null
-    @Volatile private var rmsAccumulator: Double = 0.0
-    @Volatile private var rmsSampleCount: Int = 0
+    @Volatile private var isMeasuring = false
     @Volatile private var hasCommittedThisSong = false
 
     /**
-     * Target perceived loudness (RMS amplitude in 0..1). 0.18 corresponds
-     * roughly to -15 dBFS RMS, in the same ballpark as Spotify's -14 LUFS
-     * normalization target. Conservative enough that the limiter rarely
-     * needs to clamp peaks for typical mastered music.
+     * Target integrated loudness, Spotify's default normalization level.
      */
-    private val targetRms = 0.18f
+    private val targetLufs = -14f
 
     /** Hard caps on the per-track gain so we never clip badly mastered audio. */
     private val maxGainDb = 6f
     private val minGainDb = -8f
 
+    /** Seconds of audio to measure before committing mid-song. */
+    private val commitAfterSeconds = 30f
+    /** Shortest measurement we trust when a song ends early. */
+    private val minMeasuredSeconds = 5f
+
     init {
         scope.launch {
             cache = sessionManager.getLoudnessCache()
@@ -74,7 +78,7 @@ class LoudnessAnalyzer @Inject constructor(
     }
 
     /**
-     * Returns the per-track gain in dB to bring the cached RMS up to the
+     * Returns the per-track gain in dB to bring the cached loudness to the
      * normalization target. Returns 0f if we have no measurement yet — the
      * caller should keep its baseline makeup gain in that case so the user
      * still hears a uniform volume across the catalogue once measurements
@@ -82,8 +86,8 @@ class LoudnessAnalyzer @Inject constructor(
      */
     fun getCachedGainDb(songId: String?): Float {
         songId ?: return 0f
-        val rms = cache[songId] ?: return 0f
-        return gainOffsetForRms(rms)
+        val lufs = knownLufs(songId) ?: return 0f
+        return gainOffsetForLufs(lufs)
     }
 
     /**
@@ -94,16 +98,18 @@ class LoudnessAnalyzer @Inject constructor(
      */
     suspend fun getCachedGainDbAwait(songId: String?): Float {
         songId ?: return 0f
+        loudnessScanner.lookup(songId)?.let { return gainOffsetForLufs(it.integratedLufs) }
         cacheReady.await()
-        val rms = cache[songId] ?: return 0f
-        return gainOffsetForRms(rms)
+        val lufs = cache[songId] ?: return 0f
+        return gainOffsetForLufs(lufs)
     }
 
-    fun gainOffsetForRms(rms: Float): Float {
-        if (rms <= 0.0001f) return 0f
-        val ratio = targetRms / rms
-        val db = 20f * log10(ratio.toDouble()).toFloat()
-        return min(maxGainDb, max(minGainDb, db))
+    private fun knownLufs(songId: String): Float? =
+        loudnessScanner.lookup(songId)?.integratedLufs ?: cache[songId]
+
+    fun gainOffsetForLufs(lufs: Float): Float {
+        if (!lufs.isFinite()) return 0f
+        return (targetLufs - lufs).coerceIn(minGainDb, maxGainDb)
     }
 
     /**
@@ -121,35 +127,26 @@ class LoudnessAnalyzer @Inject constructor(
         commitPendingIfReady()
 
         currentSongId = songId
-        rmsAccumulator = 0.0
-        rmsSampleCount = 0
         hasCommittedThisSong = false
+        samplingJob?.cancel()
+        samplingJob = null
 
-        // Skip measurement if we already have a cached value — saves CPU
-        // and keeps the average stable across replays.
-        if (cache.containsKey(songId)) {
-            samplingJob?.cancel()
-            samplingJob = null
+        // Skip measurement if we already have a cached value — keeps the
+        // value stable across replays.
+        if (knownLufs(songId) != null) {
+            isMeasuring = false
             return
         }
 
-        samplingJob?.cancel()
+        // Gating makes leading silence harmless, so measure from the start
+        nativeSpatialAudio.resetLoudness()
+        isMeasuring = true
         samplingJob = scope.launch {
             try {
-                // Skip the first second (intro / silence) where RMS is
-                // biased low and would push the gain estimate too high.
-                delay(1_000)
-                while (true) {
-                    val sample = try { nativeSpatialAudio.getRmsLevel() } catch (_: Exception) { 0f }
-                    if (sample > 0.005f) {
-                        rmsAccumulator += sample.toDouble().pow(2.0)
-                        rmsSampleCount += 1
-                    }
-                    // Commit once we have ~30s of audio (300 samples @ 100ms).
-                    if (rmsSampleCount >= 300 && !hasCommittedThisSong) {
-                        commitPendingIfReady()
-                    }
-                    delay(100)
+                while (!hasCommittedThisSong) {
+                    delay(1_000)
+                    val reading = nativeSpatialAudio.getLoudness() ?: continue
+                    if (reading.measuredSeconds >= commitAfterSeconds) commitPendingIfReady()
                 }
             } catch (_: Exception) { /* job cancelled */ }
         }
@@ -164,25 +161,20 @@ class LoudnessAnalyzer @Inject constructor(
         samplingJob?.cancel()
         samplingJob = null
         currentSongId = null
-        rmsAccumulator = 0.0
-        rmsSampleCount = 0
+        isMeasuring = false
         hasCommittedThisSong = false
     }
 
     private fun commitPendingIfReady() {
-        if (hasCommittedThisSong) return
+        if (hasCommittedThisSong || !isMeasuring) return
         val id = currentSongId ?: return
-        val n = rmsSampleCount
-        // Need at least ~5s of valid samples (50 readings @ 100ms) before
-        // we trust the average enough to publish.
-        if (n < 50) return
-        val meanSquared = rmsAccumulator / n
-        val rms = kotlin.math.sqrt(meanSquared).toFloat()
-        if (rms <= 0f || rms.isNaN()) return
+        val reading = try { nativeSpatialAudio.getLoudness() } catch (_: Exception) { null } ?: return
+        if (reading.measuredSeconds < minMeasuredSeconds || !reading.hasIntegrated) return
 
         hasCommittedThisSong = true
+        val lufs = reading.integratedLufs
         scope.launch {
-            sessionManager.setLoudnessForSong(id, rms)
+            sessionManager.setLoudnessForSong(id, lufs)
             cache = sessionManager.getLoudnessCache()
         }
     }
@@ -0,0 +1,24 @@
+package com.suvojeet.suvmusic.player
+
+/**
+ * EBU R128 loudness of a native chain's input, measured since its last
+ * loudness reset. Loudness values are negative infinity until enough audio
+ * has been seen (400 ms momentary, 3 s short-term, one gated block
+ * integrated).
+ */
+data class LoudnessReading(
+    val momentaryLufs: Float,
+    val shortTermLufs: Float,
+    val integratedLufs: Float,
+    val loudnessRangeLu: Float,
+    val measuredSeconds: Float
+) {
+    val hasIntegrated: Boolean get() = integratedLufs.isFinite()
+
+    companion object {
+        fun fromArray(values: FloatArray?): LoudnessReading? {
+            if (values == null || values.size < 5) return null
+            return LoudnessReading(values[0], values[1], values[2], values[3], values[4])
+        }
+    }
+}
@@ -0,0 +1,85 @@
+package com.suvojeet.suvmusic.player
+
+import android.content.Context
+import android.net.Uri
+import com.suvojeet.suvmusic.core.model.Song
+import dagger.hilt.android.qualifiers.ApplicationContext
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
+import kotlinx.coroutines.withContext
+import java.io.File
+import javax.inject.Inject
+import javax.inject.Singleton
+
+/**
+ * Offline loudness for local files, so downloaded and on-device songs are
+ * normalized from their first second instead of after 30 s of playback.
+ *
+ * [scanSongs] measures files that are not in the index yet on a native
+ * worker pool and rewrites the index (`files/loudness.idx`); [lookup] is an
+ * O(1) read of the memory-mapped index, cheap enough for track start. The
+ * native decoder reads WAV, AIFF and FLAC; other formats (MP3, AAC, Opus)
+ * are skipped and left to [LoudnessAnalyzer]'s playback measurement.
+ */
+@Singleton
+class LoudnessScanner @Inject constructor(
+    @ApplicationContext context: Context,
+    private val nativeSpatialAudio: NativeSpatialAudio,
+) {
+    private val indexFile = File(context.filesDir, "loudness.idx")
+    private val scanMutex = Mutex()
+
+    // Guards index against a lookup racing the swap after a scan
+    private val indexLock = Any()
+    private var index: NativeLoudnessIndex? = null
+    private var indexOpened = false
+
+    // Songs already tried this process; unsupported files fail the same way every time
+    private val attempted = HashSet<String>()
+
+    fun lookup(songId: String): TrackLoudness? {
+        synchronized(indexLock) {
+            if (!indexOpened) {
+                index = nativeSpatialAudio.openLoudnessIndex(indexFile.path)
+                indexOpened = true
+            }
+            return index?.lookup(songId)
+        }
+    }
+
+    /**
+     * Measures every song with a local file that the index does not cover
+     * yet. Returns the number of songs added.
+     */
+    suspend fun scanSongs(songs: List<Song>): Int = scanMutex.withLock {
+        val pending = songs.mapNotNull { song ->
+            val path = localPath(song) ?: return@mapNotNull null
+            if (song.id in attempted || lookup(song.id) != null) null else song.id to path
+        }
+        if (pending.isEmpty()) return 0
+        pending.forEach { attempted += it.first }
+
+        val measured = withContext(Dispatchers.IO) {
+            nativeSpatialAudio.scanLoudness(
+                pending.map { it.first }.toTypedArray(),
+                pending.map { it.second }.toTypedArray(),
+                indexFile.path
+            )
+        }
+        if (measured <= 0) return 0
+
+        synchronized(indexLock) {
+            index?.close()
+            index = nativeSpatialAudio.openLoudnessIndex(indexFile.path)
+            indexOpened = true
+        }
+        measured
+    }
+
+    private fun localPath(song: Song): String? {
+        val uri = song.localUri?.let { Uri.parse(it) } ?: return null
+        if (uri.scheme != "file") return null
+        return uri.path?.takeIf { File(it).isFile }
+    }
+}
@@ -3092,8 +3092,9 @@ class MusicPlayer @Inject constructor(
      * Optimization 3: Smoothly ramp playback speed over 300ms to avoid audio artifacts.
      */
     fun setPlaybackParameters(speed: Float, pitch: Float) {
-        val clampedSpeed = speed.coerceIn(0.1f, 5.0f)
-        val clampedPitch = pitch.coerceIn(0.1f, 5.0f)
+        // Ranges of the native time stretcher in the audio sink
+        val clampedSpeed = speed.coerceIn(TimeStretchAudioProcessor.MIN_SPEED, TimeStretchAudioProcessor.MAX_SPEED)
+        val clampedPitch = pitch.coerceIn(TimeStretchAudioProcessor.MIN_PITCH, TimeStretchAudioProcessor.MAX_PITCH)
         
         playbackSpeedRampJob?.cancel()
         playbackSpeedRampJob = scope.launch {
@@ -3110,8 +3111,8 @@ class MusicPlayer @Inject constructor(
             }
             
             // Final target speed
-            mediaController?.playbackParameters = androidx.media3.common.PlaybackParameters(clampedSpeed, 1.0f)
-            spatialAudioProcessor.setPlaybackParams(clampedPitch)
+            // Speed and pitch are rendered together by the sink's time stretcher
+            mediaController?.playbackParameters = androidx.media3.common.PlaybackParameters(clampedSpeed, clampedPitch)
             
             _playerState.update { 
                 it.copy(
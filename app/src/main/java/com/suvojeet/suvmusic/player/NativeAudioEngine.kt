@@ -0,0 +1,72 @@
+package com.suvojeet.suvmusic.player
+
+import java.nio.ByteBuffer
+
+/**
+ * Handle to a native DSP chain with its own filter, limiter and meter state.
+ *
+ * Parameters may be changed from any thread, but [process] must only be called
+ * from one render thread at a time, and never concurrently with [close].
+ */
+class NativeAudioEngine internal constructor(
+    private val native: NativeSpatialAudio,
+    private var handle: Long
+) : AutoCloseable {
+
+    /**
+     * Process a direct buffer in place. [encoding] is a Media3 C.ENCODING_PCM_*
+     * value (16/24/32-bit integer or float); other encodings are ignored.
+     */
+    fun process(
+        buffer: ByteBuffer,
+        encoding: Int,
+        frameCount: Int,
+        channelCount: Int,
+        sampleRate: Int,
+        azimuth: Float = 0f,
+        elevation: Float = 0f
+    ) {
+        if (handle == 0L) return
+        if (!buffer.isDirect) {
+            throw IllegalArgumentException("process requires a direct ByteBuffer")
+        }
+        native.engineProcess(handle, buffer, encoding, frameCount, channelCount, sampleRate, azimuth, elevation)
+    }
+
+    fun applyAIState(state: com.suvojeet.suvmusic.ai.AudioEffectState) {
+        if (handle == 0L) return
+        native.engineApplyAIState(handle, state)
+    }
+
+    /** Pitch ratio (0.5..2) at the stream's own sample rate; tempo is not changed. */
+    fun setPlaybackParams(pitch: Float) {
+        if (handle != 0L) native.engineSetPlaybackParams(handle, pitch)
+    }
+
+    fun reset() {
+        if (handle != 0L) native.engineReset(handle)
+    }
+
+    fun getPeakLevel(): Float = if (handle != 0L) native.engineGetPeakLevel(handle) else 0f
+    fun getTruePeakLevel(): Float = if (handle != 0L) native.engineGetTruePeakLevel(handle) else 0f
+
+    /** This chain's input loudness; see [NativeSpatialAudio.getLoudness]. */
+    fun getLoudness(): LoudnessReading? =
+        if (handle != 0L) LoudnessReading.fromArray(native.engineGetLoudness(handle)) else null
+
+    fun resetLoudness() {
+        if (handle != 0L) native.engineResetLoudness(handle)
+    }
+
+    /** This chain's render timing; see [NativeSpatialAudio.getDspProfile]. */
+    fun getDspProfile(reset: Boolean = false): DspProfile? =
+        if (handle != 0L) DspProfile.fromArray(native.engineGetDspProfile(handle, reset)) else null
+
+    override fun close() {
+        val h = handle
+        if (h != 0L) {
+            handle = 0L
+            native.destroyEngine(h)
+        }
+    }
+}
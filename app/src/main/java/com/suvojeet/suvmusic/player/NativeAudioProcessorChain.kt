@@ -0,0 +1,37 @@
+package com.suvojeet.suvmusic.player
+
+import androidx.media3.common.PlaybackParameters
+import androidx.media3.common.audio.AudioProcessor
+import androidx.media3.common.audio.AudioProcessorChain
+import androidx.media3.exoplayer.audio.SilenceSkippingAudioProcessor
+
+/**
+ * Audio sink processor chain: effects, silence skipping, then speed and pitch
+ * through [TimeStretchAudioProcessor]. Replaces Media3's default chain so that
+ * Sonic is never instantiated and speed/pitch cost a single native pass.
+ */
+class NativeAudioProcessorChain(
+    spatialAudioProcessor: SpatialAudioProcessor,
+    private val timeStretch: TimeStretchAudioProcessor
+) : AudioProcessorChain {
+
+    private val silenceSkipping = SilenceSkippingAudioProcessor()
+    private val processors = arrayOf<AudioProcessor>(spatialAudioProcessor, silenceSkipping, timeStretch)
+
+    override fun getAudioProcessors(): Array<AudioProcessor> = processors
+
+    override fun applyPlaybackParameters(playbackParameters: PlaybackParameters): PlaybackParameters {
+        val speed = timeStretch.setSpeed(playbackParameters.speed)
+        val pitch = timeStretch.setPitch(playbackParameters.pitch)
+        return PlaybackParameters(speed, pitch)
+    }
+
+    override fun applySkipSilenceEnabled(skipSilenceEnabled: Boolean): Boolean {
+        silenceSkipping.setEnabled(skipSilenceEnabled)
+        return skipSilenceEnabled
+    }
+
+    override fun getMediaDuration(playoutDuration: Long): Long = timeStretch.getMediaDuration(playoutDuration)
+
+    override fun getSkippedOutputFrameCount(): Long = silenceSkipping.skippedFrames
+}
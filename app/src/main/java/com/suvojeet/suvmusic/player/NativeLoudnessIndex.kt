@@ -0,0 +1,26 @@
+package com.suvojeet.suvmusic.player
+
+/**
+ * Read-only, memory-mapped view of a loudness index written by
+ * [NativeSpatialAudio.scanLoudness]. Lookups are O(1) and safe from any
+ * thread, but never concurrently with [close]. A rescan does not change an
+ * open index; open a new one to see it.
+ */
+class NativeLoudnessIndex internal constructor(
+    private val native: NativeSpatialAudio,
+    private var handle: Long
+) : AutoCloseable {
+
+    fun lookup(songId: String): TrackLoudness? {
+        if (handle == 0L) return null
+        return TrackLoudness.fromArray(native.loudnessIndexLookup(handle, songId))
+    }
+
+    override fun close() {
+        val h = handle
+        if (h != 0L) {
+            handle = 0L
+            native.closeLoudnessIndex(h)
+        }
+    }
+}
@@ -46,6 +46,66 @@ class NativeSpatialAudio @Inject constructor() {
         elevation: Float
     )
 
+    /**
+     * Process a 32-bit float buffer in place, without any format conversion.
+     */
+    fun processFloat(buffer: ByteBuffer, frameCount: Int, channelCount: Int, sampleRate: Int, azimuth: Float, elevation: Float) {
+        if (!isLibraryLoaded) return
+        if (!buffer.isDirect) {
+            throw IllegalArgumentException("processFloat requires a direct ByteBuffer")
+        }
+        nProcessFloat(buffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+    }
+
+    private external fun nProcessFloat(
+        buffer: ByteBuffer,
+        frameCount: Int,
+        channelCount: Int,
+        sampleRate: Int,
+        azimuth: Float,
+        elevation: Float
+    )
+
+    /**
+     * Process a packed 24-bit PCM buffer in place.
+     */
+    fun processPcm24(buffer: ByteBuffer, frameCount: Int, channelCount: Int, sampleRate: Int, azimuth: Float, elevation: Float) {
+        if (!isLibraryLoaded) return
+        if (!buffer.isDirect) {
+            throw IllegalArgumentException("processPcm24 requires a direct ByteBuffer")
+        }
+        nProcessPcm24(buffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+    }
+
+    private external fun nProcessPcm24(
+        buffer: ByteBuffer,
+        frameCount: Int,
+        channelCount: Int,
+        sampleRate: Int,
+        azimuth: Float,
+        elevation: Float
+    )
+
+    /**
+     * Process a 32-bit integer PCM buffer in place.
+     */
+    fun processPcm32(buffer: ByteBuffer, frameCount: Int, channelCount: Int, sampleRate: Int, azimuth: Float, elevation: Float) {
+        if (!isLibraryLoaded) return
+        if (!buffer.isDirect) {
+            throw IllegalArgumentException("processPcm32 requires a direct ByteBuffer")
+        }
+        nProcessPcm32(buffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+    }
+
+    private external fun nProcessPcm32(
+        buffer: ByteBuffer,
+        frameCount: Int,
+        channelCount: Int,
+        sampleRate: Int,
+        azimuth: Float,
+        elevation: Float
+    )
+
     /**
      * Reset the internal state of the spatializer.
      */
@@ -65,6 +125,23 @@ class NativeSpatialAudio @Inject constructor() {
 
     private external fun nSetSpatializerEnabled(enabled: Boolean)
 
+    /**
+     * Load a measured HRIR set (SUVHRIR1 binary, memory-mapped) for binaural
+     * rendering. Returns false if the file could not be used; the previous set
+     * stays active.
+     */
+    fun loadHrtf(path: String): Boolean = isLibraryLoaded && nLoadHrtf(path)
+
+    /** Switch back to the built-in spherical-head HRTF model. */
+    fun useBuiltInHrtf() {
+        if (isLibraryLoaded) {
+            nUseBuiltInHrtf()
+        }
+    }
+
+    private external fun nLoadHrtf(path: String): Boolean
+    private external fun nUseBuiltInHrtf()
+
     fun setLimiterEnabled(enabled: Boolean) {
         if (isLibraryLoaded) {
             nSetLimiterEnabled(enabled)
@@ -89,6 +166,18 @@ class NativeSpatialAudio @Inject constructor() {
 
     private external fun nSetLimiterBalance(balance: Float)
 
+    /**
+     * Limit inter-sample (true) peaks rather than sample peaks. On by default;
+     * adds under 0.3 ms of latency.
+     */
+    fun setLimiterTruePeak(enabled: Boolean) {
+        if (isLibraryLoaded) {
+            nSetLimiterTruePeak(enabled)
+        }
+    }
+
+    private external fun nSetLimiterTruePeak(enabled: Boolean)
+
     fun setCrossfeedParams(enabled: Boolean, strength: Float) {
         if (isLibraryLoaded) {
             nSetCrossfeedParams(enabled, strength)
@@ -169,6 +258,25 @@ class NativeSpatialAudio @Inject constructor() {
 
     fun getPeakLevel(): Float = if (isLibraryLoaded) nGetPeakLevel() else 0f
     fun getRmsLevel(): Float = if (isLibraryLoaded) nGetRmsLevel() else 0f
+    /** Linear true-peak level (ITU-R BS.1770); 20 * log10 gives dBTP. */
+    fun getTruePeakLevel(): Float = if (isLibraryLoaded) nGetTruePeakLevel() else 0f
+
+    /**
+     * Standards-based (ITU-R BS.1770 / EBU R128) loudness of the main chain's
+     * input since the last [resetLoudness].
+     */
+    fun getLoudness(): LoudnessReading? =
+        if (isLibraryLoaded) LoudnessReading.fromArray(nGetLoudness()) else null
+
+    /** Starts a new integrated loudness measurement from the next buffer. */
+    fun resetLoudness() {
+        if (isLibraryLoaded) {
+            nResetLoudness()
+        }
+    }
+
+    private external fun nGetLoudness(): FloatArray?
+    private external fun nResetLoudness()
 
     private external fun nApplyAIState(
         eqEnabled: Boolean,
@@ -186,6 +294,7 @@ class NativeSpatialAudio @Inject constructor() {
 
     private external fun nGetPeakLevel(): Float
     private external fun nGetRmsLevel(): Float
+    private external fun nGetTruePeakLevel(): Float
 
     private external fun nGetEqBand(index: Int): Float
     private external fun nIsEqEnabled(): Boolean
@@ -193,11 +302,177 @@ class NativeSpatialAudio @Inject constructor() {
     private external fun nGetVirtualizer(): Float
     private external fun nIsSpatializerEnabled(): Boolean
 
+    /**
+     * Turns per-stage render timing on or off for every native chain. Off by
+     * default; while on, each callback costs a few extra clock reads.
+     */
+    fun setDspProfilingEnabled(enabled: Boolean) {
+        if (isLibraryLoaded) {
+            nSetDspProfilingEnabled(enabled)
+        }
+    }
+
+    /**
+     * Render timing of the main chain since profiling was enabled or last
+     * reset. Never blocks the audio thread; [reset] starts a fresh window
+     * from the next callback.
+     */
+    fun getDspProfile(reset: Boolean = false): DspProfile? =
+        if (isLibraryLoaded) DspProfile.fromArray(nGetDspProfile(reset)) else null
+
+    private external fun nSetDspProfilingEnabled(enabled: Boolean)
+    private external fun nGetDspProfile(reset: Boolean): LongArray?
+
+    /**
+     * Creates an independent native DSP chain (e.g. for the incoming track of a
+     * crossfade or a preview player). Returns null if the library is not loaded.
+     * The caller owns the engine and must close it.
+     */
+    fun createEngine(): NativeAudioEngine? {
+        if (!isLibraryLoaded) return null
+        val handle = nCreateEngine()
+        return if (handle != 0L) NativeAudioEngine(this, handle) else null
+    }
+
+    // JNI binds natives by their JVM name, which Kotlin mangles for internal
+    // members, so the natives are private and the handle classes call these.
+    internal fun destroyEngine(handle: Long) = nDestroyEngine(handle)
+
+    internal fun engineProcess(
+        handle: Long,
+        buffer: ByteBuffer,
+        encoding: Int,
+        frameCount: Int,
+        channelCount: Int,
+        sampleRate: Int,
+        azimuth: Float,
+        elevation: Float
+    ) = nProcess(handle, buffer, encoding, frameCount, channelCount, sampleRate, azimuth, elevation)
+
+    internal fun engineApplyAIState(handle: Long, state: com.suvojeet.suvmusic.ai.AudioEffectState) =
+        nEngineApplyAIState(
+            handle,
+            state.isEqEnabled,
+            state.safeEqBands.toFloatArray(),
+            state.safeBassBoost,
+            state.safeVirtualizer,
+            state.isSpatialEnabled,
+            state.isCrossfeedEnabled,
+            state.safeLimiterThresholdDb,
+            state.safeLimiterRatio,
+            state.safeLimiterAttackMs,
+            state.safeLimiterReleaseMs,
+            state.safeLimiterMakeupGain
+        )
+
+    internal fun engineSetPlaybackParams(handle: Long, pitch: Float) = nEngineSetPlaybackParams(handle, pitch)
+    internal fun engineReset(handle: Long) = nEngineReset(handle)
+    internal fun engineGetPeakLevel(handle: Long): Float = nEngineGetPeakLevel(handle)
+    internal fun engineGetTruePeakLevel(handle: Long): Float = nEngineGetTruePeakLevel(handle)
+    internal fun engineGetLoudness(handle: Long): FloatArray? = nEngineGetLoudness(handle)
+    internal fun engineResetLoudness(handle: Long) = nEngineResetLoudness(handle)
+    internal fun engineGetDspProfile(handle: Long, reset: Boolean): LongArray? = nEngineGetDspProfile(handle, reset)
+
+    private external fun nCreateEngine(): Long
+    private external fun nDestroyEngine(handle: Long)
+
+    private external fun nProcess(
+        handle: Long,
+        buffer: ByteBuffer,
+        encoding: Int,
+        frameCount: Int,
+        channelCount: Int,
+        sampleRate: Int,
+        azimuth: Float,
+        elevation: Float
+    )
+
+    private external fun nEngineApplyAIState(
+        handle: Long,
+        eqEnabled: Boolean,
+        eqBands: FloatArray,
+        bassBoost: Float,
+        virtualizer: Float,
+        spatialEnabled: Boolean,
+        crossfeedEnabled: Boolean,
+        limiterThreshold: Float,
+        limiterRatio: Float,
+        limiterAttack: Float,
+        limiterRelease: Float,
+        limiterGain: Float
+    )
+
+    private external fun nEngineSetPlaybackParams(handle: Long, pitch: Float)
+    private external fun nEngineReset(handle: Long)
+    private external fun nEngineGetPeakLevel(handle: Long): Float
+    private external fun nEngineGetTruePeakLevel(handle: Long): Float
+    private external fun nEngineGetLoudness(handle: Long): FloatArray?
+    private external fun nEngineResetLoudness(handle: Long)
+    private external fun nEngineGetDspProfile(handle: Long, reset: Boolean): LongArray?
+
+    /**
+     * Creates a native tempo/pitch stream for the given format (1..16 channels,
+     * 8..192 kHz). Returns null if the library is not loaded or the format is
+     * unsupported. The caller owns the stretcher and must close it.
+     */
+    fun createTimeStretcher(channelCount: Int, sampleRate: Int): NativeTimeStretcher? {
+        if (!isLibraryLoaded) return null
+        val handle = nCreateTimeStretcher(channelCount, sampleRate)
+        return if (handle != 0L) NativeTimeStretcher(this, handle) else null
+    }
+
+    internal fun destroyTimeStretcher(handle: Long) = nDestroyTimeStretcher(handle)
+    internal fun timeStretcherSetParams(handle: Long, tempo: Float, pitch: Float, speech: Boolean) =
+        nTimeStretcherSetParams(handle, tempo, pitch, speech)
+    internal fun timeStretcherPut(handle: Long, buffer: ByteBuffer, offsetFrames: Int, frameCount: Int, encoding: Int): Int =
+        nTimeStretcherPut(handle, buffer, offsetFrames, frameCount, encoding)
+    internal fun timeStretcherReceive(handle: Long, buffer: ByteBuffer, offsetFrames: Int, maxFrames: Int, encoding: Int): Int =
+        nTimeStretcherReceive(handle, buffer, offsetFrames, maxFrames, encoding)
+    internal fun timeStretcherFlush(handle: Long) = nTimeStretcherFlush(handle)
+    internal fun timeStretcherClear(handle: Long) = nTimeStretcherClear(handle)
+
+    private external fun nCreateTimeStretcher(channelCount: Int, sampleRate: Int): Long
+    private external fun nDestroyTimeStretcher(handle: Long)
+    private external fun nTimeStretcherSetParams(handle: Long, tempo: Float, pitch: Float, speech: Boolean)
+    private external fun nTimeStretcherPut(handle: Long, buffer: ByteBuffer, offsetFrames: Int, frameCount: Int, encoding: Int): Int
+    private external fun nTimeStretcherReceive(handle: Long, buffer: ByteBuffer, offsetFrames: Int, maxFrames: Int, encoding: Int): Int
+    private external fun nTimeStretcherFlush(handle: Long)
+    private external fun nTimeStretcherClear(handle: Long)
+
+    /**
+     * Measures integrated loudness, true peak and ReplayGain of local files on
+     * [threads] native workers (0: one per core) and merges the results into
+     * the index at [indexPath], keyed by song ID. Blocks for the whole scan.
+     * Returns the number of files measured (unsupported or unreadable files
+     * are skipped), or -1 if the index could not be written.
+     */
+    fun scanLoudness(songIds: Array<String>, filePaths: Array<String>, indexPath: String, threads: Int = 0): Int {
+        if (!isLibraryLoaded) return -1
+        return nScanLoudness(songIds, filePaths, indexPath, threads)
+    }
+
+    /** Returns null if the library is not loaded or there is no valid index at [indexPath]. */
+    fun openLoudnessIndex(indexPath: String): NativeLoudnessIndex? {
+        if (!isLibraryLoaded) return null
+        val handle = nOpenLoudnessIndex(indexPath)
+        return if (handle != 0L) NativeLoudnessIndex(this, handle) else null
+    }
+
+    internal fun closeLoudnessIndex(handle: Long) = nCloseLoudnessIndex(handle)
+    internal fun loudnessIndexLookup(handle: Long, songId: String): FloatArray? = nLoudnessIndexLookup(handle, songId)
+
+    private external fun nScanLoudness(songIds: Array<String>, filePaths: Array<String>, indexPath: String, threads: Int): Int
+    private external fun nOpenLoudnessIndex(indexPath: String): Long
+    private external fun nCloseLoudnessIndex(handle: Long)
+    private external fun nLoudnessIndexLookup(handle: Long, songId: String): FloatArray?
+
     /**
      * Extracts waveform data from a file using high-performance Memory-Mapped IO (mmap).
+     * Every sample is read; each point is the peak of its slice of the file.
      * @param filePath Path to the local file.
      * @param numPoints Number of points to return in the waveform.
-     * @return FloatArray of peak amplitudes.
+     * @return FloatArray of peak amplitudes, empty for formats other than
+     * WAV, AIFF and FLAC.
      */
     fun extractWaveform(filePath: String, numPoints: Int): FloatArray? {
         return if (isLibraryLoaded) {
@@ -205,5 +480,50 @@ class NativeSpatialAudio @Inject constructor() {
         } else null
     }
 
+    /**
+     * Scans [filePath] into a multi-resolution waveform for zoomable views.
+     * Reads WAV, AIFF and FLAC. Returns null if the library is not loaded or
+     * the file cannot be read. The caller owns the waveform and must close it.
+     */
+    fun openWaveform(filePath: String): NativeWaveform? {
+        if (!isLibraryLoaded) return null
+        val handle = nOpenWaveform(filePath)
+        return if (handle != 0L) NativeWaveform(this, handle) else null
+    }
+
+    /**
+     * Keeps batch-extracted waveforms in [directory] under [budgetBytes],
+     * evicting the least recently used. Call once before [extractWaveforms].
+     */
+    fun configureWaveformCache(directory: String, budgetBytes: Long) {
+        if (isLibraryLoaded) {
+            nConfigureWaveformCache(directory, budgetBytes)
+        }
+    }
+
+    /**
+     * Waveforms of many files at once, [numPoints] points each over the whole
+     * track; null entries for files that cannot be read or are not WAV, AIFF
+     * or FLAC.
+     * Cached files are served from the waveform cache, the rest are scanned
+     * concurrently and cached. Points are drawn from 4096-frame buckets either
+     * way, so a file's result does not depend on whether it was cached.
+     * Blocks until done.
+     */
+    fun extractWaveforms(filePaths: Array<String>, numPoints: Int): List<WaveformPoints?>? {
+        if (!isLibraryLoaded) return null
+        val arrays = nExtractWaveforms(filePaths, numPoints) ?: return null
+        return arrays.map { WaveformPoints.fromArray(it) }
+    }
+
+    internal fun closeWaveform(handle: Long) = nCloseWaveform(handle)
+    internal fun waveformPoints(handle: Long, start: Double, end: Double, numPoints: Int): FloatArray? =
+        nWaveformPoints(handle, start, end, numPoints)
+
     private external fun nExtractWaveform(filePath: String, numPoints: Int): FloatArray?
+    private external fun nConfigureWaveformCache(directory: String, budgetBytes: Long)
+    private external fun nExtractWaveforms(filePaths: Array<String>, numPoints: Int): Array<FloatArray?>?
+    private external fun nOpenWaveform(filePath: String): Long
+    private external fun nCloseWaveform(handle: Long)
+    private external fun nWaveformPoints(handle: Long, start: Double, end: Double, numPoints: Int): FloatArray?
 }
@@ -0,0 +1,60 @@
+package com.suvojeet.suvmusic.player
+
+import java.nio.ByteBuffer
+
+/**
+ * Handle to a native tempo/pitch stream (phase vocoder for music, WSOLA for
+ * speech) with a fixed channel count and sample rate.
+ *
+ * [setParams] may be called from any thread. Everything else must be called
+ * from one thread at a time, and never concurrently with [close].
+ *
+ * Buffers must be direct; offsets are in frames from the start of the buffer,
+ * independent of its position. [encoding] is a Media3 C.ENCODING_PCM_* value.
+ */
+class NativeTimeStretcher internal constructor(
+    private val native: NativeSpatialAudio,
+    private var handle: Long
+) : AutoCloseable {
+
+    /** [tempo] is clamped to 0.25..4 and [pitch] to 0.5..2. Switching [speech] clears the stream. */
+    fun setParams(tempo: Float, pitch: Float, speech: Boolean) {
+        if (handle != 0L) native.timeStretcherSetParams(handle, tempo, pitch, speech)
+    }
+
+    /** Returns how many of [frameCount] frames were consumed; call [receive] to make room for the rest. */
+    fun put(buffer: ByteBuffer, offsetFrames: Int, frameCount: Int, encoding: Int): Int {
+        if (handle == 0L) return 0
+        if (!buffer.isDirect) {
+            throw IllegalArgumentException("put requires a direct ByteBuffer")
+        }
+        return native.timeStretcherPut(handle, buffer, offsetFrames, frameCount, encoding)
+    }
+
+    /** Returns the number of frames written, at most [maxFrames]. */
+    fun receive(buffer: ByteBuffer, offsetFrames: Int, maxFrames: Int, encoding: Int): Int {
+        if (handle == 0L) return 0
+        if (!buffer.isDirect) {
+            throw IllegalArgumentException("receive requires a direct ByteBuffer")
+        }
+        return native.timeStretcherReceive(handle, buffer, offsetFrames, maxFrames, encoding)
+    }
+
+    /** Marks end of stream; the tail becomes available to [receive]. */
+    fun flush() {
+        if (handle != 0L) native.timeStretcherFlush(handle)
+    }
+
+    /** Drops all buffered audio, e.g. after a seek. */
+    fun clear() {
+        if (handle != 0L) native.timeStretcherClear(handle)
+    }
+
+    override fun close() {
+        val h = handle
+        if (h != 0L) {
+            handle = 0L
+            native.destroyTimeStretcher(h)
+        }
+    }
+}
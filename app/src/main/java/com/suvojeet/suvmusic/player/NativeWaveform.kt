@@ -0,0 +1,47 @@
+package com.suvojeet.suvmusic.player
+
+/**
+ * Min/max/RMS waveform of one file at every zoom level, scanned once when
+ * created. [points] is cheap enough to call on every zoom or scroll step.
+ *
+ * Not thread-safe against [close]; otherwise any thread may read it.
+ */
+class NativeWaveform internal constructor(
+    private val native: NativeSpatialAudio,
+    private var handle: Long
+) : AutoCloseable {
+
+    /**
+     * [numPoints] points spread evenly over [start]..[end], given as
+     * fractions of the track length. Returns null for an empty range.
+     */
+    fun points(numPoints: Int, start: Double = 0.0, end: Double = 1.0): WaveformPoints? {
+        if (handle == 0L) return null
+        return WaveformPoints.fromArray(native.waveformPoints(handle, start, end, numPoints))
+    }
+
+    override fun close() {
+        val h = handle
+        if (h != 0L) {
+            handle = 0L
+            native.closeWaveform(h)
+        }
+    }
+}
+
+/** Per-point sample minimum, maximum and RMS, all in -1..1 full scale. */
+class WaveformPoints(val min: FloatArray, val max: FloatArray, val rms: FloatArray) {
+    val size: Int get() = min.size
+
+    companion object {
+        fun fromArray(values: FloatArray?): WaveformPoints? {
+            if (values == null || values.isEmpty() || values.size % 3 != 0) return null
+            val count = values.size / 3
+            return WaveformPoints(
+                FloatArray(count) { values[3 * it] },
+                FloatArray(count) { values[3 * it + 1] },
+                FloatArray(count) { values[3 * it + 2] }
+            )
+        }
+    }
+}
@@ -180,17 +180,18 @@ class SpatialAudioProcessor @Inject constructor(
     }
 
     override fun onConfigure(inputAudioFormat: AudioFormat): AudioFormat {
-        // Accept both 16-bit and Float
-        if (inputAudioFormat.encoding != C.ENCODING_PCM_16BIT && inputAudioFormat.encoding != C.ENCODING_PCM_FLOAT) {
-            return AudioFormat.NOT_SET
+        // The native chain processes every linear PCM format in place, so the
+        // output keeps the input encoding and Media3 needs no conversion stage.
+        when (inputAudioFormat.encoding) {
+            C.ENCODING_PCM_16BIT, C.ENCODING_PCM_24BIT, C.ENCODING_PCM_32BIT, C.ENCODING_PCM_FLOAT -> Unit
+            else -> return AudioFormat.NOT_SET
         }
         
         // Initialize effects with current state
         nativeSpatialAudio.setCrossfeedParams(isCrossfeedEnabled && !isSpatialEnabled, 0.15f)
         nativeSpatialAudio.setPlaybackParams(currentPitch)
 
-        // Always output 16-bit PCM for maximum compatibility
-        return AudioFormat(inputAudioFormat.sampleRate, inputAudioFormat.channelCount, C.ENCODING_PCM_16BIT)
+        return inputAudioFormat
     }
 
     override fun queueInput(inputBuffer: ByteBuffer) {
@@ -220,7 +221,8 @@ class SpatialAudioProcessor @Inject constructor(
 
         val bytesPerSample = when (encoding) {
             C.ENCODING_PCM_16BIT -> 2
-            C.ENCODING_PCM_FLOAT -> 4
+            C.ENCODING_PCM_24BIT -> 3
+            C.ENCODING_PCM_32BIT, C.ENCODING_PCM_FLOAT -> 4
             else -> {
                 // Unknown encoding, just pass through to avoid silence
                 val passthrough = replaceOutputBuffer(remaining)
@@ -233,37 +235,24 @@ class SpatialAudioProcessor @Inject constructor(
         val frameCount = remaining / (bytesPerSample * channelCount)
         if (frameCount <= 0) return
 
-        // 1. Prepare output buffer (we always output PCM 16-bit as per onConfigure)
-        val requiredBytes = frameCount * channelCount * 2
+        // 1. Copy the input into the output buffer; the native chain works on it in place
+        val requiredBytes = frameCount * channelCount * bytesPerSample
         val outBuffer = replaceOutputBuffer(requiredBytes)
         outBuffer.order(ByteOrder.LITTLE_ENDIAN)
         outBuffer.clear()
-
-        // 2. Convert input to PCM 16-bit if necessary
-        try {
-            when (encoding) {
-                C.ENCODING_PCM_16BIT -> outBuffer.put(inputBuffer)
-                C.ENCODING_PCM_FLOAT -> {
-                    inputBuffer.order(ByteOrder.LITTLE_ENDIAN)
-                    repeat(frameCount * channelCount) {
-                        val clamped = inputBuffer.getFloat().coerceIn(-1f, 1f)
-                        val sample = (clamped * 32767f).toInt().toShort()
-                        outBuffer.putShort(sample)
-                    }
-                }
-            }
-        } catch (e: Exception) {
-            // Conversion failed, return empty to avoid noise, but log it
-            android.util.Log.e("SpatialAudioProcessor", "Buffer conversion error", e)
-            return
-        }
+        val inputLimit = inputBuffer.limit()
+        inputBuffer.limit(inputBuffer.position() + requiredBytes)
+        outBuffer.put(inputBuffer)
+        inputBuffer.limit(inputLimit)
+        // Drop any trailing partial frame so it is not re-queued forever
+        inputBuffer.position(inputLimit)
         outBuffer.flip()
 
-        // 3. Process with Native JNI if effects are active
+        // 2. Process with Native JNI if effects are active
         val effectsActive = isSpatialEnabled || isLimiterEnabled || (isCrossfeedEnabled && !isSpatialEnabled) || currentPitch != 1.0f
         
         if (!effectsActive) {
-            // No effects active, output buffer already contains the converted data
+            // No effects active, output buffer already contains the input data
             return
         }
 
@@ -283,27 +272,41 @@ class SpatialAudioProcessor @Inject constructor(
             nativeSpatialAudio.setLimiterBalance(currentBalance)
         }
 
-        // Use direct native buffer for JNI
-        var nativeBuffer = directNativeBuffer
-        if (nativeBuffer == null || nativeBuffer.capacity() < requiredBytes) {
-            nativeBuffer = ByteBuffer.allocateDirect(requiredBytes).order(ByteOrder.LITTLE_ENDIAN)
-            directNativeBuffer = nativeBuffer
+        // Media3 allocates direct output buffers, so normally we process in
+        // place; otherwise stage through a reusable direct buffer.
+        val stageThroughNative = !outBuffer.isDirect
+        var nativeBuffer = outBuffer
+        if (stageThroughNative) {
+            var staging = directNativeBuffer
+            if (staging == null || staging.capacity() < requiredBytes) {
+                staging = ByteBuffer.allocateDirect(requiredBytes).order(ByteOrder.LITTLE_ENDIAN)
+                directNativeBuffer = staging
+            }
+            nativeBuffer = staging
         }
         
         try {
-            nativeBuffer.clear()
-            outBuffer.position(0)
-            nativeBuffer.put(outBuffer)
-            nativeBuffer.flip()
+            if (stageThroughNative) {
+                nativeBuffer.clear()
+                nativeBuffer.put(outBuffer)
+                nativeBuffer.flip()
+            }
 
             // JNI Call
-            nativeSpatialAudio.processPcm16(nativeBuffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+            when (encoding) {
+                C.ENCODING_PCM_16BIT -> nativeSpatialAudio.processPcm16(nativeBuffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+                C.ENCODING_PCM_24BIT -> nativeSpatialAudio.processPcm24(nativeBuffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+                C.ENCODING_PCM_32BIT -> nativeSpatialAudio.processPcm32(nativeBuffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+                C.ENCODING_PCM_FLOAT -> nativeSpatialAudio.processFloat(nativeBuffer, frameCount, channelCount, sampleRate, azimuth, elevation)
+            }
 
-            // Copy processed data back to output buffer
-            nativeBuffer.position(0)
-            outBuffer.clear()
-            outBuffer.put(nativeBuffer)
-            outBuffer.flip()
+            if (stageThroughNative) {
+                // Copy processed data back to output buffer
+                nativeBuffer.position(0)
+                outBuffer.clear()
+                outBuffer.put(nativeBuffer)
+                outBuffer.flip()
+            }
         } catch (e: Exception) {
             android.util.Log.e("SpatialAudioProcessor", "Native processing error", e)
             // On error, the outBuffer already has the (unprocessed) data, 
@@ -0,0 +1,202 @@
+package com.suvojeet.suvmusic.player
+
+import androidx.media3.common.C
+import androidx.media3.common.audio.AudioProcessor.AudioFormat
+import androidx.media3.common.audio.AudioProcessor.UnhandledAudioFormatException
+import androidx.media3.common.audio.BaseAudioProcessor
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import javax.inject.Inject
+import javax.inject.Singleton
+import kotlin.math.abs
+
+/**
+ * Playback speed and pitch through the native time stretcher, in place of
+ * Media3's Sonic processor. Speed and pitch are rendered in one pass at the
+ * stream's own sample rate, so a pitch change never costs an extra resample.
+ *
+ * Like Sonic, new parameters take effect on the next flush, which the audio
+ * sink triggers itself when playback parameters change.
+ */
+@Singleton
+class TimeStretchAudioProcessor @Inject constructor(
+    private val nativeSpatialAudio: NativeSpatialAudio
+) : BaseAudioProcessor() {
+
+    private var speed = 1.0f
+    private var pitch = 1.0f
+    @Volatile private var speechMode = false
+
+    private var stretcher: NativeTimeStretcher? = null
+    private var stretcherFormat = AudioFormat.NOT_SET
+    private var inputStaging: ByteBuffer? = null
+    private var outputStaging: ByteBuffer? = null
+    private var drainPending = false
+
+    /** Returns the speed that will be applied, clamped to 0.25..4. */
+    fun setSpeed(speed: Float): Float {
+        this.speed = speed.coerceIn(MIN_SPEED, MAX_SPEED)
+        return this.speed
+    }
+
+    /** Returns the pitch that will be applied, clamped to 0.5..2. */
+    fun setPitch(pitch: Float): Float {
+        this.pitch = pitch.coerceIn(MIN_PITCH, MAX_PITCH)
+        return this.pitch
+    }
+
+    /**
+     * WSOLA instead of the phase vocoder: crisper consonants on spoken word,
+     * but it smears chords. Applies from the next flush.
+     */
+    fun setSpeechMode(enabled: Boolean) {
+        speechMode = enabled
+    }
+
+    /** Media time covered by [playoutDurationUs] of output at the current speed. */
+    fun getMediaDuration(playoutDurationUs: Long): Long =
+        if (isActive) (playoutDurationUs * speed.toDouble()).toLong() else playoutDurationUs
+
+    override fun onConfigure(inputAudioFormat: AudioFormat): AudioFormat {
+        when (inputAudioFormat.encoding) {
+            C.ENCODING_PCM_16BIT, C.ENCODING_PCM_24BIT, C.ENCODING_PCM_32BIT, C.ENCODING_PCM_FLOAT -> Unit
+            else -> throw UnhandledAudioFormatException(inputAudioFormat)
+        }
+        return inputAudioFormat
+    }
+
+    override fun isActive(): Boolean =
+        super.isActive() && (abs(speed - 1.0f) >= NEUTRAL_TOLERANCE || abs(pitch - 1.0f) >= NEUTRAL_TOLERANCE)
+
+    override fun queueInput(inputBuffer: ByteBuffer) {
+        val remaining = inputBuffer.remaining()
+        if (remaining == 0) return
+
+        val stretcher = stretcher
+        val frameBytes = inputAudioFormat.bytesPerFrame
+        val frameCount = remaining / frameBytes
+        if (stretcher == null || frameCount == 0) {
+            // Unsupported format for the native side: pass through at 1x
+            val out = replaceOutputBuffer(remaining)
+            out.put(inputBuffer)
+            out.flip()
+            return
+        }
+
+        val encoding = inputAudioFormat.encoding
+        val inputBytes = frameCount * frameBytes
+        val input: ByteBuffer
+        val inputOffset: Int
+        if (inputBuffer.isDirect && inputBuffer.position() % frameBytes == 0) {
+            input = inputBuffer
+            inputOffset = inputBuffer.position() / frameBytes
+        } else {
+            input = stagingBuffer(inputStaging, inputBytes).also { inputStaging = it }
+            val limit = inputBuffer.limit()
+            inputBuffer.limit(inputBuffer.position() + inputBytes)
+            input.clear()
+            input.put(inputBuffer)
+            inputBuffer.limit(limit)
+            inputOffset = 0
+        }
+        // A trailing partial frame would otherwise be re-queued forever
+        inputBuffer.position(inputBuffer.limit())
+
+        var consumed = 0
+        var produced = 0
+        var output = stagingBuffer(outputStaging, (frameCount + RECEIVE_CHUNK_FRAMES) * frameBytes)
+        while (true) {
+            var progress = 0
+            if (consumed < frameCount) {
+                val n = stretcher.put(input, inputOffset + consumed, frameCount - consumed, encoding)
+                consumed += n
+                progress += n
+            }
+            if (output.capacity() < (produced + RECEIVE_CHUNK_FRAMES) * frameBytes) {
+                output = grow(output, produced * frameBytes, (produced + RECEIVE_CHUNK_FRAMES) * frameBytes * 2)
+            }
+            val n = stretcher.receive(output, produced, RECEIVE_CHUNK_FRAMES, encoding)
+            produced += n
+            progress += n
+            if (progress == 0) break
+        }
+        outputStaging = output
+
+        if (produced == 0) return
+        output.position(0)
+        output.limit(produced * frameBytes)
+        val out = replaceOutputBuffer(produced * frameBytes)
+        out.put(output)
+        out.flip()
+    }
+
+    override fun onQueueEndOfStream() {
+        stretcher?.flush()
+        drainPending = stretcher != null
+    }
+
+    // The tail is handed out lazily so it never overwrites output the next
+    // stage has not consumed yet.
+    override fun getOutput(): ByteBuffer {
+        val stretcher = stretcher
+        if (drainPending && stretcher != null && !hasPendingOutput()) {
+            val frameBytes = inputAudioFormat.bytesPerFrame
+            val out = replaceOutputBuffer(RECEIVE_CHUNK_FRAMES * frameBytes)
+            val n = stretcher.receive(out, 0, RECEIVE_CHUNK_FRAMES, inputAudioFormat.encoding)
+            if (n == 0) drainPending = false
+            out.limit(n * frameBytes)
+        }
+        return super.getOutput()
+    }
+
+    override fun isEnded(): Boolean = super.isEnded() && !drainPending
+
+    override fun onFlush() {
+        drainPending = false
+        if (!isActive) return
+
+        val format = inputAudioFormat
+        var stretcher = stretcher
+        if (stretcher == null || stretcherFormat != format) {
+            stretcher?.close()
+            stretcher = nativeSpatialAudio.createTimeStretcher(format.channelCount, format.sampleRate)
+            this.stretcher = stretcher
+            stretcherFormat = format
+        }
+        stretcher?.setParams(speed, pitch, speechMode)
+        stretcher?.clear()
+    }
+
+    override fun onReset() {
+        stretcher?.close()
+        stretcher = null
+        stretcherFormat = AudioFormat.NOT_SET
+        inputStaging = null
+        outputStaging = null
+        drainPending = false
+    }
+
+    private fun stagingBuffer(current: ByteBuffer?, bytes: Int): ByteBuffer {
+        if (current != null && current.capacity() >= bytes) return current
+        return ByteBuffer.allocateDirect(bytes).order(ByteOrder.LITTLE_ENDIAN)
+    }
+
+    private fun grow(buffer: ByteBuffer, usedBytes: Int, bytes: Int): ByteBuffer {
+        val bigger = ByteBuffer.allocateDirect(bytes).order(ByteOrder.LITTLE_ENDIAN)
+        buffer.position(0)
+        buffer.limit(usedBytes)
+        bigger.put(buffer)
+        bigger.clear()
+        return bigger
+    }
+
+    companion object {
+        const val MIN_SPEED = 0.25f
+        const val MAX_SPEED = 4.0f
+        const val MIN_PITCH = 0.5f
+        const val MAX_PITCH = 2.0f
+
+        private const val NEUTRAL_TOLERANCE = 1e-4f
+        private const val RECEIVE_CHUNK_FRAMES = 4096
+    }
+}
@@ -0,0 +1,19 @@
+package com.suvojeet.suvmusic.player
+
+/**
+ * Whole-file loudness from the offline library scan. [gainDb] is the
+ * ReplayGain 2.0 track gain (to -18 LUFS); [truePeak] is linear.
+ */
+data class TrackLoudness(
+    val integratedLufs: Float,
+    val loudnessRangeLu: Float,
+    val truePeak: Float,
+    val gainDb: Float
+) {
+    companion object {
+        fun fromArray(values: FloatArray?): TrackLoudness? {
+            if (values == null || values.size < 4) return null
+            return TrackLoudness(values[0], values[1], values[2], values[3])
+        }
+    }
+}
@@ -0,0 +1,105 @@
+package com.suvojeet.suvmusic.recommendation
+
+import android.content.Context
+import android.util.Log
+import dagger.hilt.android.qualifiers.ApplicationContext
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.launch
+import java.io.File
+import javax.inject.Inject
+import javax.inject.Singleton
+
+/**
+ * Nearest-neighbour index over the genre vectors of every song the engine
+ * has scored, kept in `cache/genre_index.hnsw` across restarts. Lets
+ * [RecommendationEngine] cut a large candidate pool down to the songs
+ * closest to the user's taste before scoring, instead of computing every
+ * candidate's similarity. Songs enter the index as their genre vectors are
+ * computed; a song's vector never changes, so it is added once.
+ */
+@Singleton
+class GenreVectorIndex @Inject constructor(
+    @ApplicationContext context: Context,
+    private val nativeScorer: NativeRecommendationScorer,
+) {
+    private val file = File(context.cacheDir, "genre_index.hnsw")
+    private val scope = CoroutineScope(SupervisorJob() + Dispatchers.IO)
+
+    // Mirror of the indexed IDs, so known songs are skipped without a JNI call
+    private val indexed = HashSet<String>()
+    private var saveJob: Job? = null
+
+    private val index: NativeVectorIndex? by lazy {
+        nativeScorer.createVectorIndex(GenreTaxonomy.GENRE_COUNT, M, EF_CONSTRUCTION)?.also { index ->
+            if (file.exists() && index.load(file.path)) {
+                index.ids()?.let { indexed.addAll(it) }
+                Log.d(TAG, "Loaded ${indexed.size} genre vectors")
+            }
+        }
+    }
+
+    /** Indexes the songs not indexed yet; all-zero vectors (no genre known) are left out. */
+    @Synchronized
+    fun index(songIds: List<String>, genreVectors: List<FloatArray>) {
+        val index = index ?: return
+        val dim = GenreTaxonomy.GENRE_COUNT
+        val added = ArrayList<String>()
+        val packed = ArrayList<FloatArray>()
+        for (i in songIds.indices) {
+            val id = songIds[i]
+            if (id in indexed || !GenreTaxonomy.isNonZero(genreVectors[i])) continue
+            indexed.add(id)
+            added.add(id)
+            packed.add(genreVectors[i])
+        }
+        if (added.isEmpty()) return
+
+        val vectors = FloatArray(added.size * dim)
+        for ((i, vec) in packed.withIndex()) {
+            vec.copyInto(vectors, i * dim, 0, dim.coerceAtMost(vec.size))
+        }
+        if (!index.add(added, vectors)) {
+            // Full: the rest stay unindexed and are simply never filtered out
+            Log.w(TAG, "Genre index full at ${index.size()} songs")
+            indexed.removeAll(added.toSet())
+            index.ids()?.let { indexed.addAll(it) }
+        }
+        scheduleSave()
+    }
+
+    /**
+     * Marks which of [songIds] to keep: the [keep] indexed songs most similar
+     * to [query], plus every song not indexed yet (nothing is known against
+     * them). Null if the index is unavailable.
+     */
+    @Synchronized
+    fun selectSimilar(query: FloatArray, songIds: List<String>, keep: Int): BooleanArray? {
+        val index = index ?: return null
+        val positions = index.searchAmong(query, songIds.toTypedArray(), keep, maxOf(keep, EF_SEARCH))
+            ?: return null
+        val selected = BooleanArray(songIds.size) { songIds[it] !in indexed }
+        for (p in positions) selected[p] = true
+        return selected
+    }
+
+    // Saves once additions settle, rather than after every request
+    private fun scheduleSave() {
+        saveJob?.cancel()
+        saveJob = scope.launch {
+            delay(SAVE_DELAY_MS)
+            if (index?.save(file.path) != true) Log.e(TAG, "Failed to save genre index")
+        }
+    }
+
+    private companion object {
+        const val TAG = "GenreVectorIndex"
+        const val M = NativeVectorIndex.DEFAULT_M
+        const val EF_CONSTRUCTION = NativeVectorIndex.DEFAULT_EF_CONSTRUCTION
+        const val EF_SEARCH = 64
+        const val SAVE_DELAY_MS = 5_000L
+    }
+}
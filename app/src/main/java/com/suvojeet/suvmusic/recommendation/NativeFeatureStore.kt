@@ -0,0 +1,122 @@
+package com.suvojeet.suvmusic.recommendation
+
+/**
+ * Scoring features kept native between recommendation requests, so a
+ * request only sends what changed since the last one instead of the whole
+ * `NUM_FEATURES × N` table.
+ *
+ * [sync] computes each candidate's features in Kotlin as before, but diffs
+ * them against what the native table already holds and uploads only the
+ * changed rows and columns. [score] then sends just the candidates' slots,
+ * the request-dependent features and the weights. At most [MAX_SONGS] songs
+ * stay resident; the least recently synced are dropped beyond that.
+ *
+ * Thread-safe. Create through [NativeRecommendationScorer.createFeatureStore].
+ */
+class NativeFeatureStore internal constructor(
+    private val scorer: NativeRecommendationScorer,
+    private var handle: Long
+) : AutoCloseable {
+
+    companion object {
+        const val MAX_SONGS = 50_000
+        private const val ALL_FEATURES_MASK = (1 shl NativeRecommendationScorer.NUM_FEATURES) - 1
+    }
+
+    private class Row(var slot: Int, val values: FloatArray)
+
+    // Mirror of the native table, in access order for eviction
+    private val rows = LinkedHashMap<String, Row>(256, 0.75f, true)
+
+    /**
+     * Brings the stored features of [songIds] up to date and returns their
+     * slots, or null on failure. [fill] writes the features of song i into
+     * a zeroed row; features that [score] overrides can be left alone.
+     */
+    @Synchronized
+    fun sync(songIds: List<String>, fill: (index: Int, row: FloatArray) -> Unit): IntArray? {
+        if (handle == 0L) return null
+        val numFeatures = NativeRecommendationScorer.NUM_FEATURES
+        val slots = IntArray(songIds.size)
+        val row = FloatArray(numFeatures)
+        // Songs to upload, grouped by which features changed
+        val changes = HashMap<Int, MutableList<Int>>()
+
+        for (i in songIds.indices) {
+            row.fill(0f)
+            fill(i, row)
+            val stored = rows[songIds[i]]
+            var mask = ALL_FEATURES_MASK
+            if (stored != null) {
+                mask = 0
+                for (f in 0 until numFeatures) {
+                    if (stored.values[f] != row[f]) mask = mask or (1 shl f)
+                }
+                row.copyInto(stored.values)
+            } else {
+                rows[songIds[i]] = Row(-1, row.copyOf())
+            }
+            if (mask != 0) changes.getOrPut(mask) { mutableListOf() }.add(i)
+        }
+
+        for ((mask, indices) in changes) {
+            val features = (0 until numFeatures).filter { (mask and (1 shl it)) != 0 }
+            val n = indices.size
+            val values = FloatArray(features.size * n)
+            for ((run, f) in features.withIndex()) {
+                for ((k, i) in indices.withIndex()) values[run * n + k] = rows.getValue(songIds[i]).values[f]
+            }
+            val ids = Array(n) { songIds[indices[it]] }
+            val assigned = scorer.featureStoreUpsert(handle, ids, mask, values) ?: run {
+                // Drop the batch on both sides so the next sync uploads it in full
+                ids.forEach { rows.remove(it) }
+                scorer.featureStoreRemove(handle, ids)
+                return null
+            }
+            for ((k, i) in indices.withIndex()) rows.getValue(songIds[i]).slot = assigned[k]
+        }
+
+        // Also covers repeated IDs, whose later copies found the row unchanged
+        for (i in songIds.indices) slots[i] = rows.getValue(songIds[i]).slot
+        evictOverflow(keep = songIds.size)
+        return slots
+    }
+
+    /**
+     * Top-K positions in [slots] by descending score. [overrides] holds
+     * `slots.size` values for each feature in [overrideMask], in ascending
+     * feature order, and replaces the stored values for this request.
+     */
+    @Synchronized
+    fun score(slots: IntArray, overrideMask: Int, overrides: FloatArray?, weights: FloatArray, topK: Int): IntArray? {
+        if (handle == 0L) return null
+        return scorer.featureStoreScore(handle, slots, overrideMask, overrides, weights, topK)
+    }
+
+    /** Drops [songIds] from the table. */
+    @Synchronized
+    fun remove(songIds: Collection<String>) {
+        if (handle == 0L) return
+        val present = songIds.filter { rows.remove(it) != null }
+        if (present.isNotEmpty()) scorer.featureStoreRemove(handle, present.toTypedArray())
+    }
+
+    // The 'keep' most recently synced rows are the current request's
+    private fun evictOverflow(keep: Int) {
+        val excess = rows.size - maxOf(MAX_SONGS, keep)
+        if (excess <= 0) return
+        val eldest = rows.keys.take(excess)
+        eldest.forEach { rows.remove(it) }
+        scorer.featureStoreRemove(handle, eldest.toTypedArray())
+    }
+
+    @Synchronized
+    override fun close() {
+        val h = handle
+        if (h != 0L) {
+            handle = 0L
+            rows.clear()
+            scorer.releaseFeatureStore(h)
+        }
+    }
+}
@@ -1,6 +1,8 @@
 package com.suvojeet.suvmusic.recommendation
 
 import android.util.Log
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import javax.inject.Inject
 import javax.inject.Singleton
 
@@ -30,6 +32,16 @@ class NativeRecommendationScorer @Inject constructor() {
 
         /** Number of weight values (must match C++ NUM_WEIGHTS) */
         const val NUM_WEIGHTS = 11
+
+        /**
+         * A direct buffer of [count] floats (or ints) in native byte order, as
+         * the `*Direct` calls expect. Allocate once and reuse across calls.
+         */
+        fun allocateBuffer(count: Int): ByteBuffer =
+            ByteBuffer.allocateDirect(count * 4).order(ByteOrder.nativeOrder())
+
+        private fun isUsable(buffer: ByteBuffer, count: Int): Boolean =
+            buffer.isDirect && buffer.order() == ByteOrder.nativeOrder() && buffer.capacity() >= count * 4
     }
 
     @Volatile
@@ -149,6 +161,118 @@ class NativeRecommendationScorer @Inject constructor() {
         }
     }
 
+    /**
+     * Zero-copy variant of [scoreCandidates]: reads features and weights from
+     * direct buffers (see [allocateBuffer]) and writes every score into
+     * [scoresOut] and the top-K indices, as ints, into [topKOut]. Buffers are
+     * used from offset 0 whatever their position. Nothing is allocated on
+     * either side of the call.
+     *
+     * @return Number of indices written (min(topK, numCandidates)), or -1 if
+     *   native is unavailable or a buffer is not direct, native-ordered or large enough.
+     */
+    fun scoreCandidatesDirect(
+        features: ByteBuffer,
+        numCandidates: Int,
+        weights: ByteBuffer,
+        scoresOut: ByteBuffer,
+        topKOut: ByteBuffer,
+        topK: Int
+    ): Int {
+        if (!isAvailable || numCandidates < 0 || topK < 0) return -1
+        if (!isUsable(features, NUM_FEATURES * numCandidates) || !isUsable(weights, NUM_WEIGHTS) ||
+            !isUsable(scoresOut, numCandidates) || !isUsable(topKOut, minOf(topK, numCandidates))
+        ) {
+            Log.e(TAG, "Unusable direct buffers for $numCandidates candidates")
+            return -1
+        }
+
+        return try {
+            nScoreCandidatesDirect(features, numCandidates, weights, scoresOut, topKOut, topK)
+        } catch (e: Exception) {
+            Log.e(TAG, "Native direct scoring failed", e)
+            -1
+        }
+    }
+
+    /**
+     * Zero-copy variant of [cosineSimilarity] over the first [dim] floats of
+     * two direct buffers. Returns 0 if native is unavailable or a buffer is unusable.
+     */
+    fun cosineSimilarityDirect(vecA: ByteBuffer, vecB: ByteBuffer, dim: Int): Float {
+        if (!isAvailable || dim <= 0 || !isUsable(vecA, dim) || !isUsable(vecB, dim)) return 0f
+        return try {
+            nCosineSimilarityDirect(vecA, vecB, dim)
+        } catch (e: Exception) {
+            0f
+        }
+    }
+
+    /**
+     * Zero-copy variant of [batchCosineSimilarity]: [userVector] holds [dim]
+     * floats, [candidateVectors] `numCandidates × dim`, and the similarities
+     * are written into [simsOut].
+     *
+     * @return false if native is unavailable or a buffer is unusable
+     */
+    fun batchCosineSimilarityDirect(
+        userVector: ByteBuffer,
+        candidateVectors: ByteBuffer,
+        numCandidates: Int,
+        dim: Int,
+        simsOut: ByteBuffer
+    ): Boolean {
+        if (!isAvailable || numCandidates < 0 || dim <= 0) return false
+        if (!isUsable(userVector, dim) || !isUsable(candidateVectors, numCandidates * dim) ||
+            !isUsable(simsOut, numCandidates)
+        ) {
+            return false
+        }
+
+        return try {
+            nBatchCosineSimilarityDirect(userVector, candidateVectors, numCandidates, dim, simsOut)
+        } catch (e: Exception) {
+            Log.e(TAG, "Direct batch cosine similarity failed", e)
+            false
+        }
+    }
+
+    /**
+     * Creates a native-resident feature table for repeated scoring of
+     * overlapping candidate sets. Returns null if native is unavailable.
+     * The caller owns the store and must close it.
+     */
+    fun createFeatureStore(): NativeFeatureStore? {
+        if (!isAvailable) return null
+        return try {
+            val handle = nCreateFeatureStore()
+            if (handle != 0L) NativeFeatureStore(this, handle) else null
+        } catch (e: Exception) {
+            Log.e(TAG, "Feature store creation failed", e)
+            null
+        }
+    }
+
+    /**
+     * Creates an empty approximate nearest-neighbour index over [dim]-length
+     * vectors. Returns null if native is unavailable. The caller owns the
+     * index and must close it.
+     */
+    fun createVectorIndex(
+        dim: Int,
+        m: Int = NativeVectorIndex.DEFAULT_M,
+        efConstruction: Int = NativeVectorIndex.DEFAULT_EF_CONSTRUCTION
+    ): NativeVectorIndex? {
+        if (!isAvailable) return null
+        return try {
+            val handle = nCreateVectorIndex(dim, m, efConstruction)
+            if (handle != 0L) NativeVectorIndex(this, handle, dim) else null
+        } catch (e: Exception) {
+            Log.e(TAG, "Vector index creation failed", e)
+            null
+        }
+    }
+
     /**
      * Kotlin fallback for cosine similarity when native is unavailable.
      */
@@ -188,4 +312,119 @@ class NativeRecommendationScorer @Inject constructor() {
         numCandidates: Int,
         dim: Int
     ): FloatArray
+
+    private external fun nScoreCandidatesDirect(
+        features: ByteBuffer,
+        numCandidates: Int,
+        weights: ByteBuffer,
+        scoresOut: ByteBuffer,
+        topKOut: ByteBuffer,
+        topK: Int
+    ): Int
+
+    private external fun nCosineSimilarityDirect(
+        vecA: ByteBuffer,
+        vecB: ByteBuffer,
+        dim: Int
+    ): Float
+
+    private external fun nBatchCosineSimilarityDirect(
+        userVec: ByteBuffer,
+        candidateVecs: ByteBuffer,
+        numCandidates: Int,
+        dim: Int,
+        simsOut: ByteBuffer
+    ): Boolean
+
+    // JNI binds natives by their JVM name, which Kotlin mangles for internal
+    // members, so the natives are private and the handle classes call these.
+    internal fun releaseFeatureStore(handle: Long) = nReleaseFeatureStore(handle)
+
+    internal fun featureStoreUpsert(handle: Long, songIds: Array<String>, columnMask: Int, values: FloatArray): IntArray? =
+        nFeatureStoreUpsert(handle, songIds, columnMask, values)
+
+    internal fun featureStoreRemove(handle: Long, songIds: Array<String>): Int = nFeatureStoreRemove(handle, songIds)
+
+    internal fun featureStoreScore(
+        handle: Long,
+        slots: IntArray,
+        overrideMask: Int,
+        overrides: FloatArray?,
+        weights: FloatArray,
+        topK: Int
+    ): IntArray? = nFeatureStoreScore(handle, slots, overrideMask, overrides, weights, topK)
+
+    private external fun nCreateFeatureStore(): Long
+
+    private external fun nReleaseFeatureStore(handle: Long)
+
+    private external fun nFeatureStoreUpsert(
+        handle: Long,
+        songIds: Array<String>,
+        columnMask: Int,
+        values: FloatArray
+    ): IntArray?
+
+    private external fun nFeatureStoreRemove(handle: Long, songIds: Array<String>): Int
+
+    private external fun nFeatureStoreScore(
+        handle: Long,
+        slots: IntArray,
+        overrideMask: Int,
+        overrides: FloatArray?,
+        weights: FloatArray,
+        topK: Int
+    ): IntArray?
+
+    internal fun releaseVectorIndex(handle: Long) = nReleaseVectorIndex(handle)
+    internal fun vectorIndexAdd(handle: Long, songIds: Array<String>, vectors: FloatArray): Boolean =
+        nVectorIndexAdd(handle, songIds, vectors)
+    internal fun vectorIndexRemove(handle: Long, songIds: Array<String>): Int = nVectorIndexRemove(handle, songIds)
+    internal fun vectorIndexSize(handle: Long): Int = nVectorIndexSize(handle)
+    internal fun vectorIndexIds(handle: Long): Array<String>? = nVectorIndexIds(handle)
+    internal fun vectorIndexSearch(handle: Long, query: FloatArray, topK: Int, ef: Int, simsOut: FloatArray?): Array<String>? =
+        nVectorIndexSearch(handle, query, topK, ef, simsOut)
+    internal fun vectorIndexSearchAmong(
+        handle: Long,
+        query: FloatArray,
+        songIds: Array<String>,
+        topK: Int,
+        ef: Int,
+        simsOut: FloatArray?
+    ): IntArray? = nVectorIndexSearchAmong(handle, query, songIds, topK, ef, simsOut)
+    internal fun vectorIndexSave(handle: Long, path: String): Boolean = nVectorIndexSave(handle, path)
+    internal fun vectorIndexLoad(handle: Long, path: String): Boolean = nVectorIndexLoad(handle, path)
+
+    private external fun nCreateVectorIndex(dim: Int, m: Int, efConstruction: Int): Long
+
+    private external fun nReleaseVectorIndex(handle: Long)
+
+    private external fun nVectorIndexAdd(handle: Long, songIds: Array<String>, vectors: FloatArray): Boolean
+
+    private external fun nVectorIndexRemove(handle: Long, songIds: Array<String>): Int
+
+    private external fun nVectorIndexSize(handle: Long): Int
+
+    private external fun nVectorIndexIds(handle: Long): Array<String>?
+
+    private external fun nVectorIndexSearch(
+        handle: Long,
+        query: FloatArray,
+        topK: Int,
+        ef: Int,
+        simsOut: FloatArray?
+    ): Array<String>?
+
+    private external fun nVectorIndexSearchAmong(
+        handle: Long,
+        query: FloatArray,
+        songIds: Array<String>,
+        topK: Int,
+        ef: Int,
+        simsOut: FloatArray?
+    ): IntArray?
+
+    private external fun nVectorIndexSave(handle: Long, path: String): Boolean
+
+    private external fun nVectorIndexLoad(handle: Long, path: String): Boolean
 }
@@ -0,0 +1,87 @@
+package com.suvojeet.suvmusic.recommendation
+
+/**
+ * Approximate nearest-neighbour index over song vectors (HNSW graph), for
+ * narrowing a large candidate pool to the songs closest to a query vector
+ * before the full scoring pass. Similarity is cosine.
+ *
+ * [searchAmong] costs roughly logarithmically in the index size rather than
+ * linearly in the pool, so it pays off once pools run into the thousands.
+ * [save] and [load] keep the built graph across restarts.
+ *
+ * Thread-safe. Create through [NativeRecommendationScorer.createVectorIndex].
+ */
+class NativeVectorIndex internal constructor(
+    private val scorer: NativeRecommendationScorer,
+    private var handle: Long,
+    val dim: Int
+) : AutoCloseable {
+
+    companion object {
+        const val DEFAULT_M = 16
+        const val DEFAULT_EF_CONSTRUCTION = 100
+    }
+
+    /** Adds songs, or replaces the vectors of ones already indexed. [vectors] is `songIds.size × dim`, packed. */
+    @Synchronized
+    fun add(songIds: List<String>, vectors: FloatArray): Boolean {
+        if (handle == 0L || songIds.isEmpty()) return false
+        return scorer.vectorIndexAdd(handle, songIds.toTypedArray(), vectors)
+    }
+
+    /** Drops [songIds]; returns how many were indexed. */
+    @Synchronized
+    fun remove(songIds: Collection<String>): Int {
+        if (handle == 0L || songIds.isEmpty()) return 0
+        return scorer.vectorIndexRemove(handle, songIds.toTypedArray())
+    }
+
+    @Synchronized
+    fun size(): Int = if (handle == 0L) 0 else scorer.vectorIndexSize(handle)
+
+    /** IDs of every indexed song, or null on failure. */
+    @Synchronized
+    fun ids(): Array<String>? = if (handle == 0L) null else scorer.vectorIndexIds(handle)
+
+    /**
+     * Up to [topK] indexed songs most similar to [query], best first. A wider
+     * [ef] finds the true nearest more often at some cost in time.
+     */
+    @Synchronized
+    fun search(query: FloatArray, topK: Int, ef: Int = topK, simsOut: FloatArray? = null): Array<String>? {
+        if (handle == 0L) return null
+        return scorer.vectorIndexSearch(handle, query, topK, ef, simsOut)
+    }
+
+    /**
+     * Like [search], restricted to [songIds]: returns positions in it, best
+     * first. Songs that are not indexed are never returned.
+     */
+    @Synchronized
+    fun searchAmong(
+        query: FloatArray,
+        songIds: Array<String>,
+        topK: Int,
+        ef: Int = topK,
+        simsOut: FloatArray? = null
+    ): IntArray? {
+        if (handle == 0L) return null
+        return scorer.vectorIndexSearchAmong(handle, query, songIds, topK, ef, simsOut)
+    }
+
+    @Synchronized
+    fun save(path: String): Boolean = handle != 0L && scorer.vectorIndexSave(handle, path)
+
+    /** Replaces the contents with a saved index; false (unchanged) if missing, corrupt or built differently. */
+    @Synchronized
+    fun load(path: String): Boolean = handle != 0L && scorer.vectorIndexLoad(handle, path)
+
+    @Synchronized
+    override fun close() {
+        val h = handle
+        if (h != 0L) {
+            handle = 0L
+            scorer.releaseVectorIndex(h)
+        }
+    }
+}
@@ -22,6 +22,7 @@ import com.suvojeet.suvmusic.core.data.local.dao.DislikedItemDao
 import com.suvojeet.suvmusic.core.data.local.entity.DislikedArtist as DislikedArtistEntity
 import com.suvojeet.suvmusic.core.data.local.entity.DislikedSong as DislikedSongEntity
 import kotlinx.coroutines.launch
+import java.nio.ByteBuffer
 import java.util.Calendar
 import java.util.Collections
 import java.util.concurrent.ConcurrentHashMap
@@ -53,12 +54,19 @@ class RecommendationEngine @Inject constructor(
     private val nativeScorer: NativeRecommendationScorer,
     private val songGenreDao: com.suvojeet.suvmusic.core.data.local.dao.SongGenreDao,
     private val weeklyRecommendations: WeeklyRecommendations,
-    private val dailyMixGenerator: DailyMixGenerator
+    private val dailyMixGenerator: DailyMixGenerator,
+    private val genreIndex: GenreVectorIndex
 ) {
     companion object {
         private const val TAG = "RecommendationEngine"
         /** Max concurrent YouTube API calls to prevent throttling */
         private const val MAX_CONCURRENT_API_CALLS = 5
+        /** Scoring features that depend on the request: time of day (5), variety (6) */
+        private const val REQUEST_FEATURES_MASK = (1 shl 5) or (1 shl 6)
+        /** Pools larger than this are narrowed through [GenreVectorIndex] before scoring */
+        private const val RETRIEVAL_MIN_CANDIDATES = 4000
+        /** Genre-nearest candidates kept by that narrowing */
+        private const val RETRIEVAL_CANDIDATES = 2000
     }
 
     /** Application-scoped coroutine scope with SupervisorJob — survives child failures */
@@ -67,6 +75,11 @@ class RecommendationEngine @Inject constructor(
     /** Semaphore to rate-limit parallel YouTube API calls */
     private val apiSemaphore = Semaphore(MAX_CONCURRENT_API_CALLS)
 
+    private val genreSimBuffers = ThreadLocal.withInitial { GenreSimBuffers() }
+
+    /** Native-resident scoring features; null when the native scorer is unavailable */
+    private val featureStore: NativeFeatureStore? by lazy { nativeScorer.createFeatureStore() }
+
     /**
      * In-memory set of disliked song IDs (synced with DB).
      * Thread-safe: uses ConcurrentHashMap-backed set.
@@ -983,9 +996,9 @@ class RecommendationEngine @Inject constructor(
      * Score and rank candidates using the native SIMD engine (with Kotlin fallback).
      *
      * Pipeline:
-     * 1. Filter disliked songs/artists
+     * 1. Filter disliked songs/artists; narrow large pools to the genre-nearest ([preselectByGenre])
      * 2. Infer genre vectors for each candidate (cached in Room)
-     * 3. Marshal features into SoA FloatArray
+     * 3. Sync changed features into the native feature store
      * 4. Single JNI call to native scorer
      * 5. Unpack top-K indices back to Song list
      *
@@ -994,10 +1007,13 @@ class RecommendationEngine @Inject constructor(
     private suspend fun scoreAndRank(candidates: List<Song>, profile: UserTasteProfile): List<Song> {
         val currentHour = Calendar.getInstance().get(Calendar.HOUR_OF_DAY)
 
-        // Step 1: Filter disliked
-        val filtered = candidates.filter {
-            it.id !in dislikedSongIds && it.artist.lowercase().trim() !in dislikedArtists
-        }
+        // Step 1: Filter disliked, then narrow large pools to the genre-nearest
+        val filtered = preselectByGenre(
+            candidates.filter {
+                it.id !in dislikedSongIds && it.artist.lowercase().trim() !in dislikedArtists
+            },
+            profile
+        )
 
         if (filtered.isEmpty()) return emptyList()
 
@@ -1035,7 +1051,24 @@ class RecommendationEngine @Inject constructor(
     }
 
     /**
-     * Native SIMD scoring path. Marshals features into SoA layout and calls C++.
+     * Keeps the [RETRIEVAL_CANDIDATES] songs whose genres best match the
+     * user's, plus any whose genres are not indexed yet, in their original
+     * order. Small pools and profiles without genre data pass through.
+     */
+    private fun preselectByGenre(candidates: List<Song>, profile: UserTasteProfile): List<Song> {
+        if (candidates.size <= RETRIEVAL_MIN_CANDIDATES || !GenreTaxonomy.isNonZero(profile.genreAffinityVector)) {
+            return candidates
+        }
+        val keep = genreIndex.selectSimilar(
+            profile.genreAffinityVector, candidates.map { it.id }, RETRIEVAL_CANDIDATES
+        ) ?: return candidates
+        return candidates.filterIndexed { i, _ -> keep[i] }
+    }
+
+    /**
+     * Native SIMD scoring path. Per-song features live in [featureStore] between
+     * requests; only those that changed are uploaded, and the request sends the
+     * features that depend on it (time of day, variety) alongside the weights.
      */
     private fun scoreWithNative(
         candidates: List<Song>,
@@ -1046,43 +1079,42 @@ class RecommendationEngine @Inject constructor(
         recentGenreSims: FloatArray,
         skipGenreSims: FloatArray
     ): List<Song>? {
+        val store = featureStore ?: return null
         val N = candidates.size
-        val numFeatures = NativeRecommendationScorer.NUM_FEATURES
 
-        // Marshal features into SoA (column-major) FloatArray
-        val features = FloatArray(numFeatures * N)
-
-        for (i in 0 until N) {
+        val slots = store.sync(candidates.map { it.id }) { i, row ->
             val song = candidates[i]
             val artistKey = song.artist.trim().lowercase()
 
             // Feature 0: Artist affinity
-            features[0 * N + i] = profile.artistAffinities[artistKey] ?: 0f
+            row[0] = profile.artistAffinities[artistKey] ?: 0f
             // Feature 1: Freshness (1 = not recently played)
-            features[1 * N + i] = if (song.id in profile.recentSongIds) 0f else 1f
+            row[1] = if (song.id in profile.recentSongIds) 0f else 1f
             // Feature 2: Skip flag
-            features[2 * N + i] = if (song.id in profile.frequentlySkippedIds) 1f else 0f
+            row[2] = if (song.id in profile.frequentlySkippedIds) 1f else 0f
             // Feature 3: Liked song
-            features[3 * N + i] = if (song.id in profile.likedSongIds) 1f else 0f
+            row[3] = if (song.id in profile.likedSongIds) 1f else 0f
             // Feature 4: Liked artist
-            features[4 * N + i] = if (artistKey in profile.likedArtists) 1f else 0f
-            // Feature 5: Time-of-day weight
-            features[5 * N + i] = profile.timeOfDayWeights[currentHour] ?: 0.5f
-            // Feature 6: Variety penalty
-            features[6 * N + i] = varietyPenalties[i]
+            row[4] = if (artistKey in profile.likedArtists) 1f else 0f
+            // Features 5 and 6 are per request (below)
             // Feature 7: Genre similarity
-            features[7 * N + i] = genreSims[i]
+            row[7] = genreSims[i]
             // Feature 8: Recent genre similarity
-            features[8 * N + i] = recentGenreSims[i]
+            row[8] = recentGenreSims[i]
             // Feature 9: Skip genre penalty
-            features[9 * N + i] = skipGenreSims[i]
+            row[9] = skipGenreSims[i]
             // Feature 10: Reserved
-            features[10 * N + i] = 0f
-        }
+        } ?: return null
+
+        // Feature 5: Time-of-day weight; feature 6: variety penalty
+        val overrides = FloatArray(2 * N)
+        overrides.fill(profile.timeOfDayWeights[currentHour] ?: 0.5f, 0, N)
+        varietyPenalties.copyInto(overrides, N)
 
-        val topIndices = nativeScorer.scoreCandidates(
-            features = features,
-            numCandidates = N,
+        val topIndices = store.score(
+            slots = slots,
+            overrideMask = REQUEST_FEATURES_MASK,
+            overrides = overrides,
             weights = scoringWeights,
             topK = N // Return all, sorted
         ) ?: return null
@@ -1151,7 +1183,7 @@ class RecommendationEngine @Inject constructor(
         }
 
         // Build candidate genre vectors (infer missing, cache them)
-        val candidateVectors = FloatArray(N * dim)
+        val genreVectors = ArrayList<FloatArray>(N)
         val newGenres = mutableListOf<com.suvojeet.suvmusic.core.data.local.entity.SongGenre>()
 
         for (i in 0 until N) {
@@ -1166,31 +1198,61 @@ class RecommendationEngine @Inject constructor(
                 }
                 inferred
             }
-            // Pack into contiguous array for batch operation
-            System.arraycopy(genreVec, 0, candidateVectors, i * dim, dim.coerceAtMost(genreVec.size))
+            genreVectors.add(genreVec)
         }
 
         // Persist newly inferred genres
         if (newGenres.isNotEmpty()) {
             try { songGenreDao.insertGenres(newGenres) } catch (_: Exception) { }
         }
+        genreIndex.index(songIds, genreVectors)
 
-        // Try native batch cosine similarity
-        val nativeSims = nativeScorer.batchCosineSimilarity(targetVector, candidateVectors, N)
-        if (nativeSims != null && nativeSims.size == N) {
-            return nativeSims
+        // Try native batch cosine similarity, packed straight into reused direct buffers
+        // (no suspension from here on, so the thread's buffers stay ours)
+        if (nativeScorer.isNativeAvailable()) {
+            val buffers = genreSimBuffers.get()!!.ensure(N, dim)
+            val target = buffers.target.asFloatBuffer()
+            target.put(targetVector, 0, dim.coerceAtMost(targetVector.size))
+            repeat(dim - target.position()) { target.put(0f) }
+            val packed = buffers.vectors.asFloatBuffer()
+            for (vec in genreVectors) {
+                val length = dim.coerceAtMost(vec.size)
+                packed.put(vec, 0, length)
+                repeat(dim - length) { packed.put(0f) }
+            }
+            if (nativeScorer.batchCosineSimilarityDirect(buffers.target, buffers.vectors, N, dim, buffers.sims)) {
+                val sims = FloatArray(N)
+                buffers.sims.asFloatBuffer().get(sims)
+                return sims
+            }
         }
 
         // Kotlin fallback: compute individually
         val sims = FloatArray(N)
         for (i in 0 until N) {
-            val startIdx = i * dim
-            val vec = candidateVectors.copyOfRange(startIdx, startIdx + dim)
+            val vec = FloatArray(dim)
+            genreVectors[i].copyInto(vec, endIndex = dim.coerceAtMost(genreVectors[i].size))
             sims[i] = nativeScorer.cosineSimilarity(targetVector, vec)
         }
         return sims
     }
 
+    /** Direct buffers for [computeGenreSimilarities], grown as needed and reused per thread */
+    private class GenreSimBuffers {
+        var target: ByteBuffer = NativeRecommendationScorer.allocateBuffer(0)
+        var vectors: ByteBuffer = NativeRecommendationScorer.allocateBuffer(0)
+        var sims: ByteBuffer = NativeRecommendationScorer.allocateBuffer(0)
+
+        fun ensure(numCandidates: Int, dim: Int): GenreSimBuffers {
+            if (target.capacity() < dim * 4) target = NativeRecommendationScorer.allocateBuffer(dim)
+            if (vectors.capacity() < numCandidates * dim * 4) {
+                vectors = NativeRecommendationScorer.allocateBuffer(numCandidates * dim)
+            }
+            if (sims.capacity() < numCandidates * 4) sims = NativeRecommendationScorer.allocateBuffer(numCandidates)
+            return this
+        }
+    }
+
     // ============================================================================================
     // PRIVATE — Section Generators
     // ============================================================================================
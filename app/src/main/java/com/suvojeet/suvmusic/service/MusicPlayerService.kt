@@ -81,9 +81,15 @@ class MusicPlayerService : MediaLibraryService() {
     @Inject
     lateinit var spatialAudioProcessor: com.suvojeet.suvmusic.player.SpatialAudioProcessor
 
+    @Inject
+    lateinit var timeStretchAudioProcessor: com.suvojeet.suvmusic.player.TimeStretchAudioProcessor
+
     @Inject
     lateinit var loudnessAnalyzer: com.suvojeet.suvmusic.player.LoudnessAnalyzer
 
+    @Inject
+    lateinit var loudnessScanner: com.suvojeet.suvmusic.player.LoudnessScanner
+
     @Inject
     lateinit var sleepTimerManager: com.suvojeet.suvmusic.player.SleepTimerManager
 
@@ -233,7 +239,9 @@ class MusicPlayerService : MediaLibraryService() {
             .build()
             
         val audioSink = androidx.media3.exoplayer.audio.DefaultAudioSink.Builder(this)
-            .setAudioProcessors(arrayOf(spatialAudioProcessor))
+            .setAudioProcessorChain(
+                com.suvojeet.suvmusic.player.NativeAudioProcessorChain(spatialAudioProcessor, timeStretchAudioProcessor)
+            )
             .build()
 
         val renderersFactory = object : androidx.media3.exoplayer.DefaultRenderersFactory(this) {
@@ -344,7 +352,7 @@ class MusicPlayerService : MediaLibraryService() {
 
                     // Re-apply per-track normalization gain on every song
                     // change. The Spotify-style normalization caches a
-                    // measured RMS per song and we must update the
+                    // measured loudness (LUFS) per song and we must update the
                     // limiter's makeup gain when the track flips.
                     serviceScope.launch {
                         val normEnabled = sessionManager.volumeNormalizationEnabledFlow.first()
@@ -691,6 +699,14 @@ class MusicPlayerService : MediaLibraryService() {
             }
         }
 
+        // Measure new downloads offline so their first play is already
+        // normalized. Only files missing from the index are scanned.
+        serviceScope.launch {
+            downloadRepository.downloadedSongs.collect { songs ->
+                loudnessScanner.scanSongs(songs)
+            }
+        }
+
         // Spatial strength → SpatialAudioProcessor crossfeed + spatial sweep.
         serviceScope.launch {
             sessionManager.spatialAudioStrengthFlow.collect { value ->